@@ -4,11 +4,14 @@
 #include "pico/time.h"
 #include "hardware/gpio.h"
 #include "dynamixel/dynamixel.h"
+#include "dynamixel/dynamixel_transport.h"
 #include "util/analyze_packet.h"
 #include "pico_communicator/pico_communicator.h"
+#include "dynamixel_lock.h"
+#include "dynamixel_protocol.h"
 
 
-// 同じGPIOピン、UARTインスタンスを使わないように記録する
+// 同じGPIOピン、UARTインスタンスを使わないように記録する(dynamixel_lock_device_table()で保護する)
 #define MAX_GPIO_NUM 40
 #define MAX_UART_NUM 10
 static size_t gpio_use_count[MAX_GPIO_NUM] = {0};
@@ -26,24 +29,204 @@ static dynamixel_baud_rate DYNAMIXEL_BAUD_RATE_LIST[DYNAMIXEL_BAUD_RATE_NUM] = {
     DYNAMIXEL_BAUD_RATE_4M
 };
 
+/// Return Delay Timeのデフォルト値[micro sec.](XL330の初期値)
+#define RETURN_DELAY_TIME_DEFAULT 500
+/// UARTで1Byte送るのに必要なビット数(スタートビット、データ8bit、ストップビット)
+#define UART_BITS_PER_BYTE 10
+
+/// 受信中に次のデータを待つ時間を何Byte分の送信時間にするか(割り込みで受信する場合のFIFOの閾値とタイムアウトを含む)
+#define INTER_BYTE_TIMEOUT_BYTES 8
+
+/// 応答時間の推定値の更新に使う係数(RFC 6298と同じ、SRTTは1/8、RTTVARは1/4ずつ更新する)
+#define RTT_ALPHA_SHIFT 3
+#define RTT_BETA_SHIFT 2
+/// 待ち時間をSRTT + RTT_K * RTTVARとする
+#define RTT_K 4
+
+/// 受信したデータを読み込んだ時刻を記録する数(ヘッダーのサイズ)
+#define READ_TIME_NUM 4
+/// 応答がなかったときに待ち時間を2倍にする回数の上限
+#define RTT_BACKOFF_SHIFT_MAX 3
+
 /// iterative_countのデフォルト値を設定するマクロ
 #define ITERATIVE_COUNT_DEFAULT(c) ((c) == 0 ? 5 : (c))
 
 
+/**
+ * @brief IDごとの応答時間の推定値
+ *
+ * 整数で計算するため、srttは2^RTT_ALPHA_SHIFT倍、rttvarは2^RTT_BETA_SHIFT倍した値を持つ
+*/
+typedef struct
+{
+    uint32_t scaled_srtt;
+    uint32_t scaled_rttvar;
+    bool measured;
+    // 応答がなかったときに待ち時間を2倍にした回数(次に測定したときに0に戻す)
+    uint8_t backoff_shift;
+} rtt_estimate;
+
+
+/**
+ * @brief 受信したデータを読み込んだ時刻
+ *
+ * startに読み込んだデータのreadバッファーでの先頭の位置を持つ
+*/
+typedef struct
+{
+    size_t start;
+    uint64_t us;
+} read_time;
+
+
 typedef struct dynamixel_struct
 {
+    // パケットを送受信する経路
+    dynamixel_transport transport;
+    // dynamixel_createで作成したときに使うUARTインスタンス
     uart_inst_t *uart_id;
+    // UARTとGPIOピンを、このインスタンスで初期化したか(経路を指定して作成したときはfalse)
+    bool owns_uart;
     size_t buffer_size;
     size_t read_size;
     uint8_t *read_buffer;
-    uint8_t *write_buffer;
+    // 送信中に次のパケットを作成できるように、2つのバッファーを交互に使う
+    uint8_t *write_buffer[2];
+    size_t write_buffer_index;
+    // 送信を開始して、まだ完了を確認していないパケットがあるか
+    bool write_pending;
     uint wait_us;
     uint gpio_uart_rx;
     uint gpio_uart_tx;
     dynamixel_baud_rate baud_rate;
+    // IDごとのSecondary ID(グループ表)
+    uint8_t secondary_id[DYNAMIXEL_ID_NUM];
+    // 応答パケットの待ち時間の決め方
+    dynamixel_timeout_model timeout_model;
+    uint timeout_margin_us;
+    // UARTに現在設定しているボーレート
+    uint uart_baud_rate;
+    // IDごとのReturn Delay Time[micro sec.]
+    uint16_t return_delay_time[DYNAMIXEL_ID_NUM];
+    // 応答パケットのサイズを超えて読み込まないか
+    bool stop_at_expected_length;
+    // 受信中の応答パケットのサイズ(分からない場合は0)
+    size_t expected_status_packet_size;
+    // IDごとの応答時間の推定値
+    rtt_estimate rtt[DYNAMIXEL_ID_NUM];
+    uint adaptive_timeout_min_us;
+    uint adaptive_timeout_max_us;
+    // 最後に解析した応答パケットを受信した時刻
+    dynamixel_status_timestamp status_timestamp;
+    bool status_timestamp_valid;
+    // IDごとに最後に解析した応答パケットを受信した時刻(Sync Readなどで続けて届く応答パケットの区別に使う)
+    dynamixel_status_timestamp id_status_timestamp[DYNAMIXEL_ID_NUM];
+    bool id_status_timestamp_valid[DYNAMIXEL_ID_NUM];
+    // インストラクションパケットの送信が完了した時刻
+    uint64_t instruction_us;
+    // 受信中の応答パケットについて、最近読み込んだデータの時刻(古い順)
+    read_time read_time[READ_TIME_NUM];
+    size_t read_time_num;
+    // ヘッダーが見つかった応答パケットについて、ヘッダーの最初の1Byteを読み込んだ時刻
+    uint64_t header_us;
+    bool header_found;
+    // 前の通信で遅れて届いた応答パケットを捨てるか
+    bool response_sequencing;
+    // 応答を待っている間、送信したインストラクションへの応答でないパケットを捨てる
+    bool discard_stale_packet;
+    dynamixel_stale_statistics stale_statistics;
+    // 送受信の状態(dynamixel_poll()で進める)
+    dynamixel_state state;
+    uint8_t packet_id;
+    // インストラクションパケットを送信した通信か(応答時間を記録する)
+    bool packet_sent;
+    // 応答パケットを待つか(待たない通信は、送信が完了したら終わる)
+    bool response_expected;
+    // 応答時間の推定値から計算した待ち時間を使っている
+    bool adaptive_wait;
+    uint first_byte_wait_us;
+    uint inter_byte_wait_us;
+    // 応答パケットを待ち始めた時刻
+    uint64_t wait_start_us;
+    // 最初の1Byteを待つ期限と、次のデータを待つ期限
+    uint64_t first_byte_deadline_us;
+    uint64_t deadline_us;
+    uint32_t first_byte_us;
+    size_t status_packet_size;
+    // 最初の1Byteを受信したときに捨てていた応答パケットの数
+    uint64_t discarded_packets;
+    dynamixel_parse_result packet_result;
+    // 解析結果の保存先
+    uint8_t *packet_error;
+    size_t *packet_status_parameter_size;
+    uint8_t *packet_status_parameter;
+    // dynamixel_start_packet()で始めた通信の解析結果
+    uint8_t status_error;
+    size_t status_parameter_size;
+    uint8_t *status_parameter;
+    // dynamixel_poll()の中で送り直すパケットと、残りの送り直しの回数
+    uint8_t retry_instruction;
+    uint16_t retry_parameter_size;
+    uint8_t *retry_parameter;
+    uint retry_wait_us_multiplier;
+    size_t retry_left;
+    // 応答パケットのパラメータに期待するサイズ(分からない場合は-1)
+    int expected_status_parameter_size;
 } dynamixel_struct;
 
 
+static dynamixel_t create_instance(
+    const dynamixel_transport *transport,
+    dynamixel_baud_rate baud_rate_byte,
+    uint baud_rate,
+    size_t buffer_size,
+    uint wait_us
+);
+static void release_uart(
+    dynamixel_t self
+);
+
+
+/**
+ * @brief GPIOピンとUARTインスタンスが使われていないか確かめ、使うことを記録する
+ *
+ * 確認と記録の間に他のスレッドが同じものを記録しないように、まとめてロックの中で行う
+ *
+ * @retval 0 記録した
+ * @retval 1 既に使われている
+*/
+static int reserve_uart(
+    uart_inst_t *uart_id,
+    uint gpio_uart_rx,
+    uint gpio_uart_tx
+)
+{
+    int result = 1;
+
+    dynamixel_lock_device_table();
+
+    if (uart_use_count >= MAX_UART_NUM)
+        goto unlock;
+    if (gpio_use_count[gpio_uart_rx] > 0 || gpio_use_count[gpio_uart_tx] > 0)
+        goto unlock;
+    for (size_t i = 0; i < uart_use_count; i++)
+    {
+        if (uart_id == uart_use[i])
+            goto unlock;
+    }
+
+    gpio_use_count[gpio_uart_rx]++;
+    gpio_use_count[gpio_uart_tx]++;
+    uart_use[uart_use_count] = uart_id;
+    uart_use_count++;
+    result = 0;
+
+unlock:
+    dynamixel_unlock_device_table();
+    return result;
+}
+
+
 dynamixel_t dynamixel_create(
     uart_inst_t *uart_id,
     uint gpio_uart_rx,
@@ -54,23 +237,19 @@ dynamixel_t dynamixel_create(
 )
 {
     // check device
-    if (gpio_uart_rx > MAX_GPIO_NUM || gpio_uart_tx > MAX_GPIO_NUM)
+    if (gpio_uart_rx >= MAX_GPIO_NUM || gpio_uart_tx >= MAX_GPIO_NUM)
         return NULL;
-    if (uart_use_count > MAX_UART_NUM)
-        return NULL;
-    if (gpio_use_count[gpio_uart_rx] > 0 || gpio_use_count[gpio_uart_tx] > 0)
-        return NULL;
-    for (size_t i = 0; i < uart_use_count; i++)
-    {
-        if (uart_id == uart_use[i])
-            return NULL;
-    }
     dynamixel_baud_rate baud_rate_byte;
     if (get_baud_rate_byte(baud_rate, &baud_rate_byte) == 1)
         return NULL;
+    if (reserve_uart(uart_id, gpio_uart_rx, gpio_uart_tx))
+        return NULL;
 
-    dynamixel_t self = calloc(1, sizeof(dynamixel_struct));
-    self->baud_rate = baud_rate_byte;
+    dynamixel_transport transport;
+    dynamixel_transport_init_uart(&transport, uart_id);
+    dynamixel_t self = create_instance(
+        &transport, baud_rate_byte, baud_rate, buffer_size, wait_us
+    );
 
     uint actual_baud_rate = pico_uart_init(
         uart_id, baud_rate,
@@ -83,22 +262,70 @@ dynamixel_t dynamixel_create(
     // GPIOピンをUART用に設定する
     gpio_set_function(gpio_uart_rx, GPIO_FUNC_UART);
     gpio_set_function(gpio_uart_tx, GPIO_FUNC_UART);
-    gpio_use_count[gpio_uart_rx]++;
-    gpio_use_count[gpio_uart_tx]++;
-    uart_use[uart_use_count] = uart_id;
-    uart_use_count++;
 
     self->uart_id = uart_id;
+    self->owns_uart = true;
     self->gpio_uart_rx = gpio_uart_rx;
     self->gpio_uart_tx = gpio_uart_tx;
+
+    return self;
+}
+
+
+dynamixel_t dynamixel_create_with_transport(
+    const dynamixel_transport *transport,
+    uint baud_rate,
+    size_t buffer_size,
+    uint wait_us
+)
+{
+    dynamixel_baud_rate baud_rate_byte;
+    if (get_baud_rate_byte(baud_rate, &baud_rate_byte) == 1)
+        return NULL;
+
+    return create_instance(
+        transport, baud_rate_byte, baud_rate, buffer_size, wait_us
+    );
+}
+
+
+static dynamixel_t create_instance(
+    const dynamixel_transport *transport,
+    dynamixel_baud_rate baud_rate_byte,
+    uint baud_rate,
+    size_t buffer_size,
+    uint wait_us
+)
+{
+    dynamixel_t self = calloc(1, sizeof(dynamixel_struct));
+
+    self->transport = *transport;
+    self->baud_rate = baud_rate_byte;
     self->buffer_size = buffer_size >= 20 ? buffer_size : 20;
     self->read_size = self->buffer_size / 2;
     self->wait_us = wait_us;
+    memset(self->secondary_id, DYNAMIXEL_SECONDARY_ID_NONE, DYNAMIXEL_ID_NUM);
+    self->timeout_model = DYNAMIXEL_TIMEOUT_MODEL_ADAPTIVE;
+    self->timeout_margin_us = DYNAMIXEL_TIMEOUT_MARGIN_US_DEFAULT;
+    self->adaptive_timeout_min_us = DYNAMIXEL_ADAPTIVE_TIMEOUT_MIN_US_DEFAULT;
+    self->adaptive_timeout_max_us = DYNAMIXEL_ADAPTIVE_TIMEOUT_MAX_US_DEFAULT;
+    self->uart_baud_rate = baud_rate;
+    for (size_t i = 0; i < DYNAMIXEL_ID_NUM; i++)
+        self->return_delay_time[i] = RETURN_DELAY_TIME_DEFAULT;
 
     self->read_buffer = (uint8_t *)calloc(
         self->buffer_size, sizeof(uint8_t)
     );
-    self->write_buffer = (uint8_t *)calloc(
+    for (size_t i = 0; i < 2; i++)
+    {
+        self->write_buffer[i] = (uint8_t *)calloc(
+            self->buffer_size, sizeof(uint8_t)
+        );
+    }
+    self->status_parameter = (uint8_t *)calloc(
+        self->buffer_size, sizeof(uint8_t)
+    );
+    self->retry_parameter = (uint8_t *)calloc(
         self->buffer_size, sizeof(uint8_t)
     );
 
@@ -109,196 +336,527 @@ dynamixel_t dynamixel_create(
 void dynamixel_destroy(
     dynamixel_t self
 )
+{
+    // 送信中のバッファーを解放しないようにする
+    dynamixel_wait_write(self);
+
+    if (self->owns_uart)
+        release_uart(self);
+
+    free(self->read_buffer);
+    free(self->write_buffer[0]);
+    free(self->write_buffer[1]);
+    free(self->status_parameter);
+    free(self->retry_parameter);
+    free(self);
+    self = NULL;
+}
+
+
+size_t dynamixel_get_buffer_size(
+    dynamixel_t self
+)
+{
+    return self->buffer_size;
+}
+
+
+uint64_t dynamixel_get_time_us(
+    dynamixel_t self
+)
+{
+    return self->transport.now_us(self->transport.context);
+}
+
+
+static void release_uart(
+    dynamixel_t self
+)
 {
     // GPIOピンの設定を解除する
     gpio_set_function(self->gpio_uart_rx, GPIO_FUNC_NULL);
     gpio_set_function(self->gpio_uart_tx, GPIO_FUNC_NULL);
+    // UARTの設定を解除する
+    pico_uart_deinit(self->uart_id);
+
+    dynamixel_lock_device_table();
     if (gpio_use_count[self->gpio_uart_rx] > 0)
         gpio_use_count[self->gpio_uart_rx]--;
     if (gpio_use_count[self->gpio_uart_tx] > 0)
         gpio_use_count[self->gpio_uart_tx]--;
 
-    // UARTの設定を解除する
-    pico_uart_deinit(self->uart_id);
     if (uart_use_count > 0)
     {
         for (size_t i = 0; i < uart_use_count; i++)
         {
             if (self->uart_id == uart_use[i])
             {
-                uart_use[i] = NULL;
+                // 最後の記録で埋めて、記録を詰めたままにする
                 uart_use_count--;
+                uart_use[i] = uart_use[uart_use_count];
+                uart_use[uart_use_count] = NULL;
                 break;
             }
         }
 
     }
-
-    free(self->read_buffer);
-    free(self->write_buffer);
-    free(self);
-    self = NULL;
+    dynamixel_unlock_device_table();
 }
 
 
-dynamixel_parse_result dynamixel_configure(
+void dynamixel_set_timeout_model(
     dynamixel_t self,
-    uint8_t id,
-    uint8_t *error,
-    uint16_t return_delay_time,
-    dynamixel_operating_mode operating_mode,
-    uint wait_us_multiplier,
-    size_t iterative_count
+    dynamixel_timeout_model timeout_model
 )
 {
-    dynamixel_parse_result result;
-
-    if (wait_us_multiplier == 0 && self->wait_us < 100000)
-    {
-        wait_us_multiplier = ceil(100000 / self->wait_us);
-    }
+    self->timeout_model = timeout_model;
+}
 
-    // TODO: util/pakcet_byte.hで渡された関数をボーレートの分だけループ処理する関数作ったほうが疎結合になる
-    for (size_t i = 0; i < DYNAMIXEL_BAUD_RATE_NUM; i++)
-    {
-        dynamixel_baud_rate baud_rate_byte = DYNAMIXEL_BAUD_RATE_LIST[i];
-        pico_uart_set_baudrate(self->uart_id, get_baud_rate(baud_rate_byte));
 
-        result = dynamixel_send_ping(
-            self, id, error, NULL, NULL, wait_us_multiplier
-        );
+void dynamixel_set_timeout_margin_us(
+    dynamixel_t self,
+    uint margin_us
+)
+{
+    self->timeout_margin_us = margin_us;
+}
 
-        if (result == DYNAMIXEL_PARSE_SUCCESS)
-        {
-            result = dynamixel_send_write_torque_enable(
-                self, id, error, false, wait_us_multiplier, iterative_count
-            );
-            if (result != DYNAMIXEL_PARSE_SUCCESS)
-                break;
 
-            // Dynamixelのボーレートに合わせた状態でボーレートを変える
-            result = dynamixel_send_write_baud_rate(
-                self, id, error, self->baud_rate, wait_us_multiplier, iterative_count
-            );
-            break;
-        }
-    }
+uint dynamixel_get_response_timeout_us(
+    dynamixel_t self,
+    uint8_t id,
+    size_t packet_size,
+    size_t status_packet_size
+)
+{
+    uint64_t transfer_bits;
+    uint transfer_us;
+    uint return_delay_time = RETURN_DELAY_TIME_DEFAULT;
 
-    pico_uart_set_baudrate(self->uart_id, get_baud_rate(self->baud_rate));
-    if (result != DYNAMIXEL_PARSE_SUCCESS)
-        return result;
+    transfer_bits = (uint64_t)(packet_size + status_packet_size) * UART_BITS_PER_BYTE;
+    // 切り上げる
+    transfer_us = (transfer_bits * 1000000 + self->uart_baud_rate - 1) / self->uart_baud_rate;
 
-    result = dynamixel_send_write_return_delay_time(
-        self, id, error, return_delay_time, wait_us_multiplier, iterative_count
-    );
+    if (id <= DYNAMIXEL_MAX_ID)
+        return_delay_time = self->return_delay_time[id];
 
-    if (result != DYNAMIXEL_PARSE_SUCCESS)
-        return result;
+    return transfer_us + return_delay_time + self->timeout_margin_us;
+}
 
-    result = dynamixel_send_write_operating_mode(
-        self, id, error, operating_mode, wait_us_multiplier, iterative_count
-    );
 
-    return result;
+void dynamixel_set_adaptive_timeout_range_us(
+    dynamixel_t self,
+    uint min_us,
+    uint max_us
+)
+{
+    self->adaptive_timeout_min_us = min_us;
+    self->adaptive_timeout_max_us = max_us;
 }
 
 
-dynamixel_parse_result dynamixel_send_ping(
+int dynamixel_get_rtt_estimate(
     dynamixel_t self,
     uint8_t id,
-    uint8_t *error,
-    uint16_t *dynamixel_model_no,
-    uint8_t *dynamixel_version_of_firmware,
-    uint wait_us_multiplier
+    uint *srtt_us,
+    uint *rttvar_us
 )
 {
-    dynamixel_parse_result result;
-    size_t parameter_size;
-    uint8_t *parameter = (uint8_t *)calloc(self->buffer_size, sizeof(uint8_t));
+    if (id > DYNAMIXEL_MAX_ID || !self->rtt[id].measured)
+        return 1;
 
-    result = dynamixel_send_packet(
-        self, id, DYNAMIXEL__INSTRUCTION_PING, 0, NULL,
-        error, &parameter_size, parameter, wait_us_multiplier
-    );
+    if (srtt_us)
+        *srtt_us = self->rtt[id].scaled_srtt >> RTT_ALPHA_SHIFT;
+    if (rttvar_us)
+        *rttvar_us = self->rtt[id].scaled_rttvar >> RTT_BETA_SHIFT;
 
-    if (result == DYNAMIXEL_PARSE_SUCCESS)
-    {
-        if (parameter_size == 3)
-        {
-            if (dynamixel_model_no)
-                *dynamixel_model_no = combine_byte_pair(parameter[0], parameter[1]);
-            if (dynamixel_version_of_firmware)
-                *dynamixel_version_of_firmware = parameter[2];
-        }
-        else
-        {
-            result = DYNAMIXEL_PARSE_WRONG_PARAMETER;
-        }
-    }
+    return 0;
+}
 
-    free(parameter);
-    return result;
+
+int dynamixel_get_status_timestamp(
+    dynamixel_t self,
+    dynamixel_status_timestamp *timestamp
+)
+{
+    if (!self->status_timestamp_valid)
+        return 1;
+
+    *timestamp = self->status_timestamp;
+    return 0;
 }
 
 
-dynamixel_parse_result dynamixel_send_read_once(
+int dynamixel_get_status_timestamp_of_id(
     dynamixel_t self,
     uint8_t id,
-    uint16_t start_address,
-    uint16_t data_size,
-    uint8_t *error,
-    uint8_t *data,
-    uint wait_us_multiplier
+    dynamixel_status_timestamp *timestamp
 )
 {
-    dynamixel_parse_result result;
-    size_t parameter_size, status_parameter_size;
-    uint8_t parameter[4];
-
-    // 開始アドレス
-    divide_into_byte_pair(start_address, parameter, parameter + 1);
-    // バイトサイズ
-    divide_into_byte_pair(data_size, parameter + 2, parameter + 3);
+    if (id > DYNAMIXEL_MAX_ID || !self->id_status_timestamp_valid[id])
+        return 1;
 
-    result = dynamixel_send_packet(
-        self, id, DYNAMIXEL__INSTRUCTION_READ, 4, parameter,
-        error, &status_parameter_size, data, wait_us_multiplier
-    );
+    *timestamp = self->id_status_timestamp[id];
+    return 0;
+}
 
-    // 応答パケットのパラメータサイズは、インストラクションで指定したデータサイズと等しい必要がある
-    if (result == DYNAMIXEL_PARSE_SUCCESS && status_parameter_size != data_size)
-        result = DYNAMIXEL_PARSE_WRONG_PARAMETER;
 
-    return result;
+void dynamixel_reset_rtt_estimate(
+    dynamixel_t self,
+    uint8_t id
+)
+{
+    if (id <= DYNAMIXEL_MAX_ID)
+        memset(&self->rtt[id], 0, sizeof(rtt_estimate));
 }
 
-dynamixel_parse_result dynamixel_send_read(
+
+/**
+ * @brief 測定した応答時間で推定値を更新する(RFC 6298)
+*/
+static void update_rtt_estimate(
     dynamixel_t self,
     uint8_t id,
-    uint16_t start_address,
-    uint16_t data_size,
-    uint8_t *error,
-    uint8_t *data,
-    uint wait_us_multiplier,
-    size_t iterative_count
+    uint32_t rtt_us
 )
 {
-    dynamixel_parse_result result;
+    rtt_estimate *rtt = &self->rtt[id];
+    int32_t delta;
 
-    iterative_count = ITERATIVE_COUNT_DEFAULT(iterative_count);
+    // 応答が返ってきたので、2倍にした待ち時間を元に戻す
+    rtt->backoff_shift = 0;
 
-    for (size_t i = 0; i < iterative_count; i++)
+    if (!rtt->measured)
     {
-        result = dynamixel_send_read_once(
-            self, id, start_address, data_size,
-            error, data, wait_us_multiplier
-        );
-
-        if (result == DYNAMIXEL_PARSE_SUCCESS)
-            break;
+        // 最初の測定値はSRTT = R、RTTVAR = R / 2とする
+        rtt->scaled_srtt = rtt_us << RTT_ALPHA_SHIFT;
+        rtt->scaled_rttvar = (rtt_us << RTT_BETA_SHIFT) / 2;
+        rtt->measured = true;
+        return;
     }
 
-    return result;
+    // RTTVAR = (1 - 1/4) * RTTVAR + 1/4 * |SRTT - R|
+    delta = (int32_t)rtt_us - (int32_t)(rtt->scaled_srtt >> RTT_ALPHA_SHIFT);
+    if (delta < 0)
+        delta = -delta;
+    rtt->scaled_rttvar += delta - (rtt->scaled_rttvar >> RTT_BETA_SHIFT);
+
+    // SRTT = (1 - 1/8) * SRTT + 1/8 * R
+    rtt->scaled_srtt += rtt_us - (rtt->scaled_srtt >> RTT_ALPHA_SHIFT);
+}
+
+
+/**
+ * @brief 応答が返ってこなかったので、次の待ち時間を2倍にする(RFC 6298 5.5)
+*/
+static void back_off_rtt_estimate(
+    dynamixel_t self,
+    uint8_t id
+)
+{
+    rtt_estimate *rtt = &self->rtt[id];
+
+    if (rtt->measured && rtt->backoff_shift < RTT_BACKOFF_SHIFT_MAX)
+        rtt->backoff_shift++;
+}
+
+
+/**
+ * @brief 応答時間の推定値から最初の1Byteの待ち時間を計算する
+ *
+ * (SRTT + K * RTTVAR + 余裕)を下限以上にしてから応答がなかった回数だけ2倍にし、上限以下にする。
+ * ただし、Return Delay Timeと1Byteの受信時間より短くはしない
+ *
+ * @retval 0 計算した
+ * @retval 1 まだ応答時間を測定していない
+*/
+static int get_adaptive_timeout_us(
+    dynamixel_t self,
+    uint8_t id,
+    uint *timeout_us
+)
+{
+    uint srtt_us, rttvar_us, min_window_us;
+    uint64_t adaptive_timeout_us;
+
+    if (dynamixel_get_rtt_estimate(self, id, &srtt_us, &rttvar_us))
+        return 1;
+
+    adaptive_timeout_us = (uint64_t)srtt_us + RTT_K * rttvar_us + self->timeout_margin_us;
+    if (adaptive_timeout_us < self->adaptive_timeout_min_us)
+        adaptive_timeout_us = self->adaptive_timeout_min_us;
+    adaptive_timeout_us <<= self->rtt[id].backoff_shift;
+    if (adaptive_timeout_us > self->adaptive_timeout_max_us)
+        adaptive_timeout_us = self->adaptive_timeout_max_us;
+
+    // 最初の1Byteが届くまでの最短の時間
+    min_window_us = dynamixel_get_response_timeout_us(self, id, 0, 1);
+    if (adaptive_timeout_us < min_window_us)
+        adaptive_timeout_us = min_window_us;
+
+    *timeout_us = adaptive_timeout_us;
+    return 0;
+}
+
+
+uint dynamixel_get_inter_byte_timeout_us(
+    dynamixel_t self
+)
+{
+    uint64_t transfer_bits = INTER_BYTE_TIMEOUT_BYTES * UART_BITS_PER_BYTE;
+
+    return (transfer_bits * 1000000 + self->uart_baud_rate - 1) / self->uart_baud_rate
+        + self->timeout_margin_us;
+}
+
+
+void dynamixel_set_stop_at_expected_length(
+    dynamixel_t self,
+    bool enabled
+)
+{
+    self->stop_at_expected_length = enabled;
+}
+
+
+void dynamixel_set_response_sequencing(
+    dynamixel_t self,
+    bool enabled
+)
+{
+    self->response_sequencing = enabled;
+}
+
+
+void dynamixel_get_stale_statistics(
+    dynamixel_t self,
+    dynamixel_stale_statistics *statistics
+)
+{
+    *statistics = self->stale_statistics;
+}
+
+
+/**
+ * @brief wait_us_multiplierを指定したときの待ち時間を返す
+*/
+static uint get_fixed_wait_us(
+    dynamixel_t self,
+    uint wait_us_multiplier
+)
+{
+    if (wait_us_multiplier)
+        return wait_us_multiplier * self->wait_us;
+
+    return self->wait_us;
+}
+
+
+/**
+ * @brief インストラクションから応答パケットのサイズを見積もる
+ *
+ * Sync Read、Bulk Readでは、最初に応答するIDの応答パケットのサイズとする
+*/
+static size_t get_expected_status_packet_size(
+    uint8_t id,
+    uint8_t instruction,
+    uint16_t parameter_size,
+    const uint8_t *parameter
+)
+{
+    size_t status_packet_size = DYNAMIXEL_STATUS_PACKET_OVERHEAD;
+    uint8_t response_id;
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_PING)
+        // モデル番号(2) + ファームウェアのバージョン(1)
+        status_packet_size += 3;
+    else if (instruction == DYNAMIXEL__INSTRUCTION_READ && parameter_size >= 4)
+        status_packet_size += combine_byte_pair(parameter[2], parameter[3]);
+    else if (
+        (instruction == DYNAMIXEL__INSTRUCTION_SYNC_READ || instruction == DYNAMIXEL__INSTRUCTION_BULK_READ)
+        && dynamixel_count_response(id, instruction, parameter_size) > 0
+    )
+        status_packet_size += dynamixel_get_response(id, instruction, parameter, 0, &response_id);
+
+    return status_packet_size;
+}
+
+
+static void set_uart_baud_rate(
+    dynamixel_t self,
+    uint baud_rate
+)
+{
+    self->transport.set_baud(self->transport.context, baud_rate);
+    self->uart_baud_rate = baud_rate;
+}
+
+
+dynamixel_parse_result dynamixel_configure(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t *error,
+    uint16_t return_delay_time,
+    dynamixel_operating_mode operating_mode,
+    uint wait_us_multiplier,
+    size_t iterative_count
+)
+{
+    dynamixel_parse_result result;
+
+    // 他の待ち時間の決め方では、ボーレートを変えるたびに、そのボーレートから計算した待ち時間で待つ
+    if (
+        wait_us_multiplier == 0
+        && self->timeout_model == DYNAMIXEL_TIMEOUT_MODEL_FIXED
+        && self->wait_us < 100000
+    )
+    {
+        wait_us_multiplier = ceil(100000 / self->wait_us);
+    }
+
+    // TODO: util/pakcet_byte.hで渡された関数をボーレートの分だけループ処理する関数作ったほうが疎結合になる
+    for (size_t i = 0; i < DYNAMIXEL_BAUD_RATE_NUM; i++)
+    {
+        dynamixel_baud_rate baud_rate_byte = DYNAMIXEL_BAUD_RATE_LIST[i];
+        set_uart_baud_rate(self, get_baud_rate(baud_rate_byte));
+
+        result = dynamixel_send_ping(
+            self, id, error, NULL, NULL, wait_us_multiplier
+        );
+
+        if (result == DYNAMIXEL_PARSE_SUCCESS)
+        {
+            result = dynamixel_send_write_torque_enable(
+                self, id, error, false, wait_us_multiplier, iterative_count
+            );
+            if (result != DYNAMIXEL_PARSE_SUCCESS)
+                break;
+
+            // Dynamixelのボーレートに合わせた状態でボーレートを変える
+            result = dynamixel_send_write_baud_rate(
+                self, id, error, self->baud_rate, wait_us_multiplier, iterative_count
+            );
+            break;
+        }
+    }
+
+    set_uart_baud_rate(self, get_baud_rate(self->baud_rate));
+    // 違うボーレートで測定した応答時間を使わない
+    dynamixel_reset_rtt_estimate(self, id);
+    if (result != DYNAMIXEL_PARSE_SUCCESS)
+        return result;
+
+    result = dynamixel_send_write_return_delay_time(
+        self, id, error, return_delay_time, wait_us_multiplier, iterative_count
+    );
+
+    if (result != DYNAMIXEL_PARSE_SUCCESS)
+        return result;
+
+    result = dynamixel_send_write_operating_mode(
+        self, id, error, operating_mode, wait_us_multiplier, iterative_count
+    );
+
+    return result;
+}
+
+
+dynamixel_parse_result dynamixel_send_ping(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t *error,
+    uint16_t *dynamixel_model_no,
+    uint8_t *dynamixel_version_of_firmware,
+    uint wait_us_multiplier
+)
+{
+    dynamixel_parse_result result;
+    size_t parameter_size;
+    uint8_t *parameter = (uint8_t *)calloc(self->buffer_size, sizeof(uint8_t));
+
+    result = dynamixel_send_packet(
+        self, id, DYNAMIXEL__INSTRUCTION_PING, 0, NULL,
+        error, &parameter_size, parameter, wait_us_multiplier
+    );
+
+    if (result == DYNAMIXEL_PARSE_SUCCESS)
+    {
+        if (parameter_size == 3)
+        {
+            if (dynamixel_model_no)
+                *dynamixel_model_no = combine_byte_pair(parameter[0], parameter[1]);
+            if (dynamixel_version_of_firmware)
+                *dynamixel_version_of_firmware = parameter[2];
+        }
+        else
+        {
+            result = DYNAMIXEL_PARSE_WRONG_PARAMETER;
+        }
+    }
+
+    free(parameter);
+    return result;
+}
+
+
+dynamixel_parse_result dynamixel_send_read_once(
+    dynamixel_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint8_t *error,
+    uint8_t *data,
+    uint wait_us_multiplier
+)
+{
+    dynamixel_parse_result result;
+    size_t parameter_size, status_parameter_size;
+    uint8_t parameter[4];
+
+    // 開始アドレス
+    divide_into_byte_pair(start_address, parameter, parameter + 1);
+    // バイトサイズ
+    divide_into_byte_pair(data_size, parameter + 2, parameter + 3);
+
+    result = dynamixel_send_packet(
+        self, id, DYNAMIXEL__INSTRUCTION_READ, 4, parameter,
+        error, &status_parameter_size, data, wait_us_multiplier
+    );
+
+    // 応答パケットのパラメータサイズは、インストラクションで指定したデータサイズと等しい必要がある
+    if (result == DYNAMIXEL_PARSE_SUCCESS && status_parameter_size != data_size)
+        result = DYNAMIXEL_PARSE_WRONG_PARAMETER;
+
+    return result;
+}
+
+dynamixel_parse_result dynamixel_send_read(
+    dynamixel_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint8_t *error,
+    uint8_t *data,
+    uint wait_us_multiplier,
+    size_t iterative_count
+)
+{
+    dynamixel_parse_result result;
+
+    iterative_count = ITERATIVE_COUNT_DEFAULT(iterative_count);
+
+    for (size_t i = 0; i < iterative_count; i++)
+    {
+        result = dynamixel_send_read_once(
+            self, id, start_address, data_size,
+            error, data, wait_us_multiplier
+        );
+
+        if (result == DYNAMIXEL_PARSE_SUCCESS)
+            break;
+    }
+
+    return result;
 }
 
 dynamixel_parse_result dynamixel_send_read_torque_enable(
@@ -353,7 +911,7 @@ dynamixel_parse_result dynamixel_send_read_position(
     );
 
     if (result == DYNAMIXEL_PARSE_SUCCESS)
-        *position = 0.088 * combine_signed_4_byte(
+        *position = DYNAMIXEL_POSITION_DEGREE_PER_UNIT * combine_signed_4_byte(
             data[0], data[1], data[2], data[3]
         );
     
@@ -473,7 +1031,15 @@ dynamixel_parse_result dynamixel_send_read_return_delay_time(
     );
 
     if (result == DYNAMIXEL_PARSE_SUCCESS)
+    {
         *return_delay_time = 2 * data[0];
+        // 応答パケットの待ち時間の計算に使う
+        if (id <= DYNAMIXEL_MAX_ID && self->return_delay_time[id] != *return_delay_time)
+        {
+            self->return_delay_time[id] = *return_delay_time;
+            dynamixel_reset_rtt_estimate(self, id);
+        }
+    }
     
     free(data);
     return result;
@@ -575,28 +1141,65 @@ dynamixel_parse_result dynamixel_send_read_baud_rate(
     return result;
 }
 
-
-dynamixel_parse_result dynamixel_send_write_once(
+dynamixel_parse_result dynamixel_send_read_secondary_id(
     dynamixel_t self,
     uint8_t id,
-    uint16_t start_address,
-    uint16_t data_size,
-    const uint8_t *data,
     uint8_t *error,
-    uint wait_us_multiplier
+    uint8_t *secondary_id,
+    uint wait_us_multiplier,
+    size_t iterative_count
 )
 {
     dynamixel_parse_result result;
-    size_t parameter_size, status_parameter_size;
-    uint8_t *parameter, *status_parameter;
+    uint8_t *data;
+    uint16_t start_address, data_size;
 
-    parameter = (uint8_t *)calloc(2 + data_size, sizeof(uint8_t));
-    status_parameter = (uint8_t *)calloc(self->buffer_size, sizeof(uint8_t));
+    start_address = 12;
+    data_size = 1;
+    data = (uint8_t *)calloc(data_size + 2, sizeof(uint8_t));
 
-    // 開始アドレス
-    divide_into_byte_pair(start_address, parameter, parameter + 1);
-    // 書き込みデータ
-    memcpy(parameter + 2, data, data_size);
+    result = dynamixel_send_read(
+        self, id, start_address, data_size,
+        error, data, wait_us_multiplier, iterative_count
+    );
+
+    if (result == DYNAMIXEL_PARSE_SUCCESS)
+    {
+        // 範囲外の値は割り当てなしとして扱う
+        if (data[0] > DYNAMIXEL_MAX_ID)
+            data[0] = DYNAMIXEL_SECONDARY_ID_NONE;
+
+        *secondary_id = data[0];
+        if (id <= DYNAMIXEL_MAX_ID)
+            self->secondary_id[id] = data[0];
+    }
+
+    free(data);
+    return result;
+}
+
+
+dynamixel_parse_result dynamixel_send_write_once(
+    dynamixel_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    const uint8_t *data,
+    uint8_t *error,
+    uint wait_us_multiplier
+)
+{
+    dynamixel_parse_result result;
+    size_t parameter_size, status_parameter_size;
+    uint8_t *parameter, *status_parameter;
+
+    parameter = (uint8_t *)calloc(2 + data_size, sizeof(uint8_t));
+    status_parameter = (uint8_t *)calloc(self->buffer_size, sizeof(uint8_t));
+
+    // 開始アドレス
+    divide_into_byte_pair(start_address, parameter, parameter + 1);
+    // 書き込みデータ
+    memcpy(parameter + 2, data, data_size);
 
     result = dynamixel_send_packet(
         self, id, DYNAMIXEL__INSTRUCTION_WRITE, 2 + data_size, parameter,
@@ -685,7 +1288,7 @@ dynamixel_parse_result dynamixel_send_write_goal_position(
     start_address = 116;
     data_size = 4;
     data = (uint8_t *)calloc(data_size, sizeof(uint8_t));
-    goal_position_int = round(goal_position / 0.088);
+    goal_position_int = round(goal_position / DYNAMIXEL_POSITION_DEGREE_PER_UNIT);
 
     divide_into_4_byte(
         goal_position_int,
@@ -785,11 +1388,27 @@ dynamixel_parse_result dynamixel_send_write_return_delay_time(
     data = (uint8_t *)calloc(data_size, sizeof(uint8_t));
     *data = (return_delay_time + 1) / 2;
 
+    if (id <= DYNAMIXEL_MAX_ID)
+    {
+        // 前のReturn Delay Timeで測定した応答時間は使わない。
+        // 書き込みへの応答が新しいReturn Delay Timeで返ってきてもよいように、長い方で待つ
+        dynamixel_reset_rtt_estimate(self, id);
+        if (self->return_delay_time[id] < 2 * *data)
+            self->return_delay_time[id] = 2 * *data;
+    }
+
     result = dynamixel_send_write(
         self, id, start_address, data_size, data,
         error, wait_us_multiplier, iterative_count
     );
 
+    // 応答パケットの待ち時間の計算に使う
+    if (result == DYNAMIXEL_PARSE_SUCCESS && id <= DYNAMIXEL_MAX_ID)
+    {
+        self->return_delay_time[id] = 2 * *data;
+        dynamixel_reset_rtt_estimate(self, id);
+    }
+
     free(data);
     return result;
 }
@@ -884,6 +1503,116 @@ dynamixel_parse_result dynamixel_send_write_baud_rate(
     return result;
 }
 
+dynamixel_parse_result dynamixel_send_write_secondary_id(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t *error,
+    uint8_t secondary_id,
+    uint wait_us_multiplier,
+    size_t iterative_count
+)
+{
+    dynamixel_parse_result result;
+    uint8_t *data;
+    uint16_t start_address, data_size;
+
+    if (
+        secondary_id > DYNAMIXEL_MAX_ID
+        && secondary_id != DYNAMIXEL_SECONDARY_ID_NONE
+    )
+        return DYNAMIXEL_PARSE_WRONG_WRITE_PARAMETER;
+
+    start_address = 12;
+    data_size = 1;
+    data = (uint8_t *)calloc(data_size, sizeof(uint8_t));
+    *data = secondary_id;
+
+    result = dynamixel_send_write(
+        self, id, start_address, data_size, data,
+        error, wait_us_multiplier, iterative_count
+    );
+
+    if (result == DYNAMIXEL_PARSE_SUCCESS && id <= DYNAMIXEL_MAX_ID)
+        self->secondary_id[id] = secondary_id;
+
+    free(data);
+    return result;
+}
+
+dynamixel_parse_result dynamixel_send_remove_secondary_id(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t *error,
+    uint wait_us_multiplier,
+    size_t iterative_count
+)
+{
+    return dynamixel_send_write_secondary_id(
+        self, id, error, DYNAMIXEL_SECONDARY_ID_NONE,
+        wait_us_multiplier, iterative_count
+    );
+}
+
+
+dynamixel_parse_result dynamixel_send_group_write(
+    dynamixel_t self,
+    uint8_t secondary_id,
+    uint16_t start_address,
+    uint16_t data_size,
+    const uint8_t *data
+)
+{
+    uint8_t *parameter;
+
+    if (secondary_id > DYNAMIXEL_MAX_ID)
+        return DYNAMIXEL_PARSE_WRONG_WRITE_PARAMETER;
+    // パラメータの修正で増える分を含めてwriteバッファーに入りきるか
+    if ((size_t)(DYNAMIXEL_INSTRUCTION_PACKET_OVERHEAD + (2 + data_size) * 4 / 3 + 1) > self->buffer_size)
+        return DYNAMIXEL_PARSE_WRONG_WRITE_PARAMETER;
+
+    parameter = (uint8_t *)calloc(2 + data_size, sizeof(uint8_t));
+
+    // 開始アドレス
+    divide_into_byte_pair(start_address, parameter, parameter + 1);
+    // 書き込みデータ
+    memcpy(parameter + 2, data, data_size);
+
+    // Secondary IDを宛先としたパケットには応答パケットが返ってこない
+    dynamixel_write_uart_packet(
+        self,
+        secondary_id, DYNAMIXEL__INSTRUCTION_WRITE, 2 + data_size, parameter
+    );
+
+    free(parameter);
+    return DYNAMIXEL_PARSE_SUCCESS;
+}
+
+
+size_t dynamixel_get_group_members(
+    dynamixel_t self,
+    uint8_t secondary_id,
+    uint8_t *ids,
+    size_t max_ids
+)
+{
+    size_t member_count = 0;
+
+    if (secondary_id > DYNAMIXEL_MAX_ID)
+        return 0;
+
+    for (size_t i = 0; i <= DYNAMIXEL_MAX_ID; i++)
+    {
+        if (self->secondary_id[i] != secondary_id)
+            continue;
+
+        if (ids && member_count < max_ids)
+            ids[member_count] = i;
+        member_count++;
+    }
+
+    return member_count;
+}
+
 
 dynamixel_parse_result dynamixel_send_reg_write(
     dynamixel_t self,
@@ -990,6 +1719,30 @@ dynamixel_parse_result dynamixel_send_reboot(
 }
 
 
+/**
+ * @brief 受信済みのデータを全て捨てる
+ *
+ * 前の通信で待ち時間を過ぎてから届いた応答パケットを、次の通信の応答として解析しないようにする
+*/
+static void flush_stale_data(
+    dynamixel_t self
+)
+{
+    size_t read_size;
+
+    while (!self->transport.wait_readable(self->transport.context, 0))
+    {
+        read_size = self->transport.read_available(
+            self->transport.context, self->read_buffer, self->buffer_size
+        );
+        if (read_size == 0)
+            break;
+
+        self->stale_statistics.flushed_bytes += read_size;
+    }
+}
+
+
 int dynamixel_write_uart_packet(
     dynamixel_t self,
     uint8_t id,
@@ -999,16 +1752,93 @@ int dynamixel_write_uart_packet(
 )
 {
     size_t packet_size;
+    uint8_t *write_buffer = self->write_buffer[self->write_buffer_index];
 
-    // dynamixel_write_uart_packet
+    // 前のパケットの送信中に、もう一方のバッファーでパケットを作成する
     packet_size = create_uart_packet(
-        self->write_buffer,
+        write_buffer,
         id, instruction, parameter, parameter_size
     );
 
-    return pico_uart_write_blocking(
-        self->uart_id, self->write_buffer, packet_size
-    );
+    if (dynamixel_wait_write(self))
+        return 1;
+
+    if (self->response_sequencing)
+        flush_stale_data(self);
+
+    if (self->transport.write_async(self->transport.context, write_buffer, packet_size))
+        return 1;
+
+    self->instruction_us = self->transport.now_us(self->transport.context);
+    self->write_pending = true;
+    self->write_buffer_index = 1 - self->write_buffer_index;
+    return 0;
+}
+
+
+int dynamixel_wait_write(
+    dynamixel_t self
+)
+{
+    if (!self->write_pending)
+        return 0;
+
+    self->write_pending = false;
+    if (self->transport.wait_write(self->transport.context))
+        return 1;
+
+    self->instruction_us = self->transport.now_us(self->transport.context);
+    return 0;
+}
+
+
+/**
+ * @brief 受信したデータを読み込んだ時刻を記録する
+ *
+ * ヘッダーは4Byteで、見つからない間はreadバッファーの末尾3Byteだけを残すため、
+ * ヘッダーの最初の1Byteは最近READ_TIME_NUM回の読み込みのいずれかに含まれる
+*/
+static void push_read_time(
+    dynamixel_t self,
+    size_t start
+)
+{
+    if (self->read_time_num == READ_TIME_NUM)
+    {
+        memmove(self->read_time, self->read_time + 1, (READ_TIME_NUM - 1) * sizeof(read_time));
+        self->read_time_num--;
+    }
+
+    self->read_time[self->read_time_num].start = start;
+    self->read_time[self->read_time_num].us = self->transport.now_us(self->transport.context);
+    self->read_time_num++;
+}
+
+
+/// readバッファーのデータを前に詰めた分だけ、読み込んだデータの位置をずらす
+static void shift_read_time(
+    dynamixel_t self,
+    size_t shift
+)
+{
+    for (size_t i = 0; i < self->read_time_num; i++)
+        self->read_time[i].start = self->read_time[i].start > shift ? self->read_time[i].start - shift : 0;
+}
+
+
+/// readバッファーの指定した位置のデータを読み込んだ時刻を返す
+static uint64_t find_read_time(
+    dynamixel_t self,
+    size_t position
+)
+{
+    for (size_t i = self->read_time_num; i > 0; i--)
+    {
+        if (self->read_time[i - 1].start <= position)
+            return self->read_time[i - 1].us;
+    }
+
+    return self->read_time[0].us;
 }
 
 
@@ -1018,29 +1848,42 @@ int dynamixel_partial_read_uart_packet(
 )
 {
     size_t status_packet_size = *initial_status_packet_size;
+    size_t read_size = self->read_size;
 
-    for (
-        size_t i = 0;
-        i < self->read_size
-        && status_packet_size < self->buffer_size;
-        i++
+    // readバッファーの残りのサイズを超えて読み込まない
+    if (read_size > self->buffer_size - status_packet_size)
+        read_size = self->buffer_size - status_packet_size;
+    // 応答パケットの残りのサイズを超えて読み込まない
+    if (
+        self->stop_at_expected_length
+        && status_packet_size < self->expected_status_packet_size
+        && read_size > self->expected_status_packet_size - status_packet_size
     )
+        read_size = self->expected_status_packet_size - status_packet_size;
+
+    // 新しい応答パケットの読み込みを始める
+    if (status_packet_size == 0)
     {
-        if(pico_uart_read_raw(
-            self->uart_id,
-            self->read_buffer + status_packet_size
-        ))
-            // 読み取りを行えなかった場合
-            break;
-        else
-            status_packet_size++;
+        self->read_time_num = 0;
+        self->header_found = false;
+    }
+
+    read_size = self->transport.read_available(
+        self->transport.context,
+        self->read_buffer + status_packet_size,
+        read_size
+    );
+    if (read_size > 0)
+    {
+        push_read_time(self, status_packet_size);
+        status_packet_size += read_size;
     }
 
     *initial_status_packet_size = status_packet_size;
 
     if (
         status_packet_size == self->buffer_size
-        && !pico_uart_is_readable(self->uart_id)
+        && !self->transport.wait_readable(self->transport.context, 0)
     )
     {
         // readバッファーが満杯になったが、まだデータが残っている
@@ -1051,6 +1894,54 @@ int dynamixel_partial_read_uart_packet(
 }
 
 
+/**
+ * @brief readバッファーから、解析した応答パケットとその前のデータを取り除く
+*/
+static void remove_packet(
+    dynamixel_t self,
+    int header_position,
+    size_t *status_packet_size
+)
+{
+    // ヘッダー(4) + ID(1) + 長さ(2) + 長さで表すサイズ
+    size_t packet_end = header_position + 7
+        + combine_byte_pair(self->read_buffer[header_position + 5], self->read_buffer[header_position + 6]);
+
+    // 長さが誤っている場合(checksumの誤り)は、受信したデータを全て取り除く
+    if (packet_end > *status_packet_size)
+        packet_end = *status_packet_size;
+
+    *status_packet_size -= packet_end;
+    memmove(self->read_buffer, self->read_buffer + packet_end, *status_packet_size);
+    shift_read_time(self, packet_end);
+}
+
+
+/**
+ * @brief 解析した応答パケットが、送信したインストラクションへの応答でないか判定する
+ *
+ * 応答を待っている間だけ判定する。エラーを返した宛先の応答パケットはパラメーターを含まないことがあるので、サイズでは判定しない
+*/
+static bool is_stale_packet(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t status_id,
+    uint8_t error,
+    size_t status_parameter_size
+)
+{
+    if (!self->discard_stale_packet)
+        return false;
+
+    if (id <= DYNAMIXEL_MAX_ID && status_id != id)
+        return true;
+
+    return error == 0
+        && self->expected_status_packet_size > 0
+        && status_parameter_size + DYNAMIXEL_STATUS_PACKET_OVERHEAD != self->expected_status_packet_size;
+}
+
+
 dynamixel_parse_result dynamixel_partial_uart_packet(
     dynamixel_t self,
     uint8_t id,
@@ -1064,11 +1955,54 @@ dynamixel_parse_result dynamixel_partial_uart_packet(
     int header_position, parse_result;
     size_t status_packet_size = *initial_status_packet_size;
 
-    parse_result = parse_uart_packet(
-        self->read_buffer, status_packet_size,
-        &header_position, &status_id, &status_instruction,
-        error, status_parameter, status_parameter_size
-    );
+    while (1)
+    {
+        parse_result = parse_uart_packet(
+            self->read_buffer, status_packet_size,
+            &header_position, &status_id, &status_instruction,
+            error, status_parameter, status_parameter_size
+        );
+        if (parse_result != 0 || !is_stale_packet(self, id, status_id, *error, *status_parameter_size))
+            break;
+
+        // 送信したインストラクションへの応答でないパケットを捨て、後に続くデータを解析し直す
+        remove_packet(self, header_position, &status_packet_size);
+        self->header_found = false;
+        self->stale_statistics.discarded_packets++;
+    }
+    *initial_status_packet_size = status_packet_size;
+
+    // ヘッダーを最初に見つけたときに、その時刻を記録する(以降の読み込みで記録が押し出されるため)
+    if (parse_result <= 2 && !self->header_found && self->read_time_num > 0)
+    {
+        self->header_us = find_read_time(self, header_position);
+        self->header_found = true;
+    }
+
+    if (parse_result <= 1 && self->read_time_num > 0)
+    {
+        // 応答パケットを最後まで受信した(CRCの最後の1Byteは最後に読み込んだデータに含まれる)
+        self->status_timestamp.instruction_us = self->instruction_us;
+        self->status_timestamp.header_us = self->header_us;
+        self->status_timestamp.crc_us = self->read_time[self->read_time_num - 1].us;
+        self->status_timestamp_valid = true;
+
+        // checksumが正しいときだけ、応答パケットのIDを信頼する
+        if (parse_result == 0 && status_id <= DYNAMIXEL_MAX_ID)
+        {
+            self->id_status_timestamp[status_id] = self->status_timestamp;
+            self->id_status_timestamp_valid[status_id] = true;
+        }
+    }
+    if (parse_result != 2)
+        self->header_found = false;
+
+    if (parse_result <= 1)
+    {
+        // 後に続くデータ(次の応答パケットの一部)をバッファーの先頭に残す
+        remove_packet(self, header_position, &status_packet_size);
+        *initial_status_packet_size = status_packet_size;
+    }
 
     if (parse_result == 0)
     {
@@ -1076,8 +2010,8 @@ dynamixel_parse_result dynamixel_partial_uart_packet(
         if (*error > 0)
             return DYNAMIXEL_PARSE_STATUS_ERROR;
 
-        // インストラクションパケットのIDと応答パケットのIDが違う
-        if (status_id != id)
+        // インストラクションパケットのIDと応答パケットのIDが違う(ブロードキャストIDには、どのIDも応答する)
+        if (id <= DYNAMIXEL_MAX_ID && status_id != id)
             return DYNAMIXEL_PARSE_WRONG_ID;
 
         return DYNAMIXEL_PARSE_SUCCESS;
@@ -1096,6 +2030,7 @@ dynamixel_parse_result dynamixel_partial_uart_packet(
             self->read_buffer + header_position,
             *initial_status_packet_size
         );
+        shift_read_time(self, header_position);
     }
     else if (parse_result == 3)
     {
@@ -1113,6 +2048,7 @@ dynamixel_parse_result dynamixel_partial_uart_packet(
                 status_packet_size
             );
             *initial_status_packet_size = 3;
+            shift_read_time(self, status_packet_size - 3);
         }
     }
 
@@ -1143,67 +2079,308 @@ dynamixel_parse_result dynamixel_partial_read_and_parse_uart_packet(
 }
 
 
-dynamixel_parse_result dynamixel_read_uart_packet(
+/**
+ * @brief 応答パケットを待ち始める
+*/
+static void begin_receive(
     dynamixel_t self,
-    uint8_t id,
-    uint8_t *error,
-    size_t *status_parameter_size,
-    uint8_t *status_parameter,
-    uint wait_us_multiplier
+    uint64_t now_us
 )
 {
-    int uart_read_result;
-    size_t status_packet_size;
-    uint wait_us = self->wait_us;
+    self->wait_start_us = now_us;
+    self->first_byte_deadline_us = now_us + self->first_byte_wait_us;
+    self->state = DYNAMIXEL_STATE_AWAIT_FIRST_BYTE;
+}
 
-    if (wait_us_multiplier)
-        wait_us = wait_us_multiplier * wait_us;
 
-    if (!pico_uart_is_readable_within_us(
-        self->uart_id, wait_us
-    ))
+/**
+ * @brief 通信を終える
+*/
+static void finish_packet(
+    dynamixel_t self,
+    dynamixel_parse_result result
+)
+{
+    // 最初の1Byteも届かないまま待ち時間を過ぎた
+    bool first_byte_timeout = self->state == DYNAMIXEL_STATE_AWAIT_FIRST_BYTE;
+
+    self->packet_result = result;
+    self->state = DYNAMIXEL_STATE_DONE;
+    self->expected_status_packet_size = 0;
+    self->discard_stale_packet = false;
+
+    // 送信できなかった通信では、応答を待っていない
+    if (!self->packet_sent || self->packet_id > DYNAMIXEL_MAX_ID || result == DYNAMIXEL_PARSE_WRITE_FAILED)
+        return;
+
+    // 宛先のDynamixelが応答したときだけ、応答時間を記録する
+    if (result == DYNAMIXEL_PARSE_SUCCESS || result == DYNAMIXEL_PARSE_STATUS_ERROR)
+        update_rtt_estimate(self, self->packet_id, self->first_byte_us);
+    // 推定値から計算した待ち時間で何も届かなかったときは、次の待ち時間を延ばす
+    else if (first_byte_timeout)
     {
-        // 読み込み前に初期化
-        status_packet_size = 0;
-        memset(self->read_buffer, 0, self->buffer_size);
+        if (self->adaptive_wait)
+            back_off_rtt_estimate(self, self->packet_id);
+    }
+    // 解析できなくても待ち時間内にデータは届いたので、延ばした待ち時間を元に戻す(応答時間は記録しない)
+    else
+        self->rtt[self->packet_id].backoff_shift = 0;
+}
+
+
+/**
+ * @brief 届いているデータを読み込んで解析する
+*/
+static void receive_data(
+    dynamixel_t self,
+    uint64_t now_us
+)
+{
+    dynamixel_parse_result result = dynamixel_partial_read_and_parse_uart_packet(
+        self, self->packet_id,
+        self->packet_error, self->packet_status_parameter_size,
+        self->packet_status_parameter, &self->status_packet_size
+    );
+
+    if (
+        result == DYNAMIXEL_PARSE_SUCCESS
+        || result == DYNAMIXEL_PARSE_WRONG_CHECKSUM
+        || result == DYNAMIXEL_PARSE_STATUS_ERROR
+        || result == DYNAMIXEL_PARSE_WRONG_ID
+        || result == DYNAMIXEL_PARSE_HUGE_DATA)
+    {
+        finish_packet(self, result);
+        return;
+    }
+
+    self->packet_result = result;
+    self->deadline_us = now_us + self->inter_byte_wait_us;
+}
+
 
-        do
+/**
+ * @brief 状態を1つ進める
+ *
+ * readableには、データが届いているかを呼び出し元で確かめた結果を渡す
+*/
+static dynamixel_state step_packet(
+    dynamixel_t self,
+    uint64_t now_us,
+    bool readable
+)
+{
+    switch (self->state)
+    {
+    case DYNAMIXEL_STATE_TX:
+        if (self->write_pending)
         {
-            uart_read_result = dynamixel_partial_read_and_parse_uart_packet(
-                self, id, error, status_parameter_size,
-                status_parameter, &status_packet_size
-            );
+            if (self->transport.write_done(self->transport.context))
+                break;
 
-            if (
-                uart_read_result == DYNAMIXEL_PARSE_SUCCESS
-                || uart_read_result == DYNAMIXEL_PARSE_WRONG_CHECKSUM
-                || uart_read_result == DYNAMIXEL_PARSE_STATUS_ERROR
-                || uart_read_result == DYNAMIXEL_PARSE_WRONG_ID
-                || uart_read_result == DYNAMIXEL_PARSE_HUGE_DATA)
+            // 送信が完了しているので、すぐに戻る
+            if (dynamixel_wait_write(self))
             {
-                return uart_read_result;
+                finish_packet(self, DYNAMIXEL_PARSE_WRITE_FAILED);
+                break;
             }
         }
-        while (!pico_uart_is_readable_within_us(
-            self->uart_id, wait_us
-        ));
 
-        // 応答パケットが返って来たが不十分であった(最後のparse結果を見る)
-        if (uart_read_result == DYNAMIXEL_PARSE_INADEQUATE_DATA)
+        if (!self->response_expected)
         {
-            return DYNAMIXEL_PARSE_INADEQUATE_DATA;
+            finish_packet(self, DYNAMIXEL_PARSE_SUCCESS);
+            break;
         }
-    }
 
-    // 応答が返ってこなかった
-    return DYNAMIXEL_PARSE_NO_RESPONSE;
-}
+        // 応答パケットの待ち時間は送信が完了してから数える
+        begin_receive(self, now_us);
+        break;
 
+    case DYNAMIXEL_STATE_AWAIT_FIRST_BYTE:
+        // 前の応答パケットに続いて読み込んだデータがあれば、すぐに解析する
+        if (readable || self->status_packet_size > 0)
+        {
+            // 最初の1Byteを受信するまでの時間
+            self->first_byte_us = now_us - self->wait_start_us;
+            self->discarded_packets = self->stale_statistics.discarded_packets;
 
-dynamixel_parse_result dynamixel_send_packet(
-    dynamixel_t self,
-    uint8_t id,
-    uint8_t instruction,
+            self->state = DYNAMIXEL_STATE_RECEIVING;
+            receive_data(self, now_us);
+        }
+        else if (now_us >= self->first_byte_deadline_us)
+        {
+            // 応答が返ってこなかった
+            finish_packet(self, DYNAMIXEL_PARSE_NO_RESPONSE);
+        }
+        break;
+
+    case DYNAMIXEL_STATE_RECEIVING:
+        if (readable)
+        {
+            receive_data(self, now_us);
+        }
+        else if (now_us >= self->deadline_us)
+        {
+            // 応答でないパケットを捨てて何も残っていなければ、残りの待ち時間で最初の1Byteを待ち直す
+            if (
+                self->status_packet_size == 0
+                && self->stale_statistics.discarded_packets > self->discarded_packets
+            )
+            {
+                if (now_us >= self->first_byte_deadline_us)
+                    finish_packet(self, DYNAMIXEL_PARSE_NO_RESPONSE);
+                else
+                    self->state = DYNAMIXEL_STATE_AWAIT_FIRST_BYTE;
+            }
+            // 応答パケットが返って来たが不十分であった(最後のparse結果を見る)
+            else if (self->packet_result == DYNAMIXEL_PARSE_INADEQUATE_DATA)
+                finish_packet(self, DYNAMIXEL_PARSE_INADEQUATE_DATA);
+            else
+                finish_packet(self, DYNAMIXEL_PARSE_NO_RESPONSE);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return self->state;
+}
+
+
+/**
+ * @brief 応答パケットの受信が終わるまで待つ
+ *
+ * dynamixel_poll()と同じ状態遷移を、待ち時間の期限までデータが届くのを待ちながら進める
+*/
+static void wait_receive(
+    dynamixel_t self,
+    uint64_t now_us
+)
+{
+    uint64_t deadline_us;
+    uint wait_us;
+    bool readable;
+
+    while (
+        self->state == DYNAMIXEL_STATE_AWAIT_FIRST_BYTE
+        || self->state == DYNAMIXEL_STATE_RECEIVING
+    )
+    {
+        deadline_us = self->state == DYNAMIXEL_STATE_AWAIT_FIRST_BYTE
+            ? self->first_byte_deadline_us
+            : self->deadline_us;
+        wait_us = deadline_us > now_us ? deadline_us - now_us : 0;
+
+        readable = !self->transport.wait_readable(self->transport.context, wait_us);
+        // 待ち時間を過ぎたときは、期限まで時間が進んだものとする
+        now_us = readable
+            ? self->transport.now_us(self->transport.context)
+            : now_us + wait_us;
+        step_packet(self, now_us, readable);
+    }
+}
+
+
+/**
+ * @brief 通信が終わるまで待ち、結果を返してDYNAMIXEL_STATE_IDLEに戻す
+*/
+static dynamixel_parse_result wait_packet(
+    dynamixel_t self,
+    uint64_t now_us
+)
+{
+    wait_receive(self, now_us);
+
+    self->state = DYNAMIXEL_STATE_IDLE;
+    return self->packet_result;
+}
+
+
+/**
+ * @brief 受信したデータを全て捨てて、新しい応答パケットを読み込めるようにする
+*/
+static void clear_received_data(
+    dynamixel_t self
+)
+{
+    self->status_packet_size = 0;
+    memset(self->read_buffer, 0, self->buffer_size);
+}
+
+
+/**
+ * @brief 通信を始める
+ *
+ * 解析結果は*error、*status_parameter_size、*status_parameterに保存する
+*/
+static void begin_packet(
+    dynamixel_t self,
+    uint8_t id,
+    bool sent,
+    uint first_byte_wait_us,
+    uint inter_byte_wait_us,
+    uint8_t *error,
+    size_t *status_parameter_size,
+    uint8_t *status_parameter
+)
+{
+    self->packet_id = id;
+    self->packet_sent = sent;
+    self->response_expected = true;
+    self->adaptive_wait = false;
+    self->first_byte_wait_us = first_byte_wait_us;
+    self->inter_byte_wait_us = inter_byte_wait_us;
+    self->packet_error = error;
+    self->packet_status_parameter_size = status_parameter_size;
+    self->packet_status_parameter = status_parameter;
+    self->packet_result = DYNAMIXEL_PARSE_NO_RESPONSE;
+}
+
+
+dynamixel_parse_result dynamixel_read_uart_packet(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t *error,
+    size_t *status_parameter_size,
+    uint8_t *status_parameter,
+    uint wait_us_multiplier
+)
+{
+    uint wait_us, inter_byte_wait_us;
+    uint64_t now_us;
+
+    if (wait_us_multiplier || self->timeout_model == DYNAMIXEL_TIMEOUT_MODEL_FIXED)
+    {
+        wait_us = get_fixed_wait_us(self, wait_us_multiplier);
+        inter_byte_wait_us = wait_us;
+    }
+    else
+    {
+        // 応答パケットのサイズが分からないので、readバッファーが満杯になるまでの時間とする
+        wait_us = dynamixel_get_response_timeout_us(self, id, 0, self->buffer_size);
+        inter_byte_wait_us = dynamixel_get_inter_byte_timeout_us(self);
+    }
+
+    self->expected_status_packet_size = 0;
+    begin_packet(
+        self, id, false, wait_us, inter_byte_wait_us,
+        error, status_parameter_size, status_parameter
+    );
+    clear_received_data(self);
+
+    now_us = self->transport.now_us(self->transport.context);
+    begin_receive(self, now_us);
+    return wait_packet(self, now_us);
+}
+
+
+/**
+ * @brief パケットを送信して、DYNAMIXEL_STATE_TXにする
+*/
+static int send_packet(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t instruction,
     uint16_t parameter_size,
     const uint8_t *parameter,
     uint8_t *error,
@@ -1212,14 +2389,409 @@ dynamixel_parse_result dynamixel_send_packet(
     uint wait_us_multiplier
 )
 {
-    dynamixel_write_uart_packet(
+    int write_result;
+    uint wait_us, inter_byte_wait_us;
+    bool adaptive_wait = false;
+    size_t expected_status_packet_size = get_expected_status_packet_size(
+        id, instruction, parameter_size, parameter
+    );
+
+    if (wait_us_multiplier || self->timeout_model == DYNAMIXEL_TIMEOUT_MODEL_FIXED)
+    {
+        wait_us = get_fixed_wait_us(self, wait_us_multiplier);
+        inter_byte_wait_us = wait_us;
+    }
+    else
+    {
+        adaptive_wait = self->timeout_model == DYNAMIXEL_TIMEOUT_MODEL_ADAPTIVE
+            && get_adaptive_timeout_us(self, id, &wait_us) == 0;
+        if (!adaptive_wait)
+        {
+            // 送信の完了を待ってから数えるので、送信時間は含めない
+            wait_us = dynamixel_get_response_timeout_us(
+                self, id, 0, expected_status_packet_size
+            );
+        }
+        inter_byte_wait_us = dynamixel_get_inter_byte_timeout_us(self);
+    }
+
+    write_result = dynamixel_write_uart_packet(
         self,
         id, instruction, parameter_size, parameter
     );
 
-    return dynamixel_read_uart_packet(
-        self, id,
-        error, status_parameter_size, status_parameter,
+    begin_packet(
+        self, id, true, wait_us, inter_byte_wait_us,
+        error, status_parameter_size, status_parameter
+    );
+    clear_received_data(self);
+    self->expected_status_packet_size = expected_status_packet_size;
+    self->discard_stale_packet = self->response_sequencing;
+    self->adaptive_wait = adaptive_wait;
+    self->state = DYNAMIXEL_STATE_TX;
+
+    return write_result;
+}
+
+
+dynamixel_parse_result dynamixel_send_packet(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t instruction,
+    uint16_t parameter_size,
+    const uint8_t *parameter,
+    uint8_t *error,
+    size_t *status_parameter_size,
+    uint8_t *status_parameter,
+    uint wait_us_multiplier
+)
+{
+    uint64_t now_us;
+
+    // 応答パケットの待ち時間は送信が完了してから数える
+    if (
+        send_packet(
+            self,
+            id, instruction, parameter_size, parameter,
+            error, status_parameter_size, status_parameter,
+            wait_us_multiplier
+        )
+        || dynamixel_wait_write(self)
+    )
+    {
+        finish_packet(self, DYNAMIXEL_PARSE_WRITE_FAILED);
+        self->state = DYNAMIXEL_STATE_IDLE;
+        return DYNAMIXEL_PARSE_WRITE_FAILED;
+    }
+
+    now_us = self->transport.now_us(self->transport.context);
+    step_packet(self, now_us, false);
+    return wait_packet(self, now_us);
+}
+
+
+/**
+ * @brief dynamixel_poll()で進める通信を始める
+ *
+ * 応答を受け取れなかったときは、dynamixel_poll()の中でretry_num回まで送り直す
+*/
+static int start_packet(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t instruction,
+    uint16_t parameter_size,
+    const uint8_t *parameter,
+    uint wait_us_multiplier,
+    size_t retry_num,
+    int expected_status_parameter_size
+)
+{
+    if (
+        self->state != DYNAMIXEL_STATE_IDLE
+        && self->state != DYNAMIXEL_STATE_DONE
+    )
+        return 1;
+    if (parameter_size > self->buffer_size)
+        return 1;
+
+    // 呼び出し元は追加情報を保持しなくてよいので、送り直すためにコピーする
+    if (parameter_size > 0 && parameter != self->retry_parameter)
+        memcpy(self->retry_parameter, parameter, parameter_size);
+    self->retry_instruction = instruction;
+    self->retry_parameter_size = parameter_size;
+    self->retry_wait_us_multiplier = wait_us_multiplier;
+    self->retry_left = retry_num;
+    self->expected_status_parameter_size = expected_status_parameter_size;
+
+    if (send_packet(
+        self,
+        id, instruction, parameter_size, self->retry_parameter,
+        &self->status_error, &self->status_parameter_size, self->status_parameter,
         wait_us_multiplier
+    ))
+    {
+        self->expected_status_packet_size = 0;
+        self->discard_stale_packet = false;
+        self->state = DYNAMIXEL_STATE_IDLE;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int dynamixel_start_packet(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t instruction,
+    uint16_t parameter_size,
+    const uint8_t *parameter,
+    uint wait_us_multiplier
+)
+{
+    return start_packet(
+        self, id, instruction, parameter_size, parameter,
+        wait_us_multiplier, 0, -1
     );
 }
+
+
+int dynamixel_start_read(
+    dynamixel_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint wait_us_multiplier,
+    size_t iterative_count
+)
+{
+    uint8_t parameter[4];
+
+    // 開始アドレス
+    divide_into_byte_pair(start_address, parameter, parameter + 1);
+    // バイトサイズ
+    divide_into_byte_pair(data_size, parameter + 2, parameter + 3);
+
+    return start_packet(
+        self, id, DYNAMIXEL__INSTRUCTION_READ, 4, parameter,
+        wait_us_multiplier, ITERATIVE_COUNT_DEFAULT(iterative_count) - 1, data_size
+    );
+}
+
+
+int dynamixel_start_write(
+    dynamixel_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    const uint8_t *data,
+    uint wait_us_multiplier,
+    size_t iterative_count
+)
+{
+    if (2 + (size_t)data_size > self->buffer_size)
+        return 1;
+
+    if (
+        self->state != DYNAMIXEL_STATE_IDLE
+        && self->state != DYNAMIXEL_STATE_DONE
+    )
+        return 1;
+
+    // 送り直すためのコピー先に、直接パラメータを作る
+    divide_into_byte_pair(start_address, self->retry_parameter, self->retry_parameter + 1);
+    memcpy(self->retry_parameter + 2, data, data_size);
+
+    return start_packet(
+        self, id, DYNAMIXEL__INSTRUCTION_WRITE, 2 + data_size, self->retry_parameter,
+        wait_us_multiplier, ITERATIVE_COUNT_DEFAULT(iterative_count) - 1, -1
+    );
+}
+
+
+int dynamixel_start_write_packet(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t instruction,
+    uint16_t parameter_size,
+    const uint8_t *parameter
+)
+{
+    if (
+        self->state != DYNAMIXEL_STATE_IDLE
+        && self->state != DYNAMIXEL_STATE_DONE
+    )
+        return 1;
+
+    if (dynamixel_write_uart_packet(self, id, instruction, parameter_size, parameter))
+    {
+        self->state = DYNAMIXEL_STATE_IDLE;
+        return 1;
+    }
+
+    begin_packet(
+        self, id, false, 0, 0,
+        &self->status_error, &self->status_parameter_size, self->status_parameter
+    );
+    clear_received_data(self);
+    self->response_expected = false;
+    self->expected_status_packet_size = 0;
+    self->discard_stale_packet = false;
+    self->status_error = 0;
+    self->status_parameter_size = 0;
+    self->retry_left = 0;
+    self->expected_status_parameter_size = -1;
+    self->state = DYNAMIXEL_STATE_TX;
+
+    return 0;
+}
+
+
+int dynamixel_start_read_packet(
+    dynamixel_t self,
+    uint8_t id,
+    size_t status_packet_size
+)
+{
+    uint wait_us, inter_byte_wait_us;
+
+    if (
+        self->state != DYNAMIXEL_STATE_IDLE
+        && self->state != DYNAMIXEL_STATE_DONE
+    )
+        return 1;
+
+    if (self->timeout_model == DYNAMIXEL_TIMEOUT_MODEL_FIXED)
+    {
+        wait_us = get_fixed_wait_us(self, 0);
+        inter_byte_wait_us = wait_us;
+    }
+    else
+    {
+        wait_us = dynamixel_get_response_timeout_us(self, id, 0, status_packet_size);
+        inter_byte_wait_us = dynamixel_get_inter_byte_timeout_us(self);
+    }
+
+    // 前の応答パケットに続いて読み込んだデータは、この応答パケットの一部として残す
+    begin_packet(
+        self, id, false, wait_us, inter_byte_wait_us,
+        &self->status_error, &self->status_parameter_size, self->status_parameter
+    );
+    self->expected_status_packet_size = status_packet_size;
+    self->discard_stale_packet = self->response_sequencing;
+    self->retry_left = 0;
+    self->expected_status_parameter_size = -1;
+    begin_receive(self, self->transport.now_us(self->transport.context));
+
+    return 0;
+}
+
+
+/**
+ * @brief 終わった通信の結果を確かめ、受け取れなかったときは送り直す
+*/
+static void retry_packet(
+    dynamixel_t self
+)
+{
+    // 応答パケットのパラメータは、インストラクションで指定したデータサイズと等しい必要がある
+    if (
+        self->packet_result == DYNAMIXEL_PARSE_SUCCESS
+        && self->expected_status_parameter_size >= 0
+        && self->status_parameter_size != (size_t)self->expected_status_parameter_size
+    )
+        self->packet_result = DYNAMIXEL_PARSE_WRONG_PARAMETER;
+
+    while (
+        self->state == DYNAMIXEL_STATE_DONE
+        && self->packet_result != DYNAMIXEL_PARSE_SUCCESS
+        && self->retry_left > 0
+    )
+    {
+        self->retry_left--;
+        if (send_packet(
+            self,
+            self->packet_id, self->retry_instruction,
+            self->retry_parameter_size, self->retry_parameter,
+            &self->status_error, &self->status_parameter_size, self->status_parameter,
+            self->retry_wait_us_multiplier
+        ))
+            finish_packet(self, DYNAMIXEL_PARSE_WRITE_FAILED);
+    }
+}
+
+
+dynamixel_state dynamixel_poll(
+    dynamixel_t self,
+    uint64_t now_us
+)
+{
+    bool readable = false;
+
+    if (
+        self->state == DYNAMIXEL_STATE_AWAIT_FIRST_BYTE
+        || self->state == DYNAMIXEL_STATE_RECEIVING
+    )
+        readable = !self->transport.wait_readable(self->transport.context, 0);
+
+    if (step_packet(self, now_us, readable) == DYNAMIXEL_STATE_DONE)
+        retry_packet(self);
+
+    return self->state;
+}
+
+
+dynamixel_state dynamixel_wait_done(
+    dynamixel_t self
+)
+{
+    while (
+        self->state != DYNAMIXEL_STATE_IDLE
+        && self->state != DYNAMIXEL_STATE_DONE
+    )
+    {
+        if (self->state == DYNAMIXEL_STATE_TX)
+        {
+            // 送信の完了を待ってから、応答パケットを待ち始める
+            if (dynamixel_wait_write(self))
+                finish_packet(self, DYNAMIXEL_PARSE_WRITE_FAILED);
+            else
+                step_packet(self, self->transport.now_us(self->transport.context), false);
+        }
+        else
+            wait_receive(self, self->transport.now_us(self->transport.context));
+
+        retry_packet(self);
+    }
+
+    return self->state;
+}
+
+
+int dynamixel_wait_readable(
+    dynamixel_t self,
+    uint us
+)
+{
+    return self->transport.wait_readable(self->transport.context, us);
+}
+
+
+dynamixel_state dynamixel_get_state(
+    dynamixel_t self
+)
+{
+    return self->state;
+}
+
+
+uint64_t dynamixel_get_deadline_us(
+    dynamixel_t self
+)
+{
+    if (self->state == DYNAMIXEL_STATE_AWAIT_FIRST_BYTE)
+        return self->first_byte_deadline_us;
+    if (self->state == DYNAMIXEL_STATE_RECEIVING)
+        return self->deadline_us;
+
+    return 0;
+}
+
+
+dynamixel_parse_result dynamixel_get_packet_result(
+    dynamixel_t self,
+    uint8_t *error,
+    size_t *status_parameter_size,
+    uint8_t *status_parameter
+)
+{
+    if (self->state != DYNAMIXEL_STATE_DONE)
+        return DYNAMIXEL_PARSE_NO_RESPONSE;
+
+    *error = self->status_error;
+    *status_parameter_size = self->status_parameter_size;
+    memcpy(status_parameter, self->status_parameter, self->status_parameter_size);
+    self->state = DYNAMIXEL_STATE_IDLE;
+
+    return self->packet_result;
+}
@@ -0,0 +1,567 @@
+#include <stdlib.h>
+#include <string.h>
+#include "dynamixel/dynamixel_async.h"
+#include "dynamixel_protocol.h"
+
+
+/**
+ * @brief 受け付けたリクエスト
+*/
+typedef struct
+{
+    /// parameterは、リクエストの領域にコピーしたものを指す
+    dynamixel_async_request request;
+    uint8_t *parameter;
+    /// 応答パケットの数
+    size_t response_num;
+    /// 残りの再送の回数
+    uint8_t retry_left;
+} async_request;
+
+
+/**
+ * @brief 完了キューに入れた完了
+*/
+typedef struct
+{
+    dynamixel_async_completion completion;
+    uint8_t *status_parameter;
+} async_completion;
+
+
+typedef struct dynamixel_async_struct
+{
+    dynamixel_t dynamixel;
+    dynamixel_async_config config;
+    // リクエストの領域と、空いている領域の番号
+    async_request *request;
+    size_t *free_request;
+    size_t free_request_num;
+    // 優先度ごとに、受け付けた順のリクエストの番号(送信を待っているもの)
+    size_t *pending[DYNAMIXEL_ASYNC_PRIORITY_NUM];
+    size_t pending_head[DYNAMIXEL_ASYNC_PRIORITY_NUM];
+    size_t pending_num[DYNAMIXEL_ASYNC_PRIORITY_NUM];
+    // 完了キュー
+    async_completion *completion;
+    size_t completion_head;
+    size_t completion_num;
+    // 解析した応答パケットのパラメータ(dynamixelインスタンスのバッファーのサイズ)
+    uint8_t *status_parameter;
+    // 通信中のリクエスト
+    bool active;
+    size_t active_request;
+    // 応答パケットを返さないパケット(Sync Read、Bulk Readのインストラクションを含む)の送信中か
+    bool transmitting;
+    size_t response_index;
+} dynamixel_async_struct;
+
+
+/// 送信する優先度の順
+static const dynamixel_async_priority priority_order[DYNAMIXEL_ASYNC_PRIORITY_NUM] = {
+    DYNAMIXEL_ASYNC_PRIORITY_SAFETY,
+    DYNAMIXEL_ASYNC_PRIORITY_CONTROL,
+    DYNAMIXEL_ASYNC_PRIORITY_BACKGROUND,
+};
+
+
+/// 応答パケットの待ち時間を計算するときに使う、応答パケットのサイズ
+static size_t get_status_packet_size(
+    int status_parameter_size
+)
+{
+    // 分からない場合は、パラメータのない応答パケットとする(dynamixel_send_packetと同じ)
+    if (status_parameter_size < 0)
+        return DYNAMIXEL_STATUS_PACKET_OVERHEAD;
+
+    return DYNAMIXEL_STATUS_PACKET_OVERHEAD + status_parameter_size;
+}
+
+
+dynamixel_async_t dynamixel_async_create(
+    dynamixel_t dynamixel,
+    const dynamixel_async_config *config
+)
+{
+    dynamixel_async_t self;
+    uint8_t *parameter, *status_parameter;
+    // 0を指定された場合も、領域を1つ確保する(完了キューを使わない場合など)
+    size_t completion_num = config->completion_num ? config->completion_num : 1;
+
+    if (config->request_num == 0)
+        return NULL;
+
+    self = calloc(1, sizeof(dynamixel_async_struct));
+    if (!self)
+        return NULL;
+
+    self->dynamixel = dynamixel;
+    self->config = *config;
+    self->request = calloc(config->request_num, sizeof(async_request));
+    self->free_request = calloc(config->request_num, sizeof(size_t));
+    // 優先度ごとの領域は、まとめて確保する
+    self->pending[0] = calloc(config->request_num * DYNAMIXEL_ASYNC_PRIORITY_NUM, sizeof(size_t));
+    self->completion = calloc(completion_num, sizeof(async_completion));
+    self->status_parameter = calloc(dynamixel_get_buffer_size(dynamixel), sizeof(uint8_t));
+    // 追加情報と、完了キューの応答パケットのパラメータは、それぞれまとめて確保する
+    parameter = calloc(config->request_num * config->parameter_size + 1, sizeof(uint8_t));
+    status_parameter = calloc(completion_num * config->status_parameter_size + 1, sizeof(uint8_t));
+    if (
+        !self->request || !self->free_request || !self->pending[0] || !self->completion
+        || !self->status_parameter || !parameter || !status_parameter
+    )
+    {
+        free(parameter);
+        free(status_parameter);
+        free(self->request);
+        free(self->free_request);
+        free(self->pending[0]);
+        free(self->completion);
+        free(self->status_parameter);
+        free(self);
+        return NULL;
+    }
+
+    for (size_t i = 1; i < DYNAMIXEL_ASYNC_PRIORITY_NUM; i++)
+        self->pending[i] = self->pending[0] + i * config->request_num;
+
+    for (size_t i = 0; i < config->request_num; i++)
+    {
+        self->request[i].parameter = parameter + i * config->parameter_size;
+        self->free_request[i] = config->request_num - 1 - i;
+    }
+    self->free_request_num = config->request_num;
+    for (size_t i = 0; i < completion_num; i++)
+        self->completion[i].status_parameter = status_parameter + i * config->status_parameter_size;
+
+    return self;
+}
+
+
+void dynamixel_async_destroy(
+    dynamixel_async_t self
+)
+{
+    free(self->request[0].parameter);
+    free(self->completion[0].status_parameter);
+    free(self->request);
+    free(self->free_request);
+    free(self->pending[0]);
+    free(self->completion);
+    free(self->status_parameter);
+    free(self);
+}
+
+
+/**
+ * @brief 送信を待つリクエストに加える
+ *
+ * frontのときは同じ優先度の先頭に加える(再送)
+*/
+static void push_pending(
+    dynamixel_async_t self,
+    size_t index,
+    bool front
+)
+{
+    dynamixel_async_priority priority = self->request[index].request.priority;
+    size_t request_num = self->config.request_num;
+
+    if (front)
+    {
+        self->pending_head[priority] = (self->pending_head[priority] + request_num - 1) % request_num;
+        self->pending[priority][self->pending_head[priority]] = index;
+    }
+    else
+    {
+        self->pending[priority][(self->pending_head[priority] + self->pending_num[priority]) % request_num] = index;
+    }
+    self->pending_num[priority]++;
+}
+
+
+/// 送信を待っているリクエストの数
+static size_t count_pending(
+    dynamixel_async_t self
+)
+{
+    size_t pending_num = 0;
+
+    for (size_t i = 0; i < DYNAMIXEL_ASYNC_PRIORITY_NUM; i++)
+        pending_num += self->pending_num[i];
+
+    return pending_num;
+}
+
+
+int dynamixel_async_submit(
+    dynamixel_async_t self,
+    const dynamixel_async_request *request
+)
+{
+    size_t index;
+    async_request *slot;
+    int response_num, status_parameter_size;
+    uint8_t id;
+
+    if (self->free_request_num == 0)
+        return 1;
+    if ((unsigned)request->priority >= DYNAMIXEL_ASYNC_PRIORITY_NUM)
+        return 1;
+    if (request->parameter_size > self->config.parameter_size)
+        return 1;
+    // パラメータの修正で増える分を含めてwriteバッファーに入りきるか
+    if (
+        (size_t)(DYNAMIXEL_INSTRUCTION_PACKET_OVERHEAD + request->parameter_size * 4 / 3 + 1)
+        > dynamixel_get_buffer_size(self->dynamixel)
+    )
+        return 1;
+
+    response_num = dynamixel_count_response(request->id, request->instruction, request->parameter_size);
+    if (response_num < 0)
+        return 1;
+    // 応答パケットを返さないインストラクションも、完了を1つ入れる
+    if (!request->callback && (size_t)(response_num > 0 ? response_num : 1) > self->config.completion_num)
+        return 1;
+
+    index = self->free_request[self->free_request_num - 1];
+    slot = &self->request[index];
+    slot->request = *request;
+    if (request->parameter_size > 0)
+        memcpy(slot->parameter, request->parameter, request->parameter_size);
+    slot->request.parameter = slot->parameter;
+    slot->response_num = response_num;
+    slot->retry_left = response_num == 1 ? request->retry_num : 0;
+
+    // 応答パケットのパラメータが完了に入りきるか
+    for (size_t i = 0; i < slot->response_num; i++)
+    {
+        status_parameter_size = dynamixel_get_response(
+            slot->request.id, slot->request.instruction, slot->parameter, i, &id
+        );
+        if (status_parameter_size > (int)self->config.status_parameter_size)
+            return 1;
+    }
+
+    self->free_request_num--;
+    push_pending(self, index, false);
+    return 0;
+}
+
+
+/**
+ * @brief 完了をコールバックに渡すか、完了キューに入れる
+*/
+static void complete(
+    dynamixel_async_t self,
+    const async_request *request,
+    uint8_t id,
+    dynamixel_parse_result result,
+    uint8_t error,
+    size_t status_parameter_size,
+    bool last
+)
+{
+    dynamixel_async_completion completion;
+    async_completion *entry;
+
+    completion.user_data = request->request.user_data;
+    completion.instruction = request->request.instruction;
+    completion.id = id;
+    completion.result = result;
+    completion.error = error;
+    completion.status_parameter_size = status_parameter_size;
+    completion.status_parameter = self->status_parameter;
+    completion.last = last;
+
+    if (request->request.callback)
+    {
+        request->request.callback(&completion);
+        return;
+    }
+
+    // 送信前に空きを確認しているので、完了キューは溢れない
+    entry = &self->completion[(self->completion_head + self->completion_num) % self->config.completion_num];
+    memcpy(entry->status_parameter, self->status_parameter, status_parameter_size);
+    completion.status_parameter = entry->status_parameter;
+    entry->completion = completion;
+    self->completion_num++;
+}
+
+
+/**
+ * @brief リクエストの領域を空ける
+ *
+ * コールバックの中でリクエストを追加できるように、最後の完了を渡す前に呼ぶ
+*/
+static async_request release_request(
+    dynamixel_async_t self,
+    size_t index
+)
+{
+    async_request request = self->request[index];
+
+    self->free_request[self->free_request_num++] = index;
+    return request;
+}
+
+
+/**
+ * @brief 応答パケットを複数返すインストラクションか
+ *
+ * 応答パケットを返さないパケットとして送信し、応答パケットは1つずつ待つ
+*/
+static bool is_response_train(
+    const async_request *request
+)
+{
+    return request->request.instruction == DYNAMIXEL__INSTRUCTION_SYNC_READ
+        || request->request.instruction == DYNAMIXEL__INSTRUCTION_BULK_READ;
+}
+
+
+/**
+ * @brief 通信中のリクエストの残りの応答パケットを、全て同じ結果で完了させる
+*/
+static void complete_rest(
+    dynamixel_async_t self,
+    dynamixel_parse_result result
+)
+{
+    async_request *request = &self->request[self->active_request];
+    async_request released;
+    uint8_t id;
+
+    for (; self->response_index + 1 < request->response_num; self->response_index++)
+    {
+        dynamixel_get_response(
+            request->request.id, request->request.instruction, request->parameter, self->response_index, &id
+        );
+        complete(self, request, id, result, 0, 0, false);
+    }
+    dynamixel_get_response(
+        request->request.id, request->request.instruction, request->parameter, self->response_index, &id
+    );
+    self->active = false;
+    released = release_request(self, self->active_request);
+    complete(self, &released, id, result, 0, 0, true);
+}
+
+
+/**
+ * @brief 通信中のリクエストの、次の応答パケットを待ち始める
+*/
+static void start_response(
+    dynamixel_async_t self
+)
+{
+    uint8_t id;
+    const async_request *request = &self->request[self->active_request];
+    int status_parameter_size = dynamixel_get_response(
+        request->request.id, request->request.instruction, request->parameter, self->response_index, &id
+    );
+
+    dynamixel_start_read_packet(self->dynamixel, id, get_status_packet_size(status_parameter_size));
+}
+
+
+/**
+ * @brief 次のリクエストを送信する
+ * @retval true リクエストを送信した
+ * @retval false 送信するリクエストがない、または完了キューに空きがない
+*/
+static bool start_request(
+    dynamixel_async_t self
+)
+{
+    size_t index;
+    async_request *request, released;
+    int start_result;
+    dynamixel_async_priority priority = DYNAMIXEL_ASYNC_PRIORITY_NUM;
+
+    for (size_t i = 0; i < DYNAMIXEL_ASYNC_PRIORITY_NUM; i++)
+    {
+        if (self->pending_num[priority_order[i]] > 0)
+        {
+            priority = priority_order[i];
+            break;
+        }
+    }
+    if (priority == DYNAMIXEL_ASYNC_PRIORITY_NUM)
+        return false;
+
+    index = self->pending[priority][self->pending_head[priority]];
+    request = &self->request[index];
+    if (
+        !request->request.callback
+        && self->config.completion_num - self->completion_num
+            < (request->response_num > 0 ? request->response_num : 1)
+    )
+        return false;
+
+    self->pending_head[priority] = (self->pending_head[priority] + 1) % self->config.request_num;
+    self->pending_num[priority]--;
+
+    self->active = true;
+    self->active_request = index;
+    self->response_index = 0;
+    self->transmitting = request->response_num == 0 || is_response_train(request);
+
+    // 応答パケットを1つ返すインストラクションは、応答時間の推定と送り直しをdynamixelインスタンスと同じく行う
+    if (self->transmitting)
+        start_result = dynamixel_start_write_packet(
+            self->dynamixel,
+            request->request.id, request->request.instruction,
+            request->request.parameter_size, request->parameter
+        );
+    else
+        start_result = dynamixel_start_packet(
+            self->dynamixel,
+            request->request.id, request->request.instruction,
+            request->request.parameter_size, request->parameter, 0
+        );
+
+    if (start_result)
+    {
+        // 送信を開始できなかったので、応答パケットを待たずに完了する
+        if (request->response_num == 0)
+        {
+            self->active = false;
+            released = release_request(self, index);
+            complete(self, &released, released.request.id, DYNAMIXEL_PARSE_WRITE_FAILED, 0, 0, true);
+        }
+        else
+        {
+            complete_rest(self, DYNAMIXEL_PARSE_WRITE_FAILED);
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief 通信中のリクエストを進める
+ * @retval true 送信が完了した、または応答パケット1つ分が完了した
+ * @retval false 送信の完了か、応答パケットを待っている
+*/
+static bool step_request(
+    dynamixel_async_t self
+)
+{
+    async_request *request = &self->request[self->active_request];
+    async_request released;
+    dynamixel_parse_result result;
+    uint8_t id, error = 0;
+    int expected_size;
+    size_t status_parameter_size = 0;
+    bool last;
+
+    if (
+        dynamixel_poll(self->dynamixel, dynamixel_get_time_us(self->dynamixel))
+        != DYNAMIXEL_STATE_DONE
+    )
+        return false;
+
+    result = dynamixel_get_packet_result(
+        self->dynamixel, &error, &status_parameter_size, self->status_parameter
+    );
+
+    if (self->transmitting)
+    {
+        self->transmitting = false;
+
+        if (request->response_num == 0)
+        {
+            self->active = false;
+            released = release_request(self, self->active_request);
+            complete(self, &released, released.request.id, result, 0, 0, true);
+        }
+        else if (result != DYNAMIXEL_PARSE_SUCCESS)
+            complete_rest(self, result);
+        else
+            start_response(self);
+        return true;
+    }
+
+    expected_size = dynamixel_get_response(
+        request->request.id, request->request.instruction, request->parameter, self->response_index, &id
+    );
+
+    // 応答パケットのパラメータは、インストラクションから分かるサイズと等しい必要がある
+    if (
+        result == DYNAMIXEL_PARSE_SUCCESS
+        && expected_size >= 0
+        && status_parameter_size != (size_t)expected_size
+    )
+        result = DYNAMIXEL_PARSE_WRONG_PARAMETER;
+    if (status_parameter_size > self->config.status_parameter_size)
+    {
+        result = DYNAMIXEL_PARSE_WRONG_PARAMETER;
+        status_parameter_size = 0;
+    }
+
+    if (result != DYNAMIXEL_PARSE_SUCCESS && request->retry_left > 0)
+    {
+        // 監視のリクエストは、待っている安全のためのリクエストより先に再送しない
+        if (
+            request->request.priority == DYNAMIXEL_ASYNC_PRIORITY_BACKGROUND
+            && self->pending_num[DYNAMIXEL_ASYNC_PRIORITY_SAFETY] > 0
+        )
+        {
+            request->retry_left = 0;
+        }
+        else
+        {
+            // 次のパケットの区切りで、優先度の高いリクエストを先に送れるように、送信を待つリクエストに戻す
+            request->retry_left--;
+            self->active = false;
+            push_pending(self, self->active_request, true);
+            return true;
+        }
+    }
+
+    last = self->response_index + 1 == request->response_num;
+    if (last)
+    {
+        self->active = false;
+        released = release_request(self, self->active_request);
+        complete(self, &released, id, result, error, status_parameter_size, true);
+        return true;
+    }
+
+    complete(self, request, id, result, error, status_parameter_size, false);
+    self->response_index++;
+
+    // 前のIDが応答しないと、後のIDは応答を始めない
+    if (result == DYNAMIXEL_PARSE_NO_RESPONSE)
+        complete_rest(self, DYNAMIXEL_PARSE_NO_RESPONSE);
+    else
+        start_response(self);
+    return true;
+}
+
+
+size_t dynamixel_async_progress(
+    dynamixel_async_t self
+)
+{
+    while (self->active ? step_request(self) : start_request(self))
+        ;
+
+    return count_pending(self) + (self->active ? 1 : 0);
+}
+
+
+int dynamixel_async_poll(
+    dynamixel_async_t self,
+    dynamixel_async_completion *completion
+)
+{
+    if (self->completion_num == 0)
+        return 1;
+
+    *completion = self->completion[self->completion_head].completion;
+    self->completion_head = (self->completion_head + 1) % self->config.completion_num;
+    self->completion_num--;
+    return 0;
+}
@@ -0,0 +1,328 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pico/time.h"
+#include "dynamixel/dynamixel_cycle.h"
+
+
+/**
+ * @brief 登録したreadまたはwrite
+*/
+typedef struct
+{
+    bool write;
+    uint8_t id;
+    uint16_t start_address;
+    uint16_t data_size;
+    // readでは読み取ったデータの保存先、writeでは書き込むデータ
+    uint8_t *data;
+    dynamixel_parse_result *result;
+} cycle_transaction;
+
+
+typedef struct dynamixel_cycle_struct
+{
+    dynamixel_t dynamixel;
+    dynamixel_cycle_config config;
+    cycle_transaction *transaction;
+    size_t transaction_size;
+    // 応答パケットのパラメータを受け取る領域(readバッファーと同じサイズ)
+    uint8_t *status_parameter;
+    // 周期ごとに送るメールボックス
+    dynamixel_mailbox_t mailbox;
+    // 最初の周期を始めたか
+    bool started;
+    // 次の周期の予定の開始時刻と、その周期の番号
+    uint64_t next_start_us;
+    uint64_t next_cycle;
+    // 前の周期を実際に始めた時刻
+    uint64_t last_start_us;
+    dynamixel_cycle_statistics statistics;
+} dynamixel_cycle_struct;
+
+
+dynamixel_cycle_t dynamixel_cycle_create(
+    dynamixel_t dynamixel,
+    const dynamixel_cycle_config *config
+)
+{
+    if (config->period_us == 0)
+        return NULL;
+
+    dynamixel_cycle_t self = calloc(1, sizeof(dynamixel_cycle_struct));
+    if (!self)
+        return NULL;
+
+    self->dynamixel = dynamixel;
+    self->config = *config;
+    self->transaction = calloc(config->transaction_num, sizeof(cycle_transaction));
+    self->status_parameter = calloc(dynamixel_get_buffer_size(dynamixel), sizeof(uint8_t));
+    if ((config->transaction_num && !self->transaction) || !self->status_parameter)
+    {
+        dynamixel_cycle_destroy(self);
+        return NULL;
+    }
+    dynamixel_cycle_reset_statistics(self);
+
+    return self;
+}
+
+
+void dynamixel_cycle_destroy(
+    dynamixel_cycle_t self
+)
+{
+    free(self->transaction);
+    free(self->status_parameter);
+    free(self);
+}
+
+
+static int add_transaction(
+    dynamixel_cycle_t self,
+    bool write,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint8_t *data,
+    dynamixel_parse_result *result
+)
+{
+    cycle_transaction *transaction;
+
+    if (self->transaction_size >= self->config.transaction_num)
+        return 1;
+
+    transaction = &self->transaction[self->transaction_size++];
+    transaction->write = write;
+    transaction->id = id;
+    transaction->start_address = start_address;
+    transaction->data_size = data_size;
+    transaction->data = data;
+    transaction->result = result;
+
+    return 0;
+}
+
+
+int dynamixel_cycle_add_read(
+    dynamixel_cycle_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint8_t *data,
+    dynamixel_parse_result *result
+)
+{
+    return add_transaction(
+        self, false, id, start_address, data_size, data, result
+    );
+}
+
+
+int dynamixel_cycle_add_write(
+    dynamixel_cycle_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    const uint8_t *data,
+    dynamixel_parse_result *result
+)
+{
+    return add_transaction(
+        self, true, id, start_address, data_size, (uint8_t *)data, result
+    );
+}
+
+
+void dynamixel_cycle_set_mailbox(
+    dynamixel_cycle_t self,
+    dynamixel_mailbox_t mailbox
+)
+{
+    self->mailbox = mailbox;
+}
+
+
+static uint64_t get_time_us(
+    dynamixel_cycle_t self
+)
+{
+    return dynamixel_get_time_us(self->dynamixel);
+}
+
+
+static void sleep_until_us(
+    dynamixel_cycle_t self,
+    uint64_t deadline_us
+)
+{
+    uint64_t now_us;
+
+    if (self->config.sleep_until)
+    {
+        self->config.sleep_until(self->config.sleep_context, deadline_us);
+        return;
+    }
+
+    now_us = get_time_us(self);
+    if (now_us < deadline_us)
+        sleep_us(deadline_us - now_us);
+}
+
+
+/**
+ * @brief 登録したreadまたはwriteを、登録した順に1回ずつ送る
+*/
+static void run_transactions(
+    dynamixel_cycle_t self,
+    bool write
+)
+{
+    cycle_transaction *transaction;
+    dynamixel_parse_result result;
+    uint8_t error;
+
+    for (size_t i = 0; i < self->transaction_size; i++)
+    {
+        transaction = &self->transaction[i];
+        if (transaction->write != write)
+            continue;
+
+        if (write)
+        {
+            result = dynamixel_send_write_once(
+                self->dynamixel, transaction->id,
+                transaction->start_address, transaction->data_size,
+                transaction->data, &error, 0
+            );
+        }
+        else
+        {
+            // 期待より大きい応答パケットで保存先を超えないように、一度readバッファーと同じサイズの領域で受け取る
+            result = dynamixel_send_read_once(
+                self->dynamixel, transaction->id,
+                transaction->start_address, transaction->data_size,
+                &error, self->status_parameter, 0
+            );
+            if (result == DYNAMIXEL_PARSE_SUCCESS)
+                memcpy(transaction->data, self->status_parameter, transaction->data_size);
+        }
+
+        if (result != DYNAMIXEL_PARSE_SUCCESS)
+            self->statistics.transaction_errors++;
+        if (transaction->result)
+            *transaction->result = result;
+    }
+}
+
+
+/// 処理の時間を記録する
+static void record_phase(
+    dynamixel_cycle_t self,
+    dynamixel_cycle_phase phase,
+    uint64_t start_us,
+    uint64_t end_us
+)
+{
+    uint32_t elapsed_us = (uint32_t)(end_us - start_us);
+
+    if (elapsed_us > self->statistics.phase_max_us[phase])
+        self->statistics.phase_max_us[phase] = elapsed_us;
+    self->statistics.phase_sum_us[phase] += elapsed_us;
+}
+
+
+int dynamixel_cycle_run(
+    dynamixel_cycle_t self
+)
+{
+    dynamixel_cycle_statistics *statistics = &self->statistics;
+    uint64_t start_us, read_end_us, compute_end_us, end_us, late_num;
+    uint32_t start_delay_us, period_us;
+    uint64_t cycle;
+
+    start_us = get_time_us(self);
+    if (!self->started)
+    {
+        self->next_start_us = start_us;
+        self->started = true;
+    }
+    else if (start_us < self->next_start_us)
+    {
+        sleep_until_us(self, self->next_start_us);
+        start_us = get_time_us(self);
+    }
+
+    cycle = self->next_cycle;
+    start_delay_us = (uint32_t)(start_us - self->next_start_us);
+    if (start_delay_us > statistics->start_delay_max_us)
+        statistics->start_delay_max_us = start_delay_us;
+    statistics->start_delay_sum_us += start_delay_us;
+
+    if (statistics->cycles > 0)
+    {
+        period_us = (uint32_t)(start_us - self->last_start_us);
+        if (period_us < statistics->period_min_us)
+            statistics->period_min_us = period_us;
+        if (period_us > statistics->period_max_us)
+            statistics->period_max_us = period_us;
+    }
+    self->last_start_us = start_us;
+    statistics->cycles++;
+
+    run_transactions(self, false);
+    read_end_us = get_time_us(self);
+    record_phase(self, DYNAMIXEL_CYCLE_PHASE_READ, start_us, read_end_us);
+
+    if (self->config.compute)
+        self->config.compute(self->config.user_data, cycle);
+    compute_end_us = get_time_us(self);
+    record_phase(self, DYNAMIXEL_CYCLE_PHASE_COMPUTE, read_end_us, compute_end_us);
+
+    run_transactions(self, true);
+    if (self->mailbox)
+        dynamixel_mailbox_flush(self->mailbox, self->dynamixel);
+    end_us = get_time_us(self);
+    record_phase(self, DYNAMIXEL_CYCLE_PHASE_WRITE, compute_end_us, end_us);
+
+    // 開始時刻は周期の整数倍の時刻とする(処理時間や遅れを次の周期に持ち越さない)
+    self->next_start_us += self->config.period_us;
+    self->next_cycle++;
+    if (end_us <= self->next_start_us)
+        return 0;
+
+    statistics->overruns++;
+    if (self->config.overrun_policy == DYNAMIXEL_CYCLE_OVERRUN_COMPRESS)
+    {
+        // すぐに始める。1周期以上遅れた分は飛ばす
+        late_num = (end_us - self->next_start_us) / self->config.period_us;
+    }
+    else
+    {
+        // 終わった後の最初の開始時刻まで飛ばす
+        late_num = (end_us - self->next_start_us) / self->config.period_us + 1;
+    }
+    self->next_start_us += late_num * self->config.period_us;
+    self->next_cycle += late_num;
+    statistics->skipped_cycles += late_num;
+
+    return 1;
+}
+
+
+void dynamixel_cycle_get_statistics(
+    dynamixel_cycle_t self,
+    dynamixel_cycle_statistics *statistics
+)
+{
+    *statistics = self->statistics;
+}
+
+
+void dynamixel_cycle_reset_statistics(
+    dynamixel_cycle_t self
+)
+{
+    memset(&self->statistics, 0, sizeof(dynamixel_cycle_statistics));
+    self->statistics.period_min_us = UINT32_MAX;
+}
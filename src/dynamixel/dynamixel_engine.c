@@ -0,0 +1,347 @@
+#include <stdlib.h>
+#include <string.h>
+#include "dynamixel/dynamixel_engine.h"
+#include "util/spsc_queue.h"
+#include "dynamixel_engine_worker.h"
+#include "dynamixel_protocol.h"
+
+
+/**
+ * @brief コマンドキューの要素
+ *
+ * 後に追加情報が続く
+*/
+typedef struct
+{
+    uint8_t id;
+    uint8_t instruction;
+    uint16_t parameter_size;
+    uint wait_us_multiplier;
+    void *user_data;
+} command_entry;
+
+
+/**
+ * @brief 結果キューの要素
+ *
+ * 後に応答パケットのパラメータが続く
+*/
+typedef struct
+{
+    void *user_data;
+    uint8_t id;
+    uint8_t instruction;
+    uint8_t error;
+    dynamixel_parse_result result;
+    size_t status_parameter_size;
+} result_entry;
+
+
+typedef struct dynamixel_engine_struct
+{
+    dynamixel_t dynamixel;
+    dynamixel_engine_config config;
+    // core0からcore1へのコマンド
+    spsc_queue_t command_queue;
+    // core1からcore0への結果
+    spsc_queue_t result_queue;
+    // 応答パケットのパラメータを解析する領域(readバッファーと同じサイズ、core1のみが使う)
+    uint8_t *status_parameter;
+    // dynamixel_engine_poll()で取り出して、まだ解放していない結果があるか(core0のみが使う)
+    bool result_held;
+    // core1に停止を要求したか
+    bool stop_requested;
+    // 動作中のワーカー(動作していない場合はNULL)
+    void *worker;
+} dynamixel_engine_struct;
+
+
+dynamixel_engine_t dynamixel_engine_create(
+    dynamixel_t dynamixel,
+    const dynamixel_engine_config *config
+)
+{
+    dynamixel_engine_t self = calloc(1, sizeof(dynamixel_engine_struct));
+    if (!self)
+        return NULL;
+
+    self->dynamixel = dynamixel;
+    self->config = *config;
+    self->command_queue = spsc_queue_create(
+        config->command_num, sizeof(command_entry) + config->parameter_size
+    );
+    self->result_queue = spsc_queue_create(
+        config->result_num, sizeof(result_entry) + config->status_parameter_size
+    );
+    self->status_parameter = calloc(dynamixel_get_buffer_size(dynamixel), sizeof(uint8_t));
+
+    if (!self->command_queue || !self->result_queue || !self->status_parameter)
+    {
+        if (self->command_queue)
+            spsc_queue_destroy(self->command_queue);
+        if (self->result_queue)
+            spsc_queue_destroy(self->result_queue);
+        free(self->status_parameter);
+        free(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+
+void dynamixel_engine_destroy(
+    dynamixel_engine_t self
+)
+{
+    dynamixel_engine_stop(self);
+
+    spsc_queue_destroy(self->command_queue);
+    spsc_queue_destroy(self->result_queue);
+    free(self->status_parameter);
+    free(self);
+}
+
+
+int dynamixel_engine_start(
+    dynamixel_engine_t self
+)
+{
+    if (self->worker)
+        return 1;
+
+    __atomic_store_n(&self->stop_requested, false, __ATOMIC_RELEASE);
+    return dynamixel_engine_worker_launch(self, &self->worker);
+}
+
+
+void dynamixel_engine_stop(
+    dynamixel_engine_t self
+)
+{
+    if (!self->worker)
+        return;
+
+    __atomic_store_n(&self->stop_requested, true, __ATOMIC_RELEASE);
+    dynamixel_engine_worker_join(self->worker);
+    self->worker = NULL;
+}
+
+
+int dynamixel_engine_submit(
+    dynamixel_engine_t self,
+    const dynamixel_engine_command *command
+)
+{
+    command_entry *entry;
+    int response_num;
+
+    if (command->parameter_size > self->config.parameter_size)
+        return 1;
+    // 全ての応答パケットの結果が、結果キューに一度に入る必要がある
+    response_num = dynamixel_count_response(command->id, command->instruction, command->parameter_size);
+    if (response_num < 0 || (size_t)response_num > self->config.result_num)
+        return 1;
+
+    entry = (command_entry *)spsc_queue_back(self->command_queue);
+    if (!entry)
+        return 1;
+
+    entry->id = command->id;
+    entry->instruction = command->instruction;
+    entry->parameter_size = command->parameter_size;
+    entry->wait_us_multiplier = command->wait_us_multiplier;
+    entry->user_data = command->user_data;
+    if (command->parameter_size > 0)
+        memcpy(entry + 1, command->parameter, command->parameter_size);
+
+    return spsc_queue_push(self->command_queue);
+}
+
+
+int dynamixel_engine_poll(
+    dynamixel_engine_t self,
+    dynamixel_engine_result *result
+)
+{
+    result_entry *entry;
+
+    // 前に取り出した結果の領域をcore1に返す
+    if (self->result_held)
+    {
+        spsc_queue_pop(self->result_queue);
+        self->result_held = false;
+    }
+
+    entry = (result_entry *)spsc_queue_front(self->result_queue);
+    if (!entry)
+        return 1;
+
+    result->user_data = entry->user_data;
+    result->id = entry->id;
+    result->instruction = entry->instruction;
+    result->result = entry->result;
+    result->error = entry->error;
+    result->status_parameter_size = entry->status_parameter_size;
+    result->status_parameter = (const uint8_t *)(entry + 1);
+    self->result_held = true;
+
+    return 0;
+}
+
+
+/**
+ * @brief 結果を結果キューに入れる
+ *
+ * 応答パケットのパラメータは、status_parameterから結果の領域にコピーする
+*/
+static void push_result(
+    dynamixel_engine_t self,
+    const command_entry *command,
+    uint8_t id,
+    dynamixel_parse_result parse_result,
+    uint8_t error,
+    size_t status_parameter_size
+)
+{
+    result_entry *result = (result_entry *)spsc_queue_back(self->result_queue);
+
+    result->user_data = command->user_data;
+    result->id = id;
+    result->instruction = command->instruction;
+    result->result = parse_result;
+    result->error = error;
+    result->status_parameter_size = status_parameter_size;
+
+    if (result->status_parameter_size > self->config.status_parameter_size)
+    {
+        result->result = DYNAMIXEL_PARSE_HUGE_DATA;
+        result->status_parameter_size = self->config.status_parameter_size;
+    }
+    memcpy(result + 1, self->status_parameter, result->status_parameter_size);
+
+    spsc_queue_push(self->result_queue);
+}
+
+
+/**
+ * @brief Sync Read、Bulk Readを送り、IDごとの応答パケットを順に受け取る
+*/
+static void run_response_train(
+    dynamixel_engine_t self,
+    const command_entry *command,
+    size_t response_num
+)
+{
+    dynamixel_parse_result parse_result = DYNAMIXEL_PARSE_WRITE_FAILED;
+    uint8_t error = 0, id;
+    uint16_t data_size;
+    size_t status_parameter_size = 0, index = 0;
+
+    // 応答パケットの待ち時間は、送信が完了してからIDごとに数える
+    if (
+        !dynamixel_start_write_packet(
+            self->dynamixel, command->id, command->instruction,
+            command->parameter_size, (const uint8_t *)(command + 1)
+        )
+        && dynamixel_wait_done(self->dynamixel) == DYNAMIXEL_STATE_DONE
+    )
+        parse_result = dynamixel_get_packet_result(
+            self->dynamixel, &error, &status_parameter_size, self->status_parameter
+        );
+
+    while (parse_result == DYNAMIXEL_PARSE_SUCCESS && index < response_num)
+    {
+        data_size = dynamixel_get_response(
+            command->id, command->instruction, (const uint8_t *)(command + 1), index++, &id
+        );
+        dynamixel_start_read_packet(self->dynamixel, id, DYNAMIXEL_STATUS_PACKET_OVERHEAD + data_size);
+        dynamixel_wait_done(self->dynamixel);
+        parse_result = dynamixel_get_packet_result(
+            self->dynamixel, &error, &status_parameter_size, self->status_parameter
+        );
+        // 応答パケットのパラメータサイズは、インストラクションで指定したデータサイズと等しい必要がある
+        if (parse_result == DYNAMIXEL_PARSE_SUCCESS && status_parameter_size != data_size)
+            push_result(self, command, id, DYNAMIXEL_PARSE_WRONG_PARAMETER, error, 0);
+        else
+            push_result(self, command, id, parse_result, error, status_parameter_size);
+
+        // 後のIDは前のIDの応答パケットを待ってから応答するので、応答が途切れたときだけ待つのをやめる
+        if (parse_result != DYNAMIXEL_PARSE_NO_RESPONSE)
+            parse_result = DYNAMIXEL_PARSE_SUCCESS;
+    }
+
+    // 送信できなかった、または応答が途切れたときは、残りのIDも同じ結果とする
+    for (; index < response_num; index++)
+    {
+        dynamixel_get_response(command->id, command->instruction, (const uint8_t *)(command + 1), index, &id);
+        push_result(self, command, id, parse_result, 0, 0);
+    }
+}
+
+
+bool dynamixel_engine_step(
+    dynamixel_engine_t self
+)
+{
+    command_entry *command = (command_entry *)spsc_queue_front(self->command_queue);
+    dynamixel_parse_result parse_result;
+    uint8_t error = 0;
+    size_t status_parameter_size = 0, response_num;
+
+    if (!command)
+        return false;
+
+    // 全ての結果を入れる領域がないときは、core0が結果を取り出すまで実行しない
+    response_num = dynamixel_count_response(command->id, command->instruction, command->parameter_size);
+    if (
+        spsc_queue_capacity(self->result_queue) - spsc_queue_size(self->result_queue)
+        < (response_num > 0 ? response_num : 1)
+    )
+        return false;
+
+    if (response_num == 0)
+    {
+        // 応答パケットを返さないインストラクションは、送信が完了したら終わる
+        parse_result = dynamixel_write_uart_packet(
+            self->dynamixel, command->id, command->instruction,
+            command->parameter_size, (const uint8_t *)(command + 1)
+        ) || dynamixel_wait_write(self->dynamixel)
+            ? DYNAMIXEL_PARSE_WRITE_FAILED
+            : DYNAMIXEL_PARSE_SUCCESS;
+        push_result(self, command, command->id, parse_result, 0, 0);
+    }
+    else if (
+        command->instruction == DYNAMIXEL__INSTRUCTION_SYNC_READ
+        || command->instruction == DYNAMIXEL__INSTRUCTION_BULK_READ
+    )
+        run_response_train(self, command, response_num);
+    else
+    {
+        parse_result = dynamixel_send_packet(
+            self->dynamixel,
+            command->id, command->instruction,
+            command->parameter_size, (const uint8_t *)(command + 1),
+            &error, &status_parameter_size, self->status_parameter,
+            command->wait_us_multiplier
+        );
+        push_result(self, command, command->id, parse_result, error, status_parameter_size);
+    }
+
+    spsc_queue_pop(self->command_queue);
+
+    return true;
+}
+
+
+void dynamixel_engine_worker_run(
+    dynamixel_engine_t self,
+    void (*idle)(void)
+)
+{
+    while (!__atomic_load_n(&self->stop_requested, __ATOMIC_ACQUIRE))
+    {
+        if (!dynamixel_engine_step(self))
+            idle();
+    }
+}
@@ -0,0 +1,61 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include "dynamixel_engine_worker.h"
+
+
+typedef struct
+{
+    pthread_t thread;
+    dynamixel_engine_t engine;
+} host_worker;
+
+
+/// コマンドがない間は、他のスレッド(core0の代わり)にCPUを譲る
+static void yield(void)
+{
+    sched_yield();
+}
+
+
+static void *run_worker(
+    void *arg
+)
+{
+    host_worker *worker = (host_worker *)arg;
+
+    dynamixel_engine_worker_run(worker->engine, yield);
+    return NULL;
+}
+
+
+int dynamixel_engine_worker_launch(
+    dynamixel_engine_t self,
+    void **worker
+)
+{
+    host_worker *host = calloc(1, sizeof(host_worker));
+    if (!host)
+        return 1;
+
+    host->engine = self;
+    if (pthread_create(&host->thread, NULL, run_worker, host))
+    {
+        free(host);
+        return 1;
+    }
+
+    *worker = host;
+    return 0;
+}
+
+
+void dynamixel_engine_worker_join(
+    void *worker
+)
+{
+    host_worker *host = (host_worker *)worker;
+
+    pthread_join(host->thread, NULL);
+    free(host);
+}
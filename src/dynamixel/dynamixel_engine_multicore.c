@@ -0,0 +1,61 @@
+#include "pico/multicore.h"
+#include "dynamixel_engine_worker.h"
+
+
+// core1は1つしかないので、同時に動かせるエンジンも1つ
+static dynamixel_engine_t core1_engine = NULL;
+// core1でdynamixel_engine_worker_run()が戻ったか
+static bool core1_finished = false;
+
+
+static void idle(void)
+{
+    tight_loop_contents();
+}
+
+
+/**
+ * @brief core1の処理
+ *
+ * UARTの受信割り込み(pico_uart_enable_rx_irq())を使う場合、割り込みは有効にしたコアで処理される
+*/
+static void run_core1(void)
+{
+    dynamixel_engine_worker_run(core1_engine, idle);
+
+    __atomic_store_n(&core1_finished, true, __ATOMIC_RELEASE);
+    while (1)
+        tight_loop_contents();
+}
+
+
+int dynamixel_engine_worker_launch(
+    dynamixel_engine_t self,
+    void **worker
+)
+{
+    if (core1_engine)
+        return 1;
+
+    core1_engine = self;
+    core1_finished = false;
+    multicore_reset_core1();
+    multicore_launch_core1(run_core1);
+
+    *worker = self;
+    return 0;
+}
+
+
+void dynamixel_engine_worker_join(
+    void *worker
+)
+{
+    (void)worker;
+
+    while (!__atomic_load_n(&core1_finished, __ATOMIC_ACQUIRE))
+        tight_loop_contents();
+
+    multicore_reset_core1();
+    core1_engine = NULL;
+}
@@ -0,0 +1,47 @@
+#ifndef _ONE_DYNAMIXEL_DYNAMIXEL_ENGINE_WORKER_H
+#define _ONE_DYNAMIXEL_DYNAMIXEL_ENGINE_WORKER_H
+
+#include "dynamixel/dynamixel_engine.h"
+
+/**
+ * エンジンのコマンドを実行する側(ワーカー)と、ワーカーを動かすプラットフォームごとの実装の間の関数。
+ * 実機ではcore1(dynamixel_engine_multicore.c)、hostではスレッド(dynamixel_engine_host.c)でワーカーを動かす
+*/
+
+
+/**
+ * @brief 停止を要求されるまでコマンドを実行する
+ *
+ * @param[in] self エンジン
+ * @param[in] idle 実行できるコマンドがないときに呼ぶ関数
+*/
+void dynamixel_engine_worker_run(
+    dynamixel_engine_t self,
+    void (*idle)(void)
+);
+
+
+/**
+ * @brief dynamixel_engine_worker_run()を別のコア(スレッド)で起動する
+ *
+ * @param[in] self エンジン
+ * @param[out] **worker dynamixel_engine_worker_join()に渡す値
+ * @retval 0 起動した
+ * @retval 1 起動できなかった
+*/
+int dynamixel_engine_worker_launch(
+    dynamixel_engine_t self,
+    void **worker
+);
+
+
+/**
+ * @brief dynamixel_engine_worker_run()が戻るまで待ち、コア(スレッド)を解放する
+ *
+ * @param[in] *worker dynamixel_engine_worker_launch()で受け取った値
+*/
+void dynamixel_engine_worker_join(
+    void *worker
+);
+
+#endif
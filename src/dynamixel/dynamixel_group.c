@@ -0,0 +1,515 @@
+#include <stdlib.h>
+#include <string.h>
+#include "dynamixel/dynamixel_group.h"
+#include "dynamixel_group_runner.h"
+#include "dynamixel_protocol.h"
+
+
+/// 交互に進めるときに、どのバスも進まなかった場合に受信を待つ最大の時間[micro sec.]
+#define INTERLEAVE_WAIT_US 10
+
+
+/**
+ * @brief 登録したreadまたはwrite
+*/
+typedef struct
+{
+    bool write;
+    size_t bus;
+    uint8_t id;
+    uint16_t start_address;
+    uint16_t data_size;
+    // readでは読み取ったデータの保存先、writeでは書き込むデータ
+    uint8_t *data;
+    dynamixel_parse_result *result;
+} group_transaction;
+
+
+/**
+ * @brief バスごとの状態
+ *
+ * 実行中は、そのバスを進めるスレッドだけが触る
+*/
+typedef struct
+{
+    dynamixel_t dynamixel;
+    // 応答パケットのパラメータを受け取る領域(readバッファーと同じサイズ)
+    uint8_t *status_parameter;
+    // 交互に進めるときに、送信を開始するパケットの追加情報を作る領域
+    uint8_t *parameter;
+    size_t parameter_capacity;
+    // 交互に進めるときの、次に調べる登録の添字と通信中の登録
+    size_t next;
+    group_transaction *active;
+    uint64_t start_us;
+    // 最後のreadまたはwriteの時間と、成功しなかった数
+    uint32_t elapsed_us;
+    uint64_t errors;
+} group_bus;
+
+
+typedef struct dynamixel_group_struct
+{
+    dynamixel_group_config config;
+    group_bus *bus;
+    // IDがつながっているバスの番号+1(0は登録していない)
+    size_t bus_of_id[DYNAMIXEL_MAX_ID + 1];
+    group_transaction *transaction;
+    size_t transaction_size;
+    // バスごとのスレッド(NULLのときは呼び出し元で交互に進める)
+    void *runner;
+    dynamixel_group_statistics statistics;
+} dynamixel_group_struct;
+
+
+dynamixel_group_t dynamixel_group_create(
+    const dynamixel_group_config *config
+)
+{
+    if (config->bus_num == 0)
+        return NULL;
+
+    dynamixel_group_t self = calloc(1, sizeof(dynamixel_group_struct));
+    if (!self)
+        return NULL;
+
+    self->config = *config;
+    self->bus = calloc(config->bus_num, sizeof(group_bus));
+    self->transaction = calloc(config->transaction_num, sizeof(group_transaction));
+    if (!self->bus || (config->transaction_num && !self->transaction))
+    {
+        dynamixel_group_destroy(self);
+        return NULL;
+    }
+    self->config.bus = NULL;
+
+    for (size_t i = 0; i < config->bus_num; i++)
+    {
+        group_bus *bus = &self->bus[i];
+
+        bus->dynamixel = config->bus[i];
+        bus->status_parameter = calloc(dynamixel_get_buffer_size(bus->dynamixel), sizeof(uint8_t));
+        // readの追加情報(開始アドレスとデータサイズ)
+        bus->parameter_capacity = 4;
+        bus->parameter = calloc(bus->parameter_capacity, sizeof(uint8_t));
+        if (!bus->status_parameter || !bus->parameter)
+        {
+            dynamixel_group_destroy(self);
+            return NULL;
+        }
+    }
+
+    // バスが1つのときは並行して動かすものがない
+    if (
+        !config->interleaved && config->bus_num > 1
+        && dynamixel_group_runner_launch(self, config->bus_num, &self->runner)
+    )
+    {
+        dynamixel_group_destroy(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+
+void dynamixel_group_destroy(
+    dynamixel_group_t self
+)
+{
+    if (self->runner)
+        dynamixel_group_runner_join(self->runner);
+
+    if (self->bus)
+    {
+        for (size_t i = 0; i < self->config.bus_num; i++)
+        {
+            free(self->bus[i].status_parameter);
+            free(self->bus[i].parameter);
+        }
+    }
+    free(self->bus);
+    free(self->transaction);
+    free(self);
+}
+
+
+int dynamixel_group_assign(
+    dynamixel_group_t self,
+    uint8_t id,
+    size_t bus
+)
+{
+    if (id > DYNAMIXEL_MAX_ID || bus >= self->config.bus_num)
+        return 1;
+
+    self->bus_of_id[id] = bus + 1;
+    return 0;
+}
+
+
+static int add_transaction(
+    dynamixel_group_t self,
+    bool write,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint8_t *data,
+    dynamixel_parse_result *result
+)
+{
+    group_transaction *transaction;
+    group_bus *bus;
+
+    if (self->transaction_size >= self->config.transaction_num)
+        return 1;
+    if (id > DYNAMIXEL_MAX_ID || self->bus_of_id[id] == 0)
+        return 1;
+
+    bus = &self->bus[self->bus_of_id[id] - 1];
+    if (write && 2 + (size_t)data_size > bus->parameter_capacity)
+    {
+        uint8_t *parameter = realloc(bus->parameter, 2 + data_size);
+        if (!parameter)
+            return 1;
+        bus->parameter = parameter;
+        bus->parameter_capacity = 2 + data_size;
+    }
+
+    transaction = &self->transaction[self->transaction_size++];
+    transaction->write = write;
+    transaction->bus = self->bus_of_id[id] - 1;
+    transaction->id = id;
+    transaction->start_address = start_address;
+    transaction->data_size = data_size;
+    transaction->data = data;
+    transaction->result = result;
+
+    return 0;
+}
+
+
+int dynamixel_group_add_read(
+    dynamixel_group_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint8_t *data,
+    dynamixel_parse_result *result
+)
+{
+    return add_transaction(
+        self, false, id, start_address, data_size, data, result
+    );
+}
+
+
+int dynamixel_group_add_write(
+    dynamixel_group_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    const uint8_t *data,
+    dynamixel_parse_result *result
+)
+{
+    return add_transaction(
+        self, true, id, start_address, data_size, (uint8_t *)data, result
+    );
+}
+
+
+/// 結果を保存する
+static void finish_transaction(
+    group_bus *bus,
+    group_transaction *transaction,
+    dynamixel_parse_result result
+)
+{
+    if (result == DYNAMIXEL_PARSE_SUCCESS && !transaction->write)
+        memcpy(transaction->data, bus->status_parameter, transaction->data_size);
+
+    if (result != DYNAMIXEL_PARSE_SUCCESS)
+        bus->errors++;
+    if (transaction->result)
+        *transaction->result = result;
+}
+
+
+void dynamixel_group_run_bus(
+    dynamixel_group_t self,
+    size_t bus_index,
+    bool write
+)
+{
+    group_bus *bus = &self->bus[bus_index];
+    group_transaction *transaction;
+    dynamixel_parse_result result;
+    uint64_t start_us = dynamixel_get_time_us(bus->dynamixel);
+    uint8_t error;
+
+    for (size_t i = 0; i < self->transaction_size; i++)
+    {
+        transaction = &self->transaction[i];
+        if (transaction->bus != bus_index || transaction->write != write)
+            continue;
+
+        if (write)
+        {
+            result = dynamixel_send_write_once(
+                bus->dynamixel, transaction->id,
+                transaction->start_address, transaction->data_size,
+                transaction->data, &error, 0
+            );
+        }
+        else
+        {
+            // 期待より大きい応答パケットで保存先を超えないように、一度readバッファーと同じサイズの領域で受け取る
+            result = dynamixel_send_read_once(
+                bus->dynamixel, transaction->id,
+                transaction->start_address, transaction->data_size,
+                &error, bus->status_parameter, 0
+            );
+        }
+        finish_transaction(bus, transaction, result);
+    }
+
+    bus->elapsed_us = (uint32_t)(dynamixel_get_time_us(bus->dynamixel) - start_us);
+}
+
+
+/**
+ * @brief バスの次のreadまたはwriteの送信を開始する
+ *
+ * @retval true 送信を開始した
+ * @retval false バスのreadまたはwriteが全て終わった
+*/
+static bool start_next(
+    dynamixel_group_t self,
+    size_t bus_index,
+    bool write
+)
+{
+    group_bus *bus = &self->bus[bus_index];
+    group_transaction *transaction;
+    uint16_t parameter_size;
+
+    for (; bus->next < self->transaction_size; bus->next++)
+    {
+        transaction = &self->transaction[bus->next];
+        if (transaction->bus != bus_index || transaction->write != write)
+            continue;
+
+        // 開始アドレス
+        bus->parameter[0] = transaction->start_address & 0xff;
+        bus->parameter[1] = transaction->start_address >> 8;
+        if (write)
+        {
+            // 書き込みデータ
+            memcpy(bus->parameter + 2, transaction->data, transaction->data_size);
+            parameter_size = 2 + transaction->data_size;
+        }
+        else
+        {
+            // バイトサイズ
+            bus->parameter[2] = transaction->data_size & 0xff;
+            bus->parameter[3] = transaction->data_size >> 8;
+            parameter_size = 4;
+        }
+
+        bus->next++;
+        if (dynamixel_start_packet(
+            bus->dynamixel, transaction->id,
+            write ? DYNAMIXEL__INSTRUCTION_WRITE : DYNAMIXEL__INSTRUCTION_READ,
+            parameter_size, bus->parameter, 0
+        ))
+        {
+            finish_transaction(bus, transaction, DYNAMIXEL_PARSE_NO_RESPONSE);
+            continue;
+        }
+
+        bus->active = transaction;
+        return true;
+    }
+
+    bus->active = NULL;
+    return false;
+}
+
+
+/**
+ * @brief 通信中のバスを1回進める
+ *
+ * @retval true 状態が変わった
+ * @retval false 受信を待っている、または送信中
+*/
+static bool poll_bus(
+    dynamixel_group_t self,
+    size_t bus_index,
+    bool write,
+    size_t *active_num
+)
+{
+    group_bus *bus = &self->bus[bus_index];
+    dynamixel_state state = dynamixel_get_state(bus->dynamixel);
+    dynamixel_parse_result result;
+    size_t status_parameter_size;
+    uint8_t error;
+
+    if (
+        dynamixel_poll(bus->dynamixel, dynamixel_get_time_us(bus->dynamixel))
+        != DYNAMIXEL_STATE_DONE
+    )
+        return dynamixel_get_state(bus->dynamixel) != state;
+
+    result = dynamixel_get_packet_result(
+        bus->dynamixel, &error, &status_parameter_size, bus->status_parameter
+    );
+    // 応答パケットのパラメータサイズは、インストラクションで指定したデータサイズと等しい必要がある
+    if (
+        result == DYNAMIXEL_PARSE_SUCCESS && !write
+        && status_parameter_size != bus->active->data_size
+    )
+        result = DYNAMIXEL_PARSE_WRONG_PARAMETER;
+    finish_transaction(bus, bus->active, result);
+
+    if (!start_next(self, bus_index, write))
+    {
+        bus->elapsed_us = (uint32_t)(dynamixel_get_time_us(bus->dynamixel) - bus->start_us);
+        (*active_num)--;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief 全てのバスを、dynamixel_poll()で交互に進める
+ *
+ * 全てのバスを待たずに進め、どのバスも進まなかったときだけ受信を待つ。
+ * 待つのは期限が最も近いバスで、その期限を過ぎず、他のバスを待たせないようにINTERLEAVE_WAIT_USまでとする
+*/
+static void run_interleaved(
+    dynamixel_group_t self,
+    bool write
+)
+{
+    group_bus *bus;
+    size_t active_num = 0, wait_bus;
+    uint64_t now_us, deadline_us;
+    uint wait_us, bus_wait_us;
+    bool progressed;
+
+    for (size_t i = 0; i < self->config.bus_num; i++)
+    {
+        bus = &self->bus[i];
+        bus->next = 0;
+        bus->start_us = dynamixel_get_time_us(bus->dynamixel);
+        bus->elapsed_us = 0;
+        if (start_next(self, i, write))
+            active_num++;
+    }
+
+    while (active_num > 0)
+    {
+        progressed = false;
+        for (size_t i = 0; i < self->config.bus_num; i++)
+        {
+            if (self->bus[i].active && poll_bus(self, i, write, &active_num))
+                progressed = true;
+        }
+        if (progressed || active_num == 0)
+            continue;
+
+        wait_bus = self->config.bus_num;
+        wait_us = INTERLEAVE_WAIT_US;
+        for (size_t i = 0; i < self->config.bus_num; i++)
+        {
+            bus = &self->bus[i];
+            if (!bus->active)
+                continue;
+
+            // 送信中は期限がないので、INTERLEAVE_WAIT_USずつ待つ
+            deadline_us = dynamixel_get_deadline_us(bus->dynamixel);
+            now_us = dynamixel_get_time_us(bus->dynamixel);
+            bus_wait_us = INTERLEAVE_WAIT_US;
+            if (deadline_us != 0 && deadline_us < now_us + INTERLEAVE_WAIT_US)
+                bus_wait_us = deadline_us > now_us ? deadline_us - now_us : 0;
+
+            if (wait_bus == self->config.bus_num || bus_wait_us < wait_us)
+            {
+                wait_bus = i;
+                wait_us = bus_wait_us;
+            }
+        }
+
+        dynamixel_wait_readable(self->bus[wait_bus].dynamixel, wait_us);
+    }
+}
+
+
+/**
+ * @brief 全てのバスのreadまたはwriteを並行して行う
+ *
+ * @return バスごとの時間のうち最も長いもの[micro sec.]
+*/
+static uint32_t run_phase(
+    dynamixel_group_t self,
+    bool write
+)
+{
+    uint32_t elapsed_us = 0;
+
+    if (self->runner)
+        dynamixel_group_runner_run(self->runner, write);
+    else if (self->config.bus_num == 1)
+        dynamixel_group_run_bus(self, 0, write);
+    else
+        run_interleaved(self, write);
+
+    for (size_t i = 0; i < self->config.bus_num; i++)
+    {
+        if (self->bus[i].elapsed_us > elapsed_us)
+            elapsed_us = self->bus[i].elapsed_us;
+    }
+
+    return elapsed_us;
+}
+
+
+int dynamixel_group_run(
+    dynamixel_group_t self
+)
+{
+    dynamixel_group_statistics *statistics = &self->statistics;
+    uint64_t errors = 0;
+
+    for (size_t i = 0; i < self->config.bus_num; i++)
+        self->bus[i].errors = 0;
+
+    statistics->last_read_us = run_phase(self, false);
+    if (self->config.compute)
+        self->config.compute(self->config.user_data, statistics->runs);
+    statistics->last_write_us = run_phase(self, true);
+
+    if (statistics->last_read_us > statistics->read_max_us)
+        statistics->read_max_us = statistics->last_read_us;
+    if (statistics->last_write_us > statistics->write_max_us)
+        statistics->write_max_us = statistics->last_write_us;
+    statistics->runs++;
+
+    for (size_t i = 0; i < self->config.bus_num; i++)
+        errors += self->bus[i].errors;
+    statistics->transaction_errors += errors;
+
+    return errors > 0;
+}
+
+
+void dynamixel_group_get_statistics(
+    dynamixel_group_t self,
+    dynamixel_group_statistics *statistics
+)
+{
+    *statistics = self->statistics;
+}
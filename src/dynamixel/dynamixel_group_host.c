@@ -0,0 +1,150 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "dynamixel_group_runner.h"
+
+
+typedef struct host_runner host_runner;
+
+
+typedef struct
+{
+    pthread_t thread;
+    host_runner *runner;
+    size_t bus;
+} host_bus_thread;
+
+
+/**
+ * @brief バスごとのスレッド
+ *
+ * スレッドは作成時に起動しておき、実行ごとに世代を進めて起こす(実行ごとにスレッドを作らない)
+*/
+struct host_runner
+{
+    dynamixel_group_t group;
+    size_t bus_num;
+    host_bus_thread *thread;
+    size_t thread_num;
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t finish;
+    // 実行ごとに1つ進める
+    uint64_t generation;
+    bool write;
+    // まだ終わっていないバスの数
+    size_t remaining;
+    bool stop;
+};
+
+
+static void *run_bus_thread(
+    void *arg
+)
+{
+    host_bus_thread *thread = (host_bus_thread *)arg;
+    host_runner *runner = thread->runner;
+    uint64_t generation = 0;
+    bool write;
+
+    pthread_mutex_lock(&runner->mutex);
+    while (1)
+    {
+        while (!runner->stop && runner->generation == generation)
+            pthread_cond_wait(&runner->start, &runner->mutex);
+        if (runner->stop)
+            break;
+
+        generation = runner->generation;
+        write = runner->write;
+        pthread_mutex_unlock(&runner->mutex);
+
+        dynamixel_group_run_bus(runner->group, thread->bus, write);
+
+        pthread_mutex_lock(&runner->mutex);
+        if (--runner->remaining == 0)
+            pthread_cond_signal(&runner->finish);
+    }
+    pthread_mutex_unlock(&runner->mutex);
+
+    return NULL;
+}
+
+
+int dynamixel_group_runner_launch(
+    dynamixel_group_t self,
+    size_t bus_num,
+    void **runner
+)
+{
+    host_runner *host = calloc(1, sizeof(host_runner));
+    if (!host)
+        return 1;
+
+    host->group = self;
+    host->bus_num = bus_num;
+    host->thread = calloc(bus_num, sizeof(host_bus_thread));
+    if (!host->thread)
+    {
+        free(host);
+        return 1;
+    }
+    pthread_mutex_init(&host->mutex, NULL);
+    pthread_cond_init(&host->start, NULL);
+    pthread_cond_init(&host->finish, NULL);
+
+    for (size_t i = 0; i < bus_num; i++)
+    {
+        host->thread[i].runner = host;
+        host->thread[i].bus = i;
+        if (pthread_create(&host->thread[i].thread, NULL, run_bus_thread, &host->thread[i]))
+        {
+            dynamixel_group_runner_join(host);
+            return 1;
+        }
+        host->thread_num++;
+    }
+
+    *runner = host;
+    return 0;
+}
+
+
+void dynamixel_group_runner_run(
+    void *runner,
+    bool write
+)
+{
+    host_runner *host = (host_runner *)runner;
+
+    pthread_mutex_lock(&host->mutex);
+    host->write = write;
+    host->remaining = host->bus_num;
+    host->generation++;
+    pthread_cond_broadcast(&host->start);
+
+    while (host->remaining > 0)
+        pthread_cond_wait(&host->finish, &host->mutex);
+    pthread_mutex_unlock(&host->mutex);
+}
+
+
+void dynamixel_group_runner_join(
+    void *runner
+)
+{
+    host_runner *host = (host_runner *)runner;
+
+    pthread_mutex_lock(&host->mutex);
+    host->stop = true;
+    pthread_cond_broadcast(&host->start);
+    pthread_mutex_unlock(&host->mutex);
+
+    for (size_t i = 0; i < host->thread_num; i++)
+        pthread_join(host->thread[i].thread, NULL);
+
+    pthread_cond_destroy(&host->finish);
+    pthread_cond_destroy(&host->start);
+    pthread_mutex_destroy(&host->mutex);
+    free(host->thread);
+    free(host);
+}
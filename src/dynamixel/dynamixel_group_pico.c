@@ -0,0 +1,39 @@
+#include "dynamixel_group_runner.h"
+
+
+/**
+ * 実機では、core1をdynamixel_engineが使うことがあるので、バスごとに動かすコアはない。
+ * ランナーを起動せず、呼び出し元でdynamixel_poll()を使って全てのバスを交互に進める
+*/
+
+
+int dynamixel_group_runner_launch(
+    dynamixel_group_t self,
+    size_t bus_num,
+    void **runner
+)
+{
+    (void)self;
+    (void)bus_num;
+
+    *runner = NULL;
+    return 0;
+}
+
+
+void dynamixel_group_runner_run(
+    void *runner,
+    bool write
+)
+{
+    (void)runner;
+    (void)write;
+}
+
+
+void dynamixel_group_runner_join(
+    void *runner
+)
+{
+    (void)runner;
+}
@@ -0,0 +1,64 @@
+#ifndef _ONE_DYNAMIXEL_DYNAMIXEL_GROUP_RUNNER_H
+#define _ONE_DYNAMIXEL_DYNAMIXEL_GROUP_RUNNER_H
+
+#include "dynamixel/dynamixel_group.h"
+
+/**
+ * グループのバスごとの通信と、バスを並行して動かすプラットフォームごとの実装の間の関数。
+ * hostではバスごとのスレッド(dynamixel_group_host.c)で動かす。
+ * 実機(dynamixel_group_pico.c)ではランナーを起動せず、呼び出し元で全てのバスを交互に進める
+*/
+
+
+/**
+ * @brief 1つのバスのreadまたはwriteを、登録した順に応答を待ちながら送る
+ *
+ * @param[in] self グループ
+ * @param[in] bus バスの番号
+ * @param[in] write trueのときwrite、falseのときread
+*/
+void dynamixel_group_run_bus(
+    dynamixel_group_t self,
+    size_t bus,
+    bool write
+);
+
+
+/**
+ * @brief バスごとにdynamixel_group_run_bus()を動かすランナーを起動する
+ *
+ * @param[in] self グループ
+ * @param[in] bus_num バスの数
+ * @param[out] **runner dynamixel_group_runner_run()に渡す値(NULLのときは、呼び出し元で全てのバスを交互に進める)
+ * @retval 0 起動した(または起動する必要がない)
+ * @retval 1 起動できなかった
+*/
+int dynamixel_group_runner_launch(
+    dynamixel_group_t self,
+    size_t bus_num,
+    void **runner
+);
+
+
+/**
+ * @brief 全てのバスでdynamixel_group_run_bus()を並行して動かし、全てが終わるまで待つ
+ *
+ * @param[in] *runner dynamixel_group_runner_launch()で受け取った値
+ * @param[in] write trueのときwrite、falseのときread
+*/
+void dynamixel_group_runner_run(
+    void *runner,
+    bool write
+);
+
+
+/**
+ * @brief ランナーを止めて解放する
+ *
+ * @param[in] *runner dynamixel_group_runner_launch()で受け取った値
+*/
+void dynamixel_group_runner_join(
+    void *runner
+);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _ONE_DYNAMIXEL_DYNAMIXEL_LOCK_H
+#define _ONE_DYNAMIXEL_DYNAMIXEL_LOCK_H
+
+/**
+ * 使っているGPIOピン、UARTインスタンスの記録を、複数のスレッド(コア)から同時に更新しないようにするロック。
+ * 実機ではpico_syncのmutex(dynamixel_lock_pico.c)、hostではpthreadのmutex(dynamixel_lock_host.c)を使う
+*/
+
+
+/**
+ * @brief 記録のロックを取る
+*/
+void dynamixel_lock_device_table(void);
+
+
+/**
+ * @brief 記録のロックを外す
+*/
+void dynamixel_unlock_device_table(void);
+
+#endif
@@ -0,0 +1,17 @@
+#include <pthread.h>
+#include "dynamixel_lock.h"
+
+
+static pthread_mutex_t device_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+void dynamixel_lock_device_table(void)
+{
+    pthread_mutex_lock(&device_table_mutex);
+}
+
+
+void dynamixel_unlock_device_table(void)
+{
+    pthread_mutex_unlock(&device_table_mutex);
+}
@@ -0,0 +1,17 @@
+#include "pico/mutex.h"
+#include "dynamixel_lock.h"
+
+
+auto_init_mutex(device_table_mutex);
+
+
+void dynamixel_lock_device_table(void)
+{
+    mutex_enter_blocking(&device_table_mutex);
+}
+
+
+void dynamixel_unlock_device_table(void)
+{
+    mutex_exit(&device_table_mutex);
+}
@@ -0,0 +1,295 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dynamixel/dynamixel_mailbox.h"
+#include "dynamixel_protocol.h"
+
+
+/// Sync Writeのパラメータの先頭(開始アドレスとデータサイズ)のサイズ
+#define SYNC_WRITE_HEADER_SIZE 4
+/// 読み取りが書き込みと重なったときに読み直す回数
+#define SNAPSHOT_RETRY_NUM 4
+
+
+/**
+ * @brief IDごとの値
+*/
+typedef struct
+{
+    uint8_t id;
+    // postするたびに2つ進める(奇数のときは書き込み中)
+    uint32_t sequence;
+    // 最後に送った値の番号(flushする側だけが触る)
+    uint32_t sent_sequence;
+    uint8_t *data;
+} mailbox_slot;
+
+
+typedef struct dynamixel_mailbox_struct
+{
+    uint16_t start_address;
+    uint16_t data_size;
+    mailbox_slot *slot;
+    size_t slot_num;
+    // IDの値の添字+1(0は作成時に指定していない)
+    uint8_t slot_of_id[DYNAMIXEL_MAX_ID + 1];
+    // Sync Writeのパラメータを作る領域(全てのIDの分)
+    uint8_t *parameter;
+    // 作成したSync Writeに入れた値の番号
+    uint32_t *parameter_sequence;
+    dynamixel_mailbox_statistics statistics;
+} dynamixel_mailbox_struct;
+
+
+dynamixel_mailbox_t dynamixel_mailbox_create(
+    const uint8_t *id,
+    size_t id_num,
+    uint16_t start_address,
+    uint16_t data_size
+)
+{
+    if (id_num == 0 || id_num > DYNAMIXEL_MAX_ID + 1 || data_size == 0)
+        return NULL;
+
+    dynamixel_mailbox_t self = calloc(1, sizeof(dynamixel_mailbox_struct));
+    if (!self)
+        return NULL;
+
+    self->start_address = start_address;
+    self->data_size = data_size;
+    self->slot = calloc(id_num, sizeof(mailbox_slot));
+    self->parameter = calloc(SYNC_WRITE_HEADER_SIZE + id_num * (1 + data_size), sizeof(uint8_t));
+    self->parameter_sequence = calloc(id_num, sizeof(uint32_t));
+    if (!self->slot || !self->parameter || !self->parameter_sequence)
+    {
+        dynamixel_mailbox_destroy(self);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < id_num; i++)
+    {
+        if (id[i] > DYNAMIXEL_MAX_ID || self->slot_of_id[id[i]] != 0)
+        {
+            dynamixel_mailbox_destroy(self);
+            return NULL;
+        }
+
+        self->slot[i].id = id[i];
+        self->slot[i].data = calloc(data_size, sizeof(uint8_t));
+        self->slot_num++;
+        if (!self->slot[i].data)
+        {
+            dynamixel_mailbox_destroy(self);
+            return NULL;
+        }
+        self->slot_of_id[id[i]] = i + 1;
+    }
+
+    return self;
+}
+
+
+void dynamixel_mailbox_destroy(
+    dynamixel_mailbox_t self
+)
+{
+    if (self->slot)
+    {
+        for (size_t i = 0; i < self->slot_num; i++)
+            free(self->slot[i].data);
+    }
+    free(self->slot);
+    free(self->parameter);
+    free(self->parameter_sequence);
+    free(self);
+}
+
+
+int dynamixel_mailbox_post(
+    dynamixel_mailbox_t self,
+    uint8_t id,
+    const uint8_t *data
+)
+{
+    mailbox_slot *slot;
+    uint32_t sequence;
+
+    if (id > DYNAMIXEL_MAX_ID || self->slot_of_id[id] == 0)
+        return 1;
+
+    slot = &self->slot[self->slot_of_id[id] - 1];
+    sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+
+    // 書き込み中にする。値の書き込みが、番号の更新より前に見えないようにする
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    for (size_t i = 0; i < self->data_size; i++)
+        __atomic_store_n(&slot->data[i], data[i], __ATOMIC_RELAXED);
+
+    __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+    return 0;
+}
+
+
+int dynamixel_mailbox_post_goal_position(
+    dynamixel_mailbox_t self,
+    uint8_t id,
+    float goal_position
+)
+{
+    uint8_t data[DYNAMIXEL_GOAL_POSITION_SIZE];
+    uint32_t goal_position_int;
+
+    if (self->start_address != DYNAMIXEL_GOAL_POSITION_ADDRESS || self->data_size != DYNAMIXEL_GOAL_POSITION_SIZE)
+        return 1;
+
+    goal_position_int = (uint32_t)(int32_t)round(goal_position / DYNAMIXEL_POSITION_DEGREE_PER_UNIT);
+    for (size_t i = 0; i < DYNAMIXEL_GOAL_POSITION_SIZE; i++)
+        data[i] = (goal_position_int >> (8 * i)) & 0xff;
+
+    return dynamixel_mailbox_post(self, id, data);
+}
+
+
+/**
+ * @brief 値を書き込み途中でない状態で読み取る
+ *
+ * @param[out] *data 値
+ * @param[out] *sequence 読み取った値の番号
+ * @retval true 読み取った
+ * @retval false 書き込みと重なり続けた(次のflushで読み取る)
+*/
+static bool take_snapshot(
+    dynamixel_mailbox_t self,
+    mailbox_slot *slot,
+    uint8_t *data,
+    uint32_t *sequence
+)
+{
+    uint32_t before, after;
+
+    for (size_t retry = 0; retry < SNAPSHOT_RETRY_NUM; retry++)
+    {
+        before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1)
+            continue;
+
+        for (size_t i = 0; i < self->data_size; i++)
+            data[i] = __atomic_load_n(&slot->data[i], __ATOMIC_RELAXED);
+
+        // 値の読み取りが、番号の読み直しより後に見えないようにする
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+        if (before == after)
+        {
+            *sequence = before;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief 作成したSync Writeを送り、入れた値を送ったことにする
+*/
+static size_t send_sync_write(
+    dynamixel_mailbox_t self,
+    dynamixel_t dynamixel,
+    size_t slot_num,
+    size_t *slot_index
+)
+{
+    mailbox_slot *slot;
+
+    if (
+        dynamixel_write_uart_packet(
+            dynamixel, DYNAMIXEL_BROADCAST_ID, DYNAMIXEL__INSTRUCTION_SYNC_WRITE,
+            SYNC_WRITE_HEADER_SIZE + slot_num * (1 + self->data_size), self->parameter
+        )
+        || dynamixel_wait_write(dynamixel)
+    )
+        return 0;
+
+    for (size_t i = 0; i < slot_num; i++)
+    {
+        slot = &self->slot[slot_index[i]];
+        // 前に送った後に上書きされた値は、送らなかった
+        self->statistics.superseded += (self->parameter_sequence[i] - slot->sent_sequence) / 2 - 1;
+        slot->sent_sequence = self->parameter_sequence[i];
+    }
+    self->statistics.sent += slot_num;
+    self->statistics.sync_writes++;
+
+    return slot_num;
+}
+
+
+size_t dynamixel_mailbox_flush(
+    dynamixel_mailbox_t self,
+    dynamixel_t dynamixel
+)
+{
+    mailbox_slot *slot;
+    size_t slot_index[DYNAMIXEL_MAX_ID + 1];
+    size_t packet_slot_num = 0, max_slot_num, sent_num = 0;
+    size_t parameter_max_size;
+    uint8_t *block;
+    uint32_t sequence;
+
+    // バイトスタッフィングで3Byteごとに1Byte増えても、バッファーに入る大きさ
+    parameter_max_size = dynamixel_get_buffer_size(dynamixel) > DYNAMIXEL_INSTRUCTION_PACKET_OVERHEAD
+        ? (dynamixel_get_buffer_size(dynamixel) - DYNAMIXEL_INSTRUCTION_PACKET_OVERHEAD) * 3 / 4
+        : 0;
+    if (parameter_max_size < (size_t)(SYNC_WRITE_HEADER_SIZE + 1 + self->data_size))
+        return 0;
+    max_slot_num = (parameter_max_size - SYNC_WRITE_HEADER_SIZE) / (1 + self->data_size);
+
+    // 開始アドレスとデータサイズ
+    self->parameter[0] = self->start_address & 0xff;
+    self->parameter[1] = self->start_address >> 8;
+    self->parameter[2] = self->data_size & 0xff;
+    self->parameter[3] = self->data_size >> 8;
+
+    for (size_t i = 0; i < self->slot_num; i++)
+    {
+        slot = &self->slot[i];
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) == slot->sent_sequence)
+            continue;
+
+        block = self->parameter + SYNC_WRITE_HEADER_SIZE + packet_slot_num * (1 + self->data_size);
+        if (!take_snapshot(self, slot, block + 1, &sequence) || sequence == slot->sent_sequence)
+            continue;
+
+        block[0] = slot->id;
+        self->parameter_sequence[packet_slot_num] = sequence;
+        slot_index[packet_slot_num] = i;
+        packet_slot_num++;
+
+        if (packet_slot_num == max_slot_num)
+        {
+            sent_num += send_sync_write(self, dynamixel, packet_slot_num, slot_index);
+            packet_slot_num = 0;
+        }
+    }
+
+    if (packet_slot_num > 0)
+        sent_num += send_sync_write(self, dynamixel, packet_slot_num, slot_index);
+
+    return sent_num;
+}
+
+
+void dynamixel_mailbox_get_statistics(
+    dynamixel_mailbox_t self,
+    dynamixel_mailbox_statistics *statistics
+)
+{
+    *statistics = self->statistics;
+
+    statistics->posts = 0;
+    for (size_t i = 0; i < self->slot_num; i++)
+        statistics->posts += __atomic_load_n(&self->slot[i].sequence, __ATOMIC_ACQUIRE) / 2;
+}
@@ -0,0 +1,70 @@
+#include "dynamixel/dynamixel.h"
+#include "util/analyze_packet.h"
+#include "dynamixel_protocol.h"
+
+
+int dynamixel_count_response(
+    uint8_t id,
+    uint8_t instruction,
+    uint16_t parameter_size
+)
+{
+    if (instruction == DYNAMIXEL__INSTRUCTION_SYNC_READ)
+    {
+        if (parameter_size <= DYNAMIXEL_SYNC_READ_HEADER_SIZE)
+            return -1;
+        return parameter_size - DYNAMIXEL_SYNC_READ_HEADER_SIZE;
+    }
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_BULK_READ)
+    {
+        if (parameter_size == 0 || parameter_size % DYNAMIXEL_BULK_READ_BLOCK_SIZE != 0)
+            return -1;
+        return parameter_size / DYNAMIXEL_BULK_READ_BLOCK_SIZE;
+    }
+
+    // 開始アドレス(2) + データサイズ(2)
+    if (instruction == DYNAMIXEL__INSTRUCTION_READ && parameter_size < 4)
+        return -1;
+
+    if (id <= DYNAMIXEL_MAX_ID)
+        return 1;
+
+    // ブロードキャストIDへのpingは、応答するDynamixelの数が分からない
+    if (instruction == DYNAMIXEL__INSTRUCTION_PING)
+        return -1;
+
+    return 0;
+}
+
+
+int dynamixel_get_response(
+    uint8_t id,
+    uint8_t instruction,
+    const uint8_t *parameter,
+    size_t index,
+    uint8_t *response_id
+)
+{
+    if (instruction == DYNAMIXEL__INSTRUCTION_SYNC_READ)
+    {
+        *response_id = parameter[DYNAMIXEL_SYNC_READ_HEADER_SIZE + index];
+        return combine_byte_pair(parameter[2], parameter[3]);
+    }
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_BULK_READ)
+    {
+        parameter += index * DYNAMIXEL_BULK_READ_BLOCK_SIZE;
+        *response_id = parameter[0];
+        return combine_byte_pair(parameter[3], parameter[4]);
+    }
+
+    *response_id = id;
+    if (instruction == DYNAMIXEL__INSTRUCTION_PING)
+        // モデル番号(2) + ファームウェアのバージョン(1)
+        return 3;
+    if (instruction == DYNAMIXEL__INSTRUCTION_READ)
+        return combine_byte_pair(parameter[2], parameter[3]);
+
+    return -1;
+}
@@ -0,0 +1,72 @@
+#ifndef _ONE_DYNAMIXEL_DYNAMIXEL_PROTOCOL_H
+#define _ONE_DYNAMIXEL_DYNAMIXEL_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Dynamixel Protocol 2.0とコントロールテーブルの定数(ライブラリの中だけで使う)
+*/
+
+
+/// dynamixelに割り当てられるIDの最大値
+#define DYNAMIXEL_MAX_ID 252
+#define DYNAMIXEL_ID_NUM (DYNAMIXEL_MAX_ID + 1)
+/// ブロードキャストID
+#define DYNAMIXEL_BROADCAST_ID 0xfe
+
+/// インストラクションパケットのパラメータ以外のサイズ(ヘッダー(4) + ID(1) + 長さ(2) + インストラクション(1) + CRC(2))
+#define DYNAMIXEL_INSTRUCTION_PACKET_OVERHEAD 10
+/// 応答パケットのパラメータ以外のサイズ(ヘッダー(4) + ID(1) + 長さ(2) + インストラクション(1) + エラー(1) + CRC(2))
+#define DYNAMIXEL_STATUS_PACKET_OVERHEAD 11
+
+/// Sync Readのパラメータの先頭のサイズ(開始アドレス(2) + データサイズ(2))。後にIDが続く
+#define DYNAMIXEL_SYNC_READ_HEADER_SIZE 4
+/// Bulk Readのパラメータの1IDあたりのサイズ(ID(1) + 開始アドレス(2) + データサイズ(2))
+#define DYNAMIXEL_BULK_READ_BLOCK_SIZE 5
+
+/// Goal Positionのアドレスとサイズ
+#define DYNAMIXEL_GOAL_POSITION_ADDRESS 116
+#define DYNAMIXEL_GOAL_POSITION_SIZE 4
+/// Present Position、Goal Positionの1目盛りの角度[degree]
+#define DYNAMIXEL_POSITION_DEGREE_PER_UNIT 0.088
+
+
+/**
+ * @brief インストラクションに返ってくる応答パケットの数を数える
+ *
+ * dynamixel_asyncとdynamixel_engineで、応答パケットを待つ数を決めるのに使う
+ *
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] instruction インストラクション
+ * @param[in] parameter_size 追加情報のサイズ
+ * @return 応答パケットの数(追加情報の形式が誤っている、またはブロードキャストIDへのpingのように数が分からない場合は-1)
+*/
+int dynamixel_count_response(
+    uint8_t id,
+    uint8_t instruction,
+    uint16_t parameter_size
+);
+
+
+/**
+ * @brief index番目の応答パケットを返すIDと、応答パケットのパラメータのサイズを返す
+ *
+ * dynamixel_count_response()が1以上を返したインストラクションに使う
+ *
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] instruction インストラクション
+ * @param[in] *parameter 追加情報
+ * @param[in] index 応答パケットの番号(Sync Read、Bulk Read以外は0)
+ * @param[out] *response_id 応答パケットを返すID
+ * @return パラメータのサイズ(インストラクションから分からない場合は-1)
+*/
+int dynamixel_get_response(
+    uint8_t id,
+    uint8_t instruction,
+    const uint8_t *parameter,
+    size_t index,
+    uint8_t *response_id
+);
+
+#endif
@@ -0,0 +1,289 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dynamixel/dynamixel_shared.h"
+
+
+/**
+ * @brief 結果を待っているスレッド
+ *
+ * 待っている間だけ有効なので、呼び出し元のスタックに置く
+*/
+typedef struct shared_waiter
+{
+    struct shared_waiter *next;
+    uint8_t *error;
+    size_t *status_parameter_size;
+    uint8_t *status_parameter;
+    dynamixel_parse_result result;
+    bool done;
+} shared_waiter;
+
+
+/**
+ * @brief キューに並べるリクエスト
+ *
+ * リクエストを作ったスレッドのスタックに置く。そのスレッドは完了するまで待つので、通信中も有効
+*/
+typedef struct shared_request
+{
+    struct shared_request *next;
+    uint8_t id;
+    uint8_t instruction;
+    uint16_t parameter_size;
+    const uint8_t *parameter;
+    uint wait_us_multiplier;
+    // readのデータサイズ(応答パケットのパラメータサイズと比べる)。readでない場合は-1
+    int32_t read_size;
+    // 結果を待っているスレッド(リクエストを作ったスレッドを含む)
+    shared_waiter *waiter;
+} shared_request;
+
+
+typedef struct dynamixel_shared_struct
+{
+    dynamixel_t dynamixel;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    // 通信を待っているリクエスト([head, tail])
+    shared_request *head;
+    shared_request *tail;
+    // 通信中のリクエスト
+    shared_request *active;
+    // 通信中の応答パケットのパラメータ(通信は1つずつなので、1つで足りる)
+    uint8_t *status_parameter;
+    dynamixel_shared_statistics statistics;
+} dynamixel_shared_struct;
+
+
+dynamixel_shared_t dynamixel_shared_create(
+    dynamixel_t dynamixel
+)
+{
+    dynamixel_shared_t self = calloc(1, sizeof(dynamixel_shared_struct));
+    if (!self)
+        return NULL;
+
+    self->status_parameter = malloc(dynamixel_get_buffer_size(dynamixel));
+    if (!self->status_parameter)
+    {
+        free(self);
+        return NULL;
+    }
+
+    self->dynamixel = dynamixel;
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_cond_init(&self->cond, NULL);
+
+    return self;
+}
+
+
+void dynamixel_shared_destroy(
+    dynamixel_shared_t self
+)
+{
+    pthread_cond_destroy(&self->cond);
+    pthread_mutex_destroy(&self->mutex);
+    free(self->status_parameter);
+    free(self);
+}
+
+
+void dynamixel_shared_get_statistics(
+    dynamixel_shared_t self,
+    dynamixel_shared_statistics *statistics
+)
+{
+    pthread_mutex_lock(&self->mutex);
+    *statistics = self->statistics;
+    pthread_mutex_unlock(&self->mutex);
+}
+
+
+/**
+ * @brief まとめられるreadを探す
+ *
+ * ロックを取って呼び出す。
+ * 通信中のreadは、インストラクションパケットを既に送っていて、このリクエストより前の値を返すことがあるので、まとめない
+*/
+static shared_request *find_same_read(
+    dynamixel_shared_t self,
+    const shared_request *request
+)
+{
+    shared_request *candidate;
+
+    for (candidate = self->head; candidate; candidate = candidate->next)
+    {
+        if (
+            candidate->read_size >= 0
+            && candidate->id == request->id
+            && memcmp(candidate->parameter, request->parameter, request->parameter_size) == 0
+        )
+            return candidate;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief キューの先頭のリクエストを通信し、待っている全てのスレッドに結果を渡す
+ *
+ * ロックを取って呼び出す。通信の間はロックを外す
+*/
+static void run_head(
+    dynamixel_shared_t self
+)
+{
+    shared_request *request = self->head;
+    dynamixel_parse_result result;
+    uint8_t error = 0;
+    size_t status_parameter_size = 0;
+
+    self->head = request->next;
+    if (!self->head)
+        self->tail = NULL;
+    self->active = request;
+    self->statistics.transactions++;
+
+    pthread_mutex_unlock(&self->mutex);
+    result = dynamixel_send_packet(
+        self->dynamixel, request->id, request->instruction,
+        request->parameter_size, request->parameter,
+        &error, &status_parameter_size, self->status_parameter,
+        request->wait_us_multiplier
+    );
+    // 応答パケットのパラメータサイズは、インストラクションで指定したデータサイズと等しい必要がある
+    if (
+        result == DYNAMIXEL_PARSE_SUCCESS
+        && request->read_size >= 0
+        && status_parameter_size != (size_t)request->read_size
+    )
+        result = DYNAMIXEL_PARSE_WRONG_PARAMETER;
+    pthread_mutex_lock(&self->mutex);
+
+    // 通信中にまとめられたスレッドも含めて、結果を渡す
+    for (shared_waiter *waiter = request->waiter; waiter; waiter = waiter->next)
+    {
+        *waiter->error = error;
+        if (waiter->status_parameter_size)
+            *waiter->status_parameter_size = status_parameter_size;
+        // readでは、データの領域はデータサイズ分しかない
+        if (request->read_size < 0 || result == DYNAMIXEL_PARSE_SUCCESS)
+            memcpy(waiter->status_parameter, self->status_parameter, status_parameter_size);
+        waiter->result = result;
+        waiter->done = true;
+    }
+
+    self->active = NULL;
+    pthread_cond_broadcast(&self->cond);
+}
+
+
+/**
+ * @brief リクエストをキューに並べ(まとめられる場合は既存のリクエストに加わり)、完了を待つ
+ *
+ * 誰も通信していなければ、待っているスレッドが先頭のリクエストを通信する
+*/
+static dynamixel_parse_result execute(
+    dynamixel_shared_t self,
+    shared_request *request,
+    shared_waiter *waiter
+)
+{
+    shared_request *same;
+
+    pthread_mutex_lock(&self->mutex);
+    self->statistics.requests++;
+
+    same = request->read_size >= 0 ? find_same_read(self, request) : NULL;
+    if (same)
+    {
+        waiter->next = same->waiter;
+        same->waiter = waiter;
+        self->statistics.coalesced_reads++;
+    }
+    else
+    {
+        request->next = NULL;
+        request->waiter = waiter;
+        if (self->tail)
+            self->tail->next = request;
+        else
+            self->head = request;
+        self->tail = request;
+    }
+
+    while (!waiter->done)
+    {
+        if (!self->active && self->head)
+            run_head(self);
+        else
+            pthread_cond_wait(&self->cond, &self->mutex);
+    }
+
+    pthread_mutex_unlock(&self->mutex);
+    return waiter->result;
+}
+
+
+dynamixel_parse_result dynamixel_shared_send_packet(
+    dynamixel_shared_t self,
+    uint8_t id,
+    uint8_t instruction,
+    uint16_t parameter_size,
+    const uint8_t *parameter,
+    uint8_t *error,
+    size_t *status_parameter_size,
+    uint8_t *status_parameter,
+    uint wait_us_multiplier
+)
+{
+    shared_request request = {
+        .id = id,
+        .instruction = instruction,
+        .parameter_size = parameter_size,
+        .parameter = parameter,
+        .wait_us_multiplier = wait_us_multiplier,
+        .read_size = -1,
+    };
+    shared_waiter waiter = {
+        .error = error,
+        .status_parameter_size = status_parameter_size,
+        .status_parameter = status_parameter,
+    };
+
+    return execute(self, &request, &waiter);
+}
+
+
+dynamixel_parse_result dynamixel_shared_read(
+    dynamixel_shared_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint8_t *error,
+    uint8_t *data
+)
+{
+    // 開始アドレスとバイトサイズ(リトルエンディアン)
+    uint8_t parameter[4] = {
+        start_address & 0xff, start_address >> 8,
+        data_size & 0xff, data_size >> 8,
+    };
+    shared_request request = {
+        .id = id,
+        .instruction = DYNAMIXEL__INSTRUCTION_READ,
+        .parameter_size = sizeof(parameter),
+        .parameter = parameter,
+        .read_size = data_size,
+    };
+    shared_waiter waiter = {
+        .error = error,
+        .status_parameter = data,
+    };
+
+    return execute(self, &request, &waiter);
+}
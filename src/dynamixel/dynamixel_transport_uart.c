@@ -0,0 +1,95 @@
+#include "pico/time.h"
+#include "dynamixel/dynamixel_transport.h"
+#include "pico_communicator/pico_communicator.h"
+
+
+static int uart_write(
+    void *context,
+    const uint8_t *src,
+    size_t len
+)
+{
+    return pico_uart_write_blocking((uart_inst_t *)context, src, len);
+}
+
+
+static int uart_write_async(
+    void *context,
+    const uint8_t *src,
+    size_t len
+)
+{
+    return pico_uart_start_write((uart_inst_t *)context, src, len);
+}
+
+
+static int uart_wait_write(
+    void *context
+)
+{
+    return pico_uart_wait_write((uart_inst_t *)context);
+}
+
+
+static int uart_write_done(
+    void *context
+)
+{
+    return pico_uart_write_done((uart_inst_t *)context);
+}
+
+
+static size_t uart_read_available(
+    void *context,
+    uint8_t *dst,
+    size_t max
+)
+{
+    return pico_uart_read_available((uart_inst_t *)context, dst, max);
+}
+
+
+static int uart_wait_readable(
+    void *context,
+    uint us
+)
+{
+    if (us == 0)
+        return pico_uart_is_readable((uart_inst_t *)context);
+
+    return pico_uart_is_readable_within_us((uart_inst_t *)context, us);
+}
+
+
+static uint uart_set_baud(
+    void *context,
+    uint baud_rate
+)
+{
+    return pico_uart_set_baudrate((uart_inst_t *)context, baud_rate);
+}
+
+
+static uint64_t uart_now_us(
+    void *context
+)
+{
+    return time_us_64();
+}
+
+
+void dynamixel_transport_init_uart(
+    dynamixel_transport *transport,
+    uart_inst_t *uart_id
+)
+{
+    transport->context = uart_id;
+    transport->write = uart_write;
+    transport->write_async = uart_write_async;
+    transport->wait_write = uart_wait_write;
+    transport->write_done = uart_write_done;
+    transport->read_available = uart_read_available;
+    transport->wait_readable = uart_wait_readable;
+    transport->set_baud = uart_set_baud;
+    transport->now_us = uart_now_us;
+}
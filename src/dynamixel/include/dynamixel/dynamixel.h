@@ -3,6 +3,7 @@
 
 #include "pico.h"
 #include "hardware/uart.h"
+#include "dynamixel/dynamixel_transport.h"
 #include "util/packet_byte.h"
 
 #ifdef __cplusplus
@@ -22,13 +23,73 @@ typedef enum {
     DYNAMIXEL_PARSE_NO_RESPONSE, /*!< 時間内に応答パケットが返ってこなかった */
     DYNAMIXEL_PARSE_WRONG_PARAMETER, /*!< 応答パケットのパラメータが、送信したパケットに期待するものと異なっていた */
     DYNAMIXEL_PARSE_WRONG_WRITE_PARAMETER, /*!< 送信パケットに指定するパラメータに誤りがある */
+    DYNAMIXEL_PARSE_WRITE_FAILED, /*!< インストラクションパケットの送信に失敗した(応答パケットは待たなかった) */
 } dynamixel_parse_result;
 
+/// Secondary IDを割り当てていないことを表す値
+#define DYNAMIXEL_SECONDARY_ID_NONE 0xff
+
+/**
+ * @brief 応答パケットの待ち時間の決め方
+*/
+typedef enum {
+    DYNAMIXEL_TIMEOUT_MODEL_ADAPTIVE, /*!< IDごとに測定した応答時間から計算する(測定前はDYNAMIXEL_TIMEOUT_MODEL_BAUD_RATEと同じ、デフォルト) */
+    DYNAMIXEL_TIMEOUT_MODEL_BAUD_RATE, /*!< ボーレート、送受信のデータサイズ、Return Delay Timeから計算する */
+    DYNAMIXEL_TIMEOUT_MODEL_FIXED, /*!< create時に設定した待ち時間を使う */
+} dynamixel_timeout_model;
+
+/// 応答パケットの待ち時間を計算するときに加える余裕のデフォルト値[micro sec.]
+#define DYNAMIXEL_TIMEOUT_MARGIN_US_DEFAULT 50
+/// 測定した応答時間から計算する待ち時間の下限のデフォルト値[micro sec.]
+#define DYNAMIXEL_ADAPTIVE_TIMEOUT_MIN_US_DEFAULT 100
+/// 測定した応答時間から計算する待ち時間の上限のデフォルト値[micro sec.]
+#define DYNAMIXEL_ADAPTIVE_TIMEOUT_MAX_US_DEFAULT 100000
+
 /**
  * @brief dynamixelインスタンス
 */
 typedef struct dynamixel_struct *dynamixel_t;
 
+/**
+ * @brief 応答パケットを受信した時刻
+ *
+ * 時刻は経路の現在時刻(dynamixel_transportのnow_us、UARTではtime_us_64())で、
+ * 受信したデータを読み込んだ時点の値とする
+*/
+typedef struct
+{
+    /// インストラクションパケットの送信が完了した時刻(完了を確認していない場合は送信を開始した時刻)[micro sec.]
+    uint64_t instruction_us;
+    /// 応答パケットのヘッダーの最初の1Byteを読み込んだ時刻[micro sec.]
+    uint64_t header_us;
+    /// 応答パケットのCRCの最後の1Byteを読み込んだ時刻[micro sec.]
+    uint64_t crc_us;
+} dynamixel_status_timestamp;
+
+/**
+ * @brief 送信したインストラクションへの応答でないため捨てたデータの統計
+*/
+typedef struct
+{
+    /// インストラクションパケットの送信前に、受信していたため捨てたデータサイズ
+    uint64_t flushed_bytes;
+    /// 応答を待っている間に受信し、IDまたはサイズが合わないため捨てた応答パケットの数
+    uint64_t discarded_packets;
+} dynamixel_stale_statistics;
+
+/**
+ * @brief インストラクションパケットの送信から応答パケットの受信までの状態
+ *
+ * dynamixel_start_packet()でDYNAMIXEL_STATE_TXになり、dynamixel_poll()を呼ぶたびに進む
+*/
+typedef enum {
+    DYNAMIXEL_STATE_IDLE, /*!< 通信していない */
+    DYNAMIXEL_STATE_TX, /*!< インストラクションパケットを送信している */
+    DYNAMIXEL_STATE_AWAIT_FIRST_BYTE, /*!< 応答パケットの最初の1Byteを待っている */
+    DYNAMIXEL_STATE_RECEIVING, /*!< 応答パケットを受信している */
+    DYNAMIXEL_STATE_DONE, /*!< 通信が終わった(結果はdynamixel_get_packet_result()で受け取る) */
+} dynamixel_state;
+
 /**
  * @brief dynamixelインスタンスを作成する
  *
@@ -37,7 +98,7 @@ typedef struct dynamixel_struct *dynamixel_t;
  * @param[in] gpio_uart_tx UART通信の送信を行うGPIO
  * @param[in] baud_rate UART通信のボーレート
  * @param[in] buffer_size 受信データのバッファーのサイズ(20未満を指定した場合は、20になる)
- * @param[in] wait_us 送信後の待ち時間[micro sec.]
+ * @param[in] wait_us 送信後の待ち時間[micro sec.](DYNAMIXEL_TIMEOUT_MODEL_FIXEDのとき、またはwait_us_multiplierを指定したときに使う)
  * @retval NULL 他のdynamixelインスタンスで使用したGPIOピン、UARTインスタンスを指定したとき
  * @retval dynamixelインスタンス
 */
@@ -51,6 +112,27 @@ dynamixel_t dynamixel_create(
 );
 
 
+/**
+ * @brief 送受信の経路を指定してdynamixelインスタンスを作成する
+ *
+ * UARTやGPIOピンの初期化は行わない(経路は指定したボーレートで通信できる状態にしておく)。
+ * 1つのプロセスで、UART、シリアルデバイス、シミュレーターなどの異なる経路を同時に使える
+ *
+ * @param[in] *transport 送受信の経路(インスタンスにコピーされる)
+ * @param[in] baud_rate 経路のボーレート
+ * @param[in] buffer_size 受信データのバッファーのサイズ(20未満を指定した場合は、20になる)
+ * @param[in] wait_us 送信後の待ち時間[micro sec.](DYNAMIXEL_TIMEOUT_MODEL_FIXEDのとき、またはwait_us_multiplierを指定したときに使う)
+ * @retval NULL 対応していないボーレートを指定したとき
+ * @retval dynamixelインスタンス
+*/
+dynamixel_t dynamixel_create_with_transport(
+    const dynamixel_transport *transport,
+    uint baud_rate,
+    size_t buffer_size,
+    uint wait_us
+);
+
+
 /**
  * @brief dynamixelインスタンスを破棄する
  *
@@ -61,6 +143,227 @@ void dynamixel_destroy(
 );
 
 
+/**
+ * @brief 受信データのバッファーのサイズを返す
+ *
+ * 応答パケットのパラメータを受け取る領域は、このサイズを用意する
+ *
+ * @param[in] self dynamixelインスタンス
+ * @return バッファーのサイズ
+*/
+size_t dynamixel_get_buffer_size(
+    dynamixel_t self
+);
+
+
+/**
+ * @brief 経路の現在時刻を返す
+ *
+ * @param[in] self dynamixelインスタンス
+ * @return 現在時刻(dynamixel_transportのnow_us、UARTではtime_us_64())[micro sec.]
+*/
+uint64_t dynamixel_get_time_us(
+    dynamixel_t self
+);
+
+
+/**
+ * @brief 応答パケットの待ち時間の決め方を設定する
+ *
+ * DYNAMIXEL_TIMEOUT_MODEL_FIXED以外のときも、wait_us_multiplierに1以上を指定した関数では、
+ * create時に設定した待ち時間に倍数を掛けた値を使う
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] timeout_model 待ち時間の決め方
+*/
+void dynamixel_set_timeout_model(
+    dynamixel_t self,
+    dynamixel_timeout_model timeout_model
+);
+
+
+/**
+ * @brief 応答パケットの待ち時間を計算するときに加える余裕を設定する
+ *
+ * DYNAMIXEL_TIMEOUT_MODEL_BAUD_RATE、DYNAMIXEL_TIMEOUT_MODEL_ADAPTIVEのどちらの待ち時間にも加える
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] margin_us 加える余裕[micro sec.]
+*/
+void dynamixel_set_timeout_margin_us(
+    dynamixel_t self,
+    uint margin_us
+);
+
+
+/**
+ * @brief 送信を開始してから応答パケットを受信し終えるまでの時間を計算する
+ *
+ * 送信時間 + Return Delay Time + 受信時間 + 余裕 とする。
+ * Return Delay Timeは、このインスタンスで読み書きした値を使う(不明な場合はデフォルトの500us)
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] packet_size 送信するパケットのサイズ
+ * @param[in] status_packet_size 受信する応答パケットのサイズ
+ * @return 計算した時間[micro sec.]
+*/
+uint dynamixel_get_response_timeout_us(
+    dynamixel_t self,
+    uint8_t id,
+    size_t packet_size,
+    size_t status_packet_size
+);
+
+
+/**
+ * @brief 測定した応答時間から計算する待ち時間の範囲を設定する
+ *
+ * 待ち時間はSRTT + 4 * RTTVAR + 余裕 とし、何も届かないまま待ち時間を過ぎたときは、次にデータが届くまで2倍ずつ延ばす(最大8倍)。
+ * 範囲に収めた後も、Return Delay Time + 1Byteの受信時間 + 余裕 より短くはしない
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] min_us 待ち時間の下限[micro sec.]
+ * @param[in] max_us 待ち時間の上限[micro sec.]
+*/
+void dynamixel_set_adaptive_timeout_range_us(
+    dynamixel_t self,
+    uint min_us,
+    uint max_us
+);
+
+
+/**
+ * @brief IDごとに測定した応答時間の推定値を取得する
+ *
+ * 送信が完了してから応答パケットの最初の1Byteを受信するまでの時間を測定し、
+ * TCPと同じ方法で平滑化した値(SRTT)とそのばらつき(RTTVAR)を求める
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id DynamixelのID
+ * @param[out] *srtt_us 平滑化した応答時間[micro sec.]
+ * @param[out] *rttvar_us 応答時間のばらつき[micro sec.]
+ * @retval 0 推定値を取得した
+ * @retval 1 まだ応答時間を測定していない
+*/
+int dynamixel_get_rtt_estimate(
+    dynamixel_t self,
+    uint8_t id,
+    uint *srtt_us,
+    uint *rttvar_us
+);
+
+
+/**
+ * @brief IDごとに測定した応答時間の推定値を破棄する
+ *
+ * Return Delay Timeを書き込んだとき、読み込んだ値が変わっていたとき、dynamixel_configure()でも破棄する
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id DynamixelのID
+*/
+void dynamixel_reset_rtt_estimate(
+    dynamixel_t self,
+    uint8_t id
+);
+
+
+/**
+ * @brief 最後に解析した応答パケットを受信した時刻を取得する
+ *
+ * 応答パケットを最後まで受信して解析するたびに(checksumの誤り、IDの違いを含む)更新する。
+ * header_us - instruction_usがDynamixelの応答時間(Return Delay Timeを含む)、
+ * crc_us - header_usが応答パケットの受信にかかった時間の目安になる
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[out] *timestamp 受信した時刻
+ * @retval 0 時刻を取得した
+ * @retval 1 まだ応答パケットを解析していない
+*/
+int dynamixel_get_status_timestamp(
+    dynamixel_t self,
+    dynamixel_status_timestamp *timestamp
+);
+
+
+/**
+ * @brief IDごとに、最後に解析した応答パケットを受信した時刻を取得する
+ *
+ * Sync Read、Bulk Read、ブロードキャストのPingのように1つのインストラクションに複数の応答パケットが返るとき、
+ * それぞれの応答パケットの時刻を取得するために使う。
+ * checksumが正しい応答パケットを解析するたびに、応答パケットのIDの時刻を更新する
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id 応答パケットのID
+ * @param[out] *timestamp 受信した時刻
+ * @retval 0 時刻を取得した
+ * @retval 1 まだこのIDの応答パケットを解析していない
+*/
+int dynamixel_get_status_timestamp_of_id(
+    dynamixel_t self,
+    uint8_t id,
+    dynamixel_status_timestamp *timestamp
+);
+
+
+/**
+ * @brief 応答パケットの受信中に、次のデータを待つ時間を計算する
+ *
+ * DYNAMIXEL_TIMEOUT_MODEL_ADAPTIVE、DYNAMIXEL_TIMEOUT_MODEL_BAUD_RATEのとき、最初の1Byteを受信した後はこの時間だけ次のデータを待つ。
+ * 8Byte分の送信時間 + 余裕 とする
+ *
+ * @param[in] self dynamixelインスタンス
+ * @return 計算した時間[micro sec.]
+*/
+uint dynamixel_get_inter_byte_timeout_us(
+    dynamixel_t self
+);
+
+
+/**
+ * @brief 応答パケットのサイズが分かっているときに、そのサイズを超えて読み込まないようにする
+ *
+ * 有効にすると、応答パケットの最後のByteを受信した時点で読み込みを終え、
+ * 後に続くデータはFIFOに残したままにする
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] enabled trueのとき有効にする(デフォルトは無効)
+*/
+void dynamixel_set_stop_at_expected_length(
+    dynamixel_t self,
+    bool enabled
+);
+
+
+/**
+ * @brief 前の通信で遅れて届いた応答パケットを、次の通信の応答として扱わないようにする
+ *
+ * 有効にすると、インストラクションパケットの送信前に受信済みのデータを全て捨てる。
+ * また、dynamixel_send_packet()で応答を待っている間に、IDが宛先と違う応答パケットと、
+ * エラーがなくサイズがインストラクションから見積もったサイズと違う応答パケットを捨て、
+ * 残りの待ち時間で応答パケットを待ち続ける(DYNAMIXEL_PARSE_WRONG_ID、DYNAMIXEL_PARSE_WRONG_PARAMETERとしない)
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] enabled trueのとき有効にする(デフォルトは無効)
+*/
+void dynamixel_set_response_sequencing(
+    dynamixel_t self,
+    bool enabled
+);
+
+
+/**
+ * @brief 送信したインストラクションへの応答でないため捨てたデータの統計を取得する
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[out] *statistics 統計
+*/
+void dynamixel_get_stale_statistics(
+    dynamixel_t self,
+    dynamixel_stale_statistics *statistics
+);
+
+
 /**
  * @brief dynamixelに通信設定を書き込む
  *
@@ -68,7 +371,7 @@ void dynamixel_destroy(
  * @param[in] id パケットを送るDynamixelのID
  * @param[in] return_delay_time インストラクションパケットを受け取ってから、ステータスパケットを返すまでのディレイ時間(偶数を指定、奇数を指定した場合は+1される)
  * @param[in] operating_mode 動作モード
- * @param[in] wait_us_multiplier 1以上のときcreate時に設定した応答パケットの待ち時間を一時的に、指定した倍数を掛けた値にする。0のときは、最低0.1s(=100000us)待つように設定される)
+ * @param[in] wait_us_multiplier 1以上のときcreate時に設定した応答パケットの待ち時間を一時的に、指定した倍数を掛けた値にする。0のときは、ボーレートから計算した待ち時間を使う(DYNAMIXEL_TIMEOUT_MODEL_FIXEDのときは、最低0.1s(=100000us)待つように設定される)
  * @param[in] iterative_count 1以上のとき設定処理を指定した回数だけ繰り返す。0のときは、5回だけ繰り返す(デフォルト)
  * @return 応答の結果
 */
@@ -335,6 +638,28 @@ dynamixel_parse_result dynamixel_send_read_baud_rate(
     size_t iterative_count
 );
 
+/**
+ * @brief dynamixelからSecondary IDを取得する
+ *
+ * 取得したSecondary IDは、dynamixelインスタンスのグループ表にも反映される
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[out] *error 応答パケットのエラーステータス
+ * @param[out] *secondary_id Secondary ID(割り当てられていない場合は、DYNAMIXEL_SECONDARY_ID_NONE)
+ * @param[in] wait_us_multiplier 1以上のときcreate時に設定した応答パケットの待ち時間を一時的に、指定した倍数を掛けた値にする
+ * @param[in] iterative_count 1以上のとき設定処理を指定した回数だけ繰り返す。0のときは、5回だけ繰り返す(デフォルト)
+ * @return 応答の結果
+*/
+dynamixel_parse_result dynamixel_send_read_secondary_id(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t *error,
+    uint8_t *secondary_id,
+    uint wait_us_multiplier,
+    size_t iterative_count
+);
+
 
 /**
  * @brief dynamixelにwriteを送る
@@ -538,6 +863,88 @@ dynamixel_parse_result dynamixel_send_write_baud_rate(
     size_t iterative_count
 );
 
+/**
+ * @brief dynamixelにSecondary IDを設定する
+ *
+ * 同じSecondary IDを持つdynamixelは、dynamixel_send_group_writeで1つのパケットにより同時に書き込める
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[out] *error 応答パケットのエラーステータス
+ * @param[in] secondary_id Secondary ID(0~252、DYNAMIXEL_SECONDARY_ID_NONEを指定した場合は割り当てを解除する)
+ * @param[in] wait_us_multiplier 1以上のときcreate時に設定した応答パケットの待ち時間を一時的に、指定した倍数を掛けた値にする
+ * @param[in] iterative_count 1以上のとき設定処理を指定した回数だけ繰り返す。0のときは、5回だけ繰り返す(デフォルト)
+ * @retval DYNAMIXEL_PARSE_WRONG_WRITE_PARAMETER Secondary IDが範囲外
+ * @return 応答の結果
+*/
+dynamixel_parse_result dynamixel_send_write_secondary_id(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t *error,
+    uint8_t secondary_id,
+    uint wait_us_multiplier,
+    size_t iterative_count
+);
+
+/**
+ * @brief dynamixelのSecondary IDの割り当てを解除する
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[out] *error 応答パケットのエラーステータス
+ * @param[in] wait_us_multiplier 1以上のときcreate時に設定した応答パケットの待ち時間を一時的に、指定した倍数を掛けた値にする
+ * @param[in] iterative_count 1以上のとき設定処理を指定した回数だけ繰り返す。0のときは、5回だけ繰り返す(デフォルト)
+ * @return 応答の結果
+*/
+dynamixel_parse_result dynamixel_send_remove_secondary_id(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t *error,
+    uint wait_us_multiplier,
+    size_t iterative_count
+);
+
+
+/**
+ * @brief Secondary IDを宛先としてwriteを送る
+ *
+ * Secondary IDを宛先としたパケットには応答パケットが返ってこないため、応答パケットは待たない
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] secondary_id パケットを送るグループのSecondary ID
+ * @param[in] start_address コントロールテーブルの開始アドレス
+ * @param[in] data_size 書き込みを行うデータサイズ
+ * @param[in] data 書き込みを行うデータ
+ * @retval DYNAMIXEL_PARSE_SUCCESS パケットを送信した
+ * @retval DYNAMIXEL_PARSE_WRONG_WRITE_PARAMETER Secondary IDが範囲外、またはパケットがバッファーに入りきらない
+*/
+dynamixel_parse_result dynamixel_send_group_write(
+    dynamixel_t self,
+    uint8_t secondary_id,
+    uint16_t start_address,
+    uint16_t data_size,
+    const uint8_t *data
+);
+
+
+/**
+ * @brief グループ表から、指定したSecondary IDを持つdynamixelのIDを取得する
+ *
+ * グループ表は、dynamixel_send_write_secondary_id、dynamixel_send_read_secondary_idの結果から作成される
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] secondary_id Secondary ID
+ * @param[out] *ids グループに属するdynamixelのID(NULLの場合は数のみ返す)
+ * @param[in] max_ids idsに格納できる最大数
+ * @return グループに属するdynamixelの数
+*/
+size_t dynamixel_get_group_members(
+    dynamixel_t self,
+    uint8_t secondary_id,
+    uint8_t *ids,
+    size_t max_ids
+);
+
 
 /**
  * @brief dynamixelにreg_writeを送る
@@ -633,6 +1040,7 @@ dynamixel_parse_result dynamixel_send_reboot(
  * @retval DYNAMIXEL_PARSE_HUGE_DATA
  * @retval DYNAMIXEL_PARSE_WRONG_ID
  * @retval DYNAMIXEL_PARSE_NO_RESPONSE
+ * @retval DYNAMIXEL_PARSE_WRITE_FAILED
 */
 dynamixel_parse_result dynamixel_send_packet(
     dynamixel_t self,
@@ -647,6 +1055,216 @@ dynamixel_parse_result dynamixel_send_packet(
 );
 
 
+/**
+ * @brief dynamixelにパケットを送り、応答パケットを待たずに戻る
+ *
+ * 通信はdynamixel_poll()で進め、DYNAMIXEL_STATE_DONEになったらdynamixel_get_packet_result()で結果を受け取る。
+ * 応答パケットの待ち時間はdynamixel_send_packet()と同じ。送り直しは行わない
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] instruction インストラクション
+ * @param[in] parameter_size 追加情報のサイズ
+ * @param[in] *parameter 追加情報(送信を開始した後は保持しなくてよい)
+ * @param[in] wait_us_multiplier 1以上のときcreate時に設定した応答パケットの待ち時間を一時的に、指定した倍数を掛けた値にする
+ * @retval 0 パケット送信を開始した
+ * @retval 1 通信中、またはパケット送信に失敗した
+*/
+int dynamixel_start_packet(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t instruction,
+    uint16_t parameter_size,
+    const uint8_t *parameter,
+    uint wait_us_multiplier
+);
+
+
+/**
+ * @brief dynamixelにreadを送り、応答パケットを待たずに戻る
+ *
+ * dynamixel_send_read()を待たずに行う。応答を受け取れなかったときの送り直しは、dynamixel_poll()の中で行う。
+ * 読み取ったデータは、dynamixel_get_packet_result()の応答パケットのパラメータとして受け取る
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] start_address コントロールテーブルの開始アドレス
+ * @param[in] data_size 読み取りを行うデータサイズ
+ * @param[in] wait_us_multiplier 1以上のときcreate時に設定した応答パケットの待ち時間を一時的に、指定した倍数を掛けた値にする
+ * @param[in] iterative_count 1以上のとき応答を受け取れるまで指定した回数だけ送る。0のときは、5回まで送る(デフォルト)
+ * @retval 0 パケット送信を開始した
+ * @retval 1 通信中、またはパケット送信に失敗した
+*/
+int dynamixel_start_read(
+    dynamixel_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint wait_us_multiplier,
+    size_t iterative_count
+);
+
+
+/**
+ * @brief dynamixelにwriteを送り、応答パケットを待たずに戻る
+ *
+ * dynamixel_send_write()を待たずに行う。応答を受け取れなかったときの送り直しは、dynamixel_poll()の中で行う
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] start_address コントロールテーブルの開始アドレス
+ * @param[in] data_size 書き込みを行うデータサイズ
+ * @param[in] *data 書き込みを行うデータ(送信を開始した後は保持しなくてよい)
+ * @param[in] wait_us_multiplier 1以上のときcreate時に設定した応答パケットの待ち時間を一時的に、指定した倍数を掛けた値にする
+ * @param[in] iterative_count 1以上のとき応答を受け取れるまで指定した回数だけ送る。0のときは、5回まで送る(デフォルト)
+ * @retval 0 パケット送信を開始した
+ * @retval 1 通信中、データが大きすぎる、またはパケット送信に失敗した
+*/
+int dynamixel_start_write(
+    dynamixel_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    const uint8_t *data,
+    uint wait_us_multiplier,
+    size_t iterative_count
+);
+
+
+/**
+ * @brief 応答パケットを返さないパケットを送り、送信の完了を待たずに戻る
+ *
+ * ブロードキャストIDへのwrite、Sync Writeや、Sync Read、Bulk Readの送信に使う。
+ * dynamixel_poll()で送信の完了を確かめ、完了したらDYNAMIXEL_STATE_DONEになる(結果はDYNAMIXEL_PARSE_SUCCESS、
+ * 送信に失敗した場合はDYNAMIXEL_PARSE_WRITE_FAILED)
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] instruction インストラクション
+ * @param[in] parameter_size 追加情報のサイズ
+ * @param[in] *parameter 追加情報(送信を開始した後は保持しなくてよい)
+ * @retval 0 パケット送信を開始した
+ * @retval 1 通信中、またはパケット送信に失敗した
+*/
+int dynamixel_start_write_packet(
+    dynamixel_t self,
+    uint8_t id,
+    uint8_t instruction,
+    uint16_t parameter_size,
+    const uint8_t *parameter
+);
+
+
+/**
+ * @brief パケットを送らずに、次の応答パケットを待ち始める
+ *
+ * Sync Read、Bulk Readで続けて届く応答パケットを、1つずつdynamixel_poll()で受け取るのに使う。
+ * 前の応答パケットに続いて読み込んだデータは、この応答パケットの一部として解析する。
+ * 待ち時間は呼び出した時刻から数え、応答パケットのサイズとReturn Delay Timeから計算する
+ * (DYNAMIXEL_TIMEOUT_MODEL_FIXEDのときはcreate時に設定した待ち時間)
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] id 応答パケットを返すDynamixelのID
+ * @param[in] status_packet_size 応答パケットのサイズ
+ * @retval 0 待ち始めた
+ * @retval 1 通信中
+*/
+int dynamixel_start_read_packet(
+    dynamixel_t self,
+    uint8_t id,
+    size_t status_packet_size
+);
+
+
+/**
+ * @brief 通信を進める
+ *
+ * 待たずに、送信の完了、届いているデータの読み込みと解析、待ち時間の超過を確かめて状態を進める。
+ * dynamixel_start_read()、dynamixel_start_write()で始めた通信は、応答を受け取れなければ送り直す
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] now_us 現在時刻(dynamixel_get_time_us()と同じ時計)[micro sec.]
+ * @return 進めた後の状態
+*/
+dynamixel_state dynamixel_poll(
+    dynamixel_t self,
+    uint64_t now_us
+);
+
+
+/**
+ * @brief dynamixel_poll()で進める通信が終わるまで待つ
+ *
+ * dynamixel_start_packet()などで始めた通信を、dynamixel_send_packet()と同じように待って進める(送り直しも行う)。
+ * 通信を1つの実行コンテキストで順に行う場合に使う
+ *
+ * @param[in] self dynamixelインスタンス
+ * @return 進めた後の状態(通信していなかった場合はDYNAMIXEL_STATE_IDLE)
+*/
+dynamixel_state dynamixel_wait_done(
+    dynamixel_t self
+);
+
+
+/**
+ * @brief 受信したデータがあるか、指定した時間が経つまで待つ
+ *
+ * 複数のdynamixelインスタンスをdynamixel_poll()で交互に進めるときに、進めるものがない間の待ちに使う。
+ * 他のインスタンスの受信を待たせないように、短い時間を指定する
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[in] us 待つ時間[micro sec.]
+ * @retval 0 受信したデータがある
+ * @retval 1 時間内に受信しなかった
+*/
+int dynamixel_wait_readable(
+    dynamixel_t self,
+    uint us
+);
+
+
+/**
+ * @brief 通信の状態を取得する
+ *
+ * @param[in] self dynamixelインスタンス
+ * @return 状態
+*/
+dynamixel_state dynamixel_get_state(
+    dynamixel_t self
+);
+
+
+/**
+ * @brief 応答パケットを待つ期限を取得する
+ *
+ * 期限まではデータを受信しない限りdynamixel_poll()で状態が変わらないので、
+ * 複数のdynamixelインスタンスを交互に進めるときに、受信を待つ時間を決めるのに使う
+ *
+ * @param[in] self dynamixelインスタンス
+ * @return 期限(dynamixel_get_time_us()と同じ時計)[micro sec.]。応答パケットを待っていない(送信中を含む)場合は0
+*/
+uint64_t dynamixel_get_deadline_us(
+    dynamixel_t self
+);
+
+
+/**
+ * @brief 終わった通信の結果を受け取り、DYNAMIXEL_STATE_IDLEに戻す
+ *
+ * @param[in] self dynamixelインスタンス
+ * @param[out] *error 応答パケットのエラーステータス
+ * @param[out] *status_parameter_size 応答パケットのパラメータのサイズ
+ * @param[out] *status_parameter 応答パケットのパラメータ(readバッファーのサイズ以上の領域)
+ * @return dynamixel_send_packet()と同じ解析結果(DYNAMIXEL_STATE_DONEでない場合はDYNAMIXEL_PARSE_NO_RESPONSE)
+*/
+dynamixel_parse_result dynamixel_get_packet_result(
+    dynamixel_t self,
+    uint8_t *error,
+    size_t *status_parameter_size,
+    uint8_t *status_parameter
+);
+
+
 
 ////////////////
 // 以下補助関数 //
@@ -655,12 +1273,15 @@ dynamixel_parse_result dynamixel_send_packet(
 /**
  * @brief dynamixelにパケットを送る
  *
+ * 送信の完了は待たない(送信中に次のパケットを作成できる)。
+ * 前のパケットが送信中の場合は、次のパケットを作成してから前の送信の完了を待つ
+ *
  * @param[in] self dynamixelインスタンス
  * @param[in] id パケットを送るDynamixelのID
  * @param[in] instruction インストラクション
  * @param[in] parameter_size 追加情報のサイズ
  * @param[in] *parameter 追加情報
- * @retval 0 パケット送信に成功した
+ * @retval 0 パケット送信を開始した
  * @retval 1 パケット送信に失敗した
 */
 int dynamixel_write_uart_packet(
@@ -672,6 +1293,20 @@ int dynamixel_write_uart_packet(
 );
 
 
+/**
+ * @brief dynamixel_write_uart_packetで開始した送信が完了するまで待つ
+ *
+ * 送信中のパケットがない場合は何もしない
+ *
+ * @param[in] self dynamixelインスタンス
+ * @retval 0 送信が完了した
+ * @retval 1 送信に失敗した
+*/
+int dynamixel_wait_write(
+    dynamixel_t self
+);
+
+
 /**
  * @brief 応答パケットを読み取ってバッファーに保存する
  *
@@ -694,7 +1329,7 @@ int dynamixel_partial_read_uart_packet(
  * @param[out] *error 応答パケットのエラーステータス
  * @param[out] *status_parameter_size 応答パケットのパラメータのサイズ
  * @param[out] *status_parameter 応答パケットのパラメータ
- * @param[out] *initial_status_packet_size 読み取り結果をバッファーに保存する際の最初の位置
+ * @param[out] *initial_status_packet_size 読み取り結果をバッファーに保存する際の最初の位置(応答パケットを最後まで解析できた場合は、後に続くデータをバッファーの先頭に移動し、そのサイズとする)
  * @retval DYNAMIXEL_PARSE_SUCCESS
  * @retval DYNAMIXEL_PARSE_WRONG_CHECKSUM
  * @retval DYNAMIXEL_PARSE_STATUS_ERROR
@@ -0,0 +1,196 @@
+#ifndef _ONE_DYNAMIXEL_DYNAMIXEL_ASYNC_H
+#define _ONE_DYNAMIXEL_DYNAMIXEL_ASYNC_H
+
+#include "pico.h"
+#include "dynamixel/dynamixel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief dynamixelインスタンスに、送信と応答の待ちを止まらずに行わせるキュー
+ *
+ * dynamixel_async_submit()でリクエストを受け付け、dynamixel_async_progress()を呼ぶたびに通信を進める。
+ * 通信はdynamixelインスタンスのdynamixel_start_packet()とdynamixel_poll()で進めるため、
+ * dynamixel_async_progress()は待たずに戻り、通信中に他の処理を行える。
+ * 完了は、リクエストに指定したコールバック、または完了キュー(dynamixel_async_poll())で受け取る
+*/
+typedef struct dynamixel_async_struct *dynamixel_async_t;
+
+
+/**
+ * @brief 応答パケット1つ分の完了
+ *
+ * Sync Read、Bulk Readは応答するIDごとに、他のインストラクションはリクエストごとに1つ完了する。
+ * 応答パケットを返さないインストラクション(ブロードキャストIDを宛先とするwriteなど)は、送信が完了した時点で完了する。
+ * 送信に失敗したときは、応答パケットを待たずにDYNAMIXEL_PARSE_WRITE_FAILEDで完了する
+*/
+typedef struct
+{
+    /// リクエストに指定した値
+    void *user_data;
+    /// インストラクション
+    uint8_t instruction;
+    /// 応答パケットを待ったID(応答パケットを返さないインストラクションでは宛先のID)
+    uint8_t id;
+    /// 応答の結果
+    dynamixel_parse_result result;
+    /// 応答パケットのエラーステータス
+    uint8_t error;
+    /// 応答パケットのパラメータのサイズ
+    size_t status_parameter_size;
+    /// 応答パケットのパラメータ(次にdynamixel_async_progress()を呼ぶまで有効)
+    const uint8_t *status_parameter;
+    /// リクエストの最後の完了か
+    bool last;
+} dynamixel_async_completion;
+
+
+/**
+ * @brief 完了を受け取るコールバック
+ *
+ * dynamixel_async_progress()の中で呼ばれる。コールバックの中でリクエストを追加してもよい
+*/
+typedef void (*dynamixel_async_callback)(
+    const dynamixel_async_completion *completion
+);
+
+
+/**
+ * @brief リクエストの優先度
+ *
+ * 送信を待っているリクエストは、優先度の高い順(SAFETY、CONTROL、BACKGROUND)に、同じ優先度では受け付けた順に送信する。
+ * 送信した後の応答パケットは止められない(半二重のため、途中で送信すると応答パケットと衝突する)ので、
+ * SAFETYのリクエストは通信中のリクエストが完了した後に送信される。
+ * 通信中のリクエストがSync Read、Bulk Readの場合は、応答パケットが途切れるまで全てのIDの応答を待つため、
+ * 最悪で、送信の完了からIDの数だけ応答パケットの待ち時間(dynamixel_get_response_timeout_us())を足した時間だけ待たせる。
+ * SAFETYのリクエストを待たせる時間を短くする場合は、1つのSync Read、Bulk ReadのIDの数を減らすこと
+*/
+typedef enum {
+    DYNAMIXEL_ASYNC_PRIORITY_CONTROL, /*!< 制御の読み書き(デフォルト) */
+    DYNAMIXEL_ASYNC_PRIORITY_SAFETY, /*!< トルクオフや制限の変更など、すぐに送る必要があるもの */
+    DYNAMIXEL_ASYNC_PRIORITY_BACKGROUND, /*!< 温度などの監視(SAFETYのリクエストを待たせないように、再送を打ち切る) */
+    DYNAMIXEL_ASYNC_PRIORITY_NUM,
+} dynamixel_async_priority;
+
+
+/**
+ * @brief リクエスト
+*/
+typedef struct
+{
+    /// パケットを送るDynamixelのID(Sync Read、Bulk Read、Sync Write、Bulk WriteではブロードキャストID)
+    uint8_t id;
+    /// インストラクション
+    uint8_t instruction;
+    /// 追加情報のサイズ
+    uint16_t parameter_size;
+    /// 追加情報(受け付け時にコピーされる)
+    const uint8_t *parameter;
+    /// 完了を受け取るコールバック(NULLのときは完了キューに入れる)
+    dynamixel_async_callback callback;
+    /// 完了に渡す値
+    void *user_data;
+    /// 優先度
+    dynamixel_async_priority priority;
+    /// 応答パケットを1つ返すリクエストで、応答を受け取れなかったときに再送する回数
+    /// (再送は同じ優先度の先頭に戻して行う。BACKGROUNDでは、SAFETYのリクエストが待っていれば再送しない)
+    uint8_t retry_num;
+} dynamixel_async_request;
+
+
+/**
+ * @brief キューの大きさ
+*/
+typedef struct
+{
+    /// 同時に受け付けるリクエストの数
+    size_t request_num;
+    /// 1つのリクエストの追加情報の最大サイズ
+    size_t parameter_size;
+    /// 完了キューに入れられる完了の数
+    size_t completion_num;
+    /// 1つの完了の応答パケットのパラメータの最大サイズ
+    size_t status_parameter_size;
+} dynamixel_async_config;
+
+
+/**
+ * @brief キューを作成する
+ *
+ * リクエストと完了の領域は、作成時に全て確保する
+ *
+ * @param[in] dynamixel 通信に使うdynamixelインスタンス(キューを使っている間は、他の関数で通信しない)
+ * @param[in] *config キューの大きさ
+ * @return 作成したキュー(作成できなかった場合はNULL)
+*/
+dynamixel_async_t dynamixel_async_create(
+    dynamixel_t dynamixel,
+    const dynamixel_async_config *config
+);
+
+
+/**
+ * @brief キューを破棄する
+ *
+ * 完了していないリクエストは破棄される(コールバックは呼ばれない)
+ *
+ * @param[in] self キュー
+*/
+void dynamixel_async_destroy(
+    dynamixel_async_t self
+);
+
+
+/**
+ * @brief リクエストを受け付ける
+ *
+ * 受け付けたリクエストは、優先度の高い順に1つずつ送信する
+ *
+ * @param[in] self キュー
+ * @param[in] *request リクエスト
+ * @retval 0 受け付けた
+ * @retval 1 受け付けられなかった(リクエストの領域が足りない、追加情報が大きすぎる、追加情報の形式が誤っている、
+ * 応答パケットの数が分からない(ブロードキャストIDへのping)、完了キューに入りきらない、優先度が誤っている)
+*/
+int dynamixel_async_submit(
+    dynamixel_async_t self,
+    const dynamixel_async_request *request
+);
+
+
+/**
+ * @brief 通信を進める
+ *
+ * 待たずに、送信の完了を確かめ、届いているデータを読み込んで解析し、応答が揃ったリクエストを完了させて次のリクエストを送信する。
+ * 応答パケットを1つ返すリクエストの待ち時間、応答時間の測定、受信時刻の記録、前の通信の応答パケットを捨てる設定は、
+ * dynamixel_send_packet()と同じく働く。Sync Read、Bulk Readの応答パケットはdynamixel_start_read_packet()で1つずつ待つ
+ *
+ * @param[in] self キュー
+ * @return 完了していないリクエストの数
+*/
+size_t dynamixel_async_progress(
+    dynamixel_async_t self
+);
+
+
+/**
+ * @brief 完了キューから完了を1つ取り出す
+ *
+ * @param[in] self キュー
+ * @param[out] *completion 完了
+ * @retval 0 取り出した
+ * @retval 1 完了キューが空だった
+*/
+int dynamixel_async_poll(
+    dynamixel_async_t self,
+    dynamixel_async_completion *completion
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef _ONE_DYNAMIXEL_DYNAMIXEL_CYCLE_H
+#define _ONE_DYNAMIXEL_DYNAMIXEL_CYCLE_H
+
+#include "pico.h"
+#include "dynamixel/dynamixel.h"
+#include "dynamixel/dynamixel_mailbox.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 決まった周期で、登録した通信の計画(read、計算、write)を実行するスケジューラー
+ *
+ * 周期の開始時刻は、最初の周期の開始時刻から周期の整数倍の時刻(絶対時刻)とするので、
+ * 通信の再送や処理時間のばらつきで周期がずれていかない。
+ * 時刻はdynamixelインスタンスの経路の時計(dynamixel_get_time_us())を使う
+*/
+typedef struct dynamixel_cycle_struct *dynamixel_cycle_t;
+
+
+/**
+ * @brief 周期内に終わらなかった(オーバーラン)ときの、次の周期の決め方
+*/
+typedef enum {
+    DYNAMIXEL_CYCLE_OVERRUN_SKIP, /*!< 過ぎてしまった周期を飛ばし、次の周期の開始時刻まで待つ(デフォルト) */
+    DYNAMIXEL_CYCLE_OVERRUN_COMPRESS, /*!< 遅れた周期をすぐに始め、間隔を詰めて予定の開始時刻に追いつく(1周期以上遅れた分は飛ばす) */
+} dynamixel_cycle_overrun_policy;
+
+
+/**
+ * @brief 周期の中の処理
+*/
+typedef enum {
+    DYNAMIXEL_CYCLE_PHASE_READ, /*!< readの送受信 */
+    DYNAMIXEL_CYCLE_PHASE_COMPUTE, /*!< 計算のコールバック */
+    DYNAMIXEL_CYCLE_PHASE_WRITE, /*!< writeの送受信 */
+    DYNAMIXEL_CYCLE_PHASE_NUM,
+} dynamixel_cycle_phase;
+
+
+/**
+ * @brief 周期ごとに呼ぶ計算のコールバック
+ *
+ * readの結果を受け取ったデータの領域から読み、writeするデータをwriteの領域に書き込む
+ *
+ * @param[in] *user_data dynamixel_cycle_configに指定した値
+ * @param[in] cycle 周期の番号(最初の周期の開始時刻から数える、飛ばした周期も数える)
+*/
+typedef void (*dynamixel_cycle_compute)(
+    void *user_data,
+    uint64_t cycle
+);
+
+
+/**
+ * @brief 指定した時刻まで待つ関数
+ *
+ * @param[in] *context dynamixel_cycle_configに指定した値
+ * @param[in] deadline_us 待ち終える時刻(dynamixel_get_time_us()と同じ時計)[micro sec.]
+*/
+typedef void (*dynamixel_cycle_sleep_until)(
+    void *context,
+    uint64_t deadline_us
+);
+
+
+/**
+ * @brief スケジューラーの設定
+*/
+typedef struct
+{
+    /// 周期[micro sec.]
+    uint32_t period_us;
+    /// オーバーランしたときの次の周期の決め方
+    dynamixel_cycle_overrun_policy overrun_policy;
+    /// 登録できるreadとwriteの数
+    size_t transaction_num;
+    /// 計算のコールバック(NULLのときは呼ばない)
+    dynamixel_cycle_compute compute;
+    /// コールバックに渡す値
+    void *user_data;
+    /// 周期の開始時刻まで待つ関数(NULLのときはsleep_us()で待つ、UART以外の経路では時計に合わせて指定する)
+    dynamixel_cycle_sleep_until sleep_until;
+    /// 待つ関数に渡す値
+    void *sleep_context;
+} dynamixel_cycle_config;
+
+
+/**
+ * @brief 周期の統計
+ *
+ * 開始の遅れは予定の開始時刻からの遅れ、周期は前の周期の開始からの時間とする
+*/
+typedef struct
+{
+    /// 実行した周期の数
+    uint64_t cycles;
+    /// 次の周期の開始時刻までに終わらなかった周期の数
+    uint64_t overruns;
+    /// オーバーランで飛ばした周期の数
+    uint64_t skipped_cycles;
+    /// 応答の結果がDYNAMIXEL_PARSE_SUCCESSでなかったreadとwriteの数
+    uint64_t transaction_errors;
+    /// 開始の遅れの最大値と合計[micro sec.]
+    uint32_t start_delay_max_us;
+    uint64_t start_delay_sum_us;
+    /// 周期の最小値と最大値(2つ目の周期から記録する)[micro sec.]
+    uint32_t period_min_us;
+    uint32_t period_max_us;
+    /// 処理ごとの時間の最大値と合計[micro sec.]
+    uint32_t phase_max_us[DYNAMIXEL_CYCLE_PHASE_NUM];
+    uint64_t phase_sum_us[DYNAMIXEL_CYCLE_PHASE_NUM];
+} dynamixel_cycle_statistics;
+
+
+/**
+ * @brief スケジューラーを作成する
+ *
+ * @param[in] dynamixel 通信に使うdynamixelインスタンス
+ * @param[in] *config 設定
+ * @return 作成したスケジューラー(作成できなかった場合はNULL)
+*/
+dynamixel_cycle_t dynamixel_cycle_create(
+    dynamixel_t dynamixel,
+    const dynamixel_cycle_config *config
+);
+
+
+/**
+ * @brief スケジューラーを破棄する
+ *
+ * @param[in] self スケジューラー
+*/
+void dynamixel_cycle_destroy(
+    dynamixel_cycle_t self
+);
+
+
+/**
+ * @brief 周期ごとに行うreadを登録する
+ *
+ * 登録した順に、計算の前に1回ずつ送る(再送はしない)
+ *
+ * @param[in] self スケジューラー
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] start_address コントロールテーブルの開始アドレス
+ * @param[in] data_size 読み取りを行うデータサイズ
+ * @param[out] *data 読み取ったデータ(data_sizeの領域、応答の結果がDYNAMIXEL_PARSE_SUCCESSのときだけ更新する)
+ * @param[out] *result 応答の結果(NULLのときは保存しない)
+ * @retval 0 登録した
+ * @retval 1 登録できなかった(登録できる数を超えた)
+*/
+int dynamixel_cycle_add_read(
+    dynamixel_cycle_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint8_t *data,
+    dynamixel_parse_result *result
+);
+
+
+/**
+ * @brief 周期ごとに行うwriteを登録する
+ *
+ * 登録した順に、計算の後に1回ずつ送る(再送はしない)
+ *
+ * @param[in] self スケジューラー
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] start_address コントロールテーブルの開始アドレス
+ * @param[in] data_size 書き込みを行うデータサイズ
+ * @param[in] *data 書き込むデータ(data_sizeの領域、送るときに読む)
+ * @param[out] *result 応答の結果(NULLのときは保存しない)
+ * @retval 0 登録した
+ * @retval 1 登録できなかった(登録できる数を超えた)
+*/
+int dynamixel_cycle_add_write(
+    dynamixel_cycle_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    const uint8_t *data,
+    dynamixel_parse_result *result
+);
+
+
+/**
+ * @brief 周期ごとに送るメールボックスを設定する
+ *
+ * 登録したwriteの後に、dynamixel_mailbox_flush()で更新された値をSync Writeで送る
+ *
+ * @param[in] self スケジューラー
+ * @param[in] mailbox メールボックス(NULLのときは送らない)
+*/
+void dynamixel_cycle_set_mailbox(
+    dynamixel_cycle_t self,
+    dynamixel_mailbox_t mailbox
+);
+
+
+/**
+ * @brief 次の周期の開始時刻まで待ち、1周期分を実行する
+ *
+ * 最初に呼んだときは、待たずに始める
+ *
+ * @param[in] self スケジューラー
+ * @retval 0 次の周期の開始時刻までに終わった
+ * @retval 1 オーバーランした
+*/
+int dynamixel_cycle_run(
+    dynamixel_cycle_t self
+);
+
+
+/**
+ * @brief 周期の統計を取得する
+ *
+ * @param[in] self スケジューラー
+ * @param[out] *statistics 周期の統計
+*/
+void dynamixel_cycle_get_statistics(
+    dynamixel_cycle_t self,
+    dynamixel_cycle_statistics *statistics
+);
+
+
+/**
+ * @brief 周期の統計を0に戻す
+ *
+ * @param[in] self スケジューラー
+*/
+void dynamixel_cycle_reset_statistics(
+    dynamixel_cycle_t self
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef _ONE_DYNAMIXEL_DYNAMIXEL_ENGINE_H
+#define _ONE_DYNAMIXEL_DYNAMIXEL_ENGINE_H
+
+#include "pico.h"
+#include "dynamixel/dynamixel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief dynamixelインスタンスの通信を、別のコアで行うエンジン
+ *
+ * dynamixel_engine_start()でcore1(hostではスレッド)を起動し、core1が全ての通信を行う。
+ * core0はdynamixel_engine_submit()でコマンドを送り、dynamixel_engine_poll()で結果を受け取るだけなので、
+ * 応答パケットを待つ間も制御の計算を続けられる。
+ * コマンドと結果は、ロックなしのSPSCキュー(util/spsc_queue.h)で受け渡す。
+ * submitとpollは1つの実行コンテキスト(core0)からのみ呼び出すこと。
+ * core1を使うので、dynamixelライブラリとは別のdynamixel_engineライブラリにある
+*/
+typedef struct dynamixel_engine_struct *dynamixel_engine_t;
+
+
+/**
+ * @brief コマンド
+ *
+ * dynamixel_send_packet()で送り、応答パケットを1つ待つ。
+ * ブロードキャストIDへのインストラクションは応答パケットを返さないので、送信が完了したら結果を1つ返す。
+ * Sync Read、Bulk Readは、追加情報のIDの順に応答パケットを受け取り、IDごとに結果を返す。
+ * 応答パケットの数の決め方はdynamixel_asyncと同じで、数が分からないブロードキャストIDへのpingは受け付けない
+*/
+typedef struct
+{
+    /// パケットを送るDynamixelのID
+    uint8_t id;
+    /// インストラクション
+    uint8_t instruction;
+    /// 追加情報のサイズ
+    uint16_t parameter_size;
+    /// 追加情報(受け付け時にコピーされる)
+    const uint8_t *parameter;
+    /// dynamixel_send_packet()のwait_us_multiplier(Sync Read、Bulk Readでは使わない)
+    uint wait_us_multiplier;
+    /// 結果に渡す値
+    void *user_data;
+} dynamixel_engine_command;
+
+
+/**
+ * @brief コマンドの結果
+*/
+typedef struct
+{
+    /// コマンドに指定した値
+    void *user_data;
+    /// パケットを送ったDynamixelのID(Sync Read、Bulk Readでは応答パケットを返すID)
+    uint8_t id;
+    /// インストラクション
+    uint8_t instruction;
+    /// 応答の結果(送信に失敗した場合はDYNAMIXEL_PARSE_WRITE_FAILED、応答パケットのパラメータが結果の領域に入りきらない場合はDYNAMIXEL_PARSE_HUGE_DATA)
+    dynamixel_parse_result result;
+    /// 応答パケットのエラーステータス
+    uint8_t error;
+    /// 応答パケットのパラメータのサイズ
+    size_t status_parameter_size;
+    /// 応答パケットのパラメータ(次にdynamixel_engine_poll()を呼ぶまで有効)
+    const uint8_t *status_parameter;
+} dynamixel_engine_result;
+
+
+/**
+ * @brief キューの大きさ
+*/
+typedef struct
+{
+    /// コマンドキューに入れられるコマンドの数(2のべき乗であること)
+    size_t command_num;
+    /// 1つのコマンドの追加情報の最大サイズ
+    size_t parameter_size;
+    /// 結果キューに入れられる結果の数(2のべき乗であること。Sync Read、Bulk ReadはIDの数だけ使う)
+    size_t result_num;
+    /// 1つの結果の応答パケットのパラメータの最大サイズ
+    size_t status_parameter_size;
+} dynamixel_engine_config;
+
+
+/**
+ * @brief エンジンを作成する
+ *
+ * キューの領域は、作成時に全て確保する
+ *
+ * @param[in] dynamixel 通信に使うdynamixelインスタンス(エンジンの動作中は、他の関数で使わない)
+ * @param[in] *config キューの大きさ
+ * @return 作成したエンジン(作成できなかった場合はNULL)
+*/
+dynamixel_engine_t dynamixel_engine_create(
+    dynamixel_t dynamixel,
+    const dynamixel_engine_config *config
+);
+
+
+/**
+ * @brief エンジンを破棄する
+ *
+ * 動作中の場合は停止してから破棄する。実行していないコマンドは破棄される
+ *
+ * @param[in] self エンジン
+*/
+void dynamixel_engine_destroy(
+    dynamixel_engine_t self
+);
+
+
+/**
+ * @brief core1(hostではスレッド)でコマンドの実行を始める
+ *
+ * @param[in] self エンジン
+ * @retval 0 起動した
+ * @retval 1 起動できなかった(既に動作中、またはcore1を他のエンジンが使っている)
+*/
+int dynamixel_engine_start(
+    dynamixel_engine_t self
+);
+
+
+/**
+ * @brief コマンドの実行を止める
+ *
+ * 実行中のコマンドが完了するまで待つ。実行していないコマンドはキューに残る
+ *
+ * @param[in] self エンジン
+*/
+void dynamixel_engine_stop(
+    dynamixel_engine_t self
+);
+
+
+/**
+ * @brief コマンドをコマンドキューに入れる
+ *
+ * @param[in] self エンジン
+ * @param[in] *command コマンド
+ * @retval 0 受け付けた
+ * @retval 1 受け付けられなかった(コマンドキューが満杯、追加情報が大きすぎるか形式が誤っている、応答パケットの数が分からないか結果キューに入りきらない)
+*/
+int dynamixel_engine_submit(
+    dynamixel_engine_t self,
+    const dynamixel_engine_command *command
+);
+
+
+/**
+ * @brief 結果キューから結果を1つ取り出す
+ *
+ * 前に取り出した結果の領域は、このときに解放する
+ *
+ * @param[in] self エンジン
+ * @param[out] *result 結果
+ * @retval 0 取り出した
+ * @retval 1 結果キューが空だった
+*/
+int dynamixel_engine_poll(
+    dynamixel_engine_t self,
+    dynamixel_engine_result *result
+);
+
+
+/**
+ * @brief コマンドを1つ実行する
+ *
+ * dynamixel_engine_start()の代わりに呼ぶと、呼び出し元でコマンドを実行する(2つ目のコアを使わない場合や試験に使う)。
+ * 動作中のエンジンには呼ばない
+ *
+ * @param[in] self エンジン
+ * @retval true コマンドを実行した
+ * @retval false コマンドキューが空、またはコマンドの全ての結果を入れる空きが結果キューになかった
+*/
+bool dynamixel_engine_step(
+    dynamixel_engine_t self
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef _ONE_DYNAMIXEL_DYNAMIXEL_GROUP_H
+#define _ONE_DYNAMIXEL_DYNAMIXEL_GROUP_H
+
+#include "pico.h"
+#include "dynamixel/dynamixel.h"
+#include "dynamixel/dynamixel_cycle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 複数のバス(dynamixelインスタンス)にまたがる通信の計画を、バスごとに並行して実行する
+ *
+ * IDごとにどのバスにつながっているかを登録し、readとwriteはIDから送るバスを決める。
+ * 1回の実行は、全てのバスのread、計算、全てのバスのwriteの順に行い、
+ * readとwriteはバスごとに登録した順に送る。バス同士は並行して通信するので、
+ * 実行時間は全てのバスの合計ではなく、最も遅いバスで決まる。
+ * hostではバスごとのスレッドで、実機(またはinterleavedを指定した場合)では、
+ * 呼び出し元でdynamixel_poll()を使って全てのバスを交互に進める
+*/
+typedef struct dynamixel_group_struct *dynamixel_group_t;
+
+
+/**
+ * @brief 設定
+*/
+typedef struct
+{
+    /// バス(dynamixelインスタンス)の配列(作成時にコピーされる)
+    const dynamixel_t *bus;
+    /// バスの数
+    size_t bus_num;
+    /// 登録できるreadとwriteの数(全てのバスの合計)
+    size_t transaction_num;
+    /// readとwriteの間に呼ぶ計算のコールバック(NULLのときは呼ばない)
+    dynamixel_cycle_compute compute;
+    /// コールバックに渡す値
+    void *user_data;
+    /// trueのとき、hostでもスレッドを使わずに呼び出し元で全てのバスを交互に進める
+    bool interleaved;
+} dynamixel_group_config;
+
+
+/**
+ * @brief 統計
+ *
+ * readとwriteの時間は、バスごとにそのバスの時計(dynamixel_get_time_us())で測った時間のうち、最も長いものとする
+*/
+typedef struct
+{
+    /// 実行した回数
+    uint64_t runs;
+    /// 応答の結果がDYNAMIXEL_PARSE_SUCCESSでなかったreadとwriteの数
+    uint64_t transaction_errors;
+    /// 最後の実行のreadとwriteの時間[micro sec.]
+    uint32_t last_read_us;
+    uint32_t last_write_us;
+    /// readとwriteの時間の最大値[micro sec.]
+    uint32_t read_max_us;
+    uint32_t write_max_us;
+} dynamixel_group_statistics;
+
+
+/**
+ * @brief グループを作成する
+ *
+ * hostでは、interleavedを指定しない場合にバスごとのスレッドを起動する
+ *
+ * @param[in] *config 設定
+ * @return 作成したグループ(作成できなかった場合はNULL)
+*/
+dynamixel_group_t dynamixel_group_create(
+    const dynamixel_group_config *config
+);
+
+
+/**
+ * @brief グループを破棄する
+ *
+ * スレッドを止めてから破棄する。バスのdynamixelインスタンスは破棄しない
+ *
+ * @param[in] self グループ
+*/
+void dynamixel_group_destroy(
+    dynamixel_group_t self
+);
+
+
+/**
+ * @brief IDがつながっているバスを登録する
+ *
+ * 登録し直した場合は、それ以降に登録したreadとwriteから新しいバスに送る
+ *
+ * @param[in] self グループ
+ * @param[in] id DynamixelのID
+ * @param[in] bus バスの番号(dynamixel_group_configのbusの添字)
+ * @retval 0 登録した
+ * @retval 1 登録できなかった(バスの番号が誤っている、ブロードキャストID)
+*/
+int dynamixel_group_assign(
+    dynamixel_group_t self,
+    uint8_t id,
+    size_t bus
+);
+
+
+/**
+ * @brief 実行ごとに行うreadを登録する
+ *
+ * @param[in] self グループ
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] start_address コントロールテーブルの開始アドレス
+ * @param[in] data_size 読み取りを行うデータサイズ
+ * @param[out] *data 読み取ったデータ(data_sizeの領域、応答の結果がDYNAMIXEL_PARSE_SUCCESSのときだけ更新する)
+ * @param[out] *result 応答の結果(NULLのときは保存しない)
+ * @retval 0 登録した
+ * @retval 1 登録できなかった(登録できる数を超えた、バスを登録していないID)
+*/
+int dynamixel_group_add_read(
+    dynamixel_group_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint8_t *data,
+    dynamixel_parse_result *result
+);
+
+
+/**
+ * @brief 実行ごとに行うwriteを登録する
+ *
+ * @param[in] self グループ
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] start_address コントロールテーブルの開始アドレス
+ * @param[in] data_size 書き込みを行うデータサイズ
+ * @param[in] *data 書き込むデータ(data_sizeの領域、送るときに読む)
+ * @param[out] *result 応答の結果(NULLのときは保存しない)
+ * @retval 0 登録した
+ * @retval 1 登録できなかった(登録できる数を超えた、バスを登録していないID)
+*/
+int dynamixel_group_add_write(
+    dynamixel_group_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    const uint8_t *data,
+    dynamixel_parse_result *result
+);
+
+
+/**
+ * @brief 全てのバスのread、計算、全てのバスのwriteを1回実行する
+ *
+ * @param[in] self グループ
+ * @retval 0 全てのreadとwriteが成功した
+ * @retval 1 成功しなかったreadまたはwriteがある
+*/
+int dynamixel_group_run(
+    dynamixel_group_t self
+);
+
+
+/**
+ * @brief 統計を取得する
+ *
+ * @param[in] self グループ
+ * @param[out] *statistics 統計
+*/
+void dynamixel_group_get_statistics(
+    dynamixel_group_t self,
+    dynamixel_group_statistics *statistics
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef _ONE_DYNAMIXEL_DYNAMIXEL_MAILBOX_H
+#define _ONE_DYNAMIXEL_DYNAMIXEL_MAILBOX_H
+
+#include "pico.h"
+#include "dynamixel/dynamixel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Dynamixelごとに最新の目標値を1つだけ保持するメールボックス
+ *
+ * 1つのコントロールテーブルの項目(Goal Positionなど)について、IDごとに値を1つ保持する。
+ * dynamixel_mailbox_post()は通信を待たずに値を上書きし、
+ * バスを動かす側はdynamixel_mailbox_flush()で、更新された全てのIDの最新の値を1つのSync Writeで送る。
+ * 送る前に上書きされた古い値は送らない。
+ *
+ * 値はIDごとの番号(奇数のときは書き込み中)で守り、ロックを使わない。
+ * 同じIDへのpostは1つの実行コンテキストから行うこと(IDごとに別のコアやスレッドから呼んでよい)。
+ * flushは1つの実行コンテキストから行うこと
+*/
+typedef struct dynamixel_mailbox_struct *dynamixel_mailbox_t;
+
+
+/**
+ * @brief 統計
+*/
+typedef struct
+{
+    /// postされた値の数
+    uint64_t posts;
+    /// 送る前に上書きされたため、送らなかった値の数
+    uint64_t superseded;
+    /// Sync Writeで送った値の数
+    uint64_t sent;
+    /// 送ったSync Writeの数
+    uint64_t sync_writes;
+} dynamixel_mailbox_statistics;
+
+
+/**
+ * @brief メールボックスを作成する
+ *
+ * @param[in] *id 値を保持するIDの配列
+ * @param[in] id_num IDの数
+ * @param[in] start_address コントロールテーブルの開始アドレス
+ * @param[in] data_size 1つの値のデータサイズ
+ * @return 作成したメールボックス(作成できなかった場合はNULL)
+*/
+dynamixel_mailbox_t dynamixel_mailbox_create(
+    const uint8_t *id,
+    size_t id_num,
+    uint16_t start_address,
+    uint16_t data_size
+);
+
+
+/**
+ * @brief メールボックスを破棄する
+ *
+ * @param[in] self メールボックス
+*/
+void dynamixel_mailbox_destroy(
+    dynamixel_mailbox_t self
+);
+
+
+/**
+ * @brief 値を上書きする
+ *
+ * 通信は行わず、待たずに戻る
+ *
+ * @param[in] self メールボックス
+ * @param[in] id DynamixelのID
+ * @param[in] *data 値(data_sizeの領域)
+ * @retval 0 上書きした
+ * @retval 1 作成時に指定していないID
+*/
+int dynamixel_mailbox_post(
+    dynamixel_mailbox_t self,
+    uint8_t id,
+    const uint8_t *data
+);
+
+
+/**
+ * @brief 目標positionを上書きする
+ *
+ * Goal Position(開始アドレス116、データサイズ4)のメールボックスに使う。
+ * 値の変換はdynamixel_send_write_goal_position()と同じ
+ *
+ * @param[in] self メールボックス
+ * @param[in] id DynamixelのID
+ * @param[in] goal_position dynamixelの角度[degree]
+ * @retval 0 上書きした
+ * @retval 1 作成時に指定していないID、またはGoal Positionのメールボックスでない
+*/
+int dynamixel_mailbox_post_goal_position(
+    dynamixel_mailbox_t self,
+    uint8_t id,
+    float goal_position
+);
+
+
+/**
+ * @brief 前回送った後に上書きされた全てのIDの最新の値を、Sync Writeで送る
+ *
+ * 送信の完了まで待つ(Sync Writeは応答パケットを返さない)。
+ * 1つのパケットがdynamixelインスタンスのバッファーに入りきらない場合は、複数のSync Writeに分ける。
+ * 送信に失敗した値は、次に呼んだときに送る
+ *
+ * @param[in] self メールボックス
+ * @param[in] dynamixel 送るdynamixelインスタンス
+ * @return 送った値の数
+*/
+size_t dynamixel_mailbox_flush(
+    dynamixel_mailbox_t self,
+    dynamixel_t dynamixel
+);
+
+
+/**
+ * @brief 統計を取得する
+ *
+ * flushと同じ実行コンテキストから呼ぶこと
+ *
+ * @param[in] self メールボックス
+ * @param[out] *statistics 統計
+*/
+void dynamixel_mailbox_get_statistics(
+    dynamixel_mailbox_t self,
+    dynamixel_mailbox_statistics *statistics
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
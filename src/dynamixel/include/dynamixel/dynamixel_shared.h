@@ -0,0 +1,127 @@
+#ifndef _ONE_DYNAMIXEL_DYNAMIXEL_SHARED_H
+#define _ONE_DYNAMIXEL_DYNAMIXEL_SHARED_H
+
+#include "pico.h"
+#include "dynamixel/dynamixel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 1つのdynamixelインスタンスを、複数のスレッドから使うためのハンドル(hostのみ)
+ *
+ * リクエストは内部のキューに受け付けた順に並べ、1つずつ通信する。
+ * 通信は、待っているスレッドのうちの1つが行う(通信用のスレッドは作らない)。
+ * 同じID、アドレス、サイズのreadが、キューで通信を待っているreadと重なった場合は、通信を1回にまとめて結果を全員に返す。
+ * 通信中のreadにはまとめず、後に並べる
+*/
+typedef struct dynamixel_shared_struct *dynamixel_shared_t;
+
+
+/**
+ * @brief 統計
+*/
+typedef struct
+{
+    /// 受け付けたリクエストの数
+    uint64_t requests;
+    /// 通信した回数
+    uint64_t transactions;
+    /// 他のreadにまとめたreadの数
+    uint64_t coalesced_reads;
+} dynamixel_shared_statistics;
+
+
+/**
+ * @brief ハンドルを作成する
+ *
+ * @param[in] dynamixel 通信に使うdynamixelインスタンス(ハンドルを使っている間は、他の関数で通信しない)
+ * @return 作成したハンドル(作成できなかった場合はNULL)
+*/
+dynamixel_shared_t dynamixel_shared_create(
+    dynamixel_t dynamixel
+);
+
+
+/**
+ * @brief ハンドルを破棄する
+ *
+ * 全てのスレッドがハンドルを使い終わってから呼び出すこと
+ *
+ * @param[in] self ハンドル
+*/
+void dynamixel_shared_destroy(
+    dynamixel_shared_t self
+);
+
+
+/**
+ * @brief パケットを送り、応答パケットを待つ
+ *
+ * 他のスレッドのリクエストの後に、dynamixel_send_packet()で通信する。まとめて通信することはない
+ *
+ * @param[in] self ハンドル
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] instruction インストラクション
+ * @param[in] parameter_size 追加情報のサイズ
+ * @param[in] *parameter 追加情報
+ * @param[out] *error 応答パケットのエラーステータス
+ * @param[out] *status_parameter_size 応答パケットのパラメータのサイズ
+ * @param[out] *status_parameter 応答パケットのパラメータ(サイズはdynamixel_get_buffer_size()以上にする)
+ * @param[in] wait_us_multiplier dynamixel_send_packet()のwait_us_multiplier
+ * @return 解析結果
+*/
+dynamixel_parse_result dynamixel_shared_send_packet(
+    dynamixel_shared_t self,
+    uint8_t id,
+    uint8_t instruction,
+    uint16_t parameter_size,
+    const uint8_t *parameter,
+    uint8_t *error,
+    size_t *status_parameter_size,
+    uint8_t *status_parameter,
+    uint wait_us_multiplier
+);
+
+
+/**
+ * @brief readを送り、読み込んだデータを受け取る
+ *
+ * 同じID、アドレス、サイズのreadが、キューで待っているか通信中の場合は、その結果を受け取る
+ *
+ * @param[in] self ハンドル
+ * @param[in] id パケットを送るDynamixelのID
+ * @param[in] start_address 読み込み開始アドレス
+ * @param[in] data_size 読み込むデータサイズ
+ * @param[out] *error 応答パケットのエラーステータス
+ * @param[out] *data 読み込んだデータ
+ * @return dynamixel_send_read_once()と同じ解析結果
+*/
+dynamixel_parse_result dynamixel_shared_read(
+    dynamixel_shared_t self,
+    uint8_t id,
+    uint16_t start_address,
+    uint16_t data_size,
+    uint8_t *error,
+    uint8_t *data
+);
+
+
+/**
+ * @brief 統計を取得する
+ *
+ * @param[in] self ハンドル
+ * @param[out] *statistics 統計
+*/
+void dynamixel_shared_get_statistics(
+    dynamixel_shared_t self,
+    dynamixel_shared_statistics *statistics
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
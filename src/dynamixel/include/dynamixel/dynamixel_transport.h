@@ -0,0 +1,93 @@
+#ifndef _ONE_DYNAMIXEL_DYNAMIXEL_TRANSPORT_H
+#define _ONE_DYNAMIXEL_DYNAMIXEL_TRANSPORT_H
+
+#include "pico.h"
+#include "hardware/uart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief dynamixelインスタンスがパケットを送受信する経路
+ *
+ * 関数にはcontextがそのまま渡される。
+ * 戻り値はpico_communicatorの関数と同じ規約とする(0のとき成功、読み込み可能)
+*/
+typedef struct
+{
+    /// 経路ごとのデータ(UARTのときはuartインスタンス)
+    void *context;
+
+    /**
+     * @brief 書き込みを行う(完了するまで待つ)
+     * @retval 0 書き込みを行った
+     * @retval 1 書き込みを行えなかった
+    */
+    int (*write)(void *context, const uint8_t *src, size_t len);
+
+    /**
+     * @brief 書き込みを開始する(完了を待たない、完了するまでsrcを変更しない)
+     * @retval 0 書き込みを開始した
+     * @retval 1 書き込みを開始できなかった
+    */
+    int (*write_async)(void *context, const uint8_t *src, size_t len);
+
+    /**
+     * @brief write_asyncで開始した書き込みが完了するまで待つ
+     * @retval 0 書き込みが完了した
+     * @retval 1 書き込みに失敗した
+    */
+    int (*wait_write)(void *context);
+
+    /**
+     * @brief write_asyncで開始した書き込みが完了したかを確認する(待たない)
+     * @retval 0 書き込みが完了した(書き込み中のデータがない)
+     * @retval 1 書き込み中
+    */
+    int (*write_done)(void *context);
+
+    /**
+     * @brief 受信済みのデータをまとめて読み込む(待たない)
+     * @return 読み込んだデータサイズ
+    */
+    size_t (*read_available)(void *context, uint8_t *dst, size_t max);
+
+    /**
+     * @brief 指定した時間だけ、データが読み込めるようになるまで待つ(0のときは待たない)
+     * @retval 0 読み込み可能
+     * @retval 1 読み込み不可能
+    */
+    int (*wait_readable)(void *context, uint us);
+
+    /**
+     * @brief ボーレートを変更する
+     * @return 実際に設定されたボーレート
+    */
+    uint (*set_baud)(void *context, uint baud_rate);
+
+    /**
+     * @brief 現在時刻を返す(応答時間の測定、受信時刻の記録に使う)
+     * @return 現在時刻[micro sec.](一周しない64bitの値)
+    */
+    uint64_t (*now_us)(void *context);
+} dynamixel_transport;
+
+
+/**
+ * @brief UART(pico_communicator)を使う経路を作成する
+ *
+ * @param[out] *transport 作成した経路
+ * @param[in] *uart_id UARTインスタンス
+*/
+void dynamixel_transport_init_uart(
+    dynamixel_transport *transport,
+    uart_inst_t *uart_id
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -79,6 +79,51 @@ int pico_uart_write_blocking(
 );
 
 
+/**
+ * @brief UARTへの書き込みを開始する(完了を待たない)
+ *
+ * 送信が完了するまで、srcの内容を変更したり解放したりしないこと。
+ * 前の送信が完了していない場合は、完了を待ってから開始する
+ *
+ * @param[in] *uart_id uartインスタンス
+ * @param[in] *src 書き込みを行うデータ
+ * @param[in] len データのサイズ
+ * @retval 0 書き込みを開始した
+ * @retval 1 書き込みを開始できなかった
+*/
+int pico_uart_start_write(
+    uart_inst_t *uart_id,
+    const uint8_t *src,
+    size_t len
+);
+
+
+/**
+ * @brief pico_uart_start_writeで開始した送信が完了したかを確認する
+ *
+ * 最後のByteが送信線に出きったときに完了とする
+ *
+ * @param[in] *uart_id uartインスタンス
+ * @retval 0 送信が完了した(送信中のデータがない)
+ * @retval 1 送信中
+*/
+int pico_uart_write_done(
+    uart_inst_t *uart_id
+);
+
+
+/**
+ * @brief pico_uart_start_writeで開始した送信が完了するまで待つ
+ *
+ * @param[in] *uart_id uartインスタンス
+ * @retval 0 送信が完了した
+ * @retval 1 送信に失敗した
+*/
+int pico_uart_wait_write(
+    uart_inst_t *uart_id
+);
+
+
 /**
  * @brief UARTのFIFOからの読み込みが可能か
  *
@@ -119,6 +164,95 @@ int pico_uart_read_raw(
 );
 
 
+/**
+ * @brief UARTのFIFOに溜まっているデータをまとめて読み込む
+ *
+ * データが来るのを待つことはせず、その時点で読み込めるデータのみを読み込む
+ *
+ * @param[in] *uart_id uartインスタンス
+ * @param[out] *dst 読み込みデータの保存先
+ * @param[in] max 読み込む最大のデータサイズ
+ * @return 読み込んだデータサイズ(データがなかった場合は0)
+*/
+size_t pico_uart_read_available(
+    uart_inst_t *uart_id,
+    uint8_t *dst,
+    size_t max
+);
+
+
+/**
+ * @brief 割り込みによる受信を有効にする
+ *
+ * 受信割り込みでFIFOのデータをリングバッファーに移すため、
+ * 読み込み関数を呼んでいない間もFIFOが溢れなくなる。
+ * 有効にした後は、pico_uart_is_readable、pico_uart_is_readable_within_us、
+ * pico_uart_read_raw、pico_uart_read_availableもリングバッファーから読み込む
+ *
+ * @param[in] *uart_id uartインスタンス
+ * @param[in] buffer_size リングバッファーのサイズ(2のべき乗であること)
+ * @retval 0 有効にした
+ * @retval 1 有効にできなかった
+*/
+int pico_uart_enable_rx_irq(
+    uart_inst_t *uart_id,
+    size_t buffer_size
+);
+
+
+/**
+ * @brief 割り込みによる受信を無効にする
+ *
+ * リングバッファーに残っているデータは破棄する
+ *
+ * @param[in] *uart_id uartインスタンス
+*/
+void pico_uart_disable_rx_irq(
+    uart_inst_t *uart_id
+);
+
+
+/**
+ * @brief 受信済みで読み込めるデータサイズを返す
+ *
+ * @param[in] *uart_id uartインスタンス
+ * @return 読み込めるデータサイズ
+*/
+size_t pico_uart_rx_available(
+    uart_inst_t *uart_id
+);
+
+
+/**
+ * @brief 受信済みのデータを取り出さずにコピーする
+ *
+ * @param[in] *uart_id uartインスタンス
+ * @param[out] *dst コピー先
+ * @param[in] max コピーする最大のデータサイズ
+ * @return コピーしたデータサイズ
+*/
+size_t pico_uart_rx_peek(
+    uart_inst_t *uart_id,
+    uint8_t *dst,
+    size_t max
+);
+
+
+/**
+ * @brief 受信済みのデータを先頭から捨てる
+ *
+ * pico_uart_rx_peekで確認したデータを取り出すときに使う
+ *
+ * @param[in] *uart_id uartインスタンス
+ * @param[in] len 捨てるデータサイズ
+ * @return 捨てたデータサイズ
+*/
+size_t pico_uart_rx_consume(
+    uart_inst_t *uart_id,
+    size_t len
+);
+
+
 #ifdef __cplusplus
 }
 #endif
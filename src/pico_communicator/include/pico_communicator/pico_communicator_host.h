@@ -0,0 +1,43 @@
+#ifndef _ONE_DYNAMIXEL_PICO_COMMUNICATOR_HOST_H
+#define _ONE_DYNAMIXEL_PICO_COMMUNICATOR_HOST_H
+
+#include "pico.h"
+#include "hardware/uart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief UARTインスタンスにhostのシリアルデバイスを割り当てる(PICO_PLATFORM=hostのときのみ)
+ *
+ * pico_uart_initの前に呼び出す。割り当てていないUARTインスタンスは、何も接続されていないものとして扱う
+ *
+ * @param[in] *uart_id uartインスタンス
+ * @param[in] *device_path シリアルデバイスのパス(/dev/ttyUSB0、ptyのslaveなど)
+ * @retval 0 割り当てを行った
+ * @retval 1 割り当てを行えなかった(割り当て数の上限、または初期化済みのUARTインスタンス)
+*/
+int pico_uart_host_bind(
+    uart_inst_t *uart_id,
+    const char *device_path
+);
+
+
+/**
+ * @brief UARTインスタンスに割り当てたシリアルデバイスのファイルディスクリプタを取得する
+ *
+ * @param[in] *uart_id uartインスタンス
+ * @return ファイルディスクリプタ(初期化されていない場合は-1)
+*/
+int pico_uart_host_get_fd(
+    uart_inst_t *uart_id
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
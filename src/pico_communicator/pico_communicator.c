@@ -1,5 +1,48 @@
+#include "hardware/dma.h"
+#include "hardware/irq.h"
 #include "hardware/uart.h"
+#include "pico/time.h"
 #include "pico_communicator/pico_communicator.h"
+#include "util/ring_buffer.h"
+
+
+// 受信割り込みで使うリングバッファー(UARTの番号ごと)
+static ring_buffer_t rx_ring_buffer[NUM_UARTS];
+// 非同期の送信で使うDMAチャンネル(UARTの番号ごと、初めて送信するときに確保する)
+static uint tx_dma_channel[NUM_UARTS];
+static bool tx_dma_claimed[NUM_UARTS];
+
+
+static ring_buffer_t get_rx_ring_buffer(
+    uart_inst_t *uart_id
+)
+{
+    return rx_ring_buffer[uart_get_index(uart_id)];
+}
+
+
+static void drain_rx_fifo(
+    uart_inst_t *uart_id
+)
+{
+    ring_buffer_t ring_buffer = get_rx_ring_buffer(uart_id);
+
+    // リングバッファーが満杯でもFIFOは空にする(割り込みが発生し続けるため)
+    while (uart_is_readable(uart_id))
+        ring_buffer_push(ring_buffer, (uint8_t)uart_get_hw(uart_id)->dr);
+}
+
+
+static void on_uart0_rx(void)
+{
+    drain_rx_fifo(uart0);
+}
+
+
+static void on_uart1_rx(void)
+{
+    drain_rx_fifo(uart1);
+}
 
 
 int pico_uart_write_blocking(
@@ -13,18 +56,109 @@ int pico_uart_write_blocking(
     return 0;
 }
 
+int pico_uart_start_write(
+    uart_inst_t *uart_id,
+    const uint8_t *src,
+    size_t len
+)
+{
+    uint index = uart_get_index(uart_id);
+    dma_channel_config config;
+
+    if (!tx_dma_claimed[index])
+    {
+        int channel = dma_claim_unused_channel(false);
+        if (channel < 0)
+            return 1;
+
+        tx_dma_channel[index] = channel;
+        tx_dma_claimed[index] = true;
+    }
+
+    // 前の送信データをFIFOに送り終えるまで待つ
+    dma_channel_wait_for_finish_blocking(tx_dma_channel[index]);
+
+    config = dma_channel_get_default_config(tx_dma_channel[index]);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    // UARTの送信FIFOに空きがあるときだけ転送する
+    channel_config_set_dreq(&config, uart_get_dreq(uart_id, true));
+
+    dma_channel_configure(
+        tx_dma_channel[index], &config,
+        &uart_get_hw(uart_id)->dr, src, len,
+        true
+    );
+
+    return 0;
+}
+
+int pico_uart_write_done(
+    uart_inst_t *uart_id
+)
+{
+    uint index = uart_get_index(uart_id);
+
+    if (tx_dma_claimed[index] && dma_channel_is_busy(tx_dma_channel[index]))
+        return 1;
+
+    // FIFOが空でも、シフトレジスタから送信中の場合がある
+    return (uart_get_hw(uart_id)->fr & UART_UARTFR_BUSY_BITS) ? 1 : 0;
+}
+
+int pico_uart_wait_write(
+    uart_inst_t *uart_id
+)
+{
+    uint index = uart_get_index(uart_id);
+
+    if (tx_dma_claimed[index])
+        dma_channel_wait_for_finish_blocking(tx_dma_channel[index]);
+    uart_tx_wait_blocking(uart_id);
+
+    return 0;
+}
+
 int pico_uart_is_readable(
     uart_inst_t *uart_id
 )
 {
+    if (get_rx_ring_buffer(uart_id))
+        return !ring_buffer_available(get_rx_ring_buffer(uart_id));
+
     return !uart_is_readable(uart_id);
 }
 
+int pico_uart_is_readable_within_us(
+    uart_inst_t *uart_id,
+    uint us
+)
+{
+    ring_buffer_t ring_buffer = get_rx_ring_buffer(uart_id);
+
+    if (!ring_buffer)
+        return !uart_is_readable_within_us(uart_id, us);
+
+    absolute_time_t timeout = make_timeout_time_us(us);
+    while (!ring_buffer_available(ring_buffer))
+    {
+        if (time_reached(timeout))
+            return 1;
+        tight_loop_contents();
+    }
+
+    return 0;
+}
+
 int pico_uart_read_raw(
     uart_inst_t *uart_id,
     uint8_t *dst
 )
 {
+    if (get_rx_ring_buffer(uart_id))
+        return !ring_buffer_read(get_rx_ring_buffer(uart_id), dst, 1);
+
     if (uart_is_readable(uart_id))
     {
         uart_read_blocking(uart_id, dst, 1);
@@ -35,3 +169,99 @@ int pico_uart_read_raw(
         return 1;
     }
 }
+
+size_t pico_uart_read_available(
+    uart_inst_t *uart_id,
+    uint8_t *dst,
+    size_t max
+)
+{
+    size_t n = 0;
+
+    if (get_rx_ring_buffer(uart_id))
+        return ring_buffer_read(get_rx_ring_buffer(uart_id), dst, max);
+
+    // 1Byteずつuart_read_blockingを呼ぶと、その都度readableを確認するため、DRレジスタを直接読む
+    while (n < max && uart_is_readable(uart_id))
+    {
+        dst[n] = (uint8_t)uart_get_hw(uart_id)->dr;
+        n++;
+    }
+
+    return n;
+}
+
+int pico_uart_enable_rx_irq(
+    uart_inst_t *uart_id,
+    size_t buffer_size
+)
+{
+    uint index = uart_get_index(uart_id);
+    uint irq = index == 0 ? UART0_IRQ : UART1_IRQ;
+
+    if (rx_ring_buffer[index])
+        return 1;
+
+    rx_ring_buffer[index] = ring_buffer_create(buffer_size);
+    if (!rx_ring_buffer[index])
+        return 1;
+
+    irq_set_exclusive_handler(irq, index == 0 ? on_uart0_rx : on_uart1_rx);
+    irq_set_enabled(irq, true);
+    // FIFOが閾値に達したときと、受信が途切れたとき(タイムアウト)に割り込みが発生する
+    uart_set_irq_enables(uart_id, true, false);
+
+    return 0;
+}
+
+void pico_uart_disable_rx_irq(
+    uart_inst_t *uart_id
+)
+{
+    uint index = uart_get_index(uart_id);
+    uint irq = index == 0 ? UART0_IRQ : UART1_IRQ;
+
+    if (!rx_ring_buffer[index])
+        return;
+
+    uart_set_irq_enables(uart_id, false, false);
+    irq_set_enabled(irq, false);
+    irq_remove_handler(irq, index == 0 ? on_uart0_rx : on_uart1_rx);
+
+    ring_buffer_destroy(rx_ring_buffer[index]);
+    rx_ring_buffer[index] = NULL;
+}
+
+size_t pico_uart_rx_available(
+    uart_inst_t *uart_id
+)
+{
+    if (get_rx_ring_buffer(uart_id))
+        return ring_buffer_available(get_rx_ring_buffer(uart_id));
+
+    // 割り込みを使っていない場合は、FIFOにデータがあるかどうかしか分からない
+    return uart_is_readable(uart_id) ? 1 : 0;
+}
+
+size_t pico_uart_rx_peek(
+    uart_inst_t *uart_id,
+    uint8_t *dst,
+    size_t max
+)
+{
+    if (!get_rx_ring_buffer(uart_id))
+        return 0;
+
+    return ring_buffer_peek(get_rx_ring_buffer(uart_id), dst, max);
+}
+
+size_t pico_uart_rx_consume(
+    uart_inst_t *uart_id,
+    size_t len
+)
+{
+    if (!get_rx_ring_buffer(uart_id))
+        return 0;
+
+    return ring_buffer_consume(get_rx_ring_buffer(uart_id), len);
+}
@@ -27,6 +27,8 @@ void pico_uart_deinit(
     uart_inst_t *uart_id
 )
 {
+    pico_uart_wait_write(uart_id);
+    pico_uart_disable_rx_irq(uart_id);
     uart_deinit(uart_id);
 }
 
@@ -47,14 +49,3 @@ void pico_uart_set_fifo_enabled(
 {
     uart_set_fifo_enabled(uart_id, enabled);
 }
-
-
-int pico_uart_is_readable_within_us(
-    uart_inst_t *uart_id,
-    uint us
-)
-{
-    return !uart_is_readable_within_us(
-        uart_id, us
-    );
-}
@@ -1,5 +1,262 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+// glibcの<termios.h>とは同時に読み込めないため、termios2はカーネルのヘッダーから読み込む
+#include <asm/termbits.h>
 #include "hardware/uart.h"
 #include "pico_communicator/pico_communicator.h"
+#include "pico_communicator/pico_communicator_host.h"
+
+
+// UARTインスタンスとシリアルデバイスの対応を記録する
+#define MAX_HOST_UART_NUM 8
+#define MAX_DEVICE_PATH_SIZE 256
+#define HOST_READ_BUFFER_SIZE 512
+
+typedef struct
+{
+    uart_inst_t *uart_id;
+    char device_path[MAX_DEVICE_PATH_SIZE];
+    int fd;
+    uint baud_rate;
+    // OSのバッファーから読み込んだが、まだ取り出されていないデータ
+    uint8_t read_buffer[HOST_READ_BUFFER_SIZE];
+    size_t read_position;
+    size_t read_size;
+    // pico_uart_start_writeで渡されたが、まだOSに渡していないデータ
+    const uint8_t *write_data;
+    size_t write_remaining;
+} host_uart;
+
+static host_uart host_uart_list[MAX_HOST_UART_NUM];
+static size_t host_uart_count = 0;
+
+
+static host_uart *find_host_uart(
+    uart_inst_t *uart_id
+)
+{
+    for (size_t i = 0; i < host_uart_count; i++)
+    {
+        if (host_uart_list[i].uart_id == uart_id)
+            return &host_uart_list[i];
+    }
+
+    return NULL;
+}
+
+
+static int apply_termios(
+    host_uart *uart,
+    uint baud_rate
+)
+{
+    struct termios2 tio;
+
+    if (ioctl(uart->fd, TCGETS2, &tio) < 0)
+        return 1;
+
+    // rawモード(cfmakerawと同じ設定)
+    tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+    tio.c_oflag &= ~OPOST;
+    tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    // Dynamixel2.0のフォーマット(8bit、ストップビット1、パリティなし、フロー制御なし)
+    tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS);
+    tio.c_cflag |= CS8 | CREAD | CLOCAL;
+    // readはブロックしない(待ち時間はpollで管理する)
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+
+    // BOTHERを指定すると、任意のボーレートを設定できる
+    tio.c_cflag &= ~CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_ispeed = baud_rate;
+    tio.c_ospeed = baud_rate;
+
+    if (ioctl(uart->fd, TCSETS2, &tio) < 0)
+        return 1;
+
+    // 実際に設定されたボーレートを読み出す
+    if (ioctl(uart->fd, TCGETS2, &tio) == 0 && tio.c_ospeed > 0)
+        uart->baud_rate = tio.c_ospeed;
+    else
+        uart->baud_rate = baud_rate;
+
+    return 0;
+}
+
+
+/**
+ * @brief OSのバッファーからデータを読み込んでreadバッファーに追加する
+ *
+ * @retval 0 1Byte以上のデータを読み込んだ
+ * @retval 1 データを読み込めなかった
+*/
+static int fill_read_buffer(
+    host_uart *uart
+)
+{
+    ssize_t read_size;
+
+    if (uart->read_position == uart->read_size)
+    {
+        uart->read_position = 0;
+        uart->read_size = 0;
+    }
+    if (uart->read_size == HOST_READ_BUFFER_SIZE)
+        return 1;
+
+    do
+    {
+        read_size = read(
+            uart->fd,
+            uart->read_buffer + uart->read_size,
+            HOST_READ_BUFFER_SIZE - uart->read_size
+        );
+    }
+    while (read_size < 0 && errno == EINTR);
+
+    if (read_size <= 0)
+        return 1;
+
+    uart->read_size += read_size;
+    return 0;
+}
+
+
+static int wait_readable(
+    host_uart *uart,
+    uint us
+)
+{
+    struct pollfd pfd;
+    struct timespec timeout;
+    int poll_result;
+
+    if (uart->read_position < uart->read_size)
+        return 0;
+
+    pfd.fd = uart->fd;
+    pfd.events = POLLIN;
+    timeout.tv_sec = us / 1000000;
+    timeout.tv_nsec = (us % 1000000) * 1000;
+
+    // pollはミリ秒単位のため、マイクロ秒単位で待てるppollを使う
+    do
+    {
+        poll_result = ppoll(&pfd, 1, &timeout, NULL);
+    }
+    while (poll_result < 0 && errno == EINTR);
+
+    if (poll_result <= 0 || !(pfd.revents & POLLIN))
+        return 1;
+
+    return fill_read_buffer(uart);
+}
+
+
+/**
+ * @brief 送信待ちのデータを、OSのバッファーに入るだけ書き込む
+ *
+ * @retval 0 書き込みを行った(送信待ちのデータが残っている場合もある)
+ * @retval 1 書き込みに失敗した
+*/
+static int progress_write(
+    host_uart *uart
+)
+{
+    ssize_t write_size;
+
+    while (uart->write_remaining > 0)
+    {
+        write_size = write(uart->fd, uart->write_data, uart->write_remaining);
+        if (write_size < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+
+            uart->write_remaining = 0;
+            return 1;
+        }
+
+        uart->write_data += write_size;
+        uart->write_remaining -= write_size;
+    }
+
+    return 0;
+}
+
+
+static int finish_write(
+    host_uart *uart
+)
+{
+    struct pollfd pfd;
+
+    pfd.fd = uart->fd;
+    pfd.events = POLLOUT;
+
+    while (uart->write_remaining > 0)
+    {
+        if (progress_write(uart))
+            return 1;
+        if (uart->write_remaining > 0)
+            // OSの送信バッファーが空くまで待つ
+            poll(&pfd, 1, -1);
+    }
+
+    return 0;
+}
+
+
+int pico_uart_host_bind(
+    uart_inst_t *uart_id,
+    const char *device_path
+)
+{
+    host_uart *uart;
+
+    if (strlen(device_path) >= MAX_DEVICE_PATH_SIZE)
+        return 1;
+
+    uart = find_host_uart(uart_id);
+    if (!uart)
+    {
+        if (host_uart_count >= MAX_HOST_UART_NUM)
+            return 1;
+
+        uart = &host_uart_list[host_uart_count];
+        host_uart_count++;
+        memset(uart, 0, sizeof(host_uart));
+        uart->uart_id = uart_id;
+        uart->fd = -1;
+    }
+    else if (uart->fd >= 0)
+    {
+        // 初期化済みのUARTインスタンスは付け替えられない
+        return 1;
+    }
+
+    strcpy(uart->device_path, device_path);
+    return 0;
+}
+
+
+int pico_uart_host_get_fd(
+    uart_inst_t *uart_id
+)
+{
+    host_uart *uart = find_host_uart(uart_id);
+
+    return uart ? uart->fd : -1;
+}
 
 
 uint pico_uart_init(
@@ -10,14 +267,28 @@ uint pico_uart_init(
     uart_parity_t parity
 )
 {
-    uint actual_baud_rate;
+    host_uart *uart = find_host_uart(uart_id);
+
+    // デバイスが割り当てられていない場合は、何も接続されていないUARTとして扱う
+    if (!uart)
+        return baud_rate;
+
+    if (uart->fd < 0)
+    {
+        uart->fd = open(uart->device_path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (uart->fd < 0)
+            return 0;
+    }
 
-    actual_baud_rate = uart_init(uart_id, baud_rate);
+    uart->read_position = 0;
+    uart->read_size = 0;
+    if (apply_termios(uart, baud_rate))
+        return 0;
 
-    // uart_set_hw_flow(uart_id, false, false);
-    // uart_set_format(uart_id, data_bits, stop_bits, parity);
+    // 初期化前に溜まっていたデータは破棄する
+    ioctl(uart->fd, TCFLSH, TCIOFLUSH);
 
-    return actual_baud_rate;
+    return uart->baud_rate;
 }
 
 
@@ -25,6 +296,16 @@ void pico_uart_deinit(
     uart_inst_t *uart_id
 )
 {
+    host_uart *uart = find_host_uart(uart_id);
+
+    if (!uart || uart->fd < 0)
+        return;
+
+    finish_write(uart);
+    close(uart->fd);
+    uart->fd = -1;
+    uart->read_position = 0;
+    uart->read_size = 0;
 }
 
 
@@ -33,14 +314,146 @@ uint pico_uart_set_baudrate(
     uint baud_rate
 )
 {
-    return baud_rate;
+    host_uart *uart = find_host_uart(uart_id);
+
+    if (!uart || uart->fd < 0)
+        return baud_rate;
+
+    // 送信中のデータを送りきってからボーレートを変える
+    ioctl(uart->fd, TCSBRK, 1);
+    if (apply_termios(uart, baud_rate))
+        return 0;
+
+    return uart->baud_rate;
 }
 
+
 void pico_uart_set_fifo_enabled(
     uart_inst_t *uart_id,
     bool enabled
 )
 {
+    // hostではOSのバッファーを使うので、設定することはない
+}
+
+
+int pico_uart_write_blocking(
+    uart_inst_t *uart_id,
+    const uint8_t *src,
+    size_t len
+)
+{
+    host_uart *uart = find_host_uart(uart_id);
+    struct pollfd pfd;
+    ssize_t write_size;
+
+    if (!uart || uart->fd < 0)
+        return 1;
+
+    // 非同期で送信中のデータを先に送る
+    if (finish_write(uart))
+        return 1;
+
+    pfd.fd = uart->fd;
+    pfd.events = POLLOUT;
+
+    while (len > 0)
+    {
+        write_size = write(uart->fd, src, len);
+        if (write_size < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return 1;
+
+            // OSの送信バッファーが空くまで待つ
+            poll(&pfd, 1, -1);
+            continue;
+        }
+
+        src += write_size;
+        len -= write_size;
+    }
+
+    return 0;
+}
+
+
+int pico_uart_start_write(
+    uart_inst_t *uart_id,
+    const uint8_t *src,
+    size_t len
+)
+{
+    host_uart *uart = find_host_uart(uart_id);
+
+    if (!uart || uart->fd < 0)
+        return 1;
+
+    if (finish_write(uart))
+        return 1;
+
+    uart->write_data = src;
+    uart->write_remaining = len;
+
+    return progress_write(uart);
+}
+
+
+int pico_uart_write_done(
+    uart_inst_t *uart_id
+)
+{
+    host_uart *uart = find_host_uart(uart_id);
+    int queued_size;
+
+    if (!uart || uart->fd < 0)
+        return 0;
+
+    // 書き込みに失敗した場合は、送信中のデータはないものとする
+    if (progress_write(uart))
+        return 0;
+    if (uart->write_remaining > 0)
+        return 1;
+
+    // OSの送信バッファーに残っているデータがあれば送信中とする
+    if (ioctl(uart->fd, TIOCOUTQ, &queued_size) == 0 && queued_size > 0)
+        return 1;
+
+    return 0;
+}
+
+
+int pico_uart_wait_write(
+    uart_inst_t *uart_id
+)
+{
+    host_uart *uart = find_host_uart(uart_id);
+
+    if (!uart || uart->fd < 0)
+        return 0;
+
+    if (finish_write(uart))
+        return 1;
+
+    // OSの送信バッファーが空になるまで待つ(tcdrainと同じ)
+    ioctl(uart->fd, TCSBRK, 1);
+
+    return 0;
+}
+
+
+int pico_uart_is_readable(
+    uart_inst_t *uart_id
+)
+{
+    host_uart *uart = find_host_uart(uart_id);
+
+    if (!uart || uart->fd < 0)
+        return 1;
+
+    return wait_readable(uart, 0);
 }
 
 
@@ -49,5 +462,135 @@ int pico_uart_is_readable_within_us(
     uint us
 )
 {
+    host_uart *uart = find_host_uart(uart_id);
+
+    if (!uart || uart->fd < 0)
+    {
+        // 何も接続されていないので、待ち時間だけ待って読み込み不可能とする
+        struct timespec wait = {us / 1000000, (us % 1000000) * 1000};
+        nanosleep(&wait, NULL);
+        return 1;
+    }
+
+    return wait_readable(uart, us);
+}
+
+
+int pico_uart_read_raw(
+    uart_inst_t *uart_id,
+    uint8_t *dst
+)
+{
+    host_uart *uart = find_host_uart(uart_id);
+
+    if (!uart || uart->fd < 0)
+        return 1;
+
+    if (uart->read_position == uart->read_size && fill_read_buffer(uart))
+        return 1;
+
+    *dst = uart->read_buffer[uart->read_position];
+    uart->read_position++;
+    return 0;
+}
+
+
+size_t pico_uart_read_available(
+    uart_inst_t *uart_id,
+    uint8_t *dst,
+    size_t max
+)
+{
+    host_uart *uart = find_host_uart(uart_id);
+    size_t n = 0;
+    size_t copy_size;
+
+    if (!uart || uart->fd < 0)
+        return 0;
+
+    while (n < max)
+    {
+        if (uart->read_position == uart->read_size && fill_read_buffer(uart))
+            break;
+
+        copy_size = uart->read_size - uart->read_position;
+        if (copy_size > max - n)
+            copy_size = max - n;
+
+        memcpy(dst + n, uart->read_buffer + uart->read_position, copy_size);
+        uart->read_position += copy_size;
+        n += copy_size;
+    }
+
+    return n;
+}
+
+
+int pico_uart_enable_rx_irq(
+    uart_inst_t *uart_id,
+    size_t buffer_size
+)
+{
+    // hostではOSが割り込みで受信データをバッファーに溜めているので、設定することはない
     return 0;
 }
+
+
+void pico_uart_disable_rx_irq(
+    uart_inst_t *uart_id
+)
+{
+}
+
+
+size_t pico_uart_rx_available(
+    uart_inst_t *uart_id
+)
+{
+    host_uart *uart = find_host_uart(uart_id);
+
+    if (!uart || uart->fd < 0)
+        return 0;
+
+    // OSのバッファーに溜まっているデータも取り込んでおく
+    fill_read_buffer(uart);
+
+    return uart->read_size - uart->read_position;
+}
+
+
+size_t pico_uart_rx_peek(
+    uart_inst_t *uart_id,
+    uint8_t *dst,
+    size_t max
+)
+{
+    size_t available = pico_uart_rx_available(uart_id);
+    host_uart *uart = find_host_uart(uart_id);
+
+    if (available == 0)
+        return 0;
+    if (available > max)
+        available = max;
+
+    memcpy(dst, uart->read_buffer + uart->read_position, available);
+    return available;
+}
+
+
+size_t pico_uart_rx_consume(
+    uart_inst_t *uart_id,
+    size_t len
+)
+{
+    host_uart *uart = find_host_uart(uart_id);
+
+    if (!uart || uart->fd < 0)
+        return 0;
+
+    if (len > uart->read_size - uart->read_position)
+        len = uart->read_size - uart->read_position;
+
+    uart->read_position += len;
+    return len;
+}
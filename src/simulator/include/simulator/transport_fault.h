@@ -0,0 +1,120 @@
+#ifndef _ONE_DYNAMIXEL_TRANSPORT_FAULT_H
+#define _ONE_DYNAMIXEL_TRANSPORT_FAULT_H
+
+#include "pico.h"
+#include "dynamixel/dynamixel_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 送受信に故障を起こす経路
+ *
+ * 他の経路を包み、ノイズの多いバスで起こる故障(ビット反転、バイトの欠落、応答パケットの途切れ、
+ * 余分なヘッダー、応答の遅れ)を、指定した確率で起こす。
+ * 乱数は種から決まるので、同じ種と同じ操作で同じ故障が起こる
+*/
+typedef struct transport_fault_struct *transport_fault_t;
+
+
+/// 応答パケットを途中で途切れさせるとき、残すデータサイズの上限(応答パケットの最小サイズ)
+#define TRANSPORT_FAULT_TRUNCATE_MAX_SIZE 11
+
+
+/**
+ * @brief 故障の起こし方
+ *
+ * 確率は0で起こさず、1で必ず起こす。
+ * 応答ごとの故障は、送信するたびに、その後に受信するデータに対して決める
+*/
+typedef struct
+{
+    /// 乱数の種
+    uint64_t seed;
+    /// 1Byteごとに、1bitを反転させる確率(送信と受信の両方)
+    double bit_flip_rate;
+    /// 受信の1Byteごとに、そのByteを捨てる確率
+    double byte_drop_rate;
+    /// 応答ごとに、先頭からTRANSPORT_FAULT_TRUNCATE_MAX_SIZE未満のランダムなサイズの後を捨てる確率
+    double truncate_rate;
+    /// 応答ごとに、先頭からTRANSPORT_FAULT_TRUNCATE_MAX_SIZE未満のランダムな位置にヘッダー(0xFF 0xFF 0xFD 0x00)を挿入する確率
+    double stray_header_rate;
+    /// 応答ごとに、受信を遅らせる確率
+    double late_response_rate;
+    /// 遅らせる時間の平均[micro sec.](指数分布)
+    uint late_response_mean_us;
+} transport_fault_parameter;
+
+
+/**
+ * @brief 起こした故障の統計
+*/
+typedef struct
+{
+    /// ビットを反転させた送信、受信のByte数
+    uint64_t tx_bit_flips;
+    uint64_t rx_bit_flips;
+    /// 捨てた受信のByte数(途切れさせた分は含まない)
+    uint64_t rx_byte_drops;
+    /// 途切れさせた応答の数
+    uint64_t truncated_responses;
+    /// ヘッダーを挿入した応答の数
+    uint64_t stray_headers;
+    /// 遅らせた応答の数
+    uint64_t late_responses;
+} transport_fault_statistics;
+
+
+/**
+ * @brief 故障を起こす経路のインスタンスを作成する
+ *
+ * @param[in] *inner 包む経路(コピーされる)
+ * @param[in] *parameter 故障の起こし方(コピーされる)
+ * @return 作成したインスタンス(作成できなかった場合はNULL)
+*/
+transport_fault_t transport_fault_create(
+    const dynamixel_transport *inner,
+    const transport_fault_parameter *parameter
+);
+
+
+/**
+ * @brief インスタンスを破棄する
+ *
+ * @param[in] self インスタンス
+*/
+void transport_fault_destroy(
+    transport_fault_t self
+);
+
+
+/**
+ * @brief 故障を起こしながら送受信する経路を作成する
+ *
+ * @param[in] self インスタンス
+ * @param[out] *transport 作成した経路
+*/
+void transport_fault_init_transport(
+    transport_fault_t self,
+    dynamixel_transport *transport
+);
+
+
+/**
+ * @brief 起こした故障の統計を返す
+ *
+ * @param[in] self インスタンス
+ * @param[out] *statistics 統計
+*/
+void transport_fault_get_statistics(
+    transport_fault_t self,
+    transport_fault_statistics *statistics
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
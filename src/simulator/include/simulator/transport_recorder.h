@@ -0,0 +1,88 @@
+#ifndef _ONE_DYNAMIXEL_TRANSPORT_RECORDER_H
+#define _ONE_DYNAMIXEL_TRANSPORT_RECORDER_H
+
+#include "pico.h"
+#include "dynamixel/dynamixel_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 送受信をファイルに記録する経路
+ *
+ * 他の経路を包み、送信したデータ、受信したデータ、ボーレートの変更を、
+ * 包んだ経路の時刻(now_us)とともにバイナリファイルに記録する。
+ * 記録したファイルはtransport_replayerで再生できる
+*/
+typedef struct transport_recorder_struct *transport_recorder_t;
+
+
+/**
+ * @brief 記録を開始する
+ *
+ * @param[in] *inner 包む経路(コピーされる)
+ * @param[in] *path 記録するファイルのパス(既にある場合は上書きする)
+ * @return 作成したインスタンス(ファイルを開けなかった、またはヘッダーを書き込めなかった場合はNULL)
+*/
+transport_recorder_t transport_recorder_create(
+    const dynamixel_transport *inner,
+    const char *path
+);
+
+
+/**
+ * @brief 記録を終了し、ファイルを閉じる
+ *
+ * @param[in] self インスタンス
+ * @retval 0 全ての記録をファイルに書き込んだ
+ * @retval 1 ファイルへの書き込みに失敗した(ファイルは途中までの記録となる)
+*/
+int transport_recorder_destroy(
+    transport_recorder_t self
+);
+
+
+/**
+ * @brief ファイルへの書き込みに失敗したかを返す
+ *
+ * 書き込みに失敗した後は記録しない(送受信は包んだ経路で続ける)。
+ * バッファーに溜まっているデータの書き込みの失敗は、transport_recorder_destroy()で分かる
+ *
+ * @param[in] self インスタンス
+ * @retval true 書き込みに失敗した
+ * @retval false 書き込みに失敗していない
+*/
+bool transport_recorder_has_failed(
+    transport_recorder_t self
+);
+
+
+/**
+ * @brief 記録しながら送受信する経路を作成する
+ *
+ * @param[in] self インスタンス
+ * @param[out] *transport 作成した経路
+*/
+void transport_recorder_init_transport(
+    transport_recorder_t self,
+    dynamixel_transport *transport
+);
+
+
+/**
+ * @brief 記録した数を返す
+ *
+ * @param[in] self インスタンス
+ * @return 記録した送信、受信、ボーレートの変更の数
+*/
+size_t transport_recorder_get_record_num(
+    transport_recorder_t self
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef _ONE_DYNAMIXEL_TRANSPORT_REPLAYER_H
+#define _ONE_DYNAMIXEL_TRANSPORT_REPLAYER_H
+
+#include "pico.h"
+#include "dynamixel/dynamixel_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief transport_recorderで記録した受信データを再生する経路
+ *
+ * 送信するたびに、記録の中の次の送信と対応付け、その後に記録された受信データを、
+ * 記録での送信からの経過時間と同じだけ経ってから読み込めるようにする。
+ * 送信データは記録と比較するのみで、どこにも送らない
+*/
+typedef struct transport_replayer_struct *transport_replayer_t;
+
+
+/// 再生の時刻の進め方
+typedef enum {
+    /// 実時間で、記録と同じ時間だけ待ってから受信データを渡す
+    TRANSPORT_REPLAYER_MODE_REALTIME,
+    /// 待たずに仮想的な時刻を進める(now_usは記録と同じ間隔で進む)
+    TRANSPORT_REPLAYER_MODE_FAST,
+} transport_replayer_mode;
+
+
+/**
+ * @brief 再生の統計
+*/
+typedef struct
+{
+    /// 記録と一致した送信の数
+    size_t tx_matched;
+    /// 記録と内容が異なった送信の数
+    size_t tx_mismatched;
+    /// 記録の送信を使い切った後の送信の数
+    size_t tx_unexpected;
+    /// 再生した受信データの数とサイズ
+    size_t rx_chunks;
+    size_t rx_bytes;
+    /// 読み込まれる前に次の送信が行われたため、捨てた受信データの数
+    size_t rx_skipped;
+} transport_replayer_statistics;
+
+
+/**
+ * @brief 記録ファイルを読み込む
+ *
+ * @param[in] *path 記録ファイルのパス
+ * @param[in] mode 時刻の進め方
+ * @return 作成したインスタンス(ファイルを読み込めない、または形式が正しくない場合はNULL)
+*/
+transport_replayer_t transport_replayer_create(
+    const char *path,
+    transport_replayer_mode mode
+);
+
+
+/**
+ * @brief インスタンスを破棄する
+ *
+ * @param[in] self インスタンス
+*/
+void transport_replayer_destroy(
+    transport_replayer_t self
+);
+
+
+/**
+ * @brief 記録を再生する経路を作成する
+ *
+ * @param[in] self インスタンス
+ * @param[out] *transport 作成した経路
+*/
+void transport_replayer_init_transport(
+    transport_replayer_t self,
+    dynamixel_transport *transport
+);
+
+
+/**
+ * @brief 記録を最後まで再生したか
+ *
+ * @param[in] self インスタンス
+ * @retval true 全ての記録を再生した
+ * @retval false 再生していない記録がある
+*/
+bool transport_replayer_is_finished(
+    transport_replayer_t self
+);
+
+
+/**
+ * @brief 再生の統計を返す
+ *
+ * @param[in] self インスタンス
+ * @param[out] *statistics 統計
+*/
+void transport_replayer_get_statistics(
+    transport_replayer_t self,
+    transport_replayer_statistics *statistics
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef _ONE_DYNAMIXEL_VIRTUAL_BUS_H
+#define _ONE_DYNAMIXEL_VIRTUAL_BUS_H
+
+#include "pico.h"
+#include "dynamixel/dynamixel_transport.h"
+#include "simulator/virtual_servo.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 仮想Dynamixelをつないだ仮想的なバス
+ *
+ * dynamixel_transportとしてdynamixelインスタンスに渡すと、実際のドライバーの処理で仮想Dynamixelと通信できる。
+ * 時間は仮想時間で進み、送受信にかかる時間はボーレートから、応答までの時間はReturn Delay Timeから計算する。
+ * 待ち時間は実際には待たずに仮想時間を進めるため、実時間よりも速く動く。
+ *
+ * 応答パケットの順番と時刻は次のように決める(半二重のため、重なった応答パケットは衝突して壊れる)
+ * - Sync Read、Bulk Read: パラメータのIDの順に、前の応答パケットの後からReturn Delay Time後
+ * - ブロードキャストIDのping: IDの順に、ID x 応答パケット1つ分の時間 + Return Delay Time後
+ * - それ以外: インストラクションパケットを受信してからReturn Delay Time後
+*/
+typedef struct virtual_bus_struct *virtual_bus_t;
+
+
+/// バスにつなげる仮想Dynamixelの最大数
+#define VIRTUAL_BUS_MAX_SERVO_NUM 253
+
+
+/**
+ * @brief 仮想バスの送受信の統計
+*/
+typedef struct
+{
+    /// 受信したインストラクションパケットの数
+    uint64_t instruction_packets;
+    /// 送信した応答パケットの数
+    uint64_t status_packets;
+    /// ホストが送信したデータサイズ
+    uint64_t tx_bytes;
+    /// ホストに送信したデータサイズ
+    uint64_t rx_bytes;
+    /// 仮想Dynamixelが受信できなかったパケットの数(checksumの誤り、ボーレートの不一致)
+    uint64_t dropped_packets;
+    /// 他の応答パケットと衝突した応答パケットの数
+    uint64_t collisions;
+} virtual_bus_statistics;
+
+
+/**
+ * @brief 仮想バスを作成する
+ *
+ * @param[in] baud_rate ホスト側のボーレートの初期値
+ * @return 作成した仮想バス(作成できなかった場合はNULL)
+*/
+virtual_bus_t virtual_bus_create(
+    uint baud_rate
+);
+
+
+/**
+ * @brief 仮想バスを破棄する
+ *
+ * つないだ仮想Dynamixelは破棄しない
+ * @param[in] self 仮想バス
+*/
+void virtual_bus_destroy(
+    virtual_bus_t self
+);
+
+
+/**
+ * @brief 仮想Dynamixelをバスにつなぐ
+ *
+ * @param[in] self 仮想バス
+ * @param[in] servo 仮想Dynamixel
+ * @retval 0 つないだ
+ * @retval 1 つなげる数の上限を超えた
+*/
+int virtual_bus_add_servo(
+    virtual_bus_t self,
+    virtual_servo_t servo
+);
+
+
+/**
+ * @brief 仮想バスを使う経路を作成する
+ *
+ * @param[in] self 仮想バス
+ * @param[out] *transport 作成した経路
+*/
+void virtual_bus_init_transport(
+    virtual_bus_t self,
+    dynamixel_transport *transport
+);
+
+
+/**
+ * @brief ホスト側のボーレートを返す
+ *
+ * @param[in] self 仮想バス
+ * @return ボーレート
+*/
+uint virtual_bus_get_baud_rate(
+    virtual_bus_t self
+);
+
+
+/**
+ * @brief 現在の仮想時間を返す
+ *
+ * @param[in] self 仮想バス
+ * @return 仮想時間[micro sec.]
+*/
+uint64_t virtual_bus_get_time_us(
+    virtual_bus_t self
+);
+
+
+/**
+ * @brief 仮想時間を進める(ホストの処理時間を模擬する)
+ *
+ * @param[in] self 仮想バス
+ * @param[in] us 進める時間[micro sec.]
+*/
+void virtual_bus_advance_us(
+    virtual_bus_t self,
+    uint64_t us
+);
+
+
+/**
+ * @brief ホストにまだ届いていないデータのうち、次のデータが届く時刻を返す
+ *
+ * 仮想時間を実時間に合わせて動かすときに、次に待つ時刻を決めるために使う
+ * @param[in] self 仮想バス
+ * @param[out] *time_us 次のデータが届く時刻[micro sec.](切り上げ)
+ * @retval 0 届いていないデータがある
+ * @retval 1 届いていないデータはない
+*/
+int virtual_bus_get_next_arrival_us(
+    virtual_bus_t self,
+    uint64_t *time_us
+);
+
+
+/**
+ * @brief 送受信の統計を返す
+ *
+ * @param[in] self 仮想バス
+ * @param[out] *statistics 統計
+*/
+void virtual_bus_get_statistics(
+    virtual_bus_t self,
+    virtual_bus_statistics *statistics
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef _ONE_DYNAMIXEL_VIRTUAL_MOTOR_H
+#define _ONE_DYNAMIXEL_VIRTUAL_MOTOR_H
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 減速機付きDCモーターの定数
+ *
+ * 巻線のインダクタンスは無視する(電流は電圧と逆起電力から直ちに決まる)
+*/
+typedef struct
+{
+    /// 巻線抵抗[ohm]
+    float resistance;
+    /// トルク定数(モーター軸)[N m/A]
+    float torque_constant;
+    /// 逆起電力定数(モーター軸)[V s/rad]
+    float back_emf_constant;
+    /// ロータの慣性モーメント(モーター軸)[kg m^2]
+    float rotor_inertia;
+    /// 減速比
+    float gear_ratio;
+    /// 粘性摩擦係数(出力軸)[N m s/rad]
+    float viscous_friction;
+    /// 出力軸にかかる一定の負荷トルク[N m]
+    float load_torque;
+    /// 電源電圧[V]
+    float supply_voltage;
+    /// 熱抵抗(巻線から周囲)[degC/W]
+    float thermal_resistance;
+    /// 熱時定数[sec.]
+    float thermal_time_constant;
+    /// 周囲温度[degC]
+    float ambient_temperature;
+} virtual_motor_parameter;
+
+
+/**
+ * @brief モーターの状態(出力軸の値)
+*/
+typedef struct
+{
+    /// 角度[rad]
+    float position;
+    /// 角速度[rad/s]
+    float velocity;
+    /// 電流[A]
+    float current;
+    /// 巻線の温度[degC]
+    float temperature;
+} virtual_motor_state;
+
+
+/**
+ * @brief モーターの状態を初期化する(停止した状態で、温度は周囲温度とする)
+ *
+ * @param[out] *state モーターの状態
+ * @param[in] *parameter モーターの定数
+ * @param[in] position 出力軸の角度[rad]
+*/
+void virtual_motor_init(
+    virtual_motor_state *state,
+    const virtual_motor_parameter *parameter,
+    float position
+);
+
+
+/**
+ * @brief 電圧を加えて時間を進める
+ *
+ * 時間内は電圧が一定として、1次遅れの応答を解析的に解く。
+ * 電流が制限を超える場合は、電流を制限値に保つ(トルク一定)
+ * @param[in,out] *state モーターの状態
+ * @param[in] *parameter モーターの定数
+ * @param[in] voltage 加える電圧[V](電源電圧を超える分は切り捨てる)
+ * @param[in] current_limit 電流の制限値[A](0以下のときは制限しない)
+ * @param[in] dt 進める時間[sec.]
+*/
+void virtual_motor_step(
+    virtual_motor_state *state,
+    const virtual_motor_parameter *parameter,
+    float voltage,
+    float current_limit,
+    float dt
+);
+
+
+/**
+ * @brief 指定した電流を流すのに必要な電圧を返す(電源電圧を超える場合は電源電圧)
+ *
+ * @param[in] *state モーターの状態
+ * @param[in] *parameter モーターの定数
+ * @param[in] current 電流[A]
+ * @return 電圧[V]
+*/
+float virtual_motor_get_voltage_for_current(
+    const virtual_motor_state *state,
+    const virtual_motor_parameter *parameter,
+    float current
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef _ONE_DYNAMIXEL_VIRTUAL_PTY_H
+#define _ONE_DYNAMIXEL_VIRTUAL_PTY_H
+
+#include "pico.h"
+#include "simulator/virtual_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 仮想バスをpty(疑似端末)の先につなぐ
+ *
+ * ptyのslaveをシリアルデバイスとして開いたプロセスは、実機のバスと同じように仮想Dynamixelと通信できる。
+ * 仮想バスの仮想時間は実時間に合わせて進め、応答パケットは届く時刻になってからmasterに書き込む。
+ * slaveのボーレート(termios)を変更すると、仮想バスのホスト側のボーレートも変更する
+*/
+typedef struct virtual_pty_struct *virtual_pty_t;
+
+
+/**
+ * @brief ptyを作成し、仮想バスをつなぐ
+ *
+ * slaveはrawモードで、ボーレートは仮想バスのボーレートにする
+ * @param[in] bus 仮想バス(破棄するまで使い続ける)
+ * @return 作成したpty(作成できなかった場合はNULL)
+*/
+virtual_pty_t virtual_pty_create(
+    virtual_bus_t bus
+);
+
+
+/**
+ * @brief ptyを閉じて破棄する(仮想バスは破棄しない)
+ *
+ * @param[in] self pty
+*/
+void virtual_pty_destroy(
+    virtual_pty_t self
+);
+
+
+/**
+ * @brief slaveのパスを返す
+ *
+ * @param[in] self pty
+ * @return slaveのパス(/dev/pts/3など)
+*/
+const char *virtual_pty_get_slave_path(
+    virtual_pty_t self
+);
+
+
+/**
+ * @brief 受信したデータを仮想バスに渡し、届く時刻になった応答パケットを送信する
+ *
+ * 受信するか、次の応答パケットが届く時刻になるまで、最大timeout_usだけ待つ
+ * @param[in] self pty
+ * @param[in] timeout_us 最大の待ち時間[micro sec.]
+ * @retval 0 処理した
+ * @retval 1 ptyの読み書きに失敗した
+*/
+int virtual_pty_run_once(
+    virtual_pty_t self,
+    uint timeout_us
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,296 @@
+#ifndef _ONE_DYNAMIXEL_VIRTUAL_SERVO_H
+#define _ONE_DYNAMIXEL_VIRTUAL_SERVO_H
+
+#include "pico.h"
+#include "simulator/virtual_motor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 仮想的なDynamixel(XL330などのX系列)
+ *
+ * コントロールテーブルを持ち、Protocol 2.0のインストラクションを処理して応答パケットのパラメータを作成する。
+ * パケットの送受信や時間の管理は仮想バス(virtual_bus)が行う
+*/
+typedef struct virtual_servo_struct *virtual_servo_t;
+
+
+/// コントロールテーブルのサイズ(Indirect Data 20まで)
+#define VIRTUAL_SERVO_CONTROL_TABLE_SIZE 228
+/// XL330-M288のモデル番号
+#define VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288 1200
+/// XL430-W250のモデル番号
+#define VIRTUAL_SERVO_MODEL_NUMBER_XL430_W250 1060
+/// XM430-W350のモデル番号
+#define VIRTUAL_SERVO_MODEL_NUMBER_XM430_W350 1020
+/// ファームウェアバージョンの初期値
+#define VIRTUAL_SERVO_FIRMWARE_VERSION_DEFAULT 46
+/// 応答パケットのパラメータの最大サイズ(エラー + コントロールテーブル全体)
+#define VIRTUAL_SERVO_STATUS_PARAMETER_MAX_SIZE (1 + VIRTUAL_SERVO_CONTROL_TABLE_SIZE)
+
+/**
+ * @brief 仮想Dynamixelのモデル
+ *
+ * コントロールテーブルの配置は共通で、モデル番号と各種制限の初期値・上限が異なる
+*/
+typedef enum {
+    VIRTUAL_SERVO_MODEL_XL330_M288,
+    VIRTUAL_SERVO_MODEL_XL430_W250,
+    VIRTUAL_SERVO_MODEL_XM430_W350,
+} virtual_servo_model;
+
+/// 応答パケットのエラー番号
+typedef enum {
+    VIRTUAL_SERVO_ERROR_NONE = 0x00,
+    VIRTUAL_SERVO_ERROR_RESULT_FAIL = 0x01,
+    VIRTUAL_SERVO_ERROR_INSTRUCTION = 0x02,
+    VIRTUAL_SERVO_ERROR_CRC = 0x03,
+    VIRTUAL_SERVO_ERROR_DATA_RANGE = 0x04,
+    VIRTUAL_SERVO_ERROR_DATA_LENGTH = 0x05,
+    VIRTUAL_SERVO_ERROR_DATA_LIMIT = 0x06,
+    VIRTUAL_SERVO_ERROR_ACCESS = 0x07,
+} virtual_servo_error;
+
+
+/**
+ * @brief 仮想Dynamixelを作成する
+ *
+ * コントロールテーブルはXL330の初期値で初期化する(IDのみ指定した値にする)
+ * @param[in] id ID
+ * @return 作成した仮想Dynamixel(作成できなかった場合はNULL)
+*/
+virtual_servo_t virtual_servo_create(
+    uint8_t id
+);
+
+
+/**
+ * @brief モデルとファームウェアバージョンを指定して仮想Dynamixelを作成する
+ *
+ * @param[in] id ID
+ * @param[in] model モデル
+ * @param[in] firmware_version ファームウェアバージョン(pingの応答で返す)
+ * @return 作成した仮想Dynamixel(作成できなかった場合はNULL)
+*/
+virtual_servo_t virtual_servo_create_with_model(
+    uint8_t id,
+    virtual_servo_model model,
+    uint8_t firmware_version
+);
+
+
+/**
+ * @brief 仮想Dynamixelを破棄する
+ *
+ * @param[in] self 仮想Dynamixel
+*/
+void virtual_servo_destroy(
+    virtual_servo_t self
+);
+
+
+/**
+ * @brief IDを返す
+ *
+ * @param[in] self 仮想Dynamixel
+ * @return コントロールテーブルのID
+*/
+uint8_t virtual_servo_get_id(
+    virtual_servo_t self
+);
+
+
+/**
+ * @brief モデル番号を返す
+ *
+ * @param[in] self 仮想Dynamixel
+ * @return コントロールテーブルのModel Number
+*/
+uint16_t virtual_servo_get_model_number(
+    virtual_servo_t self
+);
+
+
+/**
+ * @brief ボーレートを返す
+ *
+ * @param[in] self 仮想Dynamixel
+ * @return コントロールテーブルのBaud Rateに対応するボーレート
+*/
+uint virtual_servo_get_baud_rate(
+    virtual_servo_t self
+);
+
+
+/**
+ * @brief Return Delay Timeを返す
+ *
+ * @param[in] self 仮想Dynamixel
+ * @return Return Delay Time[micro sec.]
+*/
+uint virtual_servo_get_return_delay_time_us(
+    virtual_servo_t self
+);
+
+
+/**
+ * @brief Return Delay Timeを設定する
+ *
+ * コントロールテーブルの単位(2 micro sec.)に切り捨て、最大値(508 micro sec.)を超える場合は最大値にする
+ * @param[in] self 仮想Dynamixel
+ * @param[in] return_delay_time_us Return Delay Time[micro sec.]
+*/
+void virtual_servo_set_return_delay_time_us(
+    virtual_servo_t self,
+    uint return_delay_time_us
+);
+
+
+/**
+ * @brief コントロールテーブルを直接読み込む(アクセス権は確認しない)
+ *
+ * @param[in] self 仮想Dynamixel
+ * @param[in] address 開始アドレス
+ * @param[in] size データサイズ
+ * @param[out] *data 読み込んだデータ
+ * @retval 0 読み込んだ
+ * @retval 1 コントロールテーブルの範囲外
+*/
+int virtual_servo_read_table(
+    virtual_servo_t self,
+    uint16_t address,
+    uint16_t size,
+    uint8_t *data
+);
+
+
+/**
+ * @brief コントロールテーブルに直接書き込む(アクセス権や値の範囲は確認しない)
+ *
+ * Present Positionなどの読み込み専用の値を設定するときに使う
+ * @param[in] self 仮想Dynamixel
+ * @param[in] address 開始アドレス
+ * @param[in] size データサイズ
+ * @param[in] *data 書き込むデータ
+ * @retval 0 書き込んだ
+ * @retval 1 コントロールテーブルの範囲外
+*/
+int virtual_servo_write_table(
+    virtual_servo_t self,
+    uint16_t address,
+    uint16_t size,
+    const uint8_t *data
+);
+
+
+/**
+ * @brief モデルに合わせたモーターの定数を返す
+ *
+ * データシートの停動トルク、停動電流、無負荷回転数、減速比から求めた値(負荷トルクは0)
+ * @param[in] model モデル
+ * @param[out] *parameter モーターの定数
+ * @retval 0 返した
+ * @retval 1 モデルが不正
+*/
+int virtual_servo_get_default_motor_parameter(
+    virtual_servo_model model,
+    virtual_motor_parameter *parameter
+);
+
+
+/**
+ * @brief 動力学モデルを有効にする
+ *
+ * 有効にすると、virtual_servo_updateで制御周期(1 milli sec.)ごとに、
+ * 目標値とプロファイルから軌道を作り、PID制御でモーターに加える電圧を決めて動かす。
+ * Present Position、Present Velocity、Present Current、Present Temperatureなどは
+ * モーターの状態から更新する(コントロールテーブルへ直接書き込んだ値は上書きされる)。
+ * 無効のとき(初期状態)は、コントロールテーブルの値は変化しない
+ * @param[in] self 仮想Dynamixel
+ * @param[in] *parameter モーターの定数(NULLのときはモデルに合わせた値)
+*/
+void virtual_servo_enable_dynamics(
+    virtual_servo_t self,
+    const virtual_motor_parameter *parameter
+);
+
+
+/**
+ * @brief 動力学モデルを無効にする(コントロールテーブルの値はそのまま残す)
+ *
+ * @param[in] self 仮想Dynamixel
+*/
+void virtual_servo_disable_dynamics(
+    virtual_servo_t self
+);
+
+
+/**
+ * @brief 仮想時間を進める
+ *
+ * Realtime Tickを更新し、動力学モデルが有効な場合は現在の時刻まで制御周期ごとにモーターを動かす
+ * @param[in] self 仮想Dynamixel
+ * @param[in] now_us 現在の仮想時間[micro sec.]
+*/
+void virtual_servo_update(
+    virtual_servo_t self,
+    uint64_t now_us
+);
+
+
+/**
+ * @brief インストラクションパケットを処理する
+ *
+ * 宛先が自分(ID、ブロードキャストID、Secondary ID)でないパケットは無視する。
+ * 応答パケットを返す場合、status_parameterの先頭にエラー、その後にデータを格納する
+ * @param[in] self 仮想Dynamixel
+ * @param[in] id インストラクションパケットのID
+ * @param[in] instruction インストラクション
+ * @param[in] *parameter インストラクションパケットのパラメータ
+ * @param[in] parameter_size parameterのバイト数
+ * @param[out] *status_id 応答パケットのID
+ * @param[out] *status_parameter 応答パケットのパラメータ(VIRTUAL_SERVO_STATUS_PARAMETER_MAX_SIZE以上を用意する)
+ * @param[out] *status_parameter_size status_parameterのバイト数
+ * @retval 0 応答パケットを返す
+ * @retval 1 応答パケットを返さない
+*/
+int virtual_servo_handle_instruction(
+    virtual_servo_t self,
+    uint8_t id,
+    uint8_t instruction,
+    const uint8_t *parameter,
+    size_t parameter_size,
+    uint8_t *status_id,
+    uint8_t *status_parameter,
+    size_t *status_parameter_size
+);
+
+
+/**
+ * @brief checksumが誤っていたインストラクションパケットを処理する
+ *
+ * 自分のIDが宛先であれば、CRCエラーの応答パケットを返す
+ * @param[in] self 仮想Dynamixel
+ * @param[in] id インストラクションパケットのID
+ * @param[out] *status_id 応答パケットのID
+ * @param[out] *status_parameter 応答パケットのパラメータ
+ * @param[out] *status_parameter_size status_parameterのバイト数
+ * @retval 0 応答パケットを返す
+ * @retval 1 応答パケットを返さない
+*/
+int virtual_servo_handle_crc_error(
+    virtual_servo_t self,
+    uint8_t id,
+    uint8_t *status_id,
+    uint8_t *status_parameter,
+    size_t *status_parameter_size
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,416 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simulator/transport_fault.h"
+
+
+/// 包んだ経路から一度に読み込むサイズ
+#define READ_CHUNK_SIZE 256
+/// 種が0のときに使う種(xorshiftは0から抜け出せない)
+#define DEFAULT_SEED 0x9e3779b97f4a7c15ULL
+
+
+/// 挿入するヘッダー
+static const uint8_t stray_header[] = {0xff, 0xff, 0xfd, 0x00};
+
+
+/**
+ * @brief 受信したデータ
+ *
+ * release_usを過ぎるとドライバーが読み込める
+*/
+typedef struct
+{
+    uint8_t data;
+    uint64_t release_us;
+} fault_byte;
+
+
+typedef struct transport_fault_struct
+{
+    dynamixel_transport inner;
+    transport_fault_parameter parameter;
+    uint64_t random_state;
+    // 送信データ(ビットを反転させたもの、非同期の送信が終わるまで保持する)
+    uint8_t *tx_buffer;
+    size_t tx_buffer_size;
+    // 受信したデータのうち、まだ読み込まれていないもの([head, tail))
+    fault_byte *rx_queue;
+    size_t rx_queue_size;
+    size_t rx_head;
+    size_t rx_tail;
+    // 最後の送信の後に受信したデータサイズと、その応答で起こす故障
+    size_t rx_index;
+    bool truncate;
+    size_t truncate_index;
+    bool stray;
+    size_t stray_index;
+    uint32_t delay_us;
+    transport_fault_statistics statistics;
+} transport_fault_struct;
+
+
+/// 乱数(xorshift64*)
+static uint64_t next_random(
+    transport_fault_t self
+)
+{
+    self->random_state ^= self->random_state >> 12;
+    self->random_state ^= self->random_state << 25;
+    self->random_state ^= self->random_state >> 27;
+    return self->random_state * 0x2545f4914f6cdd1dULL;
+}
+
+
+/// [0, 1)の一様乱数
+static double next_uniform(
+    transport_fault_t self
+)
+{
+    return (next_random(self) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+/// 確率rateで真を返す(0のときは乱数を消費しない)
+static bool happen(
+    transport_fault_t self,
+    double rate
+)
+{
+    return rate > 0 && next_uniform(self) < rate;
+}
+
+
+transport_fault_t transport_fault_create(
+    const dynamixel_transport *inner,
+    const transport_fault_parameter *parameter
+)
+{
+    transport_fault_t self = calloc(1, sizeof(transport_fault_struct));
+    if (!self)
+        return NULL;
+
+    self->inner = *inner;
+    self->parameter = *parameter;
+    self->random_state = parameter->seed ? parameter->seed : DEFAULT_SEED;
+
+    return self;
+}
+
+
+void transport_fault_destroy(
+    transport_fault_t self
+)
+{
+    free(self->tx_buffer);
+    free(self->rx_queue);
+    free(self);
+}
+
+
+void transport_fault_get_statistics(
+    transport_fault_t self,
+    transport_fault_statistics *statistics
+)
+{
+    *statistics = self->statistics;
+}
+
+
+/**
+ * @brief 1Byteのうちランダムな1bitを反転させる
+*/
+static uint8_t flip_bit(
+    transport_fault_t self,
+    uint8_t data
+)
+{
+    return data ^ (1 << (next_random(self) % 8));
+}
+
+
+/**
+ * @brief 送信データに故障を起こし、次の応答で起こす故障を決める
+ *
+ * @return 送信するデータ
+*/
+static const uint8_t *prepare_write(
+    transport_fault_t self,
+    const uint8_t *src,
+    size_t len
+)
+{
+    const transport_fault_parameter *parameter = &self->parameter;
+
+    self->rx_index = 0;
+    self->truncate = happen(self, parameter->truncate_rate);
+    if (self->truncate)
+    {
+        self->truncate_index = next_random(self) % TRANSPORT_FAULT_TRUNCATE_MAX_SIZE;
+        self->statistics.truncated_responses++;
+    }
+    self->stray = happen(self, parameter->stray_header_rate);
+    if (self->stray)
+    {
+        self->stray_index = next_random(self) % TRANSPORT_FAULT_TRUNCATE_MAX_SIZE;
+        self->statistics.stray_headers++;
+    }
+    self->delay_us = 0;
+    if (happen(self, parameter->late_response_rate))
+    {
+        self->delay_us = (uint32_t)(-log(1.0 - next_uniform(self)) * parameter->late_response_mean_us);
+        self->statistics.late_responses++;
+    }
+
+    if (parameter->bit_flip_rate <= 0)
+        return src;
+
+    if (len > self->tx_buffer_size)
+    {
+        uint8_t *tx_buffer = realloc(self->tx_buffer, len);
+        if (!tx_buffer)
+            return src;
+        self->tx_buffer = tx_buffer;
+        self->tx_buffer_size = len;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        self->tx_buffer[i] = src[i];
+        if (happen(self, parameter->bit_flip_rate))
+        {
+            self->tx_buffer[i] = flip_bit(self, src[i]);
+            self->statistics.tx_bit_flips++;
+        }
+    }
+
+    return self->tx_buffer;
+}
+
+
+static int fault_write(
+    void *context,
+    const uint8_t *src,
+    size_t len
+)
+{
+    transport_fault_t self = (transport_fault_t)context;
+    const uint8_t *data = prepare_write(self, src, len);
+
+    return self->inner.write(self->inner.context, data, len);
+}
+
+
+static int fault_write_async(
+    void *context,
+    const uint8_t *src,
+    size_t len
+)
+{
+    transport_fault_t self = (transport_fault_t)context;
+    const uint8_t *data = prepare_write(self, src, len);
+
+    return self->inner.write_async(self->inner.context, data, len);
+}
+
+
+static int fault_wait_write(
+    void *context
+)
+{
+    transport_fault_t self = (transport_fault_t)context;
+
+    return self->inner.wait_write(self->inner.context);
+}
+
+
+static int fault_write_done(
+    void *context
+)
+{
+    transport_fault_t self = (transport_fault_t)context;
+
+    return self->inner.write_done(self->inner.context);
+}
+
+
+/// 受信したデータを読み込み待ちに追加する
+static void push_byte(
+    transport_fault_t self,
+    uint8_t data,
+    uint64_t release_us
+)
+{
+    if (self->rx_tail == self->rx_queue_size)
+    {
+        if (self->rx_head > 0)
+        {
+            // 読み込み済みの分を詰める
+            memmove(
+                self->rx_queue, self->rx_queue + self->rx_head,
+                (self->rx_tail - self->rx_head) * sizeof(fault_byte)
+            );
+            self->rx_tail -= self->rx_head;
+            self->rx_head = 0;
+        }
+        else
+        {
+            size_t size = self->rx_queue_size ? self->rx_queue_size * 2 : READ_CHUNK_SIZE;
+            fault_byte *rx_queue = realloc(self->rx_queue, size * sizeof(fault_byte));
+            if (!rx_queue)
+                return;
+            self->rx_queue = rx_queue;
+            self->rx_queue_size = size;
+        }
+    }
+
+    self->rx_queue[self->rx_tail].data = data;
+    self->rx_queue[self->rx_tail].release_us = release_us;
+    self->rx_tail++;
+}
+
+
+/**
+ * @brief 包んだ経路に届いているデータを全て読み込み、故障を起こして読み込み待ちに追加する
+*/
+static void pull(
+    transport_fault_t self
+)
+{
+    uint8_t buffer[READ_CHUNK_SIZE];
+    size_t read_size;
+    uint64_t release_us;
+
+    while ((read_size = self->inner.read_available(self->inner.context, buffer, sizeof(buffer))) > 0)
+    {
+        release_us = self->inner.now_us(self->inner.context) + self->delay_us;
+
+        for (size_t i = 0; i < read_size; i++, self->rx_index++)
+        {
+            if (self->truncate && self->rx_index >= self->truncate_index)
+                continue;
+
+            if (self->stray && self->rx_index == self->stray_index)
+            {
+                for (size_t j = 0; j < sizeof(stray_header); j++)
+                    push_byte(self, stray_header[j], release_us);
+            }
+
+            if (happen(self, self->parameter.byte_drop_rate))
+            {
+                self->statistics.rx_byte_drops++;
+                continue;
+            }
+
+            if (happen(self, self->parameter.bit_flip_rate))
+            {
+                push_byte(self, flip_bit(self, buffer[i]), release_us);
+                self->statistics.rx_bit_flips++;
+                continue;
+            }
+
+            push_byte(self, buffer[i], release_us);
+        }
+    }
+}
+
+
+/// 先頭のデータを読み込めるか
+static bool is_released(
+    transport_fault_t self,
+    uint64_t now_us
+)
+{
+    return self->rx_head < self->rx_tail
+        && self->rx_queue[self->rx_head].release_us <= now_us;
+}
+
+
+static size_t fault_read_available(
+    void *context,
+    uint8_t *dst,
+    size_t max
+)
+{
+    transport_fault_t self = (transport_fault_t)context;
+    uint64_t now_us;
+    size_t read_size = 0;
+
+    pull(self);
+    now_us = self->inner.now_us(self->inner.context);
+
+    while (read_size < max && is_released(self, now_us))
+        dst[read_size++] = self->rx_queue[self->rx_head++].data;
+
+    if (self->rx_head == self->rx_tail)
+        self->rx_head = self->rx_tail = 0;
+
+    return read_size;
+}
+
+
+static int fault_wait_readable(
+    void *context,
+    uint us
+)
+{
+    transport_fault_t self = (transport_fault_t)context;
+    uint64_t now_us = self->inner.now_us(self->inner.context);
+    uint64_t deadline_us = now_us + us;
+    uint64_t wait_us;
+
+    while (1)
+    {
+        pull(self);
+        now_us = self->inner.now_us(self->inner.context);
+        if (is_released(self, now_us))
+            return 0;
+
+        if (now_us >= deadline_us)
+            return 1;
+
+        // 遅らせたデータが読み込めるようになるか、次のデータが届くまで待つ
+        wait_us = deadline_us - now_us;
+        if (self->rx_head < self->rx_tail && self->rx_queue[self->rx_head].release_us - now_us < wait_us)
+            wait_us = self->rx_queue[self->rx_head].release_us - now_us;
+        self->inner.wait_readable(self->inner.context, wait_us);
+    }
+}
+
+
+static uint fault_set_baud(
+    void *context,
+    uint baud_rate
+)
+{
+    transport_fault_t self = (transport_fault_t)context;
+
+    return self->inner.set_baud(self->inner.context, baud_rate);
+}
+
+
+static uint64_t fault_now_us(
+    void *context
+)
+{
+    transport_fault_t self = (transport_fault_t)context;
+
+    return self->inner.now_us(self->inner.context);
+}
+
+
+void transport_fault_init_transport(
+    transport_fault_t self,
+    dynamixel_transport *transport
+)
+{
+    transport->context = self;
+    transport->write = fault_write;
+    transport->write_async = fault_write_async;
+    transport->wait_write = fault_wait_write;
+    transport->write_done = fault_write_done;
+    transport->read_available = fault_read_available;
+    transport->wait_readable = fault_wait_readable;
+    transport->set_baud = fault_set_baud;
+    transport->now_us = fault_now_us;
+}
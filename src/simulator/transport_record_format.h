@@ -0,0 +1,28 @@
+#ifndef _ONE_DYNAMIXEL_TRANSPORT_RECORD_FORMAT_H
+#define _ONE_DYNAMIXEL_TRANSPORT_RECORD_FORMAT_H
+
+/**
+ * 送受信の記録ファイルの形式(transport_recorder、transport_replayerで共通)
+ *
+ * ヘッダー: マジックナンバー"DXLR"(4Byte) + バージョン(1Byte)
+ * 記録: 種類(1Byte) + 前の記録からの経過時間[micro sec.](可変長整数) + 内容
+ * - 送信、受信: データサイズ(可変長整数) + データ
+ * - ボーレートの変更: ボーレート(可変長整数)
+ * - 送信の完了: なし
+ *
+ * 可変長整数は、下位から7bitずつ、続きがある場合は最上位bitを1にして並べる(LEB128)
+*/
+
+#define TRANSPORT_RECORD_MAGIC "DXLR"
+#define TRANSPORT_RECORD_MAGIC_SIZE 4
+#define TRANSPORT_RECORD_VERSION 1
+/// 1つの送信、受信の記録のデータサイズの上限(これより大きい記録は壊れているものとする)
+#define TRANSPORT_RECORD_DATA_MAX_SIZE 65536
+
+/// 記録の種類
+#define TRANSPORT_RECORD_TX 0x00
+#define TRANSPORT_RECORD_RX 0x01
+#define TRANSPORT_RECORD_BAUD_RATE 0x02
+#define TRANSPORT_RECORD_TX_DONE 0x03
+
+#endif
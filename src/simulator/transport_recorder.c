@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "simulator/transport_recorder.h"
+#include "transport_record_format.h"
+
+
+typedef struct transport_recorder_struct
+{
+    dynamixel_transport inner;
+    FILE *file;
+    // 前の記録の時刻(包んだ経路の時刻)
+    uint64_t previous_us;
+    size_t record_num;
+    // ファイルへの書き込みに失敗した(以降は記録しない)
+    bool failed;
+} transport_recorder_struct;
+
+
+transport_recorder_t transport_recorder_create(
+    const dynamixel_transport *inner,
+    const char *path
+)
+{
+    const uint8_t version = TRANSPORT_RECORD_VERSION;
+
+    transport_recorder_t self = calloc(1, sizeof(transport_recorder_struct));
+    if (!self)
+        return NULL;
+
+    self->file = fopen(path, "wb");
+    if (!self->file)
+    {
+        free(self);
+        return NULL;
+    }
+
+    self->inner = *inner;
+    self->previous_us = inner->now_us(inner->context);
+    if (
+        fwrite(TRANSPORT_RECORD_MAGIC, 1, TRANSPORT_RECORD_MAGIC_SIZE, self->file) != TRANSPORT_RECORD_MAGIC_SIZE
+        || fwrite(&version, 1, 1, self->file) != 1
+    )
+    {
+        fclose(self->file);
+        free(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+
+int transport_recorder_destroy(
+    transport_recorder_t self
+)
+{
+    // 書き込みきれていないデータは、閉じるときに書き込まれる
+    bool failed = fclose(self->file) != 0 || self->failed;
+
+    free(self);
+    return failed;
+}
+
+
+bool transport_recorder_has_failed(
+    transport_recorder_t self
+)
+{
+    return self->failed;
+}
+
+
+size_t transport_recorder_get_record_num(
+    transport_recorder_t self
+)
+{
+    return self->record_num;
+}
+
+
+/// 書き込みに失敗したら、以降は記録しない
+static void write_bytes(
+    transport_recorder_t self,
+    const uint8_t *data,
+    size_t len
+)
+{
+    if (!self->failed && fwrite(data, 1, len, self->file) != len)
+        self->failed = true;
+}
+
+
+static void write_varint(
+    transport_recorder_t self,
+    uint64_t value
+)
+{
+    uint8_t byte;
+
+    do
+    {
+        byte = value & 0x7f;
+        value >>= 7;
+        if (value)
+            byte |= 0x80;
+        write_bytes(self, &byte, 1);
+    }
+    while (value);
+}
+
+
+/// 記録の種類と、前の記録からの経過時間を書き込む
+static void write_record_header(
+    transport_recorder_t self,
+    uint8_t type
+)
+{
+    uint64_t now_us = self->inner.now_us(self->inner.context);
+
+    write_bytes(self, &type, 1);
+    write_varint(self, now_us - self->previous_us);
+    self->previous_us = now_us;
+    if (!self->failed)
+        self->record_num++;
+}
+
+
+static void write_data_record(
+    transport_recorder_t self,
+    uint8_t type,
+    const uint8_t *data,
+    size_t len
+)
+{
+    write_record_header(self, type);
+    write_varint(self, len);
+    write_bytes(self, data, len);
+}
+
+
+static int recorder_write(
+    void *context,
+    const uint8_t *src,
+    size_t len
+)
+{
+    transport_recorder_t self = (transport_recorder_t)context;
+    int result;
+
+    write_data_record(self, TRANSPORT_RECORD_TX, src, len);
+    result = self->inner.write(self->inner.context, src, len);
+    write_record_header(self, TRANSPORT_RECORD_TX_DONE);
+
+    return result;
+}
+
+
+static int recorder_write_async(
+    void *context,
+    const uint8_t *src,
+    size_t len
+)
+{
+    transport_recorder_t self = (transport_recorder_t)context;
+
+    write_data_record(self, TRANSPORT_RECORD_TX, src, len);
+    return self->inner.write_async(self->inner.context, src, len);
+}
+
+
+static int recorder_wait_write(
+    void *context
+)
+{
+    transport_recorder_t self = (transport_recorder_t)context;
+    int result = self->inner.wait_write(self->inner.context);
+
+    // 送信にかかった時間を再生で再現するため、完了した時刻を記録する
+    write_record_header(self, TRANSPORT_RECORD_TX_DONE);
+
+    return result;
+}
+
+
+/// 完了した時刻は、完了を確認した後に呼ばれるwait_writeで記録する
+static int recorder_write_done(
+    void *context
+)
+{
+    transport_recorder_t self = (transport_recorder_t)context;
+
+    return self->inner.write_done(self->inner.context);
+}
+
+
+static size_t recorder_read_available(
+    void *context,
+    uint8_t *dst,
+    size_t max
+)
+{
+    transport_recorder_t self = (transport_recorder_t)context;
+    size_t read_size = self->inner.read_available(self->inner.context, dst, max);
+
+    // 受信したデータがあるときのみ記録する
+    if (read_size > 0)
+        write_data_record(self, TRANSPORT_RECORD_RX, dst, read_size);
+
+    return read_size;
+}
+
+
+static int recorder_wait_readable(
+    void *context,
+    uint us
+)
+{
+    transport_recorder_t self = (transport_recorder_t)context;
+
+    return self->inner.wait_readable(self->inner.context, us);
+}
+
+
+static uint recorder_set_baud(
+    void *context,
+    uint baud_rate
+)
+{
+    transport_recorder_t self = (transport_recorder_t)context;
+    uint actual_baud_rate = self->inner.set_baud(self->inner.context, baud_rate);
+
+    write_record_header(self, TRANSPORT_RECORD_BAUD_RATE);
+    write_varint(self, actual_baud_rate);
+
+    return actual_baud_rate;
+}
+
+
+static uint64_t recorder_now_us(
+    void *context
+)
+{
+    transport_recorder_t self = (transport_recorder_t)context;
+
+    return self->inner.now_us(self->inner.context);
+}
+
+
+void transport_recorder_init_transport(
+    transport_recorder_t self,
+    dynamixel_transport *transport
+)
+{
+    transport->context = self;
+    transport->write = recorder_write;
+    transport->write_async = recorder_write_async;
+    transport->wait_write = recorder_wait_write;
+    transport->write_done = recorder_write_done;
+    transport->read_available = recorder_read_available;
+    transport->wait_readable = recorder_wait_readable;
+    transport->set_baud = recorder_set_baud;
+    transport->now_us = recorder_now_us;
+}
@@ -0,0 +1,563 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "simulator/transport_replayer.h"
+#include "transport_record_format.h"
+
+
+/**
+ * @brief 記録の1項目
+ *
+ * time_usは記録の開始からの時刻、データはdataの中のoffsetからsize分
+*/
+typedef struct
+{
+    uint8_t type;
+    uint64_t time_us;
+    size_t offset;
+    size_t size;
+} replay_record;
+
+
+typedef struct transport_replayer_struct
+{
+    transport_replayer_mode mode;
+    replay_record *record;
+    size_t record_num;
+    uint8_t *data;
+    // 次に処理する記録と、その受信データのうち読み込み済みのサイズ
+    size_t position;
+    size_t rx_offset;
+    // 最後に対応付けた送信の、記録での時刻と再生での時刻
+    uint64_t anchor_record_us;
+    uint64_t anchor_clock_us;
+    // TRANSPORT_REPLAYER_MODE_FASTのときの仮想的な時刻
+    uint64_t virtual_us;
+    transport_replayer_statistics statistics;
+} transport_replayer_struct;
+
+
+static uint64_t get_real_time_us()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+static uint64_t get_clock_us(
+    transport_replayer_t self
+)
+{
+    if (self->mode == TRANSPORT_REPLAYER_MODE_FAST)
+        return self->virtual_us;
+
+    return get_real_time_us();
+}
+
+
+/**
+ * @brief 可変長整数を読み込む
+ *
+ * @retval 0 読み込んだ
+ * @retval 1 ファイルの終わり、または値が64bitに収まらない
+*/
+static int read_varint(
+    FILE *file,
+    uint64_t *value
+)
+{
+    int byte;
+    uint shift = 0;
+
+    *value = 0;
+    do
+    {
+        byte = fgetc(file);
+        if (byte == EOF || shift > 63)
+            return 1;
+        // 最後の7bitのうち、64bitからはみ出す部分
+        if (shift == 63 && (byte & 0x7e))
+            return 1;
+
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    }
+    while (byte & 0x80);
+
+    return 0;
+}
+
+
+/**
+ * @brief 配列の領域を、必要な数が入るまで2倍ずつ広げる
+ *
+ * @retval 0 広げた(または広げる必要がなかった)
+ * @retval 1 領域を確保できなかった
+*/
+static int reserve(
+    void **array,
+    size_t *capacity,
+    size_t required,
+    size_t initial_capacity,
+    size_t element_size
+)
+{
+    size_t new_capacity = *capacity ? *capacity : initial_capacity;
+    void *new_array;
+
+    if (required <= *capacity)
+        return 0;
+
+    while (new_capacity < required)
+    {
+        if (new_capacity > SIZE_MAX / 2)
+            return 1;
+        new_capacity *= 2;
+    }
+    if (new_capacity > SIZE_MAX / element_size)
+        return 1;
+
+    new_array = realloc(*array, new_capacity * element_size);
+    if (!new_array)
+        return 1;
+
+    *array = new_array;
+    *capacity = new_capacity;
+    return 0;
+}
+
+
+/**
+ * @brief ファイルの残りのサイズを返す
+ *
+ * @retval 0 取得した
+ * @retval 1 ファイルの位置を取得できなかった
+*/
+static int get_remaining_size(
+    FILE *file,
+    long file_size,
+    uint64_t *remaining_size
+)
+{
+    long position = ftell(file);
+
+    if (position < 0 || position > file_size)
+        return 1;
+
+    *remaining_size = file_size - position;
+    return 0;
+}
+
+
+/// 記録ファイルを全て読み込む
+static int load(
+    transport_replayer_t self,
+    FILE *file
+)
+{
+    char magic[TRANSPORT_RECORD_MAGIC_SIZE];
+    int type, version;
+    long file_size;
+    uint64_t delta_us, value, remaining_size, time_us = 0;
+    size_t record_capacity = 0, data_size = 0, data_capacity = 0;
+
+    // 記録のデータサイズが、ファイルの残りより大きくないか確かめるため
+    if (fseek(file, 0, SEEK_END) != 0 || (file_size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0)
+        return 1;
+
+    if (
+        fread(magic, 1, TRANSPORT_RECORD_MAGIC_SIZE, file) != TRANSPORT_RECORD_MAGIC_SIZE
+        || memcmp(magic, TRANSPORT_RECORD_MAGIC, TRANSPORT_RECORD_MAGIC_SIZE) != 0
+    )
+        return 1;
+
+    version = fgetc(file);
+    if (version != TRANSPORT_RECORD_VERSION)
+        return 1;
+
+    while ((type = fgetc(file)) != EOF)
+    {
+        replay_record *record;
+
+        if (read_varint(file, &delta_us))
+            return 1;
+
+        if (
+            reserve(
+                (void **)&self->record, &record_capacity,
+                self->record_num + 1, 64, sizeof(replay_record)
+            )
+        )
+            return 1;
+
+        // 時刻が一周するほどの経過時間は壊れている
+        if (delta_us > UINT64_MAX - time_us)
+            return 1;
+        time_us += delta_us;
+        record = self->record + self->record_num;
+        record->type = type;
+        record->time_us = time_us;
+        record->offset = data_size;
+        record->size = 0;
+
+        if (type == TRANSPORT_RECORD_TX || type == TRANSPORT_RECORD_RX)
+        {
+            if (
+                read_varint(file, &value)
+                || get_remaining_size(file, file_size, &remaining_size)
+                || value > remaining_size
+                || value > TRANSPORT_RECORD_DATA_MAX_SIZE
+            )
+                return 1;
+
+            if (reserve((void **)&self->data, &data_capacity, data_size + value, 1024, sizeof(uint8_t)))
+                return 1;
+
+            if (fread(self->data + data_size, 1, value, file) != value)
+                return 1;
+            record->size = value;
+            data_size += value;
+        }
+        else if (type == TRANSPORT_RECORD_BAUD_RATE)
+        {
+            // 再生ではボーレートを使わない
+            if (read_varint(file, &value))
+                return 1;
+        }
+        else if (type != TRANSPORT_RECORD_TX_DONE)
+        {
+            return 1;
+        }
+
+        self->record_num++;
+    }
+
+    // ファイルの終わりでなく、読み込みに失敗した
+    if (ferror(file))
+        return 1;
+
+    return 0;
+}
+
+
+transport_replayer_t transport_replayer_create(
+    const char *path,
+    transport_replayer_mode mode
+)
+{
+    FILE *file;
+    int result;
+
+    transport_replayer_t self = calloc(1, sizeof(transport_replayer_struct));
+    if (!self)
+        return NULL;
+
+    file = fopen(path, "rb");
+    if (!file)
+    {
+        free(self);
+        return NULL;
+    }
+    result = load(self, file);
+    fclose(file);
+    if (result)
+    {
+        transport_replayer_destroy(self);
+        return NULL;
+    }
+
+    self->mode = mode;
+    // 最初の送信までは、再生の開始を記録の開始に対応付ける
+    self->anchor_clock_us = get_clock_us(self);
+
+    return self;
+}
+
+
+void transport_replayer_destroy(
+    transport_replayer_t self
+)
+{
+    free(self->record);
+    free(self->data);
+    free(self);
+}
+
+
+bool transport_replayer_is_finished(
+    transport_replayer_t self
+)
+{
+    return self->position >= self->record_num;
+}
+
+
+void transport_replayer_get_statistics(
+    transport_replayer_t self,
+    transport_replayer_statistics *statistics
+)
+{
+    *statistics = self->statistics;
+}
+
+
+/// ボーレートの変更の記録を読み飛ばす(再生では使わない)
+static void skip_baud_rate_record(
+    transport_replayer_t self
+)
+{
+    while (
+        self->position < self->record_num
+        && self->record[self->position].type == TRANSPORT_RECORD_BAUD_RATE
+    )
+        self->position++;
+}
+
+
+/// 記録での時刻を、再生での時刻に変換する
+static uint64_t to_clock_us(
+    transport_replayer_t self,
+    const replay_record *record
+)
+{
+    return self->anchor_clock_us + (record->time_us - self->anchor_record_us);
+}
+
+
+/// 指定した時刻まで待つ(TRANSPORT_REPLAYER_MODE_FASTでは仮想的な時刻を進める)
+static void wait_until(
+    transport_replayer_t self,
+    uint64_t time_us
+)
+{
+    uint64_t now_us = get_clock_us(self);
+    struct timespec duration;
+
+    if (time_us <= now_us)
+        return;
+
+    if (self->mode == TRANSPORT_REPLAYER_MODE_FAST)
+    {
+        self->virtual_us = time_us;
+        return;
+    }
+
+    duration.tv_sec = (time_us - now_us) / 1000000;
+    duration.tv_nsec = ((time_us - now_us) % 1000000) * 1000;
+    nanosleep(&duration, NULL);
+}
+
+
+/**
+ * @brief 次の受信データを読み込めるようになる時刻を返す
+ *
+ * @retval 0 次の受信データがある
+ * @retval 1 次の送信を行うまで、受信データはない
+*/
+static int get_next_rx_time(
+    transport_replayer_t self,
+    uint64_t *time_us
+)
+{
+    const replay_record *record;
+
+    skip_baud_rate_record(self);
+    if (self->position >= self->record_num)
+        return 1;
+
+    record = self->record + self->position;
+    if (record->type != TRANSPORT_RECORD_RX)
+        return 1;
+
+    *time_us = to_clock_us(self, record);
+    return 0;
+}
+
+
+static int replayer_write_async(
+    void *context,
+    const uint8_t *src,
+    size_t len
+)
+{
+    transport_replayer_t self = (transport_replayer_t)context;
+    const replay_record *record;
+
+    // 読み込まれていない受信データは、送信より前に届いていたものとして捨てる
+    while (self->position < self->record_num && self->record[self->position].type != TRANSPORT_RECORD_TX)
+    {
+        if (self->record[self->position].type == TRANSPORT_RECORD_RX)
+            self->statistics.rx_skipped++;
+        self->position++;
+    }
+    self->rx_offset = 0;
+
+    if (self->position >= self->record_num)
+    {
+        self->statistics.tx_unexpected++;
+        return 0;
+    }
+
+    record = self->record + self->position;
+    if (record->size == len && memcmp(self->data + record->offset, src, len) == 0)
+        self->statistics.tx_matched++;
+    else
+        self->statistics.tx_mismatched++;
+
+    self->anchor_record_us = record->time_us;
+    self->anchor_clock_us = get_clock_us(self);
+    self->position++;
+
+    return 0;
+}
+
+
+static int replayer_wait_write(
+    void *context
+)
+{
+    transport_replayer_t self = (transport_replayer_t)context;
+
+    // 記録で送信が完了した時刻まで待つ
+    skip_baud_rate_record(self);
+    if (
+        self->position < self->record_num
+        && self->record[self->position].type == TRANSPORT_RECORD_TX_DONE
+    )
+    {
+        wait_until(self, to_clock_us(self, self->record + self->position));
+        self->position++;
+    }
+
+    return 0;
+}
+
+
+static int replayer_write_done(
+    void *context
+)
+{
+    transport_replayer_t self = (transport_replayer_t)context;
+    uint64_t done_us;
+
+    skip_baud_rate_record(self);
+    if (
+        self->position >= self->record_num
+        || self->record[self->position].type != TRANSPORT_RECORD_TX_DONE
+    )
+        return 0;
+
+    // 記録で送信が完了した時刻を過ぎたら完了とする(TRANSPORT_REPLAYER_MODE_FASTでは、その時刻まで進める)
+    done_us = to_clock_us(self, self->record + self->position);
+    if (self->mode == TRANSPORT_REPLAYER_MODE_FAST)
+        wait_until(self, done_us);
+
+    return done_us > get_clock_us(self) ? 1 : 0;
+}
+
+
+static int replayer_write(
+    void *context,
+    const uint8_t *src,
+    size_t len
+)
+{
+    replayer_write_async(context, src, len);
+    return replayer_wait_write(context);
+}
+
+
+static size_t replayer_read_available(
+    void *context,
+    uint8_t *dst,
+    size_t max
+)
+{
+    transport_replayer_t self = (transport_replayer_t)context;
+    uint64_t rx_time_us;
+    size_t read_size = 0, copy_size;
+
+    while (
+        read_size < max
+        && get_next_rx_time(self, &rx_time_us) == 0
+        && rx_time_us <= get_clock_us(self)
+    )
+    {
+        const replay_record *record = self->record + self->position;
+
+        copy_size = record->size - self->rx_offset;
+        if (copy_size > max - read_size)
+            copy_size = max - read_size;
+        memcpy(dst + read_size, self->data + record->offset + self->rx_offset, copy_size);
+        read_size += copy_size;
+        self->rx_offset += copy_size;
+        self->statistics.rx_bytes += copy_size;
+
+        if (self->rx_offset == record->size)
+        {
+            self->statistics.rx_chunks++;
+            self->rx_offset = 0;
+            self->position++;
+        }
+    }
+
+    return read_size;
+}
+
+
+static int replayer_wait_readable(
+    void *context,
+    uint us
+)
+{
+    transport_replayer_t self = (transport_replayer_t)context;
+    uint64_t deadline_us = get_clock_us(self) + us;
+    uint64_t rx_time_us;
+
+    if (get_next_rx_time(self, &rx_time_us) == 0 && rx_time_us < deadline_us)
+        deadline_us = rx_time_us;
+    wait_until(self, deadline_us);
+
+    return !(get_next_rx_time(self, &rx_time_us) == 0 && rx_time_us <= get_clock_us(self));
+}
+
+
+static uint replayer_set_baud(
+    void *context,
+    uint baud_rate
+)
+{
+    return baud_rate;
+}
+
+
+static uint64_t replayer_now_us(
+    void *context
+)
+{
+    transport_replayer_t self = (transport_replayer_t)context;
+
+    return get_clock_us(self);
+}
+
+
+void transport_replayer_init_transport(
+    transport_replayer_t self,
+    dynamixel_transport *transport
+)
+{
+    transport->context = self;
+    transport->write = replayer_write;
+    transport->write_async = replayer_write_async;
+    transport->wait_write = replayer_wait_write;
+    transport->write_done = replayer_write_done;
+    transport->read_available = replayer_read_available;
+    transport->wait_readable = replayer_wait_readable;
+    transport->set_baud = replayer_set_baud;
+    transport->now_us = replayer_now_us;
+}
@@ -0,0 +1,715 @@
+#include <stdlib.h>
+#include <string.h>
+#include "simulator/virtual_bus.h"
+#include "util/analyze_packet.h"
+#include "util/crc.h"
+#include "util/packet_byte.h"
+
+
+/// UARTで1Byte送るのに必要なビット数(スタートビット、データ8bit、ストップビット)
+#define UART_BITS_PER_BYTE 10
+/// ホストから受信して、まだ解析していないデータを保持するサイズ
+#define INPUT_BUFFER_SIZE 4096
+/// ホストに送信するデータを保持する数
+#define OUTPUT_QUEUE_SIZE 65536
+/// ブロードキャストID
+#define BROADCAST_ID 0xfe
+/// pingの応答パケットのサイズ
+#define PING_STATUS_PACKET_SIZE 14
+/// 応答パケットを作成するバッファーのサイズ(パラメータの修正で増える分を含む)
+#define STATUS_PACKET_BUFFER_SIZE (11 + VIRTUAL_SERVO_STATUS_PARAMETER_MAX_SIZE * 4 / 3 + 1)
+
+
+/**
+ * @brief ホストに送信するデータ
+ *
+ * arrival_nsにホストが受信し終わる時刻を持つ(届く時刻の順に並べる)
+*/
+typedef struct
+{
+    uint8_t data;
+    uint64_t arrival_ns;
+} output_byte;
+
+
+typedef struct virtual_bus_struct
+{
+    uint baud_rate;
+    // 仮想時間[nano sec.](1Byteの送信時間が整数にならないボーレートがあるため、nsで持つ)
+    uint64_t now_ns;
+    // ホストの送信が完了する時刻
+    uint64_t tx_end_ns;
+    virtual_servo_t servo[VIRTUAL_BUS_MAX_SERVO_NUM];
+    size_t servo_num;
+    uint8_t input[INPUT_BUFFER_SIZE];
+    size_t input_size;
+    output_byte *output;
+    size_t output_head;
+    size_t output_tail;
+    virtual_bus_statistics statistics;
+} virtual_bus_struct;
+
+
+virtual_bus_t virtual_bus_create(
+    uint baud_rate
+)
+{
+    if (baud_rate == 0)
+        return NULL;
+
+    virtual_bus_t self = calloc(1, sizeof(virtual_bus_struct));
+    if (!self)
+        return NULL;
+
+    self->output = calloc(OUTPUT_QUEUE_SIZE, sizeof(output_byte));
+    if (!self->output)
+    {
+        free(self);
+        return NULL;
+    }
+    self->baud_rate = baud_rate;
+
+    return self;
+}
+
+
+void virtual_bus_destroy(
+    virtual_bus_t self
+)
+{
+    free(self->output);
+    free(self);
+}
+
+
+int virtual_bus_add_servo(
+    virtual_bus_t self,
+    virtual_servo_t servo
+)
+{
+    if (self->servo_num >= VIRTUAL_BUS_MAX_SERVO_NUM)
+        return 1;
+
+    self->servo[self->servo_num] = servo;
+    self->servo_num++;
+    return 0;
+}
+
+
+/// 指定したデータサイズを送るのにかかる時間[nano sec.]
+static uint64_t get_wire_ns(
+    uint baud_rate,
+    size_t size
+)
+{
+    return (uint64_t)size * UART_BITS_PER_BYTE * 1000000000 / baud_rate;
+}
+
+
+/// 読み込み済みのデータを詰めて、末尾にsize分の空きを作る
+static bool reserve_output(
+    virtual_bus_t self,
+    size_t size
+)
+{
+    if (self->output_tail + size > OUTPUT_QUEUE_SIZE && self->output_head > 0)
+    {
+        memmove(
+            self->output,
+            self->output + self->output_head,
+            (self->output_tail - self->output_head) * sizeof(output_byte)
+        );
+        self->output_tail -= self->output_head;
+        self->output_head = 0;
+    }
+
+    return self->output_tail + size <= OUTPUT_QUEUE_SIZE;
+}
+
+
+/**
+ * @brief ホストに送信する1Byteを、届く時刻の順に並ぶように追加する
+ *
+ * 他の仮想Dynamixelが送信中のデータと重なった場合は、信号が衝突してデータが壊れる(論理積になる)
+ * @retval true 他のデータと衝突した
+ * @retval false 衝突しなかった
+*/
+static bool insert_output(
+    virtual_bus_t self,
+    uint8_t data,
+    uint64_t arrival_ns,
+    uint64_t byte_ns
+)
+{
+    size_t position;
+
+    if (!reserve_output(self, 1))
+        return false;
+
+    position = self->output_tail;
+    while (position > self->output_head && self->output[position - 1].arrival_ns > arrival_ns)
+        position--;
+
+    if (position > self->output_head && arrival_ns - self->output[position - 1].arrival_ns < byte_ns)
+    {
+        self->output[position - 1].data &= data;
+        return true;
+    }
+    if (position < self->output_tail && self->output[position].arrival_ns - arrival_ns < byte_ns)
+    {
+        self->output[position].data &= data;
+        return true;
+    }
+
+    memmove(
+        self->output + position + 1,
+        self->output + position,
+        (self->output_tail - position) * sizeof(output_byte)
+    );
+    self->output[position].data = data;
+    self->output[position].arrival_ns = arrival_ns;
+    self->output_tail++;
+    return false;
+}
+
+
+/**
+ * @brief 応答パケットを作成し、指定した時刻から送信する
+ * @return 送信が完了する時刻
+*/
+static uint64_t send_status_packet(
+    virtual_bus_t self,
+    uint baud_rate,
+    uint64_t start_ns,
+    uint8_t status_id,
+    const uint8_t *status_parameter,
+    size_t status_parameter_size
+)
+{
+    uint8_t packet[STATUS_PACKET_BUFFER_SIZE];
+    size_t packet_size;
+    bool collided = false;
+    uint64_t byte_ns = get_wire_ns(baud_rate, 1);
+
+    packet_size = create_uart_packet(
+        packet, status_id, DYNAMIXEL__INSTRUCTION_STATUS,
+        status_parameter, status_parameter_size
+    );
+
+    for (size_t i = 0; i < packet_size; i++)
+    {
+        if (insert_output(self, packet[i], start_ns + get_wire_ns(baud_rate, i + 1), byte_ns))
+            collided = true;
+    }
+
+    self->statistics.status_packets++;
+    self->statistics.rx_bytes += packet_size;
+    if (collided)
+        self->statistics.collisions++;
+
+    return start_ns + get_wire_ns(baud_rate, packet_size);
+}
+
+
+/**
+ * @brief 仮想Dynamixelにインストラクションパケットを渡し、応答する場合は応答パケットを作成する
+ * @retval 0 応答パケットを返す
+ * @retval 1 応答パケットを返さない、または受信できなかった
+*/
+static int handle_servo(
+    virtual_bus_t self,
+    virtual_servo_t servo,
+    uint8_t id,
+    uint8_t instruction,
+    const uint8_t *parameter,
+    size_t parameter_size,
+    bool valid_checksum,
+    uint64_t received_ns,
+    uint8_t *status_id,
+    uint8_t *status_parameter,
+    size_t *status_parameter_size
+)
+{
+    virtual_servo_update(servo, received_ns / 1000);
+
+    if (!valid_checksum)
+    {
+        return virtual_servo_handle_crc_error(
+            servo, id, status_id, status_parameter, status_parameter_size
+        );
+    }
+
+    return virtual_servo_handle_instruction(
+        servo, id, instruction, parameter, parameter_size,
+        status_id, status_parameter, status_parameter_size
+    );
+}
+
+
+/**
+ * @brief Sync Read、Bulk Readで応答するIDの順番を返す
+ * @return IDの数
+*/
+static size_t get_response_order(
+    uint8_t instruction,
+    const uint8_t *parameter,
+    size_t parameter_size,
+    uint8_t *ids
+)
+{
+    size_t id_num = 0;
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_SYNC_READ)
+    {
+        for (size_t i = 4; i < parameter_size; i++)
+            ids[id_num++] = parameter[i];
+    }
+    else
+    {
+        for (size_t i = 0; i + 5 <= parameter_size; i += 5)
+            ids[id_num++] = parameter[i];
+    }
+
+    return id_num;
+}
+
+
+/**
+ * @brief Sync Read、Bulk Readを処理する
+ *
+ * 応答パケットはパラメータに並んだIDの順に返す。
+ * 各仮想Dynamixelは、前のIDの応答パケットを受信し終わってからReturn Delay Time後に送信する。
+ * 前のIDが応答しなかった場合、それより後のIDは応答しない
+*/
+static void dispatch_response_train(
+    virtual_bus_t self,
+    uint8_t id,
+    uint8_t instruction,
+    const uint8_t *parameter,
+    size_t parameter_size,
+    uint64_t received_ns
+)
+{
+    uint8_t ids[INPUT_BUFFER_SIZE];
+    uint8_t status_id;
+    uint8_t status_parameter[VIRTUAL_SERVO_STATUS_PARAMETER_MAX_SIZE];
+    size_t status_parameter_size, id_num;
+    uint64_t previous_end_ns = received_ns;
+    bool train_continues = true;
+
+    id_num = get_response_order(instruction, parameter, parameter_size, ids);
+
+    for (size_t i = 0; i < id_num; i++)
+    {
+        uint64_t end_ns = previous_end_ns;
+        bool responded = false;
+
+        for (size_t j = 0; j < self->servo_num; j++)
+        {
+            virtual_servo_t servo = self->servo[j];
+            uint baud_rate = virtual_servo_get_baud_rate(servo);
+
+            if (baud_rate != self->baud_rate || virtual_servo_get_id(servo) != ids[i])
+                continue;
+
+            if (handle_servo(
+                self, servo, id, instruction, parameter, parameter_size, true, received_ns,
+                &status_id, status_parameter, &status_parameter_size
+            ) || !train_continues)
+                continue;
+
+            // 同じIDが複数ある場合は、同時に送信を始めて衝突する
+            uint64_t servo_end_ns = send_status_packet(
+                self, baud_rate,
+                previous_end_ns + (uint64_t)virtual_servo_get_return_delay_time_us(servo) * 1000,
+                status_id, status_parameter, status_parameter_size
+            );
+            if (servo_end_ns > end_ns)
+                end_ns = servo_end_ns;
+            responded = true;
+        }
+
+        if (!responded)
+            train_continues = false;
+        previous_end_ns = end_ns;
+    }
+}
+
+
+/// 受信したインストラクションパケットを、バスにつながった仮想Dynamixelに渡す
+static void dispatch_instruction(
+    virtual_bus_t self,
+    uint8_t id,
+    uint8_t instruction,
+    const uint8_t *parameter,
+    size_t parameter_size,
+    bool valid_checksum,
+    uint64_t received_ns
+)
+{
+    uint8_t status_id;
+    uint8_t status_parameter[VIRTUAL_SERVO_STATUS_PARAMETER_MAX_SIZE];
+    size_t status_parameter_size;
+    bool received = false;
+
+    self->statistics.instruction_packets++;
+
+    if (
+        valid_checksum
+        && (
+            instruction == DYNAMIXEL__INSTRUCTION_SYNC_READ
+            || instruction == DYNAMIXEL__INSTRUCTION_BULK_READ
+        )
+    )
+    {
+        dispatch_response_train(self, id, instruction, parameter, parameter_size, received_ns);
+        return;
+    }
+
+    for (size_t i = 0; i < self->servo_num; i++)
+    {
+        virtual_servo_t servo = self->servo[i];
+        // 応答パケットは受信したときのボーレートで返す(Baud Rateを書き換えた場合も含む)
+        uint baud_rate = virtual_servo_get_baud_rate(servo);
+        uint64_t start_ns;
+
+        // ボーレートが異なる仮想Dynamixelはパケットを受信できない
+        if (baud_rate != self->baud_rate)
+            continue;
+        received = true;
+
+        if (handle_servo(
+            self, servo, id, instruction, parameter, parameter_size, valid_checksum, received_ns,
+            &status_id, status_parameter, &status_parameter_size
+        ))
+            continue;
+
+        start_ns = received_ns + (uint64_t)virtual_servo_get_return_delay_time_us(servo) * 1000;
+        // ブロードキャストIDのpingには、IDの順に応答パケット1つ分ずつずらして応答する
+        if (id == BROADCAST_ID && instruction == DYNAMIXEL__INSTRUCTION_PING)
+            start_ns += status_id * get_wire_ns(baud_rate, PING_STATUS_PACKET_SIZE);
+
+        send_status_packet(
+            self, baud_rate, start_ns,
+            status_id, status_parameter, status_parameter_size
+        );
+    }
+
+    if (!valid_checksum || !received)
+        self->statistics.dropped_packets++;
+}
+
+
+/**
+ * @brief パラメータの修正で追加されたバイトを取り除く
+ * @return 取り除いた後のパラメータのバイト数
+*/
+static size_t remove_stuffing(
+    const uint8_t *packet_parameter,
+    size_t packet_parameter_size,
+    uint8_t *parameter
+)
+{
+    size_t parameter_size = 0;
+    bool removed = false;
+
+    for (size_t i = 0; i < packet_parameter_size; i++)
+    {
+        if (
+            !removed
+            && parameter_size >= 3
+            && parameter[parameter_size - 3] == DYNAMIXEL__HEADER_1
+            && parameter[parameter_size - 2] == DYNAMIXEL__HEADER_2
+            && parameter[parameter_size - 1] == DYNAMIXEL__HEADER_3
+            && packet_parameter[i] == DYNAMIXEL__HEADER_N
+        )
+        {
+            // ヘッダーと同じ並びの後に追加されたバイト
+            removed = true;
+            continue;
+        }
+
+        removed = false;
+        parameter[parameter_size] = packet_parameter[i];
+        parameter_size++;
+    }
+
+    return parameter_size;
+}
+
+
+static void discard_input(
+    virtual_bus_t self,
+    size_t size
+)
+{
+    memmove(self->input, self->input + size, self->input_size - size);
+    self->input_size -= size;
+}
+
+
+/// 受信したデータからインストラクションパケットを探して処理する
+static void process_input(
+    virtual_bus_t self,
+    uint64_t received_ns
+)
+{
+    uint8_t parameter[INPUT_BUFFER_SIZE];
+    size_t header_position, length, packet_size, parameter_size;
+    uint16_t packet_crc;
+
+    while (self->input_size >= 4)
+    {
+        for (header_position = 0; header_position + 3 < self->input_size; header_position++)
+        {
+            if (
+                self->input[header_position] == DYNAMIXEL__HEADER_1
+                && self->input[header_position + 1] == DYNAMIXEL__HEADER_2
+                && self->input[header_position + 2] == DYNAMIXEL__HEADER_3
+                && self->input[header_position + 3] == DYNAMIXEL__HEADER_R
+            )
+                break;
+        }
+
+        // ヘッダーより前のデータは使わない(ヘッダーが見つからなかった場合は末尾の3Byteを残す)
+        discard_input(self, header_position);
+        if (self->input_size < 4 + 3)
+            return;
+
+        length = combine_byte_pair(self->input[5], self->input[6]);
+        packet_size = 4 + 3 + length;
+        if (length < 3 || packet_size > INPUT_BUFFER_SIZE)
+        {
+            // パケットとして成り立たないため、次のヘッダーを探す
+            discard_input(self, 1);
+            continue;
+        }
+        if (self->input_size < packet_size)
+            return;
+
+        packet_crc = combine_byte_pair(
+            self->input[packet_size - 2], self->input[packet_size - 1]
+        );
+        parameter_size = remove_stuffing(self->input + 8, length - 3, parameter);
+
+        dispatch_instruction(
+            self, self->input[4], self->input[7], parameter, parameter_size,
+            crc_16_ibm(self->input, packet_size - 2) == packet_crc,
+            received_ns
+        );
+
+        discard_input(self, packet_size);
+    }
+}
+
+
+static int bus_write_async(
+    void *context,
+    const uint8_t *src,
+    size_t len
+)
+{
+    virtual_bus_t self = (virtual_bus_t)context;
+    uint64_t start_ns = self->now_ns > self->tx_end_ns ? self->now_ns : self->tx_end_ns;
+
+    // 半二重のため、まだ届いていない応答パケットはホストの送信と衝突して失われる
+    while (
+        self->output_tail > self->output_head
+        && self->output[self->output_tail - 1].arrival_ns > start_ns
+    )
+        self->output_tail--;
+
+    self->tx_end_ns = start_ns + get_wire_ns(self->baud_rate, len);
+    self->statistics.tx_bytes += len;
+
+    if (len > INPUT_BUFFER_SIZE - self->input_size)
+    {
+        // 解析できないほど大きいデータは捨てる
+        self->input_size = 0;
+        if (len > INPUT_BUFFER_SIZE)
+            return 0;
+    }
+    memcpy(self->input + self->input_size, src, len);
+    self->input_size += len;
+
+    // 仮想Dynamixelは送信が完了した時点でパケットを受信する
+    process_input(self, self->tx_end_ns);
+
+    return 0;
+}
+
+
+static int bus_wait_write(
+    void *context
+)
+{
+    virtual_bus_t self = (virtual_bus_t)context;
+
+    if (self->now_ns < self->tx_end_ns)
+        self->now_ns = self->tx_end_ns;
+
+    return 0;
+}
+
+
+static int bus_write_done(
+    void *context
+)
+{
+    virtual_bus_t self = (virtual_bus_t)context;
+
+    return self->now_ns < self->tx_end_ns ? 1 : 0;
+}
+
+
+static int bus_write(
+    void *context,
+    const uint8_t *src,
+    size_t len
+)
+{
+    bus_write_async(context, src, len);
+    return bus_wait_write(context);
+}
+
+
+static size_t bus_read_available(
+    void *context,
+    uint8_t *dst,
+    size_t max
+)
+{
+    virtual_bus_t self = (virtual_bus_t)context;
+    size_t read_size = 0;
+
+    while (
+        read_size < max
+        && self->output_head < self->output_tail
+        && self->output[self->output_head].arrival_ns <= self->now_ns
+    )
+    {
+        dst[read_size] = self->output[self->output_head].data;
+        read_size++;
+        self->output_head++;
+    }
+
+    if (self->output_head == self->output_tail)
+    {
+        self->output_head = 0;
+        self->output_tail = 0;
+    }
+
+    return read_size;
+}
+
+
+static int bus_wait_readable(
+    void *context,
+    uint us
+)
+{
+    virtual_bus_t self = (virtual_bus_t)context;
+    uint64_t deadline_ns = self->now_ns + (uint64_t)us * 1000;
+
+    if (self->output_head < self->output_tail)
+    {
+        uint64_t arrival_ns = self->output[self->output_head].arrival_ns;
+
+        if (arrival_ns <= deadline_ns)
+        {
+            // 次のデータが届くまで仮想時間を進める
+            if (self->now_ns < arrival_ns)
+                self->now_ns = arrival_ns;
+            return 0;
+        }
+    }
+
+    self->now_ns = deadline_ns;
+    return 1;
+}
+
+
+static uint bus_set_baud(
+    void *context,
+    uint baud_rate
+)
+{
+    virtual_bus_t self = (virtual_bus_t)context;
+
+    self->baud_rate = baud_rate;
+    return baud_rate;
+}
+
+
+static uint64_t bus_now_us(
+    void *context
+)
+{
+    virtual_bus_t self = (virtual_bus_t)context;
+
+    return self->now_ns / 1000;
+}
+
+
+void virtual_bus_init_transport(
+    virtual_bus_t self,
+    dynamixel_transport *transport
+)
+{
+    transport->context = self;
+    transport->write = bus_write;
+    transport->write_async = bus_write_async;
+    transport->wait_write = bus_wait_write;
+    transport->write_done = bus_write_done;
+    transport->read_available = bus_read_available;
+    transport->wait_readable = bus_wait_readable;
+    transport->set_baud = bus_set_baud;
+    transport->now_us = bus_now_us;
+}
+
+
+uint virtual_bus_get_baud_rate(
+    virtual_bus_t self
+)
+{
+    return self->baud_rate;
+}
+
+
+uint64_t virtual_bus_get_time_us(
+    virtual_bus_t self
+)
+{
+    return self->now_ns / 1000;
+}
+
+
+void virtual_bus_advance_us(
+    virtual_bus_t self,
+    uint64_t us
+)
+{
+    self->now_ns += us * 1000;
+}
+
+
+int virtual_bus_get_next_arrival_us(
+    virtual_bus_t self,
+    uint64_t *time_us
+)
+{
+    if (self->output_head == self->output_tail)
+        return 1;
+
+    *time_us = (self->output[self->output_head].arrival_ns + 999) / 1000;
+    return 0;
+}
+
+
+void virtual_bus_get_statistics(
+    virtual_bus_t self,
+    virtual_bus_statistics *statistics
+)
+{
+    *statistics = self->statistics;
+}
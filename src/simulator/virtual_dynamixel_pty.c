@@ -0,0 +1,228 @@
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "simulator/virtual_bus.h"
+#include "simulator/virtual_pty.h"
+#include "simulator/virtual_servo.h"
+#include "util/packet_byte.h"
+
+
+/// 1回の処理で待つ最大の時間[micro sec.](終了の確認に使う)
+#define RUN_TIMEOUT_US 100000
+
+
+static volatile sig_atomic_t running = 1;
+
+
+static void stop(
+    int signal_number
+)
+{
+    (void)signal_number;
+    running = 0;
+}
+
+
+static void print_usage(
+    const char *program
+)
+{
+    fprintf(
+        stderr,
+        "usage: %s [-b baud_rate] [-r return_delay_time_us] [-d] id[:model[:baud_rate]] ...\n"
+        "  -b  host baud rate and default servo baud rate (default: 57600)\n"
+        "  -r  return delay time of all servos [us] (default: 500)\n"
+        "  -d  enable motor dynamics\n"
+        "  model: xl330 (default), xl430, xm430\n"
+        "example: %s -b 1000000 -d 1 2:xm430 3:xl430:57600\n",
+        program, program
+    );
+}
+
+
+static int parse_model(
+    const char *name,
+    virtual_servo_model *model
+)
+{
+    if (strcmp(name, "xl330") == 0)
+        *model = VIRTUAL_SERVO_MODEL_XL330_M288;
+    else if (strcmp(name, "xl430") == 0)
+        *model = VIRTUAL_SERVO_MODEL_XL430_W250;
+    else if (strcmp(name, "xm430") == 0)
+        *model = VIRTUAL_SERVO_MODEL_XM430_W350;
+    else
+        return 1;
+
+    return 0;
+}
+
+
+/**
+ * @brief "id[:model[:baud_rate]]"の形式から仮想Dynamixelを作成する
+ *
+ * @return 作成した仮想Dynamixel(形式が正しくない場合はNULL)
+*/
+static virtual_servo_t create_servo(
+    const char *description,
+    uint default_baud_rate,
+    uint return_delay_time_us,
+    bool dynamics
+)
+{
+    char buffer[64];
+    char *id_text, *model_text, *baud_rate_text, *end;
+    long id;
+    uint baud_rate = default_baud_rate;
+    virtual_servo_model model = VIRTUAL_SERVO_MODEL_XL330_M288;
+    dynamixel_baud_rate baud_rate_byte;
+    uint8_t baud_rate_value;
+    virtual_servo_t servo;
+
+    if (strlen(description) >= sizeof(buffer))
+        return NULL;
+    strcpy(buffer, description);
+
+    id_text = strtok(buffer, ":");
+    model_text = strtok(NULL, ":");
+    baud_rate_text = strtok(NULL, ":");
+
+    if (!id_text)
+        return NULL;
+    id = strtol(id_text, &end, 10);
+    if (*end != '\0' || id < 0 || id > 252)
+        return NULL;
+    if (model_text && parse_model(model_text, &model))
+        return NULL;
+    if (baud_rate_text)
+    {
+        baud_rate = strtoul(baud_rate_text, &end, 10);
+        if (*end != '\0')
+            return NULL;
+    }
+    if (get_baud_rate_byte(baud_rate, &baud_rate_byte))
+        return NULL;
+
+    servo = virtual_servo_create_with_model(id, model, VIRTUAL_SERVO_FIRMWARE_VERSION_DEFAULT);
+    if (!servo)
+        return NULL;
+
+    baud_rate_value = baud_rate_byte;
+    virtual_servo_write_table(servo, 8, 1, &baud_rate_value);
+    virtual_servo_set_return_delay_time_us(servo, return_delay_time_us);
+    if (dynamics)
+        virtual_servo_enable_dynamics(servo, NULL);
+
+    return servo;
+}
+
+
+/**
+ * @brief ptyの先で仮想Dynamixelを動かす
+ *
+ * 起動するとslaveのパスを標準出力に1行で出力する。SIGINT、SIGTERMで終了し、送受信の統計を標準エラー出力に出力する
+*/
+int main(
+    int argc,
+    char *argv[]
+)
+{
+    uint baud_rate = 57600;
+    uint return_delay_time_us = 500;
+    bool dynamics = false;
+    virtual_servo_t servo[VIRTUAL_BUS_MAX_SERVO_NUM];
+    size_t servo_num = 0;
+    virtual_bus_t bus;
+    virtual_pty_t pty;
+    virtual_bus_statistics statistics;
+    int option, result = 0;
+
+    while ((option = getopt(argc, argv, "b:r:dh")) != -1)
+    {
+        switch (option)
+        {
+        case 'b':
+            baud_rate = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            return_delay_time_us = strtoul(optarg, NULL, 10);
+            break;
+        case 'd':
+            dynamics = true;
+            break;
+        default:
+            print_usage(argv[0]);
+            return option == 'h' ? 0 : 2;
+        }
+    }
+
+    if (optind >= argc || argc - optind > VIRTUAL_BUS_MAX_SERVO_NUM)
+    {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    bus = virtual_bus_create(baud_rate);
+    if (!bus)
+    {
+        fprintf(stderr, "invalid baud rate: %u\n", baud_rate);
+        return 2;
+    }
+
+    for (int i = optind; i < argc; i++)
+    {
+        servo[servo_num] = create_servo(argv[i], baud_rate, return_delay_time_us, dynamics);
+        if (!servo[servo_num])
+        {
+            fprintf(stderr, "invalid servo: %s\n", argv[i]);
+            result = 2;
+            goto cleanup;
+        }
+        virtual_bus_add_servo(bus, servo[servo_num]);
+        servo_num++;
+    }
+
+    pty = virtual_pty_create(bus);
+    if (!pty)
+    {
+        perror("virtual_pty_create");
+        result = 1;
+        goto cleanup;
+    }
+
+    printf("%s\n", virtual_pty_get_slave_path(pty));
+    fflush(stdout);
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    while (running)
+    {
+        if (virtual_pty_run_once(pty, RUN_TIMEOUT_US))
+        {
+            perror("virtual_pty_run_once");
+            result = 1;
+            break;
+        }
+    }
+
+    virtual_bus_get_statistics(bus, &statistics);
+    fprintf(
+        stderr,
+        "instruction packets: %llu, status packets: %llu, dropped: %llu, collisions: %llu\n",
+        (unsigned long long)statistics.instruction_packets,
+        (unsigned long long)statistics.status_packets,
+        (unsigned long long)statistics.dropped_packets,
+        (unsigned long long)statistics.collisions
+    );
+    virtual_pty_destroy(pty);
+
+cleanup:
+    virtual_bus_destroy(bus);
+    for (size_t i = 0; i < servo_num; i++)
+        virtual_servo_destroy(servo[i]);
+
+    return result;
+}
@@ -0,0 +1,121 @@
+#include <math.h>
+#include "simulator/virtual_motor.h"
+
+
+/// この値より小さい減衰率は0として扱う[1/sec.]
+#define MIN_DECAY_RATE 1e-6f
+
+
+void virtual_motor_init(
+    virtual_motor_state *state,
+    const virtual_motor_parameter *parameter,
+    float position
+)
+{
+    state->position = position;
+    state->velocity = 0;
+    state->current = 0;
+    state->temperature = parameter->ambient_temperature;
+}
+
+
+static float clamp(
+    float value,
+    float limit
+)
+{
+    if (value > limit)
+        return limit;
+    if (value < -limit)
+        return -limit;
+    return value;
+}
+
+
+static float get_current(
+    const virtual_motor_state *state,
+    const virtual_motor_parameter *parameter,
+    float voltage
+)
+{
+    float motor_velocity = state->velocity * parameter->gear_ratio;
+
+    return (voltage - parameter->back_emf_constant * motor_velocity) / parameter->resistance;
+}
+
+
+void virtual_motor_step(
+    virtual_motor_state *state,
+    const virtual_motor_parameter *parameter,
+    float voltage,
+    float current_limit,
+    float dt
+)
+{
+    float gear_ratio = parameter->gear_ratio;
+    // 出力軸から見た慣性モーメント
+    float inertia = parameter->rotor_inertia * gear_ratio * gear_ratio;
+    float current, acceleration, decay_rate, steady_velocity, decay;
+    float copper_loss, steady_temperature;
+
+    voltage = clamp(voltage, parameter->supply_voltage);
+    current = get_current(state, parameter, voltage);
+
+    // 角速度の微分方程式をdω/dt = acceleration - decay_rate * ωの形にする
+    if (current_limit > 0 && fabsf(current) > current_limit)
+    {
+        current = clamp(current, current_limit);
+        acceleration = parameter->torque_constant * gear_ratio * current / inertia;
+        decay_rate = parameter->viscous_friction / inertia;
+    }
+    else
+    {
+        acceleration = parameter->torque_constant * gear_ratio * voltage
+            / parameter->resistance / inertia;
+        decay_rate = (
+            parameter->torque_constant * parameter->back_emf_constant * gear_ratio * gear_ratio
+                / parameter->resistance
+            + parameter->viscous_friction
+        ) / inertia;
+    }
+    acceleration -= parameter->load_torque / inertia;
+
+    if (decay_rate < MIN_DECAY_RATE)
+    {
+        state->position += state->velocity * dt + acceleration * dt * dt / 2;
+        state->velocity += acceleration * dt;
+    }
+    else
+    {
+        steady_velocity = acceleration / decay_rate;
+        decay = expf(-decay_rate * dt);
+        state->position += steady_velocity * dt
+            + (state->velocity - steady_velocity) * (1 - decay) / decay_rate;
+        state->velocity = steady_velocity + (state->velocity - steady_velocity) * decay;
+    }
+
+    state->current = get_current(state, parameter, voltage);
+    if (current_limit > 0)
+        state->current = clamp(state->current, current_limit);
+
+    // 銅損による発熱と周囲への放熱(1次遅れ)
+    copper_loss = state->current * state->current * parameter->resistance;
+    steady_temperature = parameter->ambient_temperature + copper_loss * parameter->thermal_resistance;
+    state->temperature = steady_temperature
+        + (state->temperature - steady_temperature) * expf(-dt / parameter->thermal_time_constant);
+}
+
+
+float virtual_motor_get_voltage_for_current(
+    const virtual_motor_state *state,
+    const virtual_motor_parameter *parameter,
+    float current
+)
+{
+    float motor_velocity = state->velocity * parameter->gear_ratio;
+
+    return clamp(
+        current * parameter->resistance + parameter->back_emf_constant * motor_velocity,
+        parameter->supply_voltage
+    );
+}
@@ -0,0 +1,263 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+// glibcの<termios.h>とは同時に読み込めないため、termios2はカーネルのヘッダーから読み込む
+#include <asm/termbits.h>
+#include "simulator/virtual_pty.h"
+
+
+/// 1回に読み書きするデータサイズ
+#define PTY_BUFFER_SIZE 4096
+/// slaveのパスの最大サイズ
+#define MAX_SLAVE_PATH_SIZE 256
+
+
+typedef struct virtual_pty_struct
+{
+    virtual_bus_t bus;
+    dynamixel_transport transport;
+    int master_fd;
+    // ホストがslaveを閉じてもmasterの読み込みがEIOにならないように、slaveを開いたままにする
+    int slave_fd;
+    char slave_path[MAX_SLAVE_PATH_SIZE];
+    // 仮想時間と実時間の対応
+    uint64_t start_real_us;
+    uint64_t start_bus_us;
+    // 届く時刻になったが、まだmasterに書き込めていないデータ
+    uint8_t pending[PTY_BUFFER_SIZE];
+    size_t pending_size;
+} virtual_pty_struct;
+
+
+static uint64_t get_real_time_us()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+/// slaveをrawモード、指定したボーレートにする
+static int apply_termios(
+    int fd,
+    uint baud_rate
+)
+{
+    struct termios2 tio;
+
+    if (ioctl(fd, TCGETS2, &tio) < 0)
+        return 1;
+
+    tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+    tio.c_oflag &= ~OPOST;
+    tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS | CBAUD);
+    tio.c_cflag |= CS8 | CREAD | CLOCAL | BOTHER;
+    tio.c_ispeed = baud_rate;
+    tio.c_ospeed = baud_rate;
+
+    return ioctl(fd, TCSETS2, &tio) < 0;
+}
+
+
+virtual_pty_t virtual_pty_create(
+    virtual_bus_t bus
+)
+{
+    const char *slave_path;
+
+    virtual_pty_t self = calloc(1, sizeof(virtual_pty_struct));
+    if (!self)
+        return NULL;
+
+    self->bus = bus;
+    virtual_bus_init_transport(bus, &self->transport);
+    self->slave_fd = -1;
+
+    self->master_fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (self->master_fd < 0)
+        goto fail;
+    if (grantpt(self->master_fd) != 0 || unlockpt(self->master_fd) != 0)
+        goto fail;
+
+    slave_path = ptsname(self->master_fd);
+    if (!slave_path || strlen(slave_path) >= MAX_SLAVE_PATH_SIZE)
+        goto fail;
+    strcpy(self->slave_path, slave_path);
+
+    self->slave_fd = open(self->slave_path, O_RDWR | O_NOCTTY);
+    if (self->slave_fd < 0)
+        goto fail;
+    if (apply_termios(self->slave_fd, virtual_bus_get_baud_rate(bus)))
+        goto fail;
+
+    self->start_real_us = get_real_time_us();
+    self->start_bus_us = virtual_bus_get_time_us(bus);
+
+    return self;
+
+fail:
+    virtual_pty_destroy(self);
+    return NULL;
+}
+
+
+void virtual_pty_destroy(
+    virtual_pty_t self
+)
+{
+    if (self->slave_fd >= 0)
+        close(self->slave_fd);
+    if (self->master_fd >= 0)
+        close(self->master_fd);
+    free(self);
+}
+
+
+const char *virtual_pty_get_slave_path(
+    virtual_pty_t self
+)
+{
+    return self->slave_path;
+}
+
+
+/// 仮想時間を実時間まで進める
+static void sync_time(
+    virtual_pty_t self
+)
+{
+    uint64_t target_us = self->start_bus_us + (get_real_time_us() - self->start_real_us);
+    uint64_t now_us = virtual_bus_get_time_us(self->bus);
+
+    if (now_us < target_us)
+        virtual_bus_advance_us(self->bus, target_us - now_us);
+}
+
+
+/// slaveで設定されたボーレートを仮想バスに反映する
+static void sync_baud_rate(
+    virtual_pty_t self
+)
+{
+    struct termios2 tio;
+
+    if (ioctl(self->master_fd, TCGETS2, &tio) < 0 || tio.c_ospeed == 0)
+        return;
+
+    if (tio.c_ospeed != virtual_bus_get_baud_rate(self->bus))
+        self->transport.set_baud(self->transport.context, tio.c_ospeed);
+}
+
+
+/**
+ * @brief masterから受信したデータを仮想バスに送信する
+ *
+ * 受信したデータはslaveに設定されたボーレートで送られたものとする
+ * @retval 0 受信した(データがない場合を含む)
+ * @retval 1 受信に失敗した
+*/
+static int receive_input(
+    virtual_pty_t self
+)
+{
+    uint8_t buffer[PTY_BUFFER_SIZE];
+    ssize_t read_size;
+
+    sync_baud_rate(self);
+    while (true)
+    {
+        read_size = read(self->master_fd, buffer, sizeof(buffer));
+        if (read_size < 0 && errno == EINTR)
+            continue;
+        if (read_size < 0)
+            return errno != EAGAIN && errno != EWOULDBLOCK;
+        if (read_size == 0)
+            return 0;
+
+        self->transport.write_async(self->transport.context, buffer, read_size);
+    }
+}
+
+
+/**
+ * @brief 届く時刻になった応答パケットのデータをmasterに書き込む
+ *
+ * @retval 0 書き込んだ(書き込みきれなかったデータは次回に書き込む)
+ * @retval 1 書き込みに失敗した
+*/
+static int send_output(
+    virtual_pty_t self
+)
+{
+    ssize_t write_size;
+
+    self->pending_size += self->transport.read_available(
+        self->transport.context,
+        self->pending + self->pending_size,
+        PTY_BUFFER_SIZE - self->pending_size
+    );
+
+    while (self->pending_size > 0)
+    {
+        write_size = write(self->master_fd, self->pending, self->pending_size);
+        if (write_size < 0 && errno == EINTR)
+            continue;
+        if (write_size < 0)
+            return errno != EAGAIN && errno != EWOULDBLOCK;
+
+        memmove(self->pending, self->pending + write_size, self->pending_size - write_size);
+        self->pending_size -= write_size;
+    }
+
+    return 0;
+}
+
+
+int virtual_pty_run_once(
+    virtual_pty_t self,
+    uint timeout_us
+)
+{
+    struct pollfd pfd;
+    struct timespec timeout;
+    uint64_t now_us, arrival_us;
+
+    sync_time(self);
+    if (receive_input(self) || send_output(self))
+        return 1;
+
+    // 次の応答パケットのデータが届く時刻までは待たない
+    now_us = virtual_bus_get_time_us(self->bus);
+    if (virtual_bus_get_next_arrival_us(self->bus, &arrival_us) == 0)
+    {
+        if (arrival_us <= now_us)
+            timeout_us = 0;
+        else if (arrival_us - now_us < timeout_us)
+            timeout_us = arrival_us - now_us;
+    }
+
+    pfd.fd = self->master_fd;
+    pfd.events = POLLIN;
+    // masterに書き込めなかったデータがある場合は、書き込めるようになるまで待つ
+    if (self->pending_size > 0)
+        pfd.events |= POLLOUT;
+    timeout.tv_sec = timeout_us / 1000000;
+    timeout.tv_nsec = (timeout_us % 1000000) * 1000;
+
+    if (ppoll(&pfd, 1, &timeout, NULL) < 0 && errno != EINTR)
+        return 1;
+
+    sync_time(self);
+    if (receive_input(self) || send_output(self))
+        return 1;
+
+    return 0;
+}
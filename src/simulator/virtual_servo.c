@@ -0,0 +1,1393 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simulator/virtual_servo.h"
+#include "util/analyze_packet.h"
+#include "util/packet_byte.h"
+
+
+/// ブロードキャストID
+#define BROADCAST_ID 0xfe
+/// Secondary IDを使わないときの値
+#define SECONDARY_ID_NONE 0xff
+
+// コントロールテーブルのアドレス
+#define ADDRESS_MODEL_NUMBER 0
+#define ADDRESS_FIRMWARE_VERSION 6
+#define ADDRESS_ID 7
+#define ADDRESS_BAUD_RATE 8
+#define ADDRESS_RETURN_DELAY_TIME 9
+#define ADDRESS_OPERATING_MODE 11
+#define ADDRESS_SECONDARY_ID 12
+#define ADDRESS_HOMING_OFFSET 20
+#define ADDRESS_MOVING_THRESHOLD 24
+#define ADDRESS_TEMPERATURE_LIMIT 31
+#define ADDRESS_PWM_LIMIT 36
+#define ADDRESS_CURRENT_LIMIT 38
+#define ADDRESS_VELOCITY_LIMIT 44
+#define ADDRESS_MAX_POSITION_LIMIT 48
+#define ADDRESS_MIN_POSITION_LIMIT 52
+#define ADDRESS_SHUTDOWN 63
+#define ADDRESS_TORQUE_ENABLE 64
+#define ADDRESS_STATUS_RETURN_LEVEL 68
+#define ADDRESS_REGISTERED_INSTRUCTION 69
+#define ADDRESS_HARDWARE_ERROR_STATUS 70
+#define ADDRESS_VELOCITY_I_GAIN 76
+#define ADDRESS_VELOCITY_P_GAIN 78
+#define ADDRESS_POSITION_D_GAIN 80
+#define ADDRESS_POSITION_I_GAIN 82
+#define ADDRESS_POSITION_P_GAIN 84
+#define ADDRESS_GOAL_PWM 100
+#define ADDRESS_GOAL_CURRENT 102
+#define ADDRESS_GOAL_VELOCITY 104
+#define ADDRESS_PROFILE_ACCELERATION 108
+#define ADDRESS_PROFILE_VELOCITY 112
+#define ADDRESS_GOAL_POSITION 116
+#define ADDRESS_REALTIME_TICK 120
+#define ADDRESS_MOVING 122
+#define ADDRESS_MOVING_STATUS 123
+#define ADDRESS_PRESENT_PWM 124
+#define ADDRESS_PRESENT_CURRENT 126
+#define ADDRESS_PRESENT_VELOCITY 128
+#define ADDRESS_PRESENT_POSITION 132
+#define ADDRESS_VELOCITY_TRAJECTORY 136
+#define ADDRESS_POSITION_TRAJECTORY 140
+#define ADDRESS_PRESENT_INPUT_VOLTAGE 144
+#define ADDRESS_PRESENT_TEMPERATURE 146
+#define ADDRESS_INDIRECT_ADDRESS 168
+#define ADDRESS_INDIRECT_DATA 208
+#define INDIRECT_NUM 20
+
+/// Return Delay Timeの単位[micro sec.]
+#define RETURN_DELAY_TIME_UNIT_US 2
+/// Return Delay Timeの最大値(コントロールテーブルの値)
+#define RETURN_DELAY_TIME_MAX 254
+/// Realtime Tickの周期[milli sec.]
+#define REALTIME_TICK_PERIOD_MS 32768
+/// 拡張位置制御モードで指定できる位置の範囲
+#define EXTENDED_POSITION_LIMIT 1048575
+
+/// 動力学モデルの制御周期[micro sec.]
+#define CONTROL_PERIOD_US 1000
+/// PWMの最大値(100%)
+#define PWM_MAX 885.0f
+/// 1回転あたりの位置の値
+#define PULSE_PER_REVOLUTION 4096.0f
+/// 1 radあたりの位置の値
+#define PULSE_PER_RADIAN (PULSE_PER_REVOLUTION / (2 * 3.14159265f))
+/// 速度の単位[pulse/sec.](0.229 rpm)
+#define VELOCITY_UNIT (0.229f * PULSE_PER_REVOLUTION / 60)
+/// 加速度の単位[pulse/sec.^2](214.577 rev/min^2)
+#define ACCELERATION_UNIT (214.577f * PULSE_PER_REVOLUTION / 3600)
+/// 位置ゲインの係数(KPP = Position P Gain / 128など)
+#define POSITION_P_GAIN_SCALE 128.0f
+#define POSITION_I_GAIN_SCALE 65536.0f
+#define POSITION_D_GAIN_SCALE 16.0f
+/// 速度ゲインの係数(KVP = Velocity P Gain / 128など)
+#define VELOCITY_P_GAIN_SCALE 128.0f
+#define VELOCITY_I_GAIN_SCALE 65536.0f
+/// Hardware Error Statusの過熱のビット
+#define HARDWARE_ERROR_OVERHEATING 0x04
+/// 応答パケットのエラーで、ハードウェアエラーが起きていることを示すビット
+#define ERROR_ALERT 0x80
+
+
+/**
+ * @brief コントロールテーブルの1項目
+ *
+ * min < 0の項目は符号付きの値として扱う
+*/
+typedef struct
+{
+    uint16_t address;
+    uint8_t size;
+    bool writable;
+    bool eeprom;
+    int32_t initial;
+    int32_t min;
+    int32_t max;
+} control_table_item;
+
+
+// XL330-M288のコントロールテーブル(Indirect Address、Indirect Dataは別に扱う)
+static const control_table_item CONTROL_TABLE[] = {
+    // EEPROM
+    {0, 2, false, true, VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288, 0, 0},  // Model Number
+    {2, 4, false, true, 0, 0, 0},  // Model Information
+    {6, 1, false, true, VIRTUAL_SERVO_FIRMWARE_VERSION_DEFAULT, 0, 0},  // Firmware Version
+    {7, 1, true, true, 1, 0, 252},  // ID
+    {8, 1, true, true, DYNAMIXEL_BAUD_RATE_57600, 0, 6},  // Baud Rate
+    {9, 1, true, true, 250, 0, RETURN_DELAY_TIME_MAX},  // Return Delay Time
+    {10, 1, true, true, 0, 0, 13},  // Drive Mode
+    {11, 1, true, true, DYNAMIXEL_OPERATING_MODE_POSITION_CONTROL, 0, 16},  // Operating Mode
+    {12, 1, true, true, SECONDARY_ID_NONE, 0, 255},  // Secondary(Shadow) ID
+    {13, 1, true, true, 2, 1, 2},  // Protocol Type
+    {20, 4, true, true, 0, -1044479, 1044479},  // Homing Offset
+    {24, 4, true, true, 10, 0, 1023},  // Moving Threshold
+    {31, 1, true, true, 70, 0, 100},  // Temperature Limit
+    {32, 2, true, true, 70, 31, 70},  // Max Voltage Limit
+    {34, 2, true, true, 35, 31, 70},  // Min Voltage Limit
+    {36, 2, true, true, 885, 0, 885},  // PWM Limit
+    {38, 2, true, true, 1750, 0, 1750},  // Current Limit
+    {44, 4, true, true, 445, 0, 2047},  // Velocity Limit
+    {48, 4, true, true, 4095, 0, 4095},  // Max Position Limit
+    {52, 4, true, true, 0, 0, 4095},  // Min Position Limit
+    {60, 1, true, true, 0, 0, 3},  // Startup Configuration
+    {62, 1, true, true, 140, 1, 255},  // PWM Slope
+    {63, 1, true, true, 53, 0, 255},  // Shutdown
+    // RAM
+    {64, 1, true, false, 0, 0, 1},  // Torque Enable
+    {65, 1, true, false, 0, 0, 1},  // LED
+    {68, 1, true, false, 2, 0, 2},  // Status Return Level
+    {69, 1, false, false, 0, 0, 0},  // Registered Instruction
+    {70, 1, false, false, 0, 0, 0},  // Hardware Error Status
+    {76, 2, true, false, 1000, 0, 16383},  // Velocity I Gain
+    {78, 2, true, false, 100, 0, 16383},  // Velocity P Gain
+    {80, 2, true, false, 0, 0, 16383},  // Position D Gain
+    {82, 2, true, false, 0, 0, 16383},  // Position I Gain
+    {84, 2, true, false, 400, 0, 16383},  // Position P Gain
+    {88, 2, true, false, 0, 0, 16383},  // Feedforward 2nd Gain
+    {90, 2, true, false, 0, 0, 16383},  // Feedforward 1st Gain
+    {98, 1, true, false, 0, 0, 127},  // Bus Watchdog
+    {100, 2, true, false, 0, -885, 885},  // Goal PWM
+    {102, 2, true, false, 0, -1750, 1750},  // Goal Current
+    {104, 4, true, false, 0, -2047, 2047},  // Goal Velocity
+    {108, 4, true, false, 0, 0, 32767},  // Profile Acceleration
+    {112, 4, true, false, 0, 0, 32767},  // Profile Velocity
+    {116, 4, true, false, 0, -EXTENDED_POSITION_LIMIT, EXTENDED_POSITION_LIMIT},  // Goal Position
+    {120, 2, false, false, 0, 0, 0},  // Realtime Tick
+    {122, 1, false, false, 0, 0, 0},  // Moving
+    {123, 1, false, false, 0, 0, 0},  // Moving Status
+    {124, 2, false, false, 0, -885, 885},  // Present PWM
+    {126, 2, false, false, 0, -1750, 1750},  // Present Current
+    {128, 4, false, false, 0, 0, 0},  // Present Velocity
+    {132, 4, false, false, 2048, 0, 0},  // Present Position
+    {136, 4, false, false, 0, 0, 0},  // Velocity Trajectory
+    {140, 4, false, false, 0, 0, 0},  // Position Trajectory
+    {144, 2, false, false, 50, 0, 0},  // Present Input Voltage
+    {146, 1, false, false, 28, 0, 0},  // Present Temperature
+    {147, 1, false, false, 0, 0, 0},  // Backup Ready
+};
+#define CONTROL_TABLE_ITEM_NUM (sizeof(CONTROL_TABLE) / sizeof(CONTROL_TABLE[0]))
+
+
+/**
+ * @brief モデルごとに異なる値
+ *
+ * current_limitが0のモデルは電流を制御できない(電流制御モード、電流ベース位置制御モードを使えない)。
+ * これらのモデルでは、Present Current(126)は停動電流に対する割合(Present Load、0.1%単位)になる
+*/
+typedef struct
+{
+    uint16_t model_number;
+    int32_t pwm_limit;
+    int32_t current_limit;
+    int32_t velocity_limit;
+    /// 電流の単位[mA]
+    float current_unit_ma;
+    virtual_motor_parameter motor;
+} model_spec;
+
+
+// モーターの定数(出力軸の定数を減速比で割ってモーター軸の値にする)
+// XL330-M288: 0.52 N m、1.47 A、103 rpm(5.0 V)、減速比288.35
+// XL430-W250: 1.5 N m、1.4 A、61 rpm(12.0 V)、減速比258.5
+// XM430-W350: 4.1 N m、2.3 A、46 rpm(12.0 V)、減速比353.5
+static const model_spec MODEL_SPEC[] = {
+    [VIRTUAL_SERVO_MODEL_XL330_M288] = {
+        VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288, 885, 1750, 445, 1.0f,
+        {3.40f, 0.354f / 288.35f, 0.463f / 288.35f, 1e-8f, 288.35f, 0.001f, 0, 5.0f, 20, 60, 28},
+    },
+    [VIRTUAL_SERVO_MODEL_XL430_W250] = {
+        VIRTUAL_SERVO_MODEL_NUMBER_XL430_W250, 885, 0, 265, 0,
+        {8.57f, 1.07f / 258.5f, 1.88f / 258.5f, 2e-8f, 258.5f, 0.002f, 0, 12.0f, 15, 90, 28},
+    },
+    [VIRTUAL_SERVO_MODEL_XM430_W350] = {
+        VIRTUAL_SERVO_MODEL_NUMBER_XM430_W350, 885, 1193, 167, 2.69f,
+        {5.22f, 1.78f / 353.5f, 2.49f / 353.5f, 3e-8f, 353.5f, 0.004f, 0, 12.0f, 10, 120, 28},
+    },
+};
+#define MODEL_NUM (sizeof(MODEL_SPEC) / sizeof(MODEL_SPEC[0]))
+
+
+typedef struct virtual_servo_struct
+{
+    const model_spec *spec;
+    uint8_t firmware_version;
+    uint8_t table[VIRTUAL_SERVO_CONTROL_TABLE_SIZE];
+    // REG_WRITEで登録した書き込み(ACTIONで反映する)
+    uint16_t registered_address;
+    uint16_t registered_size;
+    uint8_t registered_data[VIRTUAL_SERVO_CONTROL_TABLE_SIZE];
+    // 動力学モデル
+    bool dynamics_enabled;
+    // 最後に制御した時刻(started == falseのときは未定)
+    bool started;
+    uint64_t control_time_us;
+    virtual_motor_parameter motor_parameter;
+    virtual_motor_state motor;
+    float pwm;
+    // プロファイルで作った目標軌道[pulse]、[pulse/sec.]
+    float trajectory_position;
+    float trajectory_velocity;
+    // PID制御の積分値と前回の偏差
+    float position_integral;
+    float previous_position_error;
+    float velocity_integral;
+} virtual_servo_struct;
+
+
+static void reset_table(
+    virtual_servo_t self,
+    bool reset_eeprom,
+    bool keep_id,
+    bool keep_baud_rate
+);
+static void write_present_value(
+    virtual_servo_t self
+);
+
+
+virtual_servo_t virtual_servo_create(
+    uint8_t id
+)
+{
+    return virtual_servo_create_with_model(
+        id, VIRTUAL_SERVO_MODEL_XL330_M288, VIRTUAL_SERVO_FIRMWARE_VERSION_DEFAULT
+    );
+}
+
+
+virtual_servo_t virtual_servo_create_with_model(
+    uint8_t id,
+    virtual_servo_model model,
+    uint8_t firmware_version
+)
+{
+    if (id > 252 || (size_t)model >= MODEL_NUM)
+        return NULL;
+
+    virtual_servo_t self = calloc(1, sizeof(virtual_servo_struct));
+    if (!self)
+        return NULL;
+
+    self->spec = MODEL_SPEC + model;
+    self->firmware_version = firmware_version;
+    reset_table(self, true, false, false);
+    self->table[ADDRESS_ID] = id;
+
+    return self;
+}
+
+
+void virtual_servo_destroy(
+    virtual_servo_t self
+)
+{
+    free(self);
+}
+
+
+static const control_table_item *find_item(
+    uint16_t address
+)
+{
+    for (size_t i = 0; i < CONTROL_TABLE_ITEM_NUM; i++)
+    {
+        if (
+            CONTROL_TABLE[i].address <= address
+            && address < CONTROL_TABLE[i].address + CONTROL_TABLE[i].size
+        )
+            return CONTROL_TABLE + i;
+    }
+
+    return NULL;
+}
+
+
+static void set_value(
+    virtual_servo_t self,
+    uint16_t address,
+    uint8_t size,
+    int32_t value
+)
+{
+    uint8_t byte[4];
+
+    divide_into_4_byte(value, byte, byte + 1, byte + 2, byte + 3);
+    memcpy(self->table + address, byte, size);
+}
+
+
+static int32_t get_value(
+    virtual_servo_t self,
+    uint16_t address,
+    uint8_t size,
+    bool is_signed
+)
+{
+    const uint8_t *byte = self->table + address;
+
+    if (size == 4)
+        return combine_signed_4_byte(byte[0], byte[1], byte[2], byte[3]);
+    if (size == 2)
+        return is_signed
+            ? combine_signed_2_byte(byte[0], byte[1])
+            : combine_byte_pair(byte[0], byte[1]);
+
+    return byte[0];
+}
+
+
+/**
+ * @brief コントロールテーブルを初期値に戻す
+ *
+ * reset_eepromがfalseのときはRAM領域のみを戻す(再起動と同じ)
+*/
+static void reset_table(
+    virtual_servo_t self,
+    bool reset_eeprom,
+    bool keep_id,
+    bool keep_baud_rate
+)
+{
+    uint8_t id = self->table[ADDRESS_ID];
+    uint8_t baud_rate = self->table[ADDRESS_BAUD_RATE];
+
+    for (size_t i = 0; i < CONTROL_TABLE_ITEM_NUM; i++)
+    {
+        const control_table_item *item = CONTROL_TABLE + i;
+        if (item->eeprom && !reset_eeprom)
+            continue;
+
+        set_value(self, item->address, item->size, item->initial);
+    }
+
+    if (reset_eeprom)
+    {
+        set_value(self, ADDRESS_MODEL_NUMBER, 2, self->spec->model_number);
+        self->table[ADDRESS_FIRMWARE_VERSION] = self->firmware_version;
+        set_value(self, ADDRESS_PWM_LIMIT, 2, self->spec->pwm_limit);
+        set_value(self, ADDRESS_CURRENT_LIMIT, 2, self->spec->current_limit);
+        set_value(self, ADDRESS_VELOCITY_LIMIT, 4, self->spec->velocity_limit);
+    }
+
+    for (size_t i = 0; i < INDIRECT_NUM; i++)
+    {
+        // 初期値ではIndirect Dataそのものを指す(他のアドレスと対応付けない)
+        if (reset_eeprom)
+            set_value(self, ADDRESS_INDIRECT_ADDRESS + 2 * i, 2, ADDRESS_INDIRECT_DATA + i);
+        self->table[ADDRESS_INDIRECT_DATA + i] = 0;
+    }
+
+    if (keep_id)
+        self->table[ADDRESS_ID] = id;
+    if (keep_baud_rate)
+        self->table[ADDRESS_BAUD_RATE] = baud_rate;
+
+    self->registered_size = 0;
+
+    // モーターの状態は初期値に戻らない
+    if (self->dynamics_enabled)
+        write_present_value(self);
+}
+
+
+uint8_t virtual_servo_get_id(
+    virtual_servo_t self
+)
+{
+    return self->table[ADDRESS_ID];
+}
+
+
+uint16_t virtual_servo_get_model_number(
+    virtual_servo_t self
+)
+{
+    return self->spec->model_number;
+}
+
+
+uint virtual_servo_get_baud_rate(
+    virtual_servo_t self
+)
+{
+    return get_baud_rate(self->table[ADDRESS_BAUD_RATE]);
+}
+
+
+uint virtual_servo_get_return_delay_time_us(
+    virtual_servo_t self
+)
+{
+    return self->table[ADDRESS_RETURN_DELAY_TIME] * RETURN_DELAY_TIME_UNIT_US;
+}
+
+
+void virtual_servo_set_return_delay_time_us(
+    virtual_servo_t self,
+    uint return_delay_time_us
+)
+{
+    uint return_delay_time = return_delay_time_us / RETURN_DELAY_TIME_UNIT_US;
+
+    if (return_delay_time > RETURN_DELAY_TIME_MAX)
+        return_delay_time = RETURN_DELAY_TIME_MAX;
+
+    self->table[ADDRESS_RETURN_DELAY_TIME] = return_delay_time;
+}
+
+
+int virtual_servo_read_table(
+    virtual_servo_t self,
+    uint16_t address,
+    uint16_t size,
+    uint8_t *data
+)
+{
+    if (address + size > VIRTUAL_SERVO_CONTROL_TABLE_SIZE)
+        return 1;
+
+    memcpy(data, self->table + address, size);
+    return 0;
+}
+
+
+int virtual_servo_write_table(
+    virtual_servo_t self,
+    uint16_t address,
+    uint16_t size,
+    const uint8_t *data
+)
+{
+    if (address + size > VIRTUAL_SERVO_CONTROL_TABLE_SIZE)
+        return 1;
+
+    memcpy(self->table + address, data, size);
+    return 0;
+}
+
+
+int virtual_servo_get_default_motor_parameter(
+    virtual_servo_model model,
+    virtual_motor_parameter *parameter
+)
+{
+    if ((size_t)model >= MODEL_NUM)
+        return 1;
+
+    *parameter = MODEL_SPEC[model].motor;
+    return 0;
+}
+
+
+/// 制御の状態を現在の位置で止まっている状態にする
+static void reset_control(
+    virtual_servo_t self,
+    float position
+)
+{
+    self->trajectory_position = position;
+    self->trajectory_velocity = 0;
+    self->position_integral = 0;
+    self->previous_position_error = 0;
+    self->velocity_integral = 0;
+}
+
+
+/// 出力軸の角度[rad]をPresent Position[pulse]に変換する
+static float get_present_position(
+    virtual_servo_t self
+)
+{
+    return self->motor.position * PULSE_PER_RADIAN
+        + get_value(self, ADDRESS_HOMING_OFFSET, 4, true);
+}
+
+
+void virtual_servo_enable_dynamics(
+    virtual_servo_t self,
+    const virtual_motor_parameter *parameter
+)
+{
+    int32_t position = get_value(self, ADDRESS_PRESENT_POSITION, 4, true)
+        - get_value(self, ADDRESS_HOMING_OFFSET, 4, true);
+
+    self->motor_parameter = parameter ? *parameter : self->spec->motor;
+    virtual_motor_init(
+        &self->motor, &self->motor_parameter,
+        position / PULSE_PER_RADIAN
+    );
+    self->pwm = 0;
+    self->started = false;
+    self->dynamics_enabled = true;
+    reset_control(self, get_present_position(self));
+    write_present_value(self);
+}
+
+
+void virtual_servo_disable_dynamics(
+    virtual_servo_t self
+)
+{
+    self->dynamics_enabled = false;
+}
+
+
+/// valueをtargetに向けて最大stepだけ近づける
+static float approach(
+    float value,
+    float target,
+    float step
+)
+{
+    if (value < target)
+        return fminf(value + step, target);
+
+    return fmaxf(value - step, target);
+}
+
+
+static float clamp(
+    float value,
+    float limit
+)
+{
+    return fminf(fmaxf(value, -limit), limit);
+}
+
+
+/**
+ * @brief 台形の速度プロファイルで、目標位置に向かう軌道を1周期進める
+ *
+ * Profile Velocity、Profile Accelerationが0のときは制限しない(両方0のときは目標位置に直ちに移る)
+*/
+static void update_position_profile(
+    virtual_servo_t self,
+    float goal_position,
+    float dt
+)
+{
+    float max_velocity = get_value(self, ADDRESS_PROFILE_VELOCITY, 4, false) * VELOCITY_UNIT;
+    float acceleration = get_value(self, ADDRESS_PROFILE_ACCELERATION, 4, false) * ACCELERATION_UNIT;
+    float remaining = goal_position - self->trajectory_position;
+    float direction = remaining >= 0 ? 1.0f : -1.0f;
+    float target_velocity, next_position;
+
+    if (max_velocity == 0 && acceleration == 0)
+    {
+        self->trajectory_position = goal_position;
+        self->trajectory_velocity = 0;
+        return;
+    }
+
+    if (max_velocity == 0)
+        max_velocity = INFINITY;
+
+    // 目標位置で止まれる速度を超えないようにする
+    target_velocity = max_velocity;
+    if (acceleration > 0)
+        target_velocity = fminf(target_velocity, sqrtf(2 * acceleration * fabsf(remaining)));
+    target_velocity *= direction;
+
+    if (acceleration > 0)
+        self->trajectory_velocity = approach(self->trajectory_velocity, target_velocity, acceleration * dt);
+    else
+        self->trajectory_velocity = target_velocity;
+
+    next_position = self->trajectory_position + self->trajectory_velocity * dt;
+    if ((goal_position - next_position) * direction <= 0)
+    {
+        self->trajectory_position = goal_position;
+        self->trajectory_velocity = 0;
+    }
+    else
+    {
+        self->trajectory_position = next_position;
+    }
+}
+
+
+/// 目標速度に向かう速度の軌道を1周期進める(Profile Accelerationが0のときは直ちに目標速度にする)
+static void update_velocity_profile(
+    virtual_servo_t self,
+    float goal_velocity,
+    float dt
+)
+{
+    float acceleration = get_value(self, ADDRESS_PROFILE_ACCELERATION, 4, false) * ACCELERATION_UNIT;
+
+    if (acceleration > 0)
+        self->trajectory_velocity = approach(self->trajectory_velocity, goal_velocity, acceleration * dt);
+    else
+        self->trajectory_velocity = goal_velocity;
+}
+
+
+/// 位置のPID制御でPWMを求める(Feedforwardは模擬しない)
+static float control_position(
+    virtual_servo_t self,
+    float position,
+    float pwm_limit
+)
+{
+    float error = self->trajectory_position - position;
+    float i_gain = get_value(self, ADDRESS_POSITION_I_GAIN, 2, false) / POSITION_I_GAIN_SCALE;
+    float pwm;
+
+    self->position_integral += error;
+    if (i_gain > 0)
+        self->position_integral = clamp(self->position_integral, pwm_limit / i_gain);
+
+    pwm = get_value(self, ADDRESS_POSITION_P_GAIN, 2, false) / POSITION_P_GAIN_SCALE * error
+        + i_gain * self->position_integral
+        + get_value(self, ADDRESS_POSITION_D_GAIN, 2, false) / POSITION_D_GAIN_SCALE
+            * (error - self->previous_position_error);
+    self->previous_position_error = error;
+
+    return pwm;
+}
+
+
+/// 速度のPI制御でPWMを求める(偏差は速度の単位で計算する)
+static float control_velocity(
+    virtual_servo_t self,
+    float velocity,
+    float pwm_limit
+)
+{
+    float error = (self->trajectory_velocity - velocity) / VELOCITY_UNIT;
+    float i_gain = get_value(self, ADDRESS_VELOCITY_I_GAIN, 2, false) / VELOCITY_I_GAIN_SCALE;
+
+    self->velocity_integral += error;
+    if (i_gain > 0)
+        self->velocity_integral = clamp(self->velocity_integral, pwm_limit / i_gain);
+
+    return get_value(self, ADDRESS_VELOCITY_P_GAIN, 2, false) / VELOCITY_P_GAIN_SCALE * error
+        + i_gain * self->velocity_integral;
+}
+
+
+/// モーターの状態から、コントロールテーブルの現在値を更新する
+static void write_present_value(
+    virtual_servo_t self
+)
+{
+    float position = get_present_position(self);
+    float velocity = self->motor.velocity * PULSE_PER_RADIAN;
+    float current;
+    int32_t goal_position = get_value(self, ADDRESS_GOAL_POSITION, 4, true);
+    int32_t moving_threshold = get_value(self, ADDRESS_MOVING_THRESHOLD, 4, false);
+    uint8_t operating_mode = self->table[ADDRESS_OPERATING_MODE];
+    bool torque_enable = self->table[ADDRESS_TORQUE_ENABLE] != 0;
+    bool position_mode = operating_mode == DYNAMIXEL_OPERATING_MODE_POSITION_CONTROL
+        || operating_mode == DYNAMIXEL_OPERATING_MODE_EXTENDED_POSITION_CONTROL
+        || operating_mode == DYNAMIXEL_OPERATING_MODE_CURRENT_BASED_POSITION_CONTROL;
+    uint8_t moving_status = 0;
+
+    if (self->spec->current_unit_ma > 0)
+        current = self->motor.current * 1000 / self->spec->current_unit_ma;
+    else
+        current = self->motor.current * self->motor_parameter.resistance
+            / self->motor_parameter.supply_voltage * 1000;
+
+    set_value(self, ADDRESS_PRESENT_PWM, 2, lroundf(self->pwm));
+    set_value(self, ADDRESS_PRESENT_CURRENT, 2, lroundf(current));
+    set_value(self, ADDRESS_PRESENT_VELOCITY, 4, lroundf(velocity / VELOCITY_UNIT));
+    set_value(self, ADDRESS_PRESENT_POSITION, 4, lroundf(position));
+    set_value(self, ADDRESS_VELOCITY_TRAJECTORY, 4, lroundf(self->trajectory_velocity / VELOCITY_UNIT));
+    set_value(self, ADDRESS_POSITION_TRAJECTORY, 4, lroundf(self->trajectory_position));
+    set_value(self, ADDRESS_PRESENT_INPUT_VOLTAGE, 2, lroundf(self->motor_parameter.supply_voltage * 10));
+    self->table[ADDRESS_PRESENT_TEMPERATURE] = (uint8_t)fminf(fmaxf(roundf(self->motor.temperature), 0), 255);
+
+    self->table[ADDRESS_MOVING] = fabsf(velocity / VELOCITY_UNIT) > moving_threshold;
+
+    // Moving Status: bit 0 目標位置に到達、bit 1 プロファイルの実行中
+    if (torque_enable && position_mode)
+    {
+        if (fabsf(goal_position - position) <= moving_threshold)
+            moving_status |= 0x01;
+        if (self->trajectory_position != goal_position)
+            moving_status |= 0x02;
+    }
+    self->table[ADDRESS_MOVING_STATUS] = moving_status;
+}
+
+
+/// 制御周期1回分、目標値からPWMを決めてモーターを動かす
+static void control_step(
+    virtual_servo_t self
+)
+{
+    const float dt = CONTROL_PERIOD_US / 1e6f;
+    const virtual_motor_parameter *parameter = &self->motor_parameter;
+    uint8_t operating_mode = self->table[ADDRESS_OPERATING_MODE];
+    float current_unit = self->spec->current_unit_ma / 1000;
+    float pwm_limit = get_value(self, ADDRESS_PWM_LIMIT, 2, false);
+    float current_limit = get_value(self, ADDRESS_CURRENT_LIMIT, 2, false) * current_unit;
+    float position = get_present_position(self);
+    float velocity = self->motor.velocity * PULSE_PER_RADIAN;
+    float pwm = 0, goal_current;
+
+    // ハードウェアエラー中はトルクオンにできない
+    if (self->table[ADDRESS_HARDWARE_ERROR_STATUS] & self->table[ADDRESS_SHUTDOWN])
+        self->table[ADDRESS_TORQUE_ENABLE] = 0;
+
+    if (self->table[ADDRESS_TORQUE_ENABLE] == 0)
+    {
+        reset_control(self, position);
+    }
+    else
+    {
+        switch (operating_mode)
+        {
+        case DYNAMIXEL_OPERATING_MODE_PWM_CONTROL:
+            pwm = get_value(self, ADDRESS_GOAL_PWM, 2, true);
+            break;
+        case DYNAMIXEL_OPERATING_MODE_CURRENT_CONTROL:
+            // 電流制御は理想的に追従するとし、必要な電圧をそのまま加える
+            goal_current = get_value(self, ADDRESS_GOAL_CURRENT, 2, true) * current_unit;
+            pwm = virtual_motor_get_voltage_for_current(&self->motor, parameter, goal_current)
+                / parameter->supply_voltage * PWM_MAX;
+            break;
+        case DYNAMIXEL_OPERATING_MODE_VELOCITY_CONTROL:
+            update_velocity_profile(
+                self, get_value(self, ADDRESS_GOAL_VELOCITY, 4, true) * VELOCITY_UNIT, dt
+            );
+            pwm = control_velocity(self, velocity, pwm_limit);
+            break;
+        default:
+            update_position_profile(self, get_value(self, ADDRESS_GOAL_POSITION, 4, true), dt);
+            pwm = control_position(self, position, pwm_limit);
+            // 電流ベース位置制御では、Goal Currentで電流を制限する
+            if (operating_mode == DYNAMIXEL_OPERATING_MODE_CURRENT_BASED_POSITION_CONTROL)
+                current_limit = fminf(
+                    current_limit,
+                    fabsf(get_value(self, ADDRESS_GOAL_CURRENT, 2, true) * current_unit)
+                );
+            break;
+        }
+    }
+
+    self->pwm = clamp(pwm, pwm_limit);
+    virtual_motor_step(
+        &self->motor, parameter,
+        self->pwm / PWM_MAX * parameter->supply_voltage, current_limit, dt
+    );
+
+    if (self->motor.temperature >= self->table[ADDRESS_TEMPERATURE_LIMIT])
+        self->table[ADDRESS_HARDWARE_ERROR_STATUS] |= HARDWARE_ERROR_OVERHEATING;
+
+    write_present_value(self);
+}
+
+
+void virtual_servo_update(
+    virtual_servo_t self,
+    uint64_t now_us
+)
+{
+    set_value(
+        self, ADDRESS_REALTIME_TICK, 2,
+        (now_us / 1000) % REALTIME_TICK_PERIOD_MS
+    );
+
+    if (!self->dynamics_enabled)
+        return;
+
+    if (!self->started)
+    {
+        self->started = true;
+        self->control_time_us = now_us;
+        return;
+    }
+
+    while (self->control_time_us + CONTROL_PERIOD_US <= now_us)
+    {
+        control_step(self);
+        self->control_time_us += CONTROL_PERIOD_US;
+    }
+}
+
+
+/// Indirect Dataのアドレスを、対応付けられたアドレスに変換する
+static uint16_t resolve_indirect_address(
+    virtual_servo_t self,
+    uint16_t address
+)
+{
+    uint16_t target;
+
+    if (address < ADDRESS_INDIRECT_DATA || address >= ADDRESS_INDIRECT_DATA + INDIRECT_NUM)
+        return address;
+
+    target = combine_byte_pair(
+        self->table[ADDRESS_INDIRECT_ADDRESS + 2 * (address - ADDRESS_INDIRECT_DATA)],
+        self->table[ADDRESS_INDIRECT_ADDRESS + 2 * (address - ADDRESS_INDIRECT_DATA) + 1]
+    );
+    if (target >= VIRTUAL_SERVO_CONTROL_TABLE_SIZE)
+        return address;
+
+    return target;
+}
+
+
+static bool is_indirect_item(
+    uint16_t address
+)
+{
+    return ADDRESS_INDIRECT_ADDRESS <= address && address < ADDRESS_INDIRECT_DATA + INDIRECT_NUM;
+}
+
+
+static virtual_servo_error read_data(
+    virtual_servo_t self,
+    uint16_t address,
+    uint16_t size,
+    uint8_t *data
+)
+{
+    if (size == 0)
+        return VIRTUAL_SERVO_ERROR_DATA_LENGTH;
+    if (address + size > VIRTUAL_SERVO_CONTROL_TABLE_SIZE)
+        return VIRTUAL_SERVO_ERROR_ACCESS;
+
+    // 未定義のアドレスは0として読み込む
+    for (uint16_t i = 0; i < size; i++)
+        data[i] = self->table[resolve_indirect_address(self, address + i)];
+
+    return VIRTUAL_SERVO_ERROR_NONE;
+}
+
+
+/// 書き込む値が、他の項目で決まる制限を超えていないか
+static virtual_servo_error check_limit(
+    virtual_servo_t self,
+    uint16_t address,
+    int32_t value
+)
+{
+    int32_t limit, min_limit;
+
+    switch (address)
+    {
+    case ADDRESS_GOAL_PWM:
+        limit = get_value(self, ADDRESS_PWM_LIMIT, 2, false);
+        break;
+    case ADDRESS_GOAL_CURRENT:
+        limit = get_value(self, ADDRESS_CURRENT_LIMIT, 2, false);
+        break;
+    case ADDRESS_GOAL_VELOCITY:
+        limit = get_value(self, ADDRESS_VELOCITY_LIMIT, 4, false);
+        break;
+    case ADDRESS_GOAL_POSITION:
+        // 位置制御モード以外では拡張位置制御の範囲とする
+        if (self->table[ADDRESS_OPERATING_MODE] != DYNAMIXEL_OPERATING_MODE_POSITION_CONTROL)
+            return VIRTUAL_SERVO_ERROR_NONE;
+
+        min_limit = get_value(self, ADDRESS_MIN_POSITION_LIMIT, 4, false);
+        limit = get_value(self, ADDRESS_MAX_POSITION_LIMIT, 4, false);
+        if (value < min_limit || value > limit)
+            return VIRTUAL_SERVO_ERROR_DATA_LIMIT;
+        return VIRTUAL_SERVO_ERROR_NONE;
+    default:
+        return VIRTUAL_SERVO_ERROR_NONE;
+    }
+
+    if (value < -limit || value > limit)
+        return VIRTUAL_SERVO_ERROR_DATA_LIMIT;
+
+    return VIRTUAL_SERVO_ERROR_NONE;
+}
+
+
+/// 書き込む値がその項目で取りうる範囲か
+static virtual_servo_error check_range(
+    virtual_servo_t self,
+    const control_table_item *item,
+    int32_t value
+)
+{
+    int32_t max = item->max;
+
+    // 制限値の上限はモデルごとに異なる
+    if (item->address == ADDRESS_PWM_LIMIT)
+        max = self->spec->pwm_limit;
+    else if (item->address == ADDRESS_CURRENT_LIMIT)
+        max = self->spec->current_limit;
+    else if (item->address == ADDRESS_VELOCITY_LIMIT)
+        max = self->spec->velocity_limit;
+
+    if (value < item->min || value > max)
+        return VIRTUAL_SERVO_ERROR_DATA_RANGE;
+
+    if (
+        item->address == ADDRESS_OPERATING_MODE
+        && self->spec->current_limit == 0
+        && (
+            value == DYNAMIXEL_OPERATING_MODE_CURRENT_CONTROL
+            || value == DYNAMIXEL_OPERATING_MODE_CURRENT_BASED_POSITION_CONTROL
+        )
+    )
+        return VIRTUAL_SERVO_ERROR_DATA_RANGE;
+
+    if (
+        item->address == ADDRESS_OPERATING_MODE
+        && value != DYNAMIXEL_OPERATING_MODE_CURRENT_CONTROL
+        && value != DYNAMIXEL_OPERATING_MODE_VELOCITY_CONTROL
+        && value != DYNAMIXEL_OPERATING_MODE_POSITION_CONTROL
+        && value != DYNAMIXEL_OPERATING_MODE_EXTENDED_POSITION_CONTROL
+        && value != DYNAMIXEL_OPERATING_MODE_CURRENT_BASED_POSITION_CONTROL
+        && value != DYNAMIXEL_OPERATING_MODE_PWM_CONTROL
+    )
+        return VIRTUAL_SERVO_ERROR_DATA_RANGE;
+
+    // Secondary IDは0~252、または無効(255)のみ
+    if (item->address == ADDRESS_SECONDARY_ID && value > 252 && value != SECONDARY_ID_NONE)
+        return VIRTUAL_SERVO_ERROR_DATA_RANGE;
+
+    return VIRTUAL_SERVO_ERROR_NONE;
+}
+
+
+/**
+ * @brief 書き込めるかを確認する(コントロールテーブルは変更しない)
+ *
+ * 読み込み専用や未定義のアドレス、トルクオン中のEEPROM領域への書き込みはアクセスエラー、
+ * 項目の途中から(途中まで)の書き込みはデータ長エラーとする
+*/
+static virtual_servo_error check_write(
+    virtual_servo_t self,
+    uint16_t address,
+    uint16_t size,
+    const uint8_t *data
+)
+{
+    uint16_t offset = 0;
+    bool torque_enable = self->table[ADDRESS_TORQUE_ENABLE] != 0;
+    virtual_servo_error error;
+
+    if (size == 0)
+        return VIRTUAL_SERVO_ERROR_DATA_LENGTH;
+    if (address + size > VIRTUAL_SERVO_CONTROL_TABLE_SIZE)
+        return VIRTUAL_SERVO_ERROR_ACCESS;
+
+    while (offset < size)
+    {
+        uint16_t current = address + offset;
+
+        if (is_indirect_item(current))
+        {
+            // Indirect Addressは2Byte、Indirect Dataは1Byteずつの項目
+            if (current < ADDRESS_INDIRECT_DATA)
+            {
+                if (torque_enable)
+                    return VIRTUAL_SERVO_ERROR_ACCESS;
+                if ((current - ADDRESS_INDIRECT_ADDRESS) % 2 != 0 || offset + 2 > size)
+                    return VIRTUAL_SERVO_ERROR_DATA_LENGTH;
+                offset += 2;
+            }
+            else
+            {
+                const control_table_item *target = find_item(
+                    resolve_indirect_address(self, current)
+                );
+                if (
+                    resolve_indirect_address(self, current) != current
+                    && (!target || !target->writable || (target->eeprom && torque_enable))
+                )
+                    return VIRTUAL_SERVO_ERROR_ACCESS;
+                offset += 1;
+            }
+            continue;
+        }
+
+        const control_table_item *item = find_item(current);
+        if (!item || !item->writable)
+            return VIRTUAL_SERVO_ERROR_ACCESS;
+        if (item->eeprom && torque_enable)
+            return VIRTUAL_SERVO_ERROR_ACCESS;
+        if (item->address != current || offset + item->size > size)
+            return VIRTUAL_SERVO_ERROR_DATA_LENGTH;
+
+        const uint8_t *byte = data + offset;
+        int32_t value;
+        if (item->size == 4)
+            value = combine_signed_4_byte(byte[0], byte[1], byte[2], byte[3]);
+        else if (item->size == 2)
+            value = item->min < 0
+                ? combine_signed_2_byte(byte[0], byte[1])
+                : combine_byte_pair(byte[0], byte[1]);
+        else
+            value = byte[0];
+
+        error = check_range(self, item, value);
+        if (error == VIRTUAL_SERVO_ERROR_NONE)
+            error = check_limit(self, item->address, value);
+        if (error != VIRTUAL_SERVO_ERROR_NONE)
+            return error;
+
+        offset += item->size;
+    }
+
+    return VIRTUAL_SERVO_ERROR_NONE;
+}
+
+
+static virtual_servo_error write_data(
+    virtual_servo_t self,
+    uint16_t address,
+    uint16_t size,
+    const uint8_t *data
+)
+{
+    virtual_servo_error error = check_write(self, address, size, data);
+    if (error != VIRTUAL_SERVO_ERROR_NONE)
+        return error;
+
+    for (uint16_t i = 0; i < size; i++)
+        self->table[resolve_indirect_address(self, address + i)] = data[i];
+
+    return VIRTUAL_SERVO_ERROR_NONE;
+}
+
+
+/**
+ * @brief 応答パケットを返すかを、Status Return Levelと宛先から決める
+ *
+ * PINGはSecondary ID宛て以外は応答する。READ系はStatus Return Levelが1以上、それ以外は2のときのみ応答する
+*/
+static bool should_respond(
+    virtual_servo_t self,
+    bool unicast,
+    uint8_t id,
+    uint8_t instruction
+)
+{
+    uint8_t status_return_level = self->table[ADDRESS_STATUS_RETURN_LEVEL];
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_PING)
+        return unicast || id == BROADCAST_ID;
+
+    if (
+        instruction == DYNAMIXEL__INSTRUCTION_SYNC_READ
+        || instruction == DYNAMIXEL__INSTRUCTION_BULK_READ
+    )
+        return status_return_level >= 1;
+
+    // ブロードキャストIDやSecondary IDが宛先の場合は応答しない
+    if (!unicast)
+        return false;
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_READ)
+        return status_return_level >= 1;
+
+    return status_return_level >= 2;
+}
+
+
+/// Sync Readのパラメータから、自分のIDを探す
+static bool find_sync_read_id(
+    virtual_servo_t self,
+    const uint8_t *parameter,
+    size_t parameter_size
+)
+{
+    for (size_t i = 4; i < parameter_size; i++)
+    {
+        if (parameter[i] == self->table[ADDRESS_ID])
+            return true;
+    }
+
+    return false;
+}
+
+
+/// Sync Writeのパラメータから、自分宛ての書き込みデータを探す
+static const uint8_t *find_sync_write_data(
+    virtual_servo_t self,
+    const uint8_t *parameter,
+    size_t parameter_size,
+    uint16_t data_size
+)
+{
+    for (size_t i = 4; i + 1 + data_size <= parameter_size; i += 1 + data_size)
+    {
+        if (parameter[i] == self->table[ADDRESS_ID])
+            return parameter + i + 1;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Bulk Read、Bulk Writeのパラメータから、自分宛ての項目を探す
+ *
+ * has_dataがtrueのとき(Bulk Write)は、各項目の後ろに書き込みデータが続く
+*/
+static const uint8_t *find_bulk_item(
+    virtual_servo_t self,
+    const uint8_t *parameter,
+    size_t parameter_size,
+    bool has_data,
+    uint16_t *address,
+    uint16_t *size
+)
+{
+    size_t i = 0;
+
+    while (i + 5 <= parameter_size)
+    {
+        uint16_t item_address = combine_byte_pair(parameter[i + 1], parameter[i + 2]);
+        uint16_t item_size = combine_byte_pair(parameter[i + 3], parameter[i + 4]);
+        size_t next = i + 5 + (has_data ? item_size : 0);
+
+        if (next > parameter_size)
+            break;
+
+        if (parameter[i] == self->table[ADDRESS_ID])
+        {
+            *address = item_address;
+            *size = item_size;
+            return parameter + i + 5;
+        }
+
+        i = next;
+    }
+
+    return NULL;
+}
+
+
+/// インストラクションを実行し、エラー番号を返す(読み込んだデータはdataに格納する)
+static virtual_servo_error execute_instruction(
+    virtual_servo_t self,
+    uint8_t id,
+    uint8_t instruction,
+    const uint8_t *parameter,
+    size_t parameter_size,
+    uint8_t *data,
+    size_t *data_size,
+    bool *addressed
+)
+{
+    uint16_t address, size;
+    const uint8_t *write_data_position;
+    virtual_servo_error error;
+
+    *data_size = 0;
+    *addressed = true;
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_PING)
+    {
+        if (parameter_size != 0)
+            return VIRTUAL_SERVO_ERROR_DATA_LENGTH;
+
+        memcpy(data, self->table + ADDRESS_MODEL_NUMBER, 2);
+        data[2] = self->table[ADDRESS_FIRMWARE_VERSION];
+        *data_size = 3;
+        return VIRTUAL_SERVO_ERROR_NONE;
+    }
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_READ)
+    {
+        if (parameter_size != 4)
+            return VIRTUAL_SERVO_ERROR_DATA_LENGTH;
+
+        address = combine_byte_pair(parameter[0], parameter[1]);
+        size = combine_byte_pair(parameter[2], parameter[3]);
+        error = read_data(self, address, size, data);
+        if (error == VIRTUAL_SERVO_ERROR_NONE)
+            *data_size = size;
+        return error;
+    }
+
+    if (
+        instruction == DYNAMIXEL__INSTRUCTION_WRITE
+        || instruction == DYNAMIXEL__INSTRUCTION_REG_WRITE
+    )
+    {
+        if (parameter_size < 3)
+            return VIRTUAL_SERVO_ERROR_DATA_LENGTH;
+
+        address = combine_byte_pair(parameter[0], parameter[1]);
+        size = parameter_size - 2;
+
+        if (instruction == DYNAMIXEL__INSTRUCTION_WRITE)
+            return write_data(self, address, size, parameter + 2);
+
+        // REG_WRITEは確認のみ行い、ACTIONを受信するまで反映しない
+        error = check_write(self, address, size, parameter + 2);
+        if (error != VIRTUAL_SERVO_ERROR_NONE)
+            return error;
+
+        self->registered_address = address;
+        self->registered_size = size;
+        memcpy(self->registered_data, parameter + 2, size);
+        self->table[ADDRESS_REGISTERED_INSTRUCTION] = 1;
+        return VIRTUAL_SERVO_ERROR_NONE;
+    }
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_ACTION)
+    {
+        if (self->table[ADDRESS_REGISTERED_INSTRUCTION] == 0)
+            return VIRTUAL_SERVO_ERROR_NONE;
+
+        self->table[ADDRESS_REGISTERED_INSTRUCTION] = 0;
+        return write_data(
+            self, self->registered_address, self->registered_size, self->registered_data
+        );
+    }
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_FACTORY_RESET)
+    {
+        if (parameter_size != 1)
+            return VIRTUAL_SERVO_ERROR_DATA_LENGTH;
+
+        if (parameter[0] == DYNAMIXEL_FACTORY_RESET_ALL)
+            reset_table(self, true, false, false);
+        else if (parameter[0] == DYNAMIXEL_FACTORY_RESET_ID)
+            reset_table(self, true, true, false);
+        else if (parameter[0] == DYNAMIXEL_FACTORY_RESET_ID_AND_BAUD_RATE)
+            reset_table(self, true, true, true);
+        else
+            return VIRTUAL_SERVO_ERROR_DATA_RANGE;
+
+        return VIRTUAL_SERVO_ERROR_NONE;
+    }
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_REBOOT)
+    {
+        reset_table(self, false, true, true);
+        return VIRTUAL_SERVO_ERROR_NONE;
+    }
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_SYNC_READ)
+    {
+        if (parameter_size < 5)
+            return VIRTUAL_SERVO_ERROR_DATA_LENGTH;
+
+        *addressed = find_sync_read_id(self, parameter, parameter_size);
+        if (!*addressed)
+            return VIRTUAL_SERVO_ERROR_NONE;
+
+        address = combine_byte_pair(parameter[0], parameter[1]);
+        size = combine_byte_pair(parameter[2], parameter[3]);
+        error = read_data(self, address, size, data);
+        if (error == VIRTUAL_SERVO_ERROR_NONE)
+            *data_size = size;
+        return error;
+    }
+
+    if (instruction == DYNAMIXEL__INSTRUCTION_SYNC_WRITE)
+    {
+        if (parameter_size < 4)
+            return VIRTUAL_SERVO_ERROR_DATA_LENGTH;
+
+        address = combine_byte_pair(parameter[0], parameter[1]);
+        size = combine_byte_pair(parameter[2], parameter[3]);
+        write_data_position = find_sync_write_data(self, parameter, parameter_size, size);
+        *addressed = write_data_position != NULL;
+        if (!*addressed)
+            return VIRTUAL_SERVO_ERROR_NONE;
+
+        return write_data(self, address, size, write_data_position);
+    }
+
+    if (
+        instruction == DYNAMIXEL__INSTRUCTION_BULK_READ
+        || instruction == DYNAMIXEL__INSTRUCTION_BULK_WRITE
+    )
+    {
+        bool is_write = instruction == DYNAMIXEL__INSTRUCTION_BULK_WRITE;
+
+        write_data_position = find_bulk_item(
+            self, parameter, parameter_size, is_write, &address, &size
+        );
+        *addressed = write_data_position != NULL;
+        if (!*addressed)
+            return VIRTUAL_SERVO_ERROR_NONE;
+
+        if (is_write)
+            return write_data(self, address, size, write_data_position);
+
+        error = read_data(self, address, size, data);
+        if (error == VIRTUAL_SERVO_ERROR_NONE)
+            *data_size = size;
+        return error;
+    }
+
+    return VIRTUAL_SERVO_ERROR_INSTRUCTION;
+}
+
+
+/// 自分宛てのパケットか(ID、ブロードキャストID、Secondary IDのいずれかと一致する)
+static bool accepts_id(
+    virtual_servo_t self,
+    uint8_t id
+)
+{
+    uint8_t secondary_id = self->table[ADDRESS_SECONDARY_ID];
+
+    return id == self->table[ADDRESS_ID]
+        || id == BROADCAST_ID
+        || (secondary_id != SECONDARY_ID_NONE && id == secondary_id);
+}
+
+
+int virtual_servo_handle_instruction(
+    virtual_servo_t self,
+    uint8_t id,
+    uint8_t instruction,
+    const uint8_t *parameter,
+    size_t parameter_size,
+    uint8_t *status_id,
+    uint8_t *status_parameter,
+    size_t *status_parameter_size
+)
+{
+    size_t data_size;
+    bool addressed, unicast;
+    virtual_servo_error error;
+
+    if (!accepts_id(self, id))
+        return 1;
+
+    // 応答パケットは書き込み前のIDで返す
+    *status_id = self->table[ADDRESS_ID];
+    unicast = id == *status_id;
+
+    error = execute_instruction(
+        self, id, instruction, parameter, parameter_size,
+        status_parameter + 1, &data_size, &addressed
+    );
+
+    if (!addressed || !should_respond(self, unicast, id, instruction))
+        return 1;
+
+    status_parameter[0] = error;
+    if (self->table[ADDRESS_HARDWARE_ERROR_STATUS] != 0)
+        status_parameter[0] |= ERROR_ALERT;
+    *status_parameter_size = 1 + data_size;
+    return 0;
+}
+
+
+int virtual_servo_handle_crc_error(
+    virtual_servo_t self,
+    uint8_t id,
+    uint8_t *status_id,
+    uint8_t *status_parameter,
+    size_t *status_parameter_size
+)
+{
+    if (id != self->table[ADDRESS_ID] || self->table[ADDRESS_STATUS_RETURN_LEVEL] < 2)
+        return 1;
+
+    *status_id = self->table[ADDRESS_ID];
+    status_parameter[0] = VIRTUAL_SERVO_ERROR_CRC;
+    *status_parameter_size = 1;
+    return 0;
+}
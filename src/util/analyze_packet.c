@@ -188,12 +188,31 @@ int parse_uart_packet(
             length = combine_byte_pair(packet[i + 5], packet[i + 6]);
             parameter_size_l = length - 4;
 
+            // インストラクション、エラー、CRCの4Byteより短いlengthは誤り
+            if (length < 4)
+                return 1;
+
             if (i + 4 + 3 + length <= packet_size)
             {
                 // すべてのデータがパケット内に存在
                 *instruction = packet[i + 7];
                 *error = packet[i + 8];
 
+                packet_crc = combine_byte_pair(
+                    packet[i + 4 + 3 + length - 2],
+                    packet[i + 4 + 3 + length - 1]
+                );
+                // データからCRCを計算する
+                compute_crc = crc_16_ibm(packet + i, 4 + 3 + length - 2);
+
+                // CRCを比較してデータに誤りがないかを確認する
+                // (誤りのあるlengthでparameterの範囲を超えて書き込まないよう、パラメータの修正より先に確認する)
+                if (compute_crc != packet_crc)
+                {
+                    *parameter_size = 0;
+                    return 1;
+                }
+
                 //パラメータの修正をする
                 if (parameter_size_l > 3)
                 {
@@ -223,22 +242,7 @@ int parse_uart_packet(
                     memcpy(parameter, packet + i + 4 + 3 + 2, parameter_size_l);
                 }
 
-                packet_crc = combine_byte_pair(
-                    packet[i + 4 + 3 + length - 2],
-                    packet[i + 4 + 3 + length - 1]
-                );
-                // データからCRCを計算する
-                compute_crc = crc_16_ibm(packet + i, 4 + 3 + length - 2);
-
-                // CRCを比較してデータに誤りがないかを確認する
-                if (compute_crc == packet_crc)
-                {
-                    return 0;
-                }
-                else
-                {
-                    return 1;
-                }
+                return 0;
             }
             else
             {
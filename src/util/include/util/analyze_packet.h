@@ -103,7 +103,7 @@ int create_uart_packet(
  * @param[out] *parameter 追加情報(配列)。事前に十分なサイズを用意する(packet_size以上)
  * @param[out] *parameter_size parameterのバイト数(=配列長)
  * @retval 0 checksum値が正しいデータが見つかった
- * @retval 1 データは見つかったが、checksum値が誤っている(受信データに誤りがある可能性がある)
+ * @retval 1 データは見つかったが、checksum値が誤っている(受信データに誤りがある可能性がある。parameterには書き込まず、parameter_sizeは0)
  * @retval 2 ヘッダーは見つかったが、すべてのデータが見つからなかった(header_positionにヘッダーが代入される)
  * @retval 3 ヘッダーが見つからなかった
 */
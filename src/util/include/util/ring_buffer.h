@@ -0,0 +1,142 @@
+#ifndef _ONE_DYNAMIXEL_RING_BUFFER_H
+#define _ONE_DYNAMIXEL_RING_BUFFER_H
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 書き込み側と読み込み側が1つずつのリングバッファー(SPSC)
+ *
+ * 書き込み側(割り込みハンドラーなど)と読み込み側(メインループなど)が別々に動いていても、
+ * ロックなしで読み書きできる。
+ * 書き込み側の関数(push、write)と読み込み側の関数(available、peek、consume、read)は、
+ * それぞれ1つの実行コンテキストからのみ呼び出すこと
+*/
+typedef struct ring_buffer_struct *ring_buffer_t;
+
+
+/**
+ * @brief リングバッファーを作成する
+ *
+ * @param[in] size バッファーサイズ(2のべき乗であること)
+ * @return 作成したリングバッファー(作成できなかった場合はNULL)
+*/
+ring_buffer_t ring_buffer_create(
+    size_t size
+);
+
+
+/**
+ * @brief リングバッファーを破棄する
+ *
+ * @param[in] self リングバッファー
+*/
+void ring_buffer_destroy(
+    ring_buffer_t self
+);
+
+
+/**
+ * @brief リングバッファーに格納できる最大のデータサイズを返す
+ *
+ * @param[in] self リングバッファー
+ * @return 最大のデータサイズ
+*/
+size_t ring_buffer_capacity(
+    ring_buffer_t self
+);
+
+
+/**
+ * @brief リングバッファーに1Byte書き込む(書き込み側)
+ *
+ * @param[in] self リングバッファー
+ * @param[in] data 書き込むデータ
+ * @retval 0 書き込んだ
+ * @retval 1 バッファーが満杯で書き込めなかった
+*/
+int ring_buffer_push(
+    ring_buffer_t self,
+    uint8_t data
+);
+
+
+/**
+ * @brief リングバッファーにデータをまとめて書き込む(書き込み側)
+ *
+ * @param[in] self リングバッファー
+ * @param[in] *src 書き込むデータ
+ * @param[in] len 書き込むデータサイズ
+ * @return 書き込んだデータサイズ(バッファーの空きが足りない場合はlenより小さくなる)
+*/
+size_t ring_buffer_write(
+    ring_buffer_t self,
+    const uint8_t *src,
+    size_t len
+);
+
+
+/**
+ * @brief リングバッファーから読み込めるデータサイズを返す(読み込み側)
+ *
+ * @param[in] self リングバッファー
+ * @return 読み込めるデータサイズ
+*/
+size_t ring_buffer_available(
+    ring_buffer_t self
+);
+
+
+/**
+ * @brief リングバッファーのデータを取り出さずにコピーする(読み込み側)
+ *
+ * @param[in] self リングバッファー
+ * @param[out] *dst コピー先
+ * @param[in] max コピーする最大のデータサイズ
+ * @return コピーしたデータサイズ
+*/
+size_t ring_buffer_peek(
+    ring_buffer_t self,
+    uint8_t *dst,
+    size_t max
+);
+
+
+/**
+ * @brief リングバッファーの先頭からデータを捨てる(読み込み側)
+ *
+ * @param[in] self リングバッファー
+ * @param[in] len 捨てるデータサイズ
+ * @return 捨てたデータサイズ(読み込めるデータサイズより大きい場合は、読み込めるデータを全て捨てる)
+*/
+size_t ring_buffer_consume(
+    ring_buffer_t self,
+    size_t len
+);
+
+
+/**
+ * @brief リングバッファーからデータを取り出す(読み込み側)
+ *
+ * peekとconsumeをまとめて行う
+ *
+ * @param[in] self リングバッファー
+ * @param[out] *dst 読み込みデータの保存先
+ * @param[in] max 読み込む最大のデータサイズ
+ * @return 読み込んだデータサイズ
+*/
+size_t ring_buffer_read(
+    ring_buffer_t self,
+    uint8_t *dst,
+    size_t max
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef _ONE_DYNAMIXEL_SPSC_QUEUE_H
+#define _ONE_DYNAMIXEL_SPSC_QUEUE_H
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 書き込み側と読み込み側が1つずつの、固定サイズの要素のキュー(SPSC)
+ *
+ * 要素はキューの中の領域に直接書き込み、読み込むため、コピーせずに受け渡せる。
+ * 書き込み側(back、push)と読み込み側(front、pop)が別々のコアやスレッドで動いていても、ロックなしで使える。
+ * それぞれの関数は、1つの実行コンテキストからのみ呼び出すこと
+*/
+typedef struct spsc_queue_struct *spsc_queue_t;
+
+
+/**
+ * @brief キューを作成する
+ *
+ * @param[in] element_num 要素の数(2のべき乗であること)
+ * @param[in] element_size 要素のサイズ
+ * @return 作成したキュー(作成できなかった場合はNULL)
+*/
+spsc_queue_t spsc_queue_create(
+    size_t element_num,
+    size_t element_size
+);
+
+
+/**
+ * @brief キューを破棄する
+ *
+ * @param[in] self キュー
+*/
+void spsc_queue_destroy(
+    spsc_queue_t self
+);
+
+
+/**
+ * @brief キューに入れられる要素の数を返す
+ *
+ * @param[in] self キュー
+ * @return 要素の数
+*/
+size_t spsc_queue_capacity(
+    spsc_queue_t self
+);
+
+
+/**
+ * @brief 次に入れる要素の領域を返す(書き込み側)
+ *
+ * spsc_queue_push()を呼ぶまで、読み込み側には見えない
+ *
+ * @param[in] self キュー
+ * @return 要素の領域(キューが満杯の場合はNULL)
+*/
+void *spsc_queue_back(
+    spsc_queue_t self
+);
+
+
+/**
+ * @brief spsc_queue_back()の領域に書き込んだ要素をキューに入れる(書き込み側)
+ *
+ * @param[in] self キュー
+ * @retval 0 入れた
+ * @retval 1 キューが満杯で入れられなかった
+*/
+int spsc_queue_push(
+    spsc_queue_t self
+);
+
+
+/**
+ * @brief 最も古い要素の領域を返す(読み込み側)
+ *
+ * spsc_queue_pop()を呼ぶまで、書き込み側に上書きされない
+ *
+ * @param[in] self キュー
+ * @return 要素の領域(キューが空の場合はNULL)
+*/
+void *spsc_queue_front(
+    spsc_queue_t self
+);
+
+
+/**
+ * @brief 最も古い要素を取り除く(読み込み側)
+ *
+ * @param[in] self キュー
+ * @retval 0 取り除いた
+ * @retval 1 キューが空だった
+*/
+int spsc_queue_pop(
+    spsc_queue_t self
+);
+
+
+/**
+ * @brief キューに入っている要素の数を返す
+ *
+ * 相手側が同時に動いている場合は、呼び出した時点の近似値となる
+ *
+ * @param[in] self キュー
+ * @return 要素の数
+*/
+size_t spsc_queue_size(
+    spsc_queue_t self
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
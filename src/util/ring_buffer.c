@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <string.h>
+#include "util/ring_buffer.h"
+
+
+typedef struct ring_buffer_struct
+{
+    uint8_t *buffer;
+    size_t mask;
+    // 書き込み側のみが更新する(書き込んだ総データサイズ)
+    size_t head;
+    // 読み込み側のみが更新する(取り出した総データサイズ)
+    size_t tail;
+} ring_buffer_struct;
+
+
+// 相手側が更新するインデックスは、データより後に読み書きされるようにする
+static inline size_t load_acquire(
+    const size_t *index
+)
+{
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+
+static inline void store_release(
+    size_t *index,
+    size_t value
+)
+{
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+
+ring_buffer_t ring_buffer_create(
+    size_t size
+)
+{
+    // インデックスの計算をマスクで行うため、2のべき乗に限る
+    if (size == 0 || (size & (size - 1)) != 0)
+        return NULL;
+
+    ring_buffer_t self = calloc(1, sizeof(ring_buffer_struct));
+    if (!self)
+        return NULL;
+
+    self->buffer = calloc(size, sizeof(uint8_t));
+    if (!self->buffer)
+    {
+        free(self);
+        return NULL;
+    }
+    self->mask = size - 1;
+
+    return self;
+}
+
+
+void ring_buffer_destroy(
+    ring_buffer_t self
+)
+{
+    free(self->buffer);
+    free(self);
+}
+
+
+size_t ring_buffer_capacity(
+    ring_buffer_t self
+)
+{
+    return self->mask + 1;
+}
+
+
+int ring_buffer_push(
+    ring_buffer_t self,
+    uint8_t data
+)
+{
+    size_t head = self->head;
+
+    if (head - load_acquire(&self->tail) > self->mask)
+        return 1;
+
+    self->buffer[head & self->mask] = data;
+    store_release(&self->head, head + 1);
+
+    return 0;
+}
+
+
+size_t ring_buffer_write(
+    ring_buffer_t self,
+    const uint8_t *src,
+    size_t len
+)
+{
+    size_t head = self->head;
+    size_t free_size = self->mask + 1 - (head - load_acquire(&self->tail));
+    size_t offset = head & self->mask;
+    size_t first_size;
+
+    if (len > free_size)
+        len = free_size;
+
+    // バッファーの末尾で折り返す場合は2回に分けてコピーする
+    first_size = self->mask + 1 - offset;
+    if (first_size > len)
+        first_size = len;
+    memcpy(self->buffer + offset, src, first_size);
+    memcpy(self->buffer, src + first_size, len - first_size);
+
+    store_release(&self->head, head + len);
+
+    return len;
+}
+
+
+size_t ring_buffer_available(
+    ring_buffer_t self
+)
+{
+    return load_acquire(&self->head) - self->tail;
+}
+
+
+size_t ring_buffer_peek(
+    ring_buffer_t self,
+    uint8_t *dst,
+    size_t max
+)
+{
+    size_t tail = self->tail;
+    size_t len = load_acquire(&self->head) - tail;
+    size_t offset = tail & self->mask;
+    size_t first_size;
+
+    if (len > max)
+        len = max;
+
+    first_size = self->mask + 1 - offset;
+    if (first_size > len)
+        first_size = len;
+    memcpy(dst, self->buffer + offset, first_size);
+    memcpy(dst + first_size, self->buffer, len - first_size);
+
+    return len;
+}
+
+
+size_t ring_buffer_consume(
+    ring_buffer_t self,
+    size_t len
+)
+{
+    size_t tail = self->tail;
+    size_t available = load_acquire(&self->head) - tail;
+
+    if (len > available)
+        len = available;
+
+    store_release(&self->tail, tail + len);
+
+    return len;
+}
+
+
+size_t ring_buffer_read(
+    ring_buffer_t self,
+    uint8_t *dst,
+    size_t max
+)
+{
+    return ring_buffer_consume(
+        self, ring_buffer_peek(self, dst, max)
+    );
+}
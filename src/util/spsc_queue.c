@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include "util/spsc_queue.h"
+
+
+/// 要素の領域の境界(要素に構造体を入れられるようにする)
+#define ELEMENT_ALIGNMENT 8
+
+
+typedef struct spsc_queue_struct
+{
+    uint8_t *buffer;
+    size_t mask;
+    size_t element_size;
+    // 書き込み側のみが更新する(入れた総要素数)
+    size_t head;
+    // 読み込み側のみが更新する(取り除いた総要素数)
+    size_t tail;
+} spsc_queue_struct;
+
+
+// 相手側が更新するインデックスは、要素より後に読み書きされるようにする
+static inline size_t load_acquire(
+    const size_t *index
+)
+{
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+
+static inline void store_release(
+    size_t *index,
+    size_t value
+)
+{
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+
+spsc_queue_t spsc_queue_create(
+    size_t element_num,
+    size_t element_size
+)
+{
+    // インデックスの計算をマスクで行うため、2のべき乗に限る
+    if (element_num == 0 || (element_num & (element_num - 1)) != 0 || element_size == 0)
+        return NULL;
+
+    spsc_queue_t self = calloc(1, sizeof(spsc_queue_struct));
+    if (!self)
+        return NULL;
+
+    self->element_size = (element_size + ELEMENT_ALIGNMENT - 1) & ~(size_t)(ELEMENT_ALIGNMENT - 1);
+    self->buffer = calloc(element_num, self->element_size);
+    if (!self->buffer)
+    {
+        free(self);
+        return NULL;
+    }
+    self->mask = element_num - 1;
+
+    return self;
+}
+
+
+void spsc_queue_destroy(
+    spsc_queue_t self
+)
+{
+    free(self->buffer);
+    free(self);
+}
+
+
+size_t spsc_queue_capacity(
+    spsc_queue_t self
+)
+{
+    return self->mask + 1;
+}
+
+
+void *spsc_queue_back(
+    spsc_queue_t self
+)
+{
+    size_t head = self->head;
+
+    if (head - load_acquire(&self->tail) > self->mask)
+        return NULL;
+
+    return self->buffer + (head & self->mask) * self->element_size;
+}
+
+
+int spsc_queue_push(
+    spsc_queue_t self
+)
+{
+    size_t head = self->head;
+
+    if (head - load_acquire(&self->tail) > self->mask)
+        return 1;
+
+    store_release(&self->head, head + 1);
+
+    return 0;
+}
+
+
+void *spsc_queue_front(
+    spsc_queue_t self
+)
+{
+    size_t tail = self->tail;
+
+    if (load_acquire(&self->head) == tail)
+        return NULL;
+
+    return self->buffer + (tail & self->mask) * self->element_size;
+}
+
+
+int spsc_queue_pop(
+    spsc_queue_t self
+)
+{
+    size_t tail = self->tail;
+
+    if (load_acquire(&self->head) == tail)
+        return 1;
+
+    store_release(&self->tail, tail + 1);
+
+    return 0;
+}
+
+
+size_t spsc_queue_size(
+    spsc_queue_t self
+)
+{
+    return __atomic_load_n(&self->head, __ATOMIC_ACQUIRE)
+        - __atomic_load_n(&self->tail, __ATOMIC_ACQUIRE);
+}
@@ -61,6 +61,46 @@ int pico_uart_write_blocking(
         ->intReturnValue();
 }
 
+int pico_uart_start_write(
+    uart_inst_t *uart_id, const uint8_t *src, size_t len
+)
+{
+    return mock_c()->actualCall("pico_uart_start_write")
+        ->withPointerParameters("uart_id", uart_id)
+        ->withMemoryBufferParameter("src", src, len)
+        ->withUnsignedIntParameters("len", len)
+        ->returnIntValueOrDefault(0);
+}
+
+int pico_uart_write_done(
+    uart_inst_t *uart_id
+)
+{
+    return mock_c()->actualCall("pico_uart_write_done")
+        ->withPointerParameters("uart_id", uart_id)
+        ->returnIntValueOrDefault(0);
+}
+
+int pico_uart_wait_write(
+    uart_inst_t *uart_id
+)
+{
+    return mock_c()->actualCall("pico_uart_wait_write")
+        ->withPointerParameters("uart_id", uart_id)
+        ->returnIntValueOrDefault(0);
+}
+
+size_t pico_uart_read_available(
+    uart_inst_t *uart_id, uint8_t *dst, size_t max
+)
+{
+    return mock_c()->actualCall("pico_uart_read_available")
+        ->withPointerParameters("uart_id", uart_id)
+        ->withOutputParameter("dst", dst)
+        ->withUnsignedIntParameters("max", max)
+        ->returnUnsignedLongIntValueOrDefault(0);
+}
+
 int pico_uart_is_readable(
     uart_inst_t *uart_id
 )
@@ -1,8 +1,67 @@
+#include <string.h>
 #include "CppUTest/TestHarness.h"
 #include "CppUTestExt/MockSupport.h"
 #include "hardware/gpio.h"
 #include "dynamixel/dynamixel.h"
 
+
+// テスト用の経路(送信したパケットを記録し、決まった応答パケットを返す)
+typedef struct
+{
+    uint8_t written[100];
+    size_t written_size;
+    const uint8_t *response;
+    size_t response_size;
+    uint baud_rate;
+} fake_transport;
+
+static int fake_write(void *context, const uint8_t *src, size_t len)
+{
+    fake_transport *fake = (fake_transport *)context;
+
+    memcpy(fake->written, src, len);
+    fake->written_size = len;
+    return 0;
+}
+
+static int fake_wait_write(void *context)
+{
+    return 0;
+}
+
+static int fake_write_done(void *context)
+{
+    return 0;
+}
+
+static size_t fake_read_available(void *context, uint8_t *dst, size_t max)
+{
+    fake_transport *fake = (fake_transport *)context;
+    size_t size = fake->response_size < max ? fake->response_size : max;
+
+    memcpy(dst, fake->response, size);
+    fake->response += size;
+    fake->response_size -= size;
+    return size;
+}
+
+static int fake_wait_readable(void *context, uint us)
+{
+    return ((fake_transport *)context)->response_size == 0;
+}
+
+static uint fake_set_baud(void *context, uint baud_rate)
+{
+    ((fake_transport *)context)->baud_rate = baud_rate;
+    return baud_rate;
+}
+
+static uint64_t fake_now_us(void *context)
+{
+    return 0;
+}
+
+
 TEST_GROUP(DynamixelInitialization)
 {
     uart_inst_t *uart_dummy;
@@ -157,3 +216,49 @@ TEST(DynamixelInitialization, ProhibitUnsupportedBaudRate)
     if (dynamixel_id)
         dynamixel_destroy(dynamixel_id);
 }
+
+TEST(DynamixelInitialization, CreateWithTransport)
+{
+    fake_transport fake = {};
+    dynamixel_transport transport = {
+        &fake,
+        fake_write, fake_write, fake_wait_write, fake_write_done,
+        fake_read_available, fake_wait_readable,
+        fake_set_baud, fake_now_us
+    };
+    uint8_t response[] = {
+        0xff, 0xff, 0xfd, 0x00,
+        0x01,
+        0x07, 0x00,
+        0x55,
+        0x00,
+        0x06, 0x04,
+        0x26,
+        0x65, 0x5d
+    };
+    uint8_t expected_packet[] = {
+        0xff, 0xff, 0xfd, 0x00, 0x01, 0x03, 0x00, 0x01, 0x19, 0x4e
+    };
+    uint8_t error;
+    uint16_t dynamixel_model_no;
+
+    fake.response = response;
+    fake.response_size = sizeof(response);
+
+    // UARTやGPIOピンの関数は呼ばれない(mockに期待していない呼び出しがあると失敗する)
+    dynamixel_t dynamixel_id = dynamixel_create_with_transport(
+        &transport, 57600, 100, 10
+    );
+    CHECK(dynamixel_id != NULL);
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_ping(dynamixel_id, 0x01, &error, &dynamixel_model_no, NULL, 0)
+    );
+    UNSIGNED_LONGS_EQUAL(0x0406, dynamixel_model_no);
+    UNSIGNED_LONGS_EQUAL(sizeof(expected_packet), fake.written_size);
+    MEMCMP_EQUAL(expected_packet, fake.written, sizeof(expected_packet));
+
+    dynamixel_destroy(dynamixel_id);
+    mock().checkExpectations();
+}
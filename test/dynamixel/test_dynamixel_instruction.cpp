@@ -17,6 +17,8 @@ TEST_GROUP(DynamixelInstruction)
         dynamixel_id = dynamixel_create(
             uart_dummy, 8, 9, 57600, 100, 10
         );
+        // create時に設定した待ち時間で動作を確認する
+        dynamixel_set_timeout_model(dynamixel_id, DYNAMIXEL_TIMEOUT_MODEL_FIXED);
         mock().clear();
     }
 
@@ -60,26 +62,23 @@ TEST(DynamixelInstruction, SendPingSucceed)
         id, instruction, NULL, 0
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_ping(
         dynamixel_id, id,
@@ -125,26 +124,23 @@ TEST(DynamixelInstruction, SendPingWaitLong)
         id, instruction, NULL, 0
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 1000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_ping(
         dynamixel_id, id,
@@ -180,18 +176,12 @@ TEST(DynamixelInstruction, SendPingWithWrongParameter)
     };
     uint8_t expected_error = 0;
 
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_ping(
@@ -239,26 +229,23 @@ TEST(DynamixelInstruction, SendReadOnceSucceed)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_read_once(
         dynamixel_id, id, start_address, data_size,
@@ -306,26 +293,23 @@ TEST(DynamixelInstruction, SendReadOnceWaitLong)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 980)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_read_once(
         dynamixel_id, id, start_address, data_size,
@@ -373,26 +357,23 @@ TEST(DynamixelInstruction, SendReadOnceWithWrongParameter)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_read_once(
         dynamixel_id, id, start_address, data_size,
@@ -441,36 +422,36 @@ TEST(DynamixelInstruction, SendReadSucceedWithRetry)
     );
 
     // 最初はレスポンスなし
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(1);
 
     // 再試行
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_read(
         dynamixel_id, id, start_address, data_size,
@@ -516,26 +497,23 @@ TEST(DynamixelInstruction, SendWriteOnceSucceed)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_write_once(
         dynamixel_id, id, start_address, data_size, data,
@@ -580,36 +558,36 @@ TEST(DynamixelInstruction, SendWriteSucceedWithRetry)
     );
 
     // 最初はレスポンスなし
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(1);
 
     // 再試行
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_write(
         dynamixel_id, id, start_address, data_size, data,
@@ -653,26 +631,23 @@ TEST(DynamixelInstruction, SendWriteOnceLongWaite)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 990)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_write_once(
         dynamixel_id, id, start_address, data_size, data,
@@ -716,26 +691,23 @@ TEST(DynamixelInstruction, SendRegWriteSucceed)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 960)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_reg_write(
         dynamixel_id, id, start_address, data_size, data,
@@ -770,26 +742,23 @@ TEST(DynamixelInstruction, SendActionSucceed)
         id, instruction, NULL, 0
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 950)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_action(
         dynamixel_id, id, &error, 95
@@ -828,26 +797,23 @@ TEST(DynamixelInstruction, SendFactoryResetSucceed)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 940)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_factory_reset(
         dynamixel_id, id, &error, factory_reset, 94
@@ -881,26 +847,23 @@ TEST(DynamixelInstruction, SendRebootSucceed)
         id, instruction, NULL, 0
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 930)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_reboot(
         dynamixel_id, id, &error, 93
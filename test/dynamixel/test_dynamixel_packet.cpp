@@ -1,3 +1,4 @@
+#include <string.h>
 #include "CppUTest/TestHarness.h"
 #include "CppUTestExt/MockSupport.h"
 #include "dynamixel/dynamixel.h"
@@ -15,6 +16,8 @@ TEST_GROUP(DynamixelPacket)
         dynamixel_id = dynamixel_create(
             uart_dummy, 8, 9, 57600, 100, 10
         );
+        // create時に設定した待ち時間で動作を確認する
+        dynamixel_set_timeout_model(dynamixel_id, DYNAMIXEL_TIMEOUT_MODEL_FIXED);
         mock().clear();
     }
 
@@ -46,7 +49,7 @@ TEST(DynamixelPacket, WritePacketSucceed)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size)
@@ -61,6 +64,62 @@ TEST(DynamixelPacket, WritePacketSucceed)
     mock().checkExpectations();
 }
 
+TEST(DynamixelPacket, WriteNextPacketWhileSending)
+{
+    uint8_t instruction = 0x03;
+    uint16_t parameter_size = 0x0003;
+    uint8_t parameter0[] = {
+        0x40, 0x00, 0x01
+    };
+    uint8_t parameter1[] = {
+        0x40, 0x00, 0x00
+    };
+    int result0, result1, result2;
+
+    int expected_packet_size0, expected_packet_size1;
+    uint8_t expected_packet0[100] = {0};
+    uint8_t expected_packet1[100] = {0};
+
+    expected_packet_size0 = create_uart_packet(
+        expected_packet0,
+        0x01, instruction, parameter0, parameter_size
+    );
+    expected_packet_size1 = create_uart_packet(
+        expected_packet1,
+        0x02, instruction, parameter1, parameter_size
+    );
+
+    mock().expectOneCall("pico_uart_start_write")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withMemoryBufferParameter("src", expected_packet0, expected_packet_size0)
+        .withUnsignedIntParameter("len", expected_packet_size0);
+    // 2つ目のパケットを作成してから、1つ目の送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
+    mock().expectOneCall("pico_uart_start_write")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withMemoryBufferParameter("src", expected_packet1, expected_packet_size1)
+        .withUnsignedIntParameter("len", expected_packet_size1);
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
+
+    result0 = dynamixel_write_uart_packet(
+        dynamixel_id,
+        0x01, instruction, parameter_size, parameter0
+    );
+    result1 = dynamixel_write_uart_packet(
+        dynamixel_id,
+        0x02, instruction, parameter_size, parameter1
+    );
+    // 2つ目の送信の完了を待つ
+    result2 = dynamixel_wait_write(dynamixel_id);
+
+    LONGS_EQUAL(0, result0);
+    LONGS_EQUAL(0, result1);
+    LONGS_EQUAL(0, result2);
+    mock().checkExpectations();
+}
+
 TEST(DynamixelPacket, SendPacketSucceed)
 {
     uint8_t id = 0x01, instruction = 0x02;
@@ -96,26 +155,23 @@ TEST(DynamixelPacket, SendPacketSucceed)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_packet(
         dynamixel_id,
@@ -168,26 +224,23 @@ TEST(DynamixelPacket, SendPacketSucceedLongWait)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 800)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_send_packet(
         dynamixel_id,
@@ -231,26 +284,24 @@ TEST(DynamixelPacket, ReadAndParsePacketSucceedWithMultipleReadTwoTimes)
         0, 0, 0x5d, 0x0e, 0x00, 0x00, 0, 0
     };
 
+    // 1回目の読み込みでは、ゴミデータ44個とパケットの先頭6個を読み込む
+    uint8_t first_read[50] = {0};
+    memcpy(first_read + 44, expected_output + 1, 6);
+
     mock().expectNCalls(2, "pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    mock().expectNCalls(44, "pico_uart_read_raw")
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", expected_output, 1)
-        .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i + 1, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+        .withOutputParameterReturning("dst", first_read, 50)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(50);
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output + 1 + 6, expected_output_size - 6)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size - 6);
 
     result = dynamixel_read_uart_packet(
         dynamixel_id, id,
@@ -299,26 +350,30 @@ TEST(DynamixelPacket, ReadAndParsePacketSucceedWithMultipleReadThreeTimes)
         0, 0
     };
 
+    // 1回目の読み込みでは、ゴミデータ45個とパケットの先頭5個を読み込む
+    uint8_t first_read[50] = {0};
+    memcpy(first_read + 45, expected_output + 1, 5);
+
     mock().expectNCalls(3, "pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    mock().expectNCalls(45, "pico_uart_read_raw")
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", expected_output, 1)
-        .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i + 1, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+        .withOutputParameterReturning("dst", first_read, 50)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(50);
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output + 1 + 5, 50)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(50);
+    // バッファーの残りのサイズまでしか読み込まない
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output + 1 + 55, expected_output_size - 55)
+        .withUnsignedIntParameter("max", 45)
+        .andReturnValue(expected_output_size - 55);
 
     result = dynamixel_read_uart_packet(
         dynamixel_id, id,
@@ -361,26 +416,24 @@ TEST(DynamixelPacket, ReadAndParsePacketSucceedWithMultipleReadTNotFoundHeaderAt
         0, 0, 0x5d, 0x0e, 0x00, 0x00, 0, 0
     };
 
+    // 1回目の読み込みでは、ゴミデータ47個とパケットの先頭3個(ヘッダーの途中まで)を読み込む
+    uint8_t first_read[50] = {0};
+    memcpy(first_read + 47, expected_output + 1, 3);
+
     mock().expectNCalls(2, "pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    mock().expectNCalls(47, "pico_uart_read_raw")
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", expected_output, 1)
-        .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i + 1, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+        .withOutputParameterReturning("dst", first_read, 50)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(50);
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output + 1 + 3, expected_output_size - 3)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size - 3);
 
     result = dynamixel_read_uart_packet(
         dynamixel_id, id,
@@ -428,13 +481,10 @@ TEST(DynamixelPacket, ReadAndParsePacketSucceedWithMultipleReadWithTemporarilyUn
         .andReturnValue(0);
     for (int i = 0; i < expected_output_size; i++)
     {
-        mock().expectOneCall("pico_uart_read_raw")
+        mock().expectOneCall("pico_uart_read_available")
             .withPointerParameter("uart_id", uart_dummy)
             .withOutputParameterReturning("dst", expected_output + i + 1, 1)
-            .andReturnValue(0);
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", NULL, 0)
+            .ignoreOtherParameters()
             .andReturnValue(1);
     }
     // mock().expectNCalls(1, "pico_uart_is_readable_within_us")
@@ -476,27 +526,20 @@ TEST(DynamixelPacket, ReadAndParsePacketWrongChecksumError)
         0x7c, 0x9b
     };
     uint8_t expected_error = 0;
-    size_t expected_status_parameter_size = 4;
-    uint8_t expected_status_parameter[100] = {
-        0, 0, 0x5d, 0x0e, 0x00, 0x00, 0, 0
-    };
+    // checksumが誤っている場合、パラメータは書き込まない
+    size_t expected_status_parameter_size = 0;
+    uint8_t expected_status_parameter[100] = {0};
 
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_read_uart_packet(
         dynamixel_id, id,
@@ -506,7 +549,7 @@ TEST(DynamixelPacket, ReadAndParsePacketWrongChecksumError)
     LONGS_EQUAL(DYNAMIXEL_PARSE_WRONG_CHECKSUM, result);
     UNSIGNED_LONGS_EQUAL(expected_error,error);
     UNSIGNED_LONGS_EQUAL(expected_status_parameter_size, status_parameter_size);
-    for (int i = 0; i < expected_status_parameter_size + 4; i++)
+    for (int i = 0; i < 4 + 4; i++)
     {
         UNSIGNED_LONGS_EQUAL(expected_status_parameter[i], status_parameter[i]);
     }
@@ -542,18 +585,12 @@ TEST(DynamixelPacket, ReadAndParsePacketStatusError)
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_read_uart_packet(
         dynamixel_id, id,
@@ -590,22 +627,20 @@ TEST(DynamixelPacket, ReadAndParsePacketInadequateResponseErrorWithoutFindingHea
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(1);
-    mock().expectNCalls(48, "pico_uart_read_raw")
+    // 1回目の読み込みでは、ゴミデータ48個と受信データの先頭2個を読み込む
+    uint8_t first_read[50] = {0};
+    memcpy(first_read + 48, expected_output + 1, 2);
+
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", expected_output, 1)
-        .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i + 1, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+        .withOutputParameterReturning("dst", first_read, 50)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(50);
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output + 1 + 2, expected_output_size - 2)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size - 2);
 
     result = dynamixel_read_uart_packet(
         dynamixel_id, id,
@@ -636,22 +671,20 @@ TEST(DynamixelPacket, ReadAndParsePacketInadequateResponseErrorWithFindingHeader
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(1);
-    mock().expectNCalls(45, "pico_uart_read_raw")
+    // 1回目の読み込みでは、ゴミデータ45個と受信データの先頭5個を読み込む
+    uint8_t first_read[50] = {0};
+    memcpy(first_read + 45, expected_output + 1, 5);
+
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", expected_output, 1)
-        .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i + 1, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+        .withOutputParameterReturning("dst", first_read, 50)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(50);
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output + 1 + 5, expected_output_size - 5)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size - 5);
 
     result = dynamixel_read_uart_packet(
         dynamixel_id, id,
@@ -681,14 +714,10 @@ TEST(DynamixelPacket, ReadAndParsePacketInadequateResponseErrorWithFewResponse)
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(1);
-    mock().expectOneCall("pico_uart_read_raw")
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
         .withOutputParameterReturning("dst", expected_output, 1)
-        .andReturnValue(0);
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
-        .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
+        .withUnsignedIntParameter("max", 50)
         .andReturnValue(1);
 
     result = dynamixel_read_uart_packet(
@@ -733,17 +762,26 @@ TEST(DynamixelPacket, ReadAndParsePacketWithHugeResponse)
     mock().expectNCalls(1, "pico_uart_is_readable")
         .withPointerParameter("uart_id", uart_dummy)
         .andReturnValue(0);
-    mock().expectNCalls(45, "pico_uart_read_raw")
+    // 1回目の読み込みでは、ゴミデータ45個とパケットの先頭5個を読み込む
+    uint8_t first_read[50] = {0};
+    memcpy(first_read + 45, expected_output + 1, 5);
+
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", expected_output, 1)
-        .andReturnValue(0);
-    for (int i = 0; i < 100; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i + 1, 1)
-            .andReturnValue(0);
-    }
+        .withOutputParameterReturning("dst", first_read, 50)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(50);
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output + 1 + 5, 50)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(50);
+    // バッファーが満杯になるまで読み込む
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output + 1 + 55, 45)
+        .withUnsignedIntParameter("max", 45)
+        .andReturnValue(45);
 
     result = dynamixel_read_uart_packet(
         dynamixel_id, id,
@@ -782,18 +820,12 @@ TEST(DynamixelPacket, ReadAndParsePacketWithWrongID)
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_read_uart_packet(
         dynamixel_id, id,
@@ -860,18 +892,12 @@ TEST(DynamixelPacket, ReadPacketSucceedLongWaite)
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 90)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     result = dynamixel_read_uart_packet(
         dynamixel_id, id,
@@ -889,3 +915,425 @@ TEST(DynamixelPacket, ReadPacketSucceedLongWaite)
 }
 
 // TODO: ID=0xfeのときのパケット解析
+
+TEST(DynamixelPacket, GetResponseTimeoutFromBaudRate)
+{
+    // 送受信29Byte(290bit)を57600bpsで送ると5035us、Return Delay Timeの初期値が500us、余裕が50us
+    UNSIGNED_LONGS_EQUAL(5585, dynamixel_get_response_timeout_us(dynamixel_id, 0x01, 14, 15));
+
+    dynamixel_set_timeout_margin_us(dynamixel_id, 0);
+    UNSIGNED_LONGS_EQUAL(5535, dynamixel_get_response_timeout_us(dynamixel_id, 0x01, 14, 15));
+}
+
+TEST(DynamixelPacket, SendPacketWithBaudRateTimeout)
+{
+    uint8_t id = 0x01, instruction = 0x01;
+    int result;
+    uint8_t error;
+    size_t status_parameter_size;
+    uint8_t status_parameter[100] = {0};
+
+    int expected_packet_size;
+    uint8_t expected_packet[100] = {0};
+    size_t expected_output_size = 14;
+    uint8_t expected_output[] = {
+        0xff, 0xff, 0xfd, 0x00,
+        0x01,
+        0x07, 0x00,
+        0x55,
+        0x00,
+        0x06, 0x04,
+        0x26,
+        0x65, 0x5d
+    };
+
+    dynamixel_set_timeout_model(dynamixel_id, DYNAMIXEL_TIMEOUT_MODEL_BAUD_RATE);
+
+    expected_packet_size = create_uart_packet(
+        expected_packet,
+        id, instruction, NULL, 0
+    );
+
+    mock().expectOneCall("pico_uart_start_write")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
+        .withUnsignedIntParameter("len", expected_packet_size);
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
+    // pingの応答パケット14Byte(2431us) + Return Delay Time(500us) + 余裕(50us)
+    mock().expectOneCall("pico_uart_is_readable_within_us")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withUnsignedIntParameter("us", 2981)
+        .andReturnValue(0);
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
+
+    result = dynamixel_send_packet(
+        dynamixel_id,
+        id, instruction, 0, NULL,
+        &error, &status_parameter_size, status_parameter, 0
+    );
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result);
+    UNSIGNED_LONGS_EQUAL(3, status_parameter_size);
+    mock().checkExpectations();
+}
+
+TEST(DynamixelPacket, SendPacketWithInterByteTimeout)
+{
+    uint8_t id = 0x01, instruction = 0x01;
+    int result;
+    uint8_t error;
+    size_t status_parameter_size;
+    uint8_t status_parameter[100] = {0};
+
+    int expected_packet_size;
+    uint8_t expected_packet[100] = {0};
+    size_t expected_output_size = 14;
+    uint8_t expected_output[] = {
+        0xff, 0xff, 0xfd, 0x00,
+        0x01,
+        0x07, 0x00,
+        0x55,
+        0x00,
+        0x06, 0x04,
+        0x26,
+        0x65, 0x5d
+    };
+
+    dynamixel_set_timeout_model(dynamixel_id, DYNAMIXEL_TIMEOUT_MODEL_BAUD_RATE);
+
+    expected_packet_size = create_uart_packet(
+        expected_packet,
+        id, instruction, NULL, 0
+    );
+
+    mock().expectOneCall("pico_uart_start_write")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
+        .withUnsignedIntParameter("len", expected_packet_size);
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
+    // 最初の1Byteは応答パケット全体の時間だけ待つ
+    mock().expectOneCall("pico_uart_is_readable_within_us")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withUnsignedIntParameter("us", 2981)
+        .andReturnValue(0);
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output, 6)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(6);
+    // 受信が始まった後は、8Byte分の時間(1389us) + 余裕(50us)だけ待つ
+    mock().expectOneCall("pico_uart_is_readable_within_us")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withUnsignedIntParameter("us", 1439)
+        .andReturnValue(0);
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output + 6, expected_output_size - 6)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size - 6);
+
+    result = dynamixel_send_packet(
+        dynamixel_id,
+        id, instruction, 0, NULL,
+        &error, &status_parameter_size, status_parameter, 0
+    );
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result);
+    UNSIGNED_LONGS_EQUAL(3, status_parameter_size);
+    mock().checkExpectations();
+}
+
+TEST(DynamixelPacket, SendPacketStopAtExpectedLength)
+{
+    uint8_t id = 0x01, instruction = 0x01;
+    int result;
+    uint8_t error;
+    size_t status_parameter_size;
+    uint8_t status_parameter[100] = {0};
+
+    int expected_packet_size;
+    uint8_t expected_packet[100] = {0};
+    size_t expected_output_size = 14;
+    uint8_t expected_output[] = {
+        0xff, 0xff, 0xfd, 0x00,
+        0x01,
+        0x07, 0x00,
+        0x55,
+        0x00,
+        0x06, 0x04,
+        0x26,
+        0x65, 0x5d
+    };
+
+    dynamixel_set_timeout_model(dynamixel_id, DYNAMIXEL_TIMEOUT_MODEL_BAUD_RATE);
+    dynamixel_set_stop_at_expected_length(dynamixel_id, true);
+
+    expected_packet_size = create_uart_packet(
+        expected_packet,
+        id, instruction, NULL, 0
+    );
+
+    mock().expectOneCall("pico_uart_start_write")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
+        .withUnsignedIntParameter("len", expected_packet_size);
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
+    mock().expectOneCall("pico_uart_is_readable_within_us")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withUnsignedIntParameter("us", 2981)
+        .andReturnValue(0);
+    // pingの応答パケットのサイズ(14Byte)を超えて読み込まない
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", expected_output_size)
+        .andReturnValue(expected_output_size);
+
+    result = dynamixel_send_packet(
+        dynamixel_id,
+        id, instruction, 0, NULL,
+        &error, &status_parameter_size, status_parameter, 0
+    );
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result);
+    UNSIGNED_LONGS_EQUAL(3, status_parameter_size);
+    mock().checkExpectations();
+}
+
+TEST(DynamixelPacket, SendPacketWithResponseSequencing)
+{
+    uint8_t id = 0x01, instruction = 0x01;
+    int result;
+    uint8_t error;
+    size_t status_parameter_size;
+    uint8_t status_parameter[100] = {0};
+    dynamixel_stale_statistics statistics;
+
+    int expected_packet_size;
+    uint8_t expected_packet[100] = {0};
+    // エラー + モデル番号 + ファームウェアのバージョン
+    uint8_t ping_status[] = {0x00, 0x06, 0x04, 0x26};
+    size_t stale_output_size, expected_output_size;
+    uint8_t stale_output[100] = {0};
+    uint8_t expected_output[100] = {0};
+
+    dynamixel_set_response_sequencing(dynamixel_id, true);
+
+    expected_packet_size = create_uart_packet(
+        expected_packet,
+        id, instruction, NULL, 0
+    );
+    // 前の通信で遅れて届いたID 2の応答パケット
+    stale_output_size = create_uart_packet(
+        stale_output,
+        0x02, 0x55, ping_status, sizeof(ping_status)
+    );
+    // 送信後に届いたID 3の応答パケットと、ID 1の応答パケット
+    expected_output_size = create_uart_packet(
+        expected_output,
+        0x03, 0x55, ping_status, sizeof(ping_status)
+    );
+    expected_output_size += create_uart_packet(
+        expected_output + expected_output_size,
+        id, 0x55, ping_status, sizeof(ping_status)
+    );
+
+    // 送信前に受信済みのデータを捨てる(readバッファー全体に読み込む)
+    mock().expectOneCall("pico_uart_is_readable")
+        .withPointerParameter("uart_id", uart_dummy)
+        .andReturnValue(0);
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", stale_output, stale_output_size)
+        .withUnsignedIntParameter("max", 100)
+        .andReturnValue(stale_output_size);
+    mock().expectOneCall("pico_uart_is_readable")
+        .withPointerParameter("uart_id", uart_dummy)
+        .andReturnValue(1);
+    mock().expectOneCall("pico_uart_start_write")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
+        .withUnsignedIntParameter("len", expected_packet_size);
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
+    mock().expectOneCall("pico_uart_is_readable_within_us")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withUnsignedIntParameter("us", 10)
+        .andReturnValue(0);
+    // IDが違う応答パケットを捨て、後に続くID 1の応答パケットを解析する
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
+
+    result = dynamixel_send_packet(
+        dynamixel_id,
+        id, instruction, 0, NULL,
+        &error, &status_parameter_size, status_parameter, 0
+    );
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result);
+    UNSIGNED_LONGS_EQUAL(3, status_parameter_size);
+    MEMCMP_EQUAL(ping_status + 1, status_parameter, 3);
+    dynamixel_get_stale_statistics(dynamixel_id, &statistics);
+    UNSIGNED_LONGS_EQUAL(stale_output_size, statistics.flushed_bytes);
+    UNSIGNED_LONGS_EQUAL(1, statistics.discarded_packets);
+    mock().checkExpectations();
+}
+
+TEST(DynamixelPacket, SendSyncReadWithResponseSequencing)
+{
+    uint8_t id = 0xfe, instruction = 0x82;
+    int result;
+    uint8_t error;
+    size_t status_parameter_size;
+    uint8_t status_parameter[100] = {0};
+    dynamixel_stale_statistics statistics;
+
+    // Present Position(132から4Byte)をID 1とID 2から読む
+    uint8_t parameter[] = {0x84, 0x00, 0x04, 0x00, 0x01, 0x02};
+    int expected_packet_size;
+    uint8_t expected_packet[100] = {0};
+    // エラー + Present Position
+    uint8_t position_status[] = {0x00, 0x00, 0x08, 0x00, 0x00};
+    size_t expected_output_size;
+    uint8_t expected_output[100] = {0};
+
+    dynamixel_set_response_sequencing(dynamixel_id, true);
+
+    expected_packet_size = create_uart_packet(
+        expected_packet,
+        id, instruction, parameter, sizeof(parameter)
+    );
+    // 最初に応答するID 1の応答パケット
+    expected_output_size = create_uart_packet(
+        expected_output,
+        0x01, 0x55, position_status, sizeof(position_status)
+    );
+
+    // 送信前に受信済みのデータはない
+    mock().expectOneCall("pico_uart_is_readable")
+        .withPointerParameter("uart_id", uart_dummy)
+        .andReturnValue(1);
+    mock().expectOneCall("pico_uart_start_write")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
+        .withUnsignedIntParameter("len", expected_packet_size);
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
+    mock().expectOneCall("pico_uart_is_readable_within_us")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withUnsignedIntParameter("us", 10)
+        .andReturnValue(0);
+    // パラメータを含む応答パケットは、サイズが最初のIDの応答パケットと合うので捨てない
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
+
+    result = dynamixel_send_packet(
+        dynamixel_id,
+        id, instruction, sizeof(parameter), parameter,
+        &error, &status_parameter_size, status_parameter, 0
+    );
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result);
+    UNSIGNED_LONGS_EQUAL(4, status_parameter_size);
+    MEMCMP_EQUAL(position_status + 1, status_parameter, 4);
+    dynamixel_get_stale_statistics(dynamixel_id, &statistics);
+    UNSIGNED_LONGS_EQUAL(0, statistics.discarded_packets);
+    mock().checkExpectations();
+}
+
+TEST(DynamixelPacket, SendPacketWithAdaptiveTimeout)
+{
+    uint8_t id = 0x01, instruction = 0x01;
+    int result0, result1, result2;
+    uint8_t error;
+    uint srtt_us, rttvar_us;
+    size_t status_parameter_size;
+    uint8_t status_parameter[100] = {0};
+
+    int expected_packet_size;
+    uint8_t expected_packet[100] = {0};
+    size_t expected_output_size = 14;
+    uint8_t expected_output[] = {
+        0xff, 0xff, 0xfd, 0x00,
+        0x01,
+        0x07, 0x00,
+        0x55,
+        0x00,
+        0x06, 0x04,
+        0x26,
+        0x65, 0x5d
+    };
+
+    // 測定した応答時間を使う
+    dynamixel_set_timeout_model(dynamixel_id, DYNAMIXEL_TIMEOUT_MODEL_ADAPTIVE);
+    dynamixel_set_adaptive_timeout_range_us(dynamixel_id, 1000, 2000);
+    LONGS_EQUAL(1, dynamixel_get_rtt_estimate(dynamixel_id, id, &srtt_us, &rttvar_us));
+
+    expected_packet_size = create_uart_packet(
+        expected_packet,
+        id, instruction, NULL, 0
+    );
+
+    mock().expectNCalls(3, "pico_uart_start_write")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
+        .withUnsignedIntParameter("len", expected_packet_size);
+    mock().expectNCalls(3, "pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
+    // 応答時間を測定するまでは、ボーレートから計算した待ち時間を使う
+    mock().expectNCalls(2, "pico_uart_is_readable_within_us")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withUnsignedIntParameter("us", 2981)
+        .andReturnValue(0);
+    // 測定した応答時間は下限より十分短いので、下限の待ち時間となる
+    mock().expectOneCall("pico_uart_is_readable_within_us")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withUnsignedIntParameter("us", 1000)
+        .andReturnValue(0);
+    mock().expectNCalls(3, "pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
+
+    result0 = dynamixel_send_packet(
+        dynamixel_id,
+        id, instruction, 0, NULL,
+        &error, &status_parameter_size, status_parameter, 0
+    );
+    LONGS_EQUAL(0, dynamixel_get_rtt_estimate(dynamixel_id, id, &srtt_us, &rttvar_us));
+    CHECK(srtt_us < 1000);
+
+    result1 = dynamixel_send_packet(
+        dynamixel_id,
+        id, instruction, 0, NULL,
+        &error, &status_parameter_size, status_parameter, 0
+    );
+
+    // 推定値を破棄すると、ボーレートから計算した待ち時間に戻る
+    dynamixel_reset_rtt_estimate(dynamixel_id, id);
+    LONGS_EQUAL(1, dynamixel_get_rtt_estimate(dynamixel_id, id, &srtt_us, &rttvar_us));
+    result2 = dynamixel_send_packet(
+        dynamixel_id,
+        id, instruction, 0, NULL,
+        &error, &status_parameter_size, status_parameter, 0
+    );
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result0);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result1);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result2);
+    mock().checkExpectations();
+}
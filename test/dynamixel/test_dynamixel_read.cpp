@@ -17,6 +17,8 @@ TEST_GROUP(DynamixelRead)
         dynamixel_id = dynamixel_create(
             uart_dummy, 8, 9, 57600, 100, 10
         );
+        // create時に設定した待ち時間で動作を確認する
+        dynamixel_set_timeout_model(dynamixel_id, DYNAMIXEL_TIMEOUT_MODEL_FIXED);
         mock().clear();
     }
 
@@ -48,18 +50,12 @@ TEST(DynamixelRead, SendReadTorqueEnableSucceed)
     uint8_t expected_error = 0;
     bool expected_torque_enable = true;
 
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_read_torque_enable(
@@ -93,18 +89,12 @@ TEST(DynamixelRead, SendReadPositionSucceed)
     uint8_t expected_error = 0;
     float expected_position = 323.576;
 
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_read_position(
@@ -138,18 +128,12 @@ TEST(DynamixelRead, SendReadVelocitySucceed)
     uint8_t expected_error = 0;
     float expected_velocity = 842.033;
 
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_read_velocity(
@@ -183,18 +167,12 @@ TEST(DynamixelRead, SendReadCurrentSucceed)
     uint8_t expected_error = 0;
     float expected_current = 93;
 
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_read_current(
@@ -228,18 +206,12 @@ TEST(DynamixelRead, SendReadCurrentTemperature)
     uint8_t expected_error = 0;
     float expected_temperature = 50;
 
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_read_temperature(
@@ -273,18 +245,12 @@ TEST(DynamixelRead, SendReadReturnDelayTime)
     uint8_t expected_error = 0;
     uint16_t expected_return_delay_time = 100;
 
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_read_return_delay_time(
@@ -319,18 +285,12 @@ TEST(DynamixelRead, SendReadDriveMode)
     uint8_t expected_profile_configuration = 1;
     uint8_t expected_normal_reverse_mode = 1;
 
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_read_drive_mode(
@@ -365,18 +325,12 @@ TEST(DynamixelRead, SendReadDriveModeWithNull)
     uint8_t expected_error = 0;
     uint8_t expected_torque_on_by_goal_update = 1;
 
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_read_drive_mode(
@@ -410,18 +364,12 @@ TEST(DynamixelRead, SendReadOperatingMode)
     uint8_t expected_error = 0;
     dynamixel_operating_mode expected_operating_mode = DYNAMIXEL_OPERATING_MODE_POSITION_CONTROL;
 
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_read_operating_mode(
@@ -455,18 +403,12 @@ TEST(DynamixelRead, SendReadBaudRate)
     uint8_t expected_error = 0;
     dynamixel_baud_rate expected_baud_rate = DYNAMIXEL_BAUD_RATE_2M;
 
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_read_baud_rate(
@@ -480,3 +422,45 @@ TEST(DynamixelRead, SendReadBaudRate)
     LONGS_EQUAL(expected_baud_rate, baud_rate);
     mock().checkExpectations();
 }
+
+TEST(DynamixelRead, SendReadSecondaryId)
+{
+    uint8_t id = 0x01, error;
+    uint8_t secondary_id;
+    int result;
+
+    size_t expected_output_size = 12;
+    uint8_t expected_output[] = {
+        0xff, 0xff, 0xfd, 0x00,
+        0x01,
+        0x05, 0x00,
+        0x55,
+        0x00,
+        0x05,
+        0x4d, 0x21
+    };
+    uint8_t expected_error = 0;
+    uint8_t expected_secondary_id = 0x05;
+    uint8_t members[4] = {0};
+
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
+    mock().ignoreOtherCalls();
+
+    result = dynamixel_send_read_secondary_id(
+        dynamixel_id, id,
+        &error, &secondary_id,
+        0, 0
+    );
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result);
+    LONGS_EQUAL(expected_error, error);
+    LONGS_EQUAL(expected_secondary_id, secondary_id);
+    UNSIGNED_LONGS_EQUAL(1, dynamixel_get_group_members(dynamixel_id, expected_secondary_id, members, 4));
+    UNSIGNED_LONGS_EQUAL(id, members[0]);
+    mock().checkExpectations();
+}
@@ -17,6 +17,8 @@ TEST_GROUP(DynamixelWrite)
         dynamixel_id = dynamixel_create(
             uart_dummy, 8, 9, 115200, 100, 10
         );
+        // create時に設定した待ち時間で動作を確認する
+        dynamixel_set_timeout_model(dynamixel_id, DYNAMIXEL_TIMEOUT_MODEL_FIXED);
         mock().clear();
     }
 
@@ -57,26 +59,23 @@ TEST(DynamixelWrite, SendWriteTorqueEnableSucceed)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_write_torque_enable(
@@ -118,26 +117,23 @@ TEST(DynamixelWrite, SendWriteGoalPositionSucceed)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_write_goal_position(
@@ -179,26 +175,23 @@ TEST(DynamixelWrite, SendWriteGoalVelocitySucceed)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_write_goal_velocity(
@@ -240,26 +233,23 @@ TEST(DynamixelWrite, SendWriteGoalCurrentSucceed)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_write_goal_current(
@@ -301,26 +291,23 @@ TEST(DynamixelWrite, SendWriteReturnDelayTime)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_write_return_delay_time(
@@ -361,26 +348,23 @@ TEST(DynamixelWrite, SendWriteDriveMode)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_write_drive_mode(
@@ -422,26 +406,23 @@ TEST(DynamixelWrite, SendWriteOperatingMode)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_write_operating_mode(
@@ -483,26 +464,23 @@ TEST(DynamixelWrite, SendWriteBaudRate)
         id, instruction, parameter, parameter_size
     );
 
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
         .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 10)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().ignoreOtherCalls();
 
     result = dynamixel_send_write_baud_rate(
@@ -516,6 +494,122 @@ TEST(DynamixelWrite, SendWriteBaudRate)
     mock().checkExpectations();
 }
 
+TEST(DynamixelWrite, SendWriteSecondaryId)
+{
+    uint8_t id = 0x01, instruction = 0x03, error;
+    uint16_t parameter_size = 0x0003;
+    uint8_t secondary_id = 0x05;
+    int result;
+    uint8_t parameter[] = {
+        0x0c, 0x00, secondary_id
+    };
+
+    int expected_packet_size;
+    uint8_t expected_error = 0;
+    uint8_t expected_packet[100] = {0};
+    size_t expected_output_size = 11;
+    uint8_t expected_output[] = {
+        0xff, 0xff, 0xfd, 0x00,
+        0x01,
+        0x04, 0x00,
+        0x55,
+        0x00,
+        0xa1, 0x0c
+    };
+    uint8_t members[4] = {0};
+
+    expected_packet_size = create_uart_packet(
+        expected_packet,
+        id, instruction, parameter, parameter_size
+    );
+
+    mock().expectOneCall("pico_uart_start_write")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
+        .withUnsignedIntParameter("len", expected_packet_size);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
+    mock().expectOneCall("pico_uart_is_readable_within_us")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withUnsignedIntParameter("us", 10)
+        .andReturnValue(0);
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
+    mock().ignoreOtherCalls();
+
+    result = dynamixel_send_write_secondary_id(
+        dynamixel_id, id,
+        &error, secondary_id,
+        0, 0
+    );
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result);
+    LONGS_EQUAL(expected_error, error);
+    mock().checkExpectations();
+
+    // 書き込みに成功したIDはグループ表に登録される
+    UNSIGNED_LONGS_EQUAL(1, dynamixel_get_group_members(dynamixel_id, secondary_id, members, 4));
+    UNSIGNED_LONGS_EQUAL(id, members[0]);
+}
+
+TEST(DynamixelWrite, SendWriteSecondaryIdOutOfRange)
+{
+    uint8_t id = 0x01, error;
+    int result;
+
+    // パケットは送信されない
+    result = dynamixel_send_write_secondary_id(
+        dynamixel_id, id,
+        &error, 253,
+        0, 0
+    );
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_WRONG_WRITE_PARAMETER, result);
+    UNSIGNED_LONGS_EQUAL(0, dynamixel_get_group_members(dynamixel_id, 253, NULL, 0));
+    mock().checkExpectations();
+}
+
+TEST(DynamixelWrite, SendGroupWriteWithoutWaitingResponse)
+{
+    uint8_t secondary_id = 0x05, instruction = 0x03;
+    uint16_t parameter_size = 0x0004;
+    uint8_t data[] = {
+        0x00, 0x02
+    };
+    uint8_t parameter[] = {
+        0x66, 0x00, 0x00, 0x02
+    };
+    int result;
+
+    int expected_packet_size;
+    uint8_t expected_packet[100] = {0};
+
+    expected_packet_size = create_uart_packet(
+        expected_packet,
+        secondary_id, instruction, parameter, parameter_size
+    );
+
+    // 応答パケットを待たない(pico_uart_is_readable_within_usなどは呼ばれない)
+    mock().expectOneCall("pico_uart_start_write")
+        .withPointerParameter("uart_id", uart_dummy)
+        .withMemoryBufferParameter("src", expected_packet, expected_packet_size)
+        .withUnsignedIntParameter("len", expected_packet_size)
+        .andReturnValue(0);
+
+    result = dynamixel_send_group_write(
+        dynamixel_id, secondary_id, 102, 2, data
+    );
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result);
+    LONGS_EQUAL(14, expected_packet_size);
+    mock().checkExpectations();
+}
+
 TEST(DynamixelWrite, Configure)
 {
     uint8_t id = 0x01, instruction = 0x03, instruction_ping = 0x01, error;
@@ -582,114 +676,99 @@ TEST(DynamixelWrite, Configure)
     );
 
     // PING
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", packet_ping, expected_packet_size_ping)
         .withUnsignedIntParameter("len", expected_packet_size_ping);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size_ping; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output_ping + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output_ping, expected_output_size_ping)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size_ping);
 
     // Torque Enable
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet0, expected_packet_size0)
         .withUnsignedIntParameter("len", expected_packet_size0);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     // ボーレート
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet1, expected_packet_size1)
         .withUnsignedIntParameter("len", expected_packet_size1);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     // return delay time
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet2, expected_packet_size2)
         .withUnsignedIntParameter("len", expected_packet_size2);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     // operating mode
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet3, expected_packet_size3)
         .withUnsignedIntParameter("len", expected_packet_size3);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     mock().ignoreOtherCalls();
 
@@ -774,10 +853,13 @@ TEST(DynamixelWrite, ConfigureMultiplePing)
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("baud_rate", 9600)
         .andReturnValue(9600);
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", packet_ping, expected_packet_size_ping)
         .withUnsignedIntParameter("len", expected_packet_size_ping);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
@@ -788,118 +870,103 @@ TEST(DynamixelWrite, ConfigureMultiplePing)
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("baud_rate", 57600)
         .andReturnValue(57600);
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", packet_ping, expected_packet_size_ping)
         .withUnsignedIntParameter("len", expected_packet_size_ping);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size_ping; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output_ping + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output_ping, expected_output_size_ping)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size_ping);
 
     // Torque Enable
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet0, expected_packet_size0)
         .withUnsignedIntParameter("len", expected_packet_size0);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     // ボーレート
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet1, expected_packet_size1)
         .withUnsignedIntParameter("len", expected_packet_size1);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
     mock().expectOneCall("pico_uart_set_baudrate")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("baud_rate", 115200)
         .andReturnValue(115200);
 
     // return delay time
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet2, expected_packet_size2)
         .withUnsignedIntParameter("len", expected_packet_size2);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     // operating mode
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet3, expected_packet_size3)
         .withUnsignedIntParameter("len", expected_packet_size3);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     mock().ignoreOtherCalls();
 
@@ -981,32 +1048,32 @@ TEST(DynamixelWrite, ConfigureWithRetry)
     );
 
     // PING
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", packet_ping, expected_packet_size_ping)
         .withUnsignedIntParameter("len", expected_packet_size_ping);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size_ping; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output_ping + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output_ping, expected_output_size_ping)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size_ping);
 
     // Torque Enable1
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet0, expected_packet_size0)
         .withUnsignedIntParameter("len", expected_packet_size0);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     // レスポンスなし
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
@@ -1014,92 +1081,80 @@ TEST(DynamixelWrite, ConfigureWithRetry)
         .andReturnValue(1);
 
     // Torque Enable2
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet0, expected_packet_size0)
         .withUnsignedIntParameter("len", expected_packet_size0);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     // ボーレート
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet1, expected_packet_size1)
         .withUnsignedIntParameter("len", expected_packet_size1);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     // return delay time
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet2, expected_packet_size2)
         .withUnsignedIntParameter("len", expected_packet_size2);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     // operating mode
-    mock().expectOneCall("pico_uart_write_blocking")
+    mock().expectOneCall("pico_uart_start_write")
         .withPointerParameter("uart_id", uart_dummy)
         .withMemoryBufferParameter("src", expected_packet3, expected_packet_size3)
         .withUnsignedIntParameter("len", expected_packet_size3);
+    // 応答パケットを待つ前に送信の完了を待つ
+    mock().expectOneCall("pico_uart_wait_write")
+        .withPointerParameter("uart_id", uart_dummy);
     mock().expectOneCall("pico_uart_is_readable_within_us")
         .withPointerParameter("uart_id", uart_dummy)
         .withUnsignedIntParameter("us", 100000)
         .andReturnValue(0);
-    for (int i = 0; i < expected_output_size; i++)
-    {
-        mock().expectOneCall("pico_uart_read_raw")
-            .withPointerParameter("uart_id", uart_dummy)
-            .withOutputParameterReturning("dst", expected_output + i, 1)
-            .andReturnValue(0);
-    }
-    // FIFOにこれ以上のデータなし
-    mock().expectOneCall("pico_uart_read_raw")
+    // FIFOに溜まっているデータをまとめて読み込む
+    mock().expectOneCall("pico_uart_read_available")
         .withPointerParameter("uart_id", uart_dummy)
-        .withOutputParameterReturning("dst", NULL, 0)
-        .andReturnValue(1);
+        .withOutputParameterReturning("dst", expected_output, expected_output_size)
+        .withUnsignedIntParameter("max", 50)
+        .andReturnValue(expected_output_size);
 
     mock().ignoreOtherCalls();
 
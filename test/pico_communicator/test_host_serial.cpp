@@ -0,0 +1,174 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "CppUTest/TestHarness.h"
+#include "pico_communicator/pico_communicator.h"
+#include "pico_communicator/pico_communicator_host.h"
+
+
+// hostではUARTインスタンスのアドレスだけを識別に使う
+static int uart_dummy_entity;
+static int uart_unbound_entity;
+
+TEST_GROUP(HostSerial)
+{
+    uart_inst_t *uart_dummy;
+    int master_fd;
+
+    void setup()
+    {
+        uart_dummy = (uart_inst_t *)&uart_dummy_entity;
+
+        // ptyをシリアルデバイスの代わりに使う
+        master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+        CHECK(master_fd >= 0);
+        CHECK(grantpt(master_fd) == 0);
+        CHECK(unlockpt(master_fd) == 0);
+
+        LONGS_EQUAL(0, pico_uart_host_bind(uart_dummy, ptsname(master_fd)));
+        pico_uart_init(uart_dummy, 1000000, 8, 1, UART_PARITY_NONE);
+        CHECK(pico_uart_host_get_fd(uart_dummy) >= 0);
+    }
+
+    void teardown()
+    {
+        pico_uart_deinit(uart_dummy);
+        close(master_fd);
+    }
+};
+
+
+TEST(HostSerial, WriteReachesDevice)
+{
+    uint8_t packet[] = {0xff, 0xff, 0xfd, 0x00, 0x01, 0x03, 0x00, 0x01, 0x19, 0x4e};
+    uint8_t received[sizeof(packet)] = {0};
+    size_t received_size = 0;
+
+    LONGS_EQUAL(0, pico_uart_write_blocking(uart_dummy, packet, sizeof(packet)));
+
+    while (received_size < sizeof(packet))
+    {
+        ssize_t size = read(master_fd, received + received_size, sizeof(packet) - received_size);
+        CHECK(size > 0);
+        received_size += size;
+    }
+
+    for (size_t i = 0; i < sizeof(packet); i++)
+        UNSIGNED_LONGS_EQUAL(packet[i], received[i]);
+}
+
+TEST(HostSerial, StartWriteWithoutBlocking)
+{
+    uint8_t packet[] = {0xff, 0xff, 0xfd, 0x00, 0x01, 0x03, 0x00, 0x01, 0x19, 0x4e};
+    uint8_t received[sizeof(packet)] = {0};
+    size_t received_size = 0;
+
+    LONGS_EQUAL(0, pico_uart_start_write(uart_dummy, packet, sizeof(packet)));
+    LONGS_EQUAL(0, pico_uart_wait_write(uart_dummy));
+    LONGS_EQUAL(0, pico_uart_write_done(uart_dummy));
+
+    while (received_size < sizeof(packet))
+    {
+        ssize_t size = read(master_fd, received + received_size, sizeof(packet) - received_size);
+        CHECK(size > 0);
+        received_size += size;
+    }
+
+    MEMCMP_EQUAL(packet, received, sizeof(packet));
+}
+
+TEST(HostSerial, ReadBytesSentByDevice)
+{
+    uint8_t response[] = {0x55, 0x00, 0xff, 0xfd};
+    uint8_t data;
+
+    // 何も送られていない場合は読み込めない
+    LONGS_EQUAL(1, pico_uart_is_readable(uart_dummy));
+    LONGS_EQUAL(1, pico_uart_is_readable_within_us(uart_dummy, 1000));
+    LONGS_EQUAL(1, pico_uart_read_raw(uart_dummy, &data));
+
+    CHECK(write(master_fd, response, sizeof(response)) == sizeof(response));
+
+    LONGS_EQUAL(0, pico_uart_is_readable_within_us(uart_dummy, 100000));
+    for (size_t i = 0; i < sizeof(response); i++)
+    {
+        LONGS_EQUAL(0, pico_uart_read_raw(uart_dummy, &data));
+        UNSIGNED_LONGS_EQUAL(response[i], data);
+    }
+    LONGS_EQUAL(1, pico_uart_is_readable(uart_dummy));
+}
+
+TEST(HostSerial, ReadAvailableBytesAtOnce)
+{
+    uint8_t response[] = {0xff, 0xff, 0xfd, 0x00, 0x01, 0x04, 0x00, 0x55, 0x00, 0xa1, 0x0c};
+    uint8_t received[sizeof(response)] = {0};
+    size_t received_size;
+
+    // 何も送られていない場合は0Byte
+    UNSIGNED_LONGS_EQUAL(0, pico_uart_read_available(uart_dummy, received, sizeof(received)));
+
+    CHECK(write(master_fd, response, sizeof(response)) == sizeof(response));
+    LONGS_EQUAL(0, pico_uart_is_readable_within_us(uart_dummy, 100000));
+
+    // 最大サイズを超えて読み込まない
+    received_size = pico_uart_read_available(uart_dummy, received, 4);
+    UNSIGNED_LONGS_EQUAL(4, received_size);
+
+    while (received_size < sizeof(response))
+    {
+        LONGS_EQUAL(0, pico_uart_is_readable_within_us(uart_dummy, 100000));
+        received_size += pico_uart_read_available(
+            uart_dummy, received + received_size, sizeof(received) - received_size
+        );
+    }
+
+    for (size_t i = 0; i < sizeof(response); i++)
+        UNSIGNED_LONGS_EQUAL(response[i], received[i]);
+    LONGS_EQUAL(1, pico_uart_is_readable(uart_dummy));
+}
+
+TEST(HostSerial, PeekAndConsumeReceivedBytes)
+{
+    uint8_t response[] = {0x00, 0xff, 0xff, 0xfd};
+    uint8_t received[4] = {0};
+
+    LONGS_EQUAL(0, pico_uart_enable_rx_irq(uart_dummy, 256));
+    UNSIGNED_LONGS_EQUAL(0, pico_uart_rx_available(uart_dummy));
+
+    CHECK(write(master_fd, response, sizeof(response)) == sizeof(response));
+    LONGS_EQUAL(0, pico_uart_is_readable_within_us(uart_dummy, 100000));
+    while (pico_uart_rx_available(uart_dummy) < sizeof(response))
+        pico_uart_is_readable_within_us(uart_dummy, 100000);
+
+    // peekでは取り出されない
+    UNSIGNED_LONGS_EQUAL(4, pico_uart_rx_peek(uart_dummy, received, sizeof(received)));
+    MEMCMP_EQUAL(response, received, sizeof(response));
+    UNSIGNED_LONGS_EQUAL(4, pico_uart_rx_available(uart_dummy));
+
+    UNSIGNED_LONGS_EQUAL(1, pico_uart_rx_consume(uart_dummy, 1));
+    UNSIGNED_LONGS_EQUAL(3, pico_uart_read_available(uart_dummy, received, sizeof(received)));
+    MEMCMP_EQUAL(response + 1, received, 3);
+
+    pico_uart_disable_rx_irq(uart_dummy);
+}
+
+TEST(HostSerial, ChangeBaudRate)
+{
+    CHECK(pico_uart_set_baudrate(uart_dummy, 4000000) > 0);
+}
+
+TEST(HostSerial, UnboundUartIsNotReadable)
+{
+    uart_inst_t *uart_unbound = (uart_inst_t *)&uart_unbound_entity;
+    uint8_t data = 0;
+
+    pico_uart_init(uart_unbound, 1000000, 8, 1, UART_PARITY_NONE);
+
+    LONGS_EQUAL(-1, pico_uart_host_get_fd(uart_unbound));
+    LONGS_EQUAL(1, pico_uart_write_blocking(uart_unbound, &data, 1));
+    LONGS_EQUAL(1, pico_uart_is_readable_within_us(uart_unbound, 10));
+    LONGS_EQUAL(1, pico_uart_read_raw(uart_unbound, &data));
+    UNSIGNED_LONGS_EQUAL(0, pico_uart_read_available(uart_unbound, &data, 1));
+    LONGS_EQUAL(1, pico_uart_start_write(uart_unbound, &data, 1));
+    LONGS_EQUAL(0, pico_uart_write_done(uart_unbound));
+}
@@ -0,0 +1,434 @@
+#include <cstring>
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "dynamixel/dynamixel_async.h"
+#include "simulator/virtual_bus.h"
+
+
+/// コールバックで受け取った完了
+static dynamixel_async_completion callback_completion[8];
+static size_t callback_completion_num;
+
+static void record_completion(
+    const dynamixel_async_completion *completion
+)
+{
+    callback_completion[callback_completion_num++] = *completion;
+}
+
+
+TEST_GROUP(DYNAMIXEL_ASYNC)
+{
+    virtual_bus_t bus;
+    virtual_servo_t servo[3];
+    dynamixel_transport transport;
+    dynamixel_t dynamixel_id;
+    dynamixel_async_t async;
+
+    void setup()
+    {
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+        dynamixel_async_config config = {4, 16, 8, 8};
+
+        bus = virtual_bus_create(1000000);
+        for (size_t i = 0; i < 3; i++)
+        {
+            servo[i] = virtual_servo_create(i + 1);
+            virtual_servo_write_table(servo[i], 8, 1, &baud_rate_1m);
+            virtual_servo_set_return_delay_time_us(servo[i], 0);
+            virtual_bus_add_servo(bus, servo[i]);
+        }
+        virtual_bus_init_transport(bus, &transport);
+
+        dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+        async = dynamixel_async_create(dynamixel_id, &config);
+        callback_completion_num = 0;
+    }
+
+    void teardown()
+    {
+        dynamixel_async_destroy(async);
+        dynamixel_destroy(dynamixel_id);
+        virtual_bus_destroy(bus);
+        for (size_t i = 0; i < 3; i++)
+            virtual_servo_destroy(servo[i]);
+    }
+
+    int submit(uint8_t id, uint8_t instruction, uint16_t parameter_size, const uint8_t *parameter)
+    {
+        dynamixel_async_request request = {id, instruction, parameter_size, parameter, NULL, NULL};
+
+        return dynamixel_async_submit(async, &request);
+    }
+
+    /// 通信が終わるまで、step_usごとに通信を進める
+    size_t run(uint64_t step_us)
+    {
+        size_t step_num = 0;
+
+        while (dynamixel_async_progress(async))
+        {
+            // 通信中に他の処理を行う時間
+            virtual_bus_advance_us(bus, step_us);
+            step_num++;
+        }
+
+        return step_num;
+    }
+};
+
+TEST(DYNAMIXEL_ASYNC, PingAndReadByPolling)
+{
+    uint8_t read_parameter[] = {132, 0, 4, 0};
+    dynamixel_async_completion completion;
+    uint64_t start_us = virtual_bus_get_time_us(bus);
+    uint32_t srtt_us, rttvar_us;
+
+    LONGS_EQUAL(0, submit(1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL));
+    LONGS_EQUAL(0, submit(1, DYNAMIXEL__INSTRUCTION_READ, 4, read_parameter));
+
+    // 送信を開始してすぐに戻る
+    UNSIGNED_LONGS_EQUAL(2, dynamixel_async_progress(async));
+    UNSIGNED_LONGS_EQUAL(start_us, virtual_bus_get_time_us(bus));
+    CHECK(run(10) > 0);
+
+    LONGS_EQUAL(0, dynamixel_async_poll(async, &completion));
+    BYTES_EQUAL(DYNAMIXEL__INSTRUCTION_PING, completion.instruction);
+    UNSIGNED_LONGS_EQUAL(1, completion.id);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, completion.result);
+    UNSIGNED_LONGS_EQUAL(3, completion.status_parameter_size);
+    UNSIGNED_LONGS_EQUAL(
+        VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288,
+        completion.status_parameter[0] | (completion.status_parameter[1] << 8)
+    );
+    CHECK_TRUE(completion.last);
+
+    LONGS_EQUAL(0, dynamixel_async_poll(async, &completion));
+    BYTES_EQUAL(DYNAMIXEL__INSTRUCTION_READ, completion.instruction);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, completion.result);
+    UNSIGNED_LONGS_EQUAL(4, completion.status_parameter_size);
+    BYTES_EQUAL(0x00, completion.status_parameter[0]);
+    BYTES_EQUAL(0x08, completion.status_parameter[1]);
+
+    LONGS_EQUAL(1, dynamixel_async_poll(async, &completion));
+
+    // 応答時間はdynamixelインスタンスで測定される
+    LONGS_EQUAL(0, dynamixel_get_rtt_estimate(dynamixel_id, 1, &srtt_us, &rttvar_us));
+}
+
+TEST(DYNAMIXEL_ASYNC, WriteCompletesByCallback)
+{
+    int tag;
+    // Goal Position = 1024
+    uint8_t write_parameter[] = {116, 0, 0x00, 0x04, 0x00, 0x00};
+    uint8_t goal_position[4];
+    dynamixel_async_request request = {
+        2, DYNAMIXEL__INSTRUCTION_WRITE, 6, write_parameter, record_completion, &tag
+    };
+
+    LONGS_EQUAL(0, dynamixel_async_submit(async, &request));
+    // リクエストはコピーされる
+    memset(write_parameter, 0, sizeof(write_parameter));
+    run(10);
+
+    UNSIGNED_LONGS_EQUAL(1, callback_completion_num);
+    POINTERS_EQUAL(&tag, callback_completion[0].user_data);
+    UNSIGNED_LONGS_EQUAL(2, callback_completion[0].id);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, callback_completion[0].result);
+    virtual_servo_read_table(servo[1], 116, 4, goal_position);
+    BYTES_EQUAL(0x04, goal_position[1]);
+}
+
+TEST(DYNAMIXEL_ASYNC, SyncReadCompletesForEachId)
+{
+    // Present Position、4Byte、ID 3, 1, 2
+    uint8_t sync_read_parameter[] = {132, 0, 4, 0, 3, 1, 2};
+    // Goal Position、4Byte、ID 1, 2
+    uint8_t sync_write_parameter[] = {116, 0, 4, 0, 1, 0x00, 0x02, 0x00, 0x00, 2, 0x00, 0x02, 0x00, 0x00};
+    const uint8_t expected_id[] = {3, 1, 2};
+    dynamixel_async_completion completion;
+    dynamixel_status_timestamp timestamp[3];
+
+    LONGS_EQUAL(0, submit(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_WRITE, sizeof(sync_write_parameter), sync_write_parameter));
+    LONGS_EQUAL(0, submit(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, sizeof(sync_read_parameter), sync_read_parameter));
+    // 通信を進める間隔が長く、複数の応答パケットをまとめて読み込む場合も取りこぼさない
+    run(1000);
+
+    // Sync Writeは応答パケットを返さないので、送信が完了した時点で完了する
+    LONGS_EQUAL(0, dynamixel_async_poll(async, &completion));
+    BYTES_EQUAL(DYNAMIXEL__INSTRUCTION_SYNC_WRITE, completion.instruction);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, completion.result);
+    CHECK_TRUE(completion.last);
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        LONGS_EQUAL(0, dynamixel_async_poll(async, &completion));
+        BYTES_EQUAL(DYNAMIXEL__INSTRUCTION_SYNC_READ, completion.instruction);
+        UNSIGNED_LONGS_EQUAL(expected_id[i], completion.id);
+        LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, completion.result);
+        UNSIGNED_LONGS_EQUAL(4, completion.status_parameter_size);
+        CHECK_EQUAL(i == 2, completion.last);
+    }
+    LONGS_EQUAL(1, dynamixel_async_poll(async, &completion));
+
+    // IDごとの受信時刻は、dynamixelインスタンスで記録される
+    for (size_t i = 0; i < 3; i++)
+        LONGS_EQUAL(0, dynamixel_get_status_timestamp_of_id(dynamixel_id, expected_id[i], &timestamp[i]));
+    CHECK(timestamp[0].crc_us <= timestamp[1].header_us);
+    CHECK(timestamp[1].crc_us <= timestamp[2].header_us);
+}
+
+TEST(DYNAMIXEL_ASYNC, SyncReadStopsAfterMissingId)
+{
+    uint8_t parameter[] = {132, 0, 4, 0, 1, 9, 2};
+    dynamixel_async_completion completion;
+
+    LONGS_EQUAL(0, submit(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, sizeof(parameter), parameter));
+    run(10);
+
+    LONGS_EQUAL(0, dynamixel_async_poll(async, &completion));
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, completion.result);
+    // ID 9の応答がないため、ID 2は応答しない
+    LONGS_EQUAL(0, dynamixel_async_poll(async, &completion));
+    UNSIGNED_LONGS_EQUAL(9, completion.id);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, completion.result);
+    LONGS_EQUAL(0, dynamixel_async_poll(async, &completion));
+    UNSIGNED_LONGS_EQUAL(2, completion.id);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, completion.result);
+    CHECK_TRUE(completion.last);
+}
+
+TEST(DYNAMIXEL_ASYNC, SubmitRejectsWhenPoolIsFull)
+{
+    uint8_t sync_read_parameter[] = {132, 0, 4, 0, 1, 2, 3, 1, 2, 3, 1, 2, 3};
+    dynamixel_async_completion completion;
+
+    // 応答するDynamixelの数が分からない
+    LONGS_EQUAL(1, submit(0xfe, DYNAMIXEL__INSTRUCTION_PING, 0, NULL));
+    // 応答パケットが完了キューに入りきらない
+    LONGS_EQUAL(1, submit(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, sizeof(sync_read_parameter), sync_read_parameter));
+
+    for (size_t i = 0; i < 4; i++)
+        LONGS_EQUAL(0, submit(i + 1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL));
+    LONGS_EQUAL(1, submit(1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL));
+
+    // 完了したリクエストの領域は再び使える
+    run(10);
+    LONGS_EQUAL(0, submit(1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL));
+    run(10);
+
+    for (size_t i = 0; i < 5; i++)
+        LONGS_EQUAL(0, dynamixel_async_poll(async, &completion));
+    // ID 4は存在しない
+    UNSIGNED_LONGS_EQUAL(1, completion.id);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, completion.result);
+}
+
+TEST(DYNAMIXEL_ASYNC, SafetyRequestIsSentBeforeQueuedTelemetry)
+{
+    // Present Temperature
+    uint8_t read_parameter[] = {146, 0, 1, 0};
+    // Torque Enable = 0
+    uint8_t torque_off_parameter[] = {64, 0, 0};
+    int tag[4];
+    dynamixel_async_request request = {
+        1, DYNAMIXEL__INSTRUCTION_READ, 4, read_parameter,
+        record_completion, NULL, DYNAMIXEL_ASYNC_PRIORITY_BACKGROUND, 0
+    };
+    dynamixel_async_request torque_off = {
+        2, DYNAMIXEL__INSTRUCTION_WRITE, 3, torque_off_parameter,
+        record_completion, &tag[3], DYNAMIXEL_ASYNC_PRIORITY_SAFETY, 0
+    };
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        request.user_data = &tag[i];
+        LONGS_EQUAL(0, dynamixel_async_submit(async, &request));
+    }
+    // 最初の監視のリクエストを送信した後に、トルクオフを受け付ける
+    UNSIGNED_LONGS_EQUAL(3, dynamixel_async_progress(async));
+    LONGS_EQUAL(0, dynamixel_async_submit(async, &torque_off));
+    run(10);
+
+    // 通信中のリクエストの次に送信する
+    UNSIGNED_LONGS_EQUAL(4, callback_completion_num);
+    POINTERS_EQUAL(&tag[0], callback_completion[0].user_data);
+    POINTERS_EQUAL(&tag[3], callback_completion[1].user_data);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, callback_completion[1].result);
+    POINTERS_EQUAL(&tag[1], callback_completion[2].user_data);
+    POINTERS_EQUAL(&tag[2], callback_completion[3].user_data);
+
+    // 不正な優先度は受け付けない
+    request.priority = DYNAMIXEL_ASYNC_PRIORITY_NUM;
+    LONGS_EQUAL(1, dynamixel_async_submit(async, &request));
+}
+
+TEST(DYNAMIXEL_ASYNC, SafetyRequestWaitsForWholeResponseTrain)
+{
+    // Present Position、4Byte、ID 1, 2, 3
+    uint8_t sync_read_parameter[] = {132, 0, 4, 0, 1, 2, 3};
+    // Torque Enable = 0
+    uint8_t torque_off_parameter[] = {64, 0, 0};
+    int tag;
+    dynamixel_async_request sync_read = {
+        0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, sizeof(sync_read_parameter), sync_read_parameter,
+        record_completion, NULL, DYNAMIXEL_ASYNC_PRIORITY_BACKGROUND, 0
+    };
+    dynamixel_async_request torque_off = {
+        2, DYNAMIXEL__INSTRUCTION_WRITE, 3, torque_off_parameter,
+        record_completion, &tag, DYNAMIXEL_ASYNC_PRIORITY_SAFETY, 0
+    };
+    dynamixel_status_timestamp last_response, torque_off_response;
+    virtual_bus_statistics statistics;
+
+    LONGS_EQUAL(0, dynamixel_async_submit(async, &sync_read));
+    UNSIGNED_LONGS_EQUAL(1, dynamixel_async_progress(async));
+    LONGS_EQUAL(0, dynamixel_async_submit(async, &torque_off));
+    // 最初の応答パケットを受け取った後も、残りの応答パケットを待つ
+    while (callback_completion_num == 0)
+    {
+        dynamixel_async_progress(async);
+        virtual_bus_advance_us(bus, 10);
+    }
+    virtual_bus_get_statistics(bus, &statistics);
+    UNSIGNED_LONGS_EQUAL(1, statistics.instruction_packets);
+    run(10);
+
+    UNSIGNED_LONGS_EQUAL(4, callback_completion_num);
+    for (size_t i = 0; i < 3; i++)
+    {
+        BYTES_EQUAL(DYNAMIXEL__INSTRUCTION_SYNC_READ, callback_completion[i].instruction);
+        UNSIGNED_LONGS_EQUAL(i + 1, callback_completion[i].id);
+        LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, callback_completion[i].result);
+    }
+    POINTERS_EQUAL(&tag, callback_completion[3].user_data);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, callback_completion[3].result);
+
+    // トルクオフは最後の応答パケットを受信した後に送信される
+    LONGS_EQUAL(0, dynamixel_get_status_timestamp_of_id(dynamixel_id, 3, &last_response));
+    LONGS_EQUAL(0, dynamixel_get_status_timestamp_of_id(dynamixel_id, 2, &torque_off_response));
+    CHECK(torque_off_response.instruction_us > last_response.crc_us);
+}
+
+TEST(DYNAMIXEL_ASYNC, SafetyRequestAbortsBackgroundRetries)
+{
+    uint8_t read_parameter[] = {146, 0, 1, 0};
+    virtual_bus_statistics statistics;
+    // ID 9は存在しない
+    dynamixel_async_request request = {
+        9, DYNAMIXEL__INSTRUCTION_READ, 4, read_parameter,
+        record_completion, NULL, DYNAMIXEL_ASYNC_PRIORITY_BACKGROUND, 3
+    };
+    dynamixel_async_request ping = {
+        1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL,
+        record_completion, NULL, DYNAMIXEL_ASYNC_PRIORITY_SAFETY, 0
+    };
+
+    // 安全のためのリクエストがなければ、3回再送する
+    LONGS_EQUAL(0, dynamixel_async_submit(async, &request));
+    run(10);
+    virtual_bus_get_statistics(bus, &statistics);
+    UNSIGNED_LONGS_EQUAL(4, statistics.instruction_packets);
+    UNSIGNED_LONGS_EQUAL(1, callback_completion_num);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, callback_completion[0].result);
+
+    // 待っている安全のためのリクエストがあれば、再送せずに完了する
+    LONGS_EQUAL(0, dynamixel_async_submit(async, &request));
+    dynamixel_async_progress(async);
+    LONGS_EQUAL(0, dynamixel_async_submit(async, &ping));
+    run(10);
+    virtual_bus_get_statistics(bus, &statistics);
+    UNSIGNED_LONGS_EQUAL(4 + 2, statistics.instruction_packets);
+    UNSIGNED_LONGS_EQUAL(3, callback_completion_num);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, callback_completion[1].result);
+    BYTES_EQUAL(DYNAMIXEL__INSTRUCTION_PING, callback_completion[2].instruction);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, callback_completion[2].result);
+}
+
+TEST(DYNAMIXEL_ASYNC, ControlRetryYieldsToSafetyRequest)
+{
+    uint8_t read_parameter[] = {132, 0, 4, 0};
+    virtual_bus_statistics statistics;
+    dynamixel_async_request request = {
+        9, DYNAMIXEL__INSTRUCTION_READ, 4, read_parameter,
+        record_completion, NULL, DYNAMIXEL_ASYNC_PRIORITY_CONTROL, 1
+    };
+    dynamixel_async_request ping = {
+        1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL,
+        record_completion, NULL, DYNAMIXEL_ASYNC_PRIORITY_SAFETY, 0
+    };
+
+    LONGS_EQUAL(0, dynamixel_async_submit(async, &request));
+    dynamixel_async_progress(async);
+    LONGS_EQUAL(0, dynamixel_async_submit(async, &ping));
+    run(10);
+
+    // 制御のリクエストは、安全のためのリクエストの後に再送する
+    virtual_bus_get_statistics(bus, &statistics);
+    UNSIGNED_LONGS_EQUAL(3, statistics.instruction_packets);
+    UNSIGNED_LONGS_EQUAL(2, callback_completion_num);
+    BYTES_EQUAL(DYNAMIXEL__INSTRUCTION_PING, callback_completion[0].instruction);
+    UNSIGNED_LONGS_EQUAL(9, callback_completion[1].id);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, callback_completion[1].result);
+}
+
+TEST(DYNAMIXEL_ASYNC, NoResponseRequestCompletesAfterWriteDone)
+{
+    // Goal Position、4Byte、ID 1
+    uint8_t sync_write_parameter[] = {116, 0, 4, 0, 1, 0x00, 0x02, 0x00, 0x00};
+    dynamixel_async_completion completion;
+
+    LONGS_EQUAL(0, submit(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_WRITE, sizeof(sync_write_parameter), sync_write_parameter));
+
+    // 送信が完了するまで完了しない(インストラクションパケット19Byte)
+    UNSIGNED_LONGS_EQUAL(1, dynamixel_async_progress(async));
+    virtual_bus_advance_us(bus, 18 * 10);
+    UNSIGNED_LONGS_EQUAL(1, dynamixel_async_progress(async));
+    LONGS_EQUAL(1, dynamixel_async_poll(async, &completion));
+
+    virtual_bus_advance_us(bus, 10);
+    UNSIGNED_LONGS_EQUAL(0, dynamixel_async_progress(async));
+    LONGS_EQUAL(0, dynamixel_async_poll(async, &completion));
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, completion.result);
+}
+
+
+static int fail_write_async(void *context, const uint8_t *src, size_t len)
+{
+    return 1;
+}
+
+TEST(DYNAMIXEL_ASYNC, WriteFailureIsReportedWithoutWaiting)
+{
+    uint8_t sync_read_parameter[] = {132, 0, 4, 0, 1, 2};
+    dynamixel_transport failing_transport = transport;
+    dynamixel_t failing_dynamixel;
+    dynamixel_async_t failing_async;
+    dynamixel_async_config config = {4, 16, 8, 8};
+    dynamixel_async_request ping = {1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL, record_completion, NULL};
+    dynamixel_async_request sync_read = {
+        0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, sizeof(sync_read_parameter), sync_read_parameter,
+        record_completion, NULL
+    };
+    uint64_t start_us = virtual_bus_get_time_us(bus);
+
+    failing_transport.write_async = fail_write_async;
+    failing_dynamixel = dynamixel_create_with_transport(&failing_transport, 1000000, 100, 10);
+    failing_async = dynamixel_async_create(failing_dynamixel, &config);
+
+    LONGS_EQUAL(0, dynamixel_async_submit(failing_async, &ping));
+    LONGS_EQUAL(0, dynamixel_async_submit(failing_async, &sync_read));
+    UNSIGNED_LONGS_EQUAL(0, dynamixel_async_progress(failing_async));
+
+    // 応答パケットを待たずに、全ての応答パケットの分が送信の失敗として完了する
+    UNSIGNED_LONGS_EQUAL(start_us, virtual_bus_get_time_us(bus));
+    UNSIGNED_LONGS_EQUAL(3, callback_completion_num);
+    for (size_t i = 0; i < 3; i++)
+        LONGS_EQUAL(DYNAMIXEL_PARSE_WRITE_FAILED, callback_completion[i].result);
+    CHECK_TRUE(callback_completion[0].last);
+    CHECK_FALSE(callback_completion[1].last);
+    CHECK_TRUE(callback_completion[2].last);
+
+    dynamixel_async_destroy(failing_async);
+    dynamixel_destroy(failing_dynamixel);
+}
@@ -0,0 +1,297 @@
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "dynamixel/dynamixel_cycle.h"
+#include "simulator/virtual_bus.h"
+
+
+/// 周期ごとに呼ばれた計算の記録
+typedef struct
+{
+    virtual_bus_t bus;
+    uint64_t cycle[16];
+    uint64_t start_us[16];
+    size_t call_num;
+    // 計算に時間がかかる周期と、その時間
+    uint64_t slow_cycle;
+    uint64_t slow_us;
+    uint8_t present_position[4];
+    uint8_t goal_position[4];
+} compute_record;
+
+
+static void compute(
+    void *user_data,
+    uint64_t cycle
+)
+{
+    compute_record *record = (compute_record *)user_data;
+
+    if (record->call_num < 16)
+    {
+        record->cycle[record->call_num] = cycle;
+        record->start_us[record->call_num] = virtual_bus_get_time_us(record->bus);
+    }
+    record->call_num++;
+
+    // 現在位置から少し進めた位置を目標位置とする
+    for (size_t i = 0; i < 4; i++)
+        record->goal_position[i] = record->present_position[i];
+    record->goal_position[0] += 10;
+
+    if (cycle == record->slow_cycle)
+        virtual_bus_advance_us(record->bus, record->slow_us);
+}
+
+
+/// 仮想時間を進めて待つ
+static void sleep_until(
+    void *context,
+    uint64_t deadline_us
+)
+{
+    virtual_bus_t bus = (virtual_bus_t)context;
+    uint64_t now_us = virtual_bus_get_time_us(bus);
+
+    if (now_us < deadline_us)
+        virtual_bus_advance_us(bus, deadline_us - now_us);
+}
+
+
+TEST_GROUP(DYNAMIXEL_CYCLE)
+{
+    virtual_bus_t bus;
+    virtual_servo_t servo[2];
+    dynamixel_transport transport;
+    dynamixel_t dynamixel_id;
+    dynamixel_cycle_t cycle;
+    compute_record record;
+
+    void setup()
+    {
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+
+        bus = virtual_bus_create(1000000);
+        for (size_t i = 0; i < 2; i++)
+        {
+            servo[i] = virtual_servo_create(i + 1);
+            virtual_servo_write_table(servo[i], 8, 1, &baud_rate_1m);
+            virtual_servo_set_return_delay_time_us(servo[i], 0);
+            virtual_bus_add_servo(bus, servo[i]);
+        }
+        virtual_bus_init_transport(bus, &transport);
+
+        dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+        memset(&record, 0, sizeof(record));
+        record.bus = bus;
+        record.slow_cycle = UINT64_MAX;
+        cycle = NULL;
+    }
+
+    void teardown()
+    {
+        if (cycle)
+            dynamixel_cycle_destroy(cycle);
+        dynamixel_destroy(dynamixel_id);
+        virtual_bus_destroy(bus);
+        for (size_t i = 0; i < 2; i++)
+            virtual_servo_destroy(servo[i]);
+    }
+
+    /// 各Dynamixelの現在位置を読み、目標位置を書く周期を作成する
+    void create_cycle(uint32_t period_us, dynamixel_cycle_overrun_policy overrun_policy, size_t servo_num)
+    {
+        dynamixel_cycle_config config = {
+            period_us, overrun_policy, 4, compute, &record, sleep_until, bus
+        };
+
+        cycle = dynamixel_cycle_create(dynamixel_id, &config);
+        for (size_t i = 0; i < servo_num; i++)
+        {
+            LONGS_EQUAL(0, dynamixel_cycle_add_read(cycle, i + 1, 132, 4, record.present_position, NULL));
+            LONGS_EQUAL(0, dynamixel_cycle_add_write(cycle, i + 1, 116, 4, record.goal_position, NULL));
+        }
+    }
+
+    void print_statistics(const char *name)
+    {
+        dynamixel_cycle_statistics statistics;
+
+        dynamixel_cycle_get_statistics(cycle, &statistics);
+        UT_PRINT(StringFromFormat(
+            "%s: period %u-%u us, start delay max %u us, overruns %u, read %.0f us, compute %.0f us, write %.0f us",
+            name, (unsigned)statistics.period_min_us, (unsigned)statistics.period_max_us,
+            (unsigned)statistics.start_delay_max_us, (unsigned)statistics.overruns,
+            (double)statistics.phase_sum_us[DYNAMIXEL_CYCLE_PHASE_READ] / statistics.cycles,
+            (double)statistics.phase_sum_us[DYNAMIXEL_CYCLE_PHASE_COMPUTE] / statistics.cycles,
+            (double)statistics.phase_sum_us[DYNAMIXEL_CYCLE_PHASE_WRITE] / statistics.cycles
+        ).asCharString());
+    }
+};
+
+TEST(DYNAMIXEL_CYCLE, RejectsZeroPeriodAndTooManyTransactions)
+{
+    uint8_t data[4];
+    dynamixel_cycle_config config = {0, DYNAMIXEL_CYCLE_OVERRUN_SKIP, 1, NULL, NULL, sleep_until, bus};
+
+    POINTERS_EQUAL(NULL, dynamixel_cycle_create(dynamixel_id, &config));
+
+    config.period_us = 1000;
+    cycle = dynamixel_cycle_create(dynamixel_id, &config);
+    LONGS_EQUAL(0, dynamixel_cycle_add_read(cycle, 1, 132, 4, data, NULL));
+    LONGS_EQUAL(1, dynamixel_cycle_add_write(cycle, 1, 116, 4, data, NULL));
+}
+
+TEST(DYNAMIXEL_CYCLE, Holds1kHzAgainstAbsoluteDeadlines)
+{
+    dynamixel_cycle_statistics statistics;
+    uint8_t goal_position[4];
+    uint64_t start_us = virtual_bus_get_time_us(bus);
+
+    create_cycle(1000, DYNAMIXEL_CYCLE_OVERRUN_SKIP, 1);
+    for (size_t i = 0; i < 1000; i++)
+        LONGS_EQUAL(0, dynamixel_cycle_run(cycle));
+
+    for (size_t i = 0; i < 16; i++)
+    {
+        UNSIGNED_LONGS_EQUAL(i, record.cycle[i]);
+        // readの送受信(14Byte + 15Byte)の後に計算する
+        UNSIGNED_LONGS_EQUAL(start_us + i * 1000 + 29 * 10, record.start_us[i]);
+    }
+
+    dynamixel_cycle_get_statistics(cycle, &statistics);
+    UNSIGNED_LONGS_EQUAL(1000, statistics.cycles);
+    UNSIGNED_LONGS_EQUAL(0, statistics.overruns);
+    UNSIGNED_LONGS_EQUAL(0, statistics.transaction_errors);
+    UNSIGNED_LONGS_EQUAL(1000, statistics.period_min_us);
+    UNSIGNED_LONGS_EQUAL(1000, statistics.period_max_us);
+    UNSIGNED_LONGS_EQUAL(0, statistics.start_delay_max_us);
+    UNSIGNED_LONGS_EQUAL(29 * 10, statistics.phase_max_us[DYNAMIXEL_CYCLE_PHASE_READ]);
+    // Goal Positionのwrite(16Byte + 11Byte)
+    UNSIGNED_LONGS_EQUAL(27 * 10, statistics.phase_max_us[DYNAMIXEL_CYCLE_PHASE_WRITE]);
+
+    // 計算したデータを書き込んでいる
+    virtual_servo_read_table(servo[0], 116, 4, goal_position);
+    MEMCMP_EQUAL(record.goal_position, goal_position, 4);
+    print_statistics("1 servo at 1 kHz");
+}
+
+TEST(DYNAMIXEL_CYCLE, FailedTransactionKeepsPeriod)
+{
+    dynamixel_cycle_statistics statistics;
+    dynamixel_parse_result result = DYNAMIXEL_PARSE_SUCCESS;
+    uint8_t data[4];
+
+    create_cycle(2000, DYNAMIXEL_CYCLE_OVERRUN_SKIP, 1);
+    // ID 9は存在しない
+    dynamixel_cycle_add_read(cycle, 9, 132, 4, data, &result);
+    for (size_t i = 0; i < 10; i++)
+        LONGS_EQUAL(0, dynamixel_cycle_run(cycle));
+
+    dynamixel_cycle_get_statistics(cycle, &statistics);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, result);
+    UNSIGNED_LONGS_EQUAL(10, statistics.transaction_errors);
+    UNSIGNED_LONGS_EQUAL(2000, statistics.period_min_us);
+    UNSIGNED_LONGS_EQUAL(2000, statistics.period_max_us);
+}
+
+TEST(DYNAMIXEL_CYCLE, Holds500HzWith2Servos)
+{
+    dynamixel_cycle_statistics statistics;
+
+    create_cycle(2000, DYNAMIXEL_CYCLE_OVERRUN_SKIP, 2);
+    for (size_t i = 0; i < 500; i++)
+        LONGS_EQUAL(0, dynamixel_cycle_run(cycle));
+
+    dynamixel_cycle_get_statistics(cycle, &statistics);
+    UNSIGNED_LONGS_EQUAL(0, statistics.overruns);
+    UNSIGNED_LONGS_EQUAL(2000, statistics.period_min_us);
+    UNSIGNED_LONGS_EQUAL(2000, statistics.period_max_us);
+    print_statistics("2 servos at 500 Hz");
+}
+
+TEST(DYNAMIXEL_CYCLE, OverrunSkipsMissedCycles)
+{
+    dynamixel_cycle_statistics statistics;
+    uint64_t start_us = virtual_bus_get_time_us(bus);
+
+    create_cycle(1000, DYNAMIXEL_CYCLE_OVERRUN_SKIP, 1);
+    // 周期3の計算に2周期かかり、5.56msに終わる
+    record.slow_cycle = 3;
+    record.slow_us = 2000;
+
+    for (size_t i = 0; i < 3; i++)
+        LONGS_EQUAL(0, dynamixel_cycle_run(cycle));
+    LONGS_EQUAL(1, dynamixel_cycle_run(cycle));
+    LONGS_EQUAL(0, dynamixel_cycle_run(cycle));
+
+    // 周期4、5を飛ばして、周期6の開始時刻から始める
+    UNSIGNED_LONGS_EQUAL(6, record.cycle[4]);
+    UNSIGNED_LONGS_EQUAL(start_us + 6000 + 29 * 10, record.start_us[4]);
+
+    dynamixel_cycle_get_statistics(cycle, &statistics);
+    UNSIGNED_LONGS_EQUAL(1, statistics.overruns);
+    UNSIGNED_LONGS_EQUAL(2, statistics.skipped_cycles);
+    UNSIGNED_LONGS_EQUAL(0, statistics.start_delay_max_us);
+    UNSIGNED_LONGS_EQUAL(3000, statistics.period_max_us);
+    UNSIGNED_LONGS_EQUAL(2000, statistics.phase_max_us[DYNAMIXEL_CYCLE_PHASE_COMPUTE]);
+}
+
+TEST(DYNAMIXEL_CYCLE, OverrunCompressCatchesUp)
+{
+    dynamixel_cycle_statistics statistics;
+    uint64_t start_us = virtual_bus_get_time_us(bus);
+
+    create_cycle(1000, DYNAMIXEL_CYCLE_OVERRUN_COMPRESS, 1);
+    // 周期3は5.56msに終わる
+    record.slow_cycle = 3;
+    record.slow_us = 2000;
+
+    for (size_t i = 0; i < 8; i++)
+        dynamixel_cycle_run(cycle);
+
+    // 1周期以上遅れた周期4を飛ばし、周期5、6を間隔を詰めてすぐに始める
+    UNSIGNED_LONGS_EQUAL(5, record.cycle[4]);
+    UNSIGNED_LONGS_EQUAL(start_us + 5560 + 290, record.start_us[4]);
+    UNSIGNED_LONGS_EQUAL(6, record.cycle[5]);
+    UNSIGNED_LONGS_EQUAL(start_us + 6120 + 290, record.start_us[5]);
+    // 周期7からは予定の開始時刻に戻る
+    UNSIGNED_LONGS_EQUAL(7, record.cycle[6]);
+    UNSIGNED_LONGS_EQUAL(start_us + 7000 + 290, record.start_us[6]);
+
+    dynamixel_cycle_get_statistics(cycle, &statistics);
+    UNSIGNED_LONGS_EQUAL(2, statistics.overruns);
+    UNSIGNED_LONGS_EQUAL(1, statistics.skipped_cycles);
+    UNSIGNED_LONGS_EQUAL(560, statistics.start_delay_max_us);
+    UNSIGNED_LONGS_EQUAL(560, statistics.period_min_us);
+}
+
+TEST(DYNAMIXEL_CYCLE, FlushesMailboxInWritePhase)
+{
+    const uint8_t id[] = {1, 2};
+    dynamixel_mailbox_t mailbox = dynamixel_mailbox_create(id, 2, 116, 4);
+    virtual_bus_statistics bus_statistics;
+    uint8_t goal_position[4];
+
+    create_cycle(1000, DYNAMIXEL_CYCLE_OVERRUN_SKIP, 0);
+    dynamixel_cycle_set_mailbox(cycle, mailbox);
+
+    // 2つの値は1つのSync Writeで送る
+    LONGS_EQUAL(0, dynamixel_mailbox_post_goal_position(mailbox, 1, 0.088 * 100));
+    LONGS_EQUAL(0, dynamixel_mailbox_post_goal_position(mailbox, 2, 0.088 * 200));
+    LONGS_EQUAL(0, dynamixel_cycle_run(cycle));
+    virtual_bus_get_statistics(bus, &bus_statistics);
+    UNSIGNED_LONGS_EQUAL(1, bus_statistics.instruction_packets);
+    virtual_servo_read_table(servo[0], 116, 4, goal_position);
+    BYTES_EQUAL(100, goal_position[0]);
+    virtual_servo_read_table(servo[1], 116, 4, goal_position);
+    BYTES_EQUAL(200, goal_position[0]);
+
+    // 更新がなければ送らない
+    LONGS_EQUAL(0, dynamixel_cycle_run(cycle));
+    virtual_bus_get_statistics(bus, &bus_statistics);
+    UNSIGNED_LONGS_EQUAL(1, bus_statistics.instruction_packets);
+
+    dynamixel_cycle_destroy(cycle);
+    cycle = NULL;
+    dynamixel_mailbox_destroy(mailbox);
+}
@@ -0,0 +1,379 @@
+#include <chrono>
+#include <cmath>
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "dynamixel/dynamixel_engine.h"
+#include "simulator/virtual_bus.h"
+
+
+TEST_GROUP(DYNAMIXEL_ENGINE)
+{
+    virtual_bus_t bus;
+    virtual_servo_t servo[2];
+    dynamixel_transport transport;
+    dynamixel_t dynamixel_id;
+    dynamixel_engine_t engine;
+
+    void setup()
+    {
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+        dynamixel_engine_config config = {4, 16, 4, 8};
+
+        bus = virtual_bus_create(1000000);
+        for (size_t i = 0; i < 2; i++)
+        {
+            servo[i] = virtual_servo_create(i + 1);
+            virtual_servo_write_table(servo[i], 8, 1, &baud_rate_1m);
+            virtual_servo_set_return_delay_time_us(servo[i], 0);
+            virtual_bus_add_servo(bus, servo[i]);
+        }
+        virtual_bus_init_transport(bus, &transport);
+
+        dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+        engine = dynamixel_engine_create(dynamixel_id, &config);
+    }
+
+    void teardown()
+    {
+        dynamixel_engine_destroy(engine);
+        dynamixel_destroy(dynamixel_id);
+        virtual_bus_destroy(bus);
+        for (size_t i = 0; i < 2; i++)
+            virtual_servo_destroy(servo[i]);
+    }
+
+    int submit(uint8_t id, uint8_t instruction, uint16_t parameter_size, const uint8_t *parameter, void *user_data)
+    {
+        dynamixel_engine_command command = {id, instruction, parameter_size, parameter, 0, user_data};
+
+        return dynamixel_engine_submit(engine, &command);
+    }
+};
+
+TEST(DYNAMIXEL_ENGINE, StepRunsCommandsInOrder)
+{
+    uint8_t read_parameter[] = {132, 0, 4, 0};
+    int tag[2];
+    dynamixel_engine_result result;
+
+    LONGS_EQUAL(0, submit(1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL, &tag[0]));
+    LONGS_EQUAL(0, submit(2, DYNAMIXEL__INSTRUCTION_READ, 4, read_parameter, &tag[1]));
+    // コマンドは受け付け時にコピーされる
+    read_parameter[0] = 0;
+
+    // 実行するまで結果はない
+    LONGS_EQUAL(1, dynamixel_engine_poll(engine, &result));
+    CHECK_TRUE(dynamixel_engine_step(engine));
+    CHECK_TRUE(dynamixel_engine_step(engine));
+    CHECK_FALSE(dynamixel_engine_step(engine));
+
+    LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+    POINTERS_EQUAL(&tag[0], result.user_data);
+    BYTES_EQUAL(DYNAMIXEL__INSTRUCTION_PING, result.instruction);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result.result);
+    UNSIGNED_LONGS_EQUAL(3, result.status_parameter_size);
+    UNSIGNED_LONGS_EQUAL(
+        VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288,
+        result.status_parameter[0] | (result.status_parameter[1] << 8)
+    );
+
+    LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+    POINTERS_EQUAL(&tag[1], result.user_data);
+    UNSIGNED_LONGS_EQUAL(2, result.id);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result.result);
+    UNSIGNED_LONGS_EQUAL(4, result.status_parameter_size);
+    BYTES_EQUAL(0x00, result.status_parameter[0]);
+    BYTES_EQUAL(0x08, result.status_parameter[1]);
+
+    LONGS_EQUAL(1, dynamixel_engine_poll(engine, &result));
+}
+
+TEST(DYNAMIXEL_ENGINE, SubmitRejectsWhenQueueIsFull)
+{
+    uint8_t large_parameter[17] = {0};
+    dynamixel_engine_result result;
+
+    LONGS_EQUAL(1, submit(1, DYNAMIXEL__INSTRUCTION_WRITE, sizeof(large_parameter), large_parameter, NULL));
+    // 応答パケットの数が分からない
+    LONGS_EQUAL(1, submit(0xfe, DYNAMIXEL__INSTRUCTION_PING, 0, NULL, NULL));
+
+    for (size_t i = 0; i < 4; i++)
+        LONGS_EQUAL(0, submit(1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL, NULL));
+    LONGS_EQUAL(1, submit(1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL, NULL));
+
+    // 結果キューが満杯の間は、次のコマンドを実行しない
+    for (size_t i = 0; i < 4; i++)
+        CHECK_TRUE(dynamixel_engine_step(engine));
+    LONGS_EQUAL(0, submit(1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL, NULL));
+    CHECK_FALSE(dynamixel_engine_step(engine));
+
+    // 取り出した結果の領域は、次に取り出すときに解放される
+    LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+    CHECK_FALSE(dynamixel_engine_step(engine));
+    LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+    CHECK_TRUE(dynamixel_engine_step(engine));
+}
+
+TEST(DYNAMIXEL_ENGINE, StatusParameterLargerThanResult)
+{
+    // Model Numberから12Byte
+    uint8_t read_parameter[] = {0, 0, 12, 0};
+    dynamixel_engine_result result;
+
+    LONGS_EQUAL(0, submit(1, DYNAMIXEL__INSTRUCTION_READ, 4, read_parameter, NULL));
+    CHECK_TRUE(dynamixel_engine_step(engine));
+
+    LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+    LONGS_EQUAL(DYNAMIXEL_PARSE_HUGE_DATA, result.result);
+    UNSIGNED_LONGS_EQUAL(8, result.status_parameter_size);
+}
+
+TEST(DYNAMIXEL_ENGINE, NoResponseInstructionCompletesAfterWrite)
+{
+    // Goal Position(116から4Byte)にID1、ID2の値を書き込む
+    uint8_t sync_write_parameter[] = {116, 0, 4, 0, 1, 0x00, 0x04, 0, 0, 2, 0x00, 0x08, 0, 0};
+    uint8_t goal_position[4];
+    uint64_t start_us = dynamixel_get_time_us(dynamixel_id);
+    dynamixel_engine_result result;
+    virtual_bus_statistics statistics;
+
+    LONGS_EQUAL(
+        0,
+        submit(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_WRITE, sizeof(sync_write_parameter), sync_write_parameter, NULL)
+    );
+    CHECK_TRUE(dynamixel_engine_step(engine));
+
+    LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result.result);
+    UNSIGNED_LONGS_EQUAL(0, result.status_parameter_size);
+    LONGS_EQUAL(1, dynamixel_engine_poll(engine, &result));
+
+    // 応答パケットを待たず、送信(24Byte)が完了したら終わる
+    CHECK_TRUE(dynamixel_get_time_us(dynamixel_id) - start_us < 300);
+    virtual_bus_get_statistics(bus, &statistics);
+    UNSIGNED_LONGS_EQUAL(0, statistics.status_packets);
+    virtual_servo_read_table(servo[1], 116, 4, goal_position);
+    BYTES_EQUAL(0x08, goal_position[1]);
+}
+
+TEST(DYNAMIXEL_ENGINE, SyncReadReturnsResultPerId)
+{
+    uint8_t sync_read_parameter[] = {132, 0, 4, 0, 1, 2};
+    uint8_t missing_parameter[] = {132, 0, 4, 0, 1, 9, 2};
+    int tag;
+    dynamixel_engine_result result;
+
+    LONGS_EQUAL(
+        0,
+        submit(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, sizeof(sync_read_parameter), sync_read_parameter, &tag)
+    );
+    CHECK_TRUE(dynamixel_engine_step(engine));
+
+    for (uint8_t id = 1; id <= 2; id++)
+    {
+        LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+        POINTERS_EQUAL(&tag, result.user_data);
+        UNSIGNED_LONGS_EQUAL(id, result.id);
+        BYTES_EQUAL(DYNAMIXEL__INSTRUCTION_SYNC_READ, result.instruction);
+        LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result.result);
+        UNSIGNED_LONGS_EQUAL(4, result.status_parameter_size);
+        BYTES_EQUAL(0x08, result.status_parameter[1]);
+    }
+    LONGS_EQUAL(1, dynamixel_engine_poll(engine, &result));
+
+    // 応答しないIDの後のIDは応答しない
+    LONGS_EQUAL(
+        0,
+        submit(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, sizeof(missing_parameter), missing_parameter, NULL)
+    );
+    CHECK_TRUE(dynamixel_engine_step(engine));
+    LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result.result);
+    LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+    UNSIGNED_LONGS_EQUAL(9, result.id);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, result.result);
+    LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+    UNSIGNED_LONGS_EQUAL(2, result.id);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, result.result);
+}
+
+TEST(DYNAMIXEL_ENGINE, SyncReadWaitsForRoomForEveryResult)
+{
+    uint8_t sync_read_parameter[] = {132, 0, 4, 0, 1, 2};
+    uint8_t too_many_parameter[] = {132, 0, 4, 0, 1, 2, 3, 4, 5};
+    dynamixel_engine_result result;
+
+    // 結果キュー(4つ)に入りきらないIDの数は受け付けない
+    LONGS_EQUAL(
+        1,
+        submit(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, sizeof(too_many_parameter), too_many_parameter, NULL)
+    );
+
+    for (size_t i = 0; i < 3; i++)
+        LONGS_EQUAL(0, submit(1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL, NULL));
+    LONGS_EQUAL(
+        0,
+        submit(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, sizeof(sync_read_parameter), sync_read_parameter, NULL)
+    );
+    for (size_t i = 0; i < 3; i++)
+        CHECK_TRUE(dynamixel_engine_step(engine));
+
+    // 2つの結果の空きができるまで実行しない
+    CHECK_FALSE(dynamixel_engine_step(engine));
+    LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+    CHECK_FALSE(dynamixel_engine_step(engine));
+    LONGS_EQUAL(0, dynamixel_engine_poll(engine, &result));
+    CHECK_TRUE(dynamixel_engine_step(engine));
+}
+
+TEST(DYNAMIXEL_ENGINE, WorkerRunsCommandsInParallel)
+{
+    uint8_t read_parameter[] = {132, 0, 4, 0};
+    dynamixel_engine_result result;
+    uintptr_t submitted = 0, completed = 0;
+    const uintptr_t command_num = 200;
+
+    LONGS_EQUAL(0, dynamixel_engine_start(engine));
+    LONGS_EQUAL(1, dynamixel_engine_start(engine));
+
+    while (completed < command_num)
+    {
+        if (
+            submitted < command_num
+            && !submit(submitted % 2 + 1, DYNAMIXEL__INSTRUCTION_READ, 4, read_parameter, (void *)submitted)
+        )
+            submitted++;
+
+        if (!dynamixel_engine_poll(engine, &result))
+        {
+            // 結果はコマンドの順に返る
+            UNSIGNED_LONGS_EQUAL(completed, (uintptr_t)result.user_data);
+            UNSIGNED_LONGS_EQUAL(completed % 2 + 1, result.id);
+            LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result.result);
+            completed++;
+        }
+    }
+
+    dynamixel_engine_stop(engine);
+    // 停止した後は、呼び出し元で実行できる
+    LONGS_EQUAL(0, submit(1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL, NULL));
+    CHECK_TRUE(dynamixel_engine_step(engine));
+}
+
+
+/**
+ * 制御の計算(ホストのCPU時間)と、バスの通信(仮想Dynamixelの計算)を周期ごとに行う。
+ * 同じ実行コンテキストで順に行う場合と、通信をエンジンのスレッドで行う場合の周期を計測する
+*/
+TEST_GROUP(DYNAMIXEL_ENGINE_BENCHMARK)
+{
+    static const size_t servo_num = 16;
+    virtual_bus_t bus;
+    virtual_servo_t servo[servo_num];
+    dynamixel_transport transport;
+    dynamixel_t dynamixel_id;
+    dynamixel_engine_t engine;
+    volatile double control_output;
+
+    void setup()
+    {
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+        dynamixel_engine_config config = {32, 16, 32, 8};
+
+        bus = virtual_bus_create(1000000);
+        for (size_t i = 0; i < servo_num; i++)
+        {
+            servo[i] = virtual_servo_create(i + 1);
+            virtual_servo_write_table(servo[i], 8, 1, &baud_rate_1m);
+            virtual_servo_set_return_delay_time_us(servo[i], 0);
+            virtual_servo_enable_dynamics(servo[i], NULL);
+            virtual_bus_add_servo(bus, servo[i]);
+        }
+        virtual_bus_init_transport(bus, &transport);
+
+        dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+        engine = dynamixel_engine_create(dynamixel_id, &config);
+    }
+
+    void teardown()
+    {
+        dynamixel_engine_destroy(engine);
+        dynamixel_destroy(dynamixel_id);
+        virtual_bus_destroy(bus);
+        for (size_t i = 0; i < servo_num; i++)
+            virtual_servo_destroy(servo[i]);
+    }
+
+    /// 制御の計算の代わり
+    void compute_control(size_t cycle)
+    {
+        double sum = 0;
+
+        for (size_t i = 0; i < 20000; i++)
+            sum += std::sin(cycle + i * 1e-3);
+        control_output = sum;
+    }
+
+    /// 全てのDynamixelの現在位置を読むコマンドを入れる
+    void submit_cycle()
+    {
+        uint8_t read_parameter[] = {132, 0, 4, 0};
+        dynamixel_engine_command command = {0, DYNAMIXEL__INSTRUCTION_READ, 4, read_parameter, 0, NULL};
+
+        for (size_t i = 0; i < servo_num; i++)
+        {
+            command.id = i + 1;
+            LONGS_EQUAL(0, dynamixel_engine_submit(engine, &command));
+        }
+    }
+
+    void wait_cycle()
+    {
+        dynamixel_engine_result result;
+
+        for (size_t i = 0; i < servo_num;)
+        {
+            if (dynamixel_engine_poll(engine, &result))
+                continue;
+
+            LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result.result);
+            i++;
+        }
+    }
+
+    double run_cycle(size_t cycle_num, bool parallel)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        if (parallel)
+            dynamixel_engine_start(engine);
+
+        for (size_t cycle = 0; cycle < cycle_num; cycle++)
+        {
+            submit_cycle();
+            if (!parallel)
+            {
+                while (dynamixel_engine_step(engine));
+            }
+            // 通信中に次の周期の制御を計算する
+            compute_control(cycle);
+            wait_cycle();
+        }
+
+        if (parallel)
+            dynamixel_engine_stop(engine);
+
+        return cycle_num / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+TEST(DYNAMIXEL_ENGINE_BENCHMARK, ControlAndBusInParallel)
+{
+    double serial = run_cycle(200, false);
+    double parallel = run_cycle(200, true);
+
+    UT_PRINT(StringFromFormat(
+        "%u servos: %.0f cycles/s (serial), %.0f cycles/s (engine thread)",
+        (unsigned)servo_num, serial, parallel
+    ).asCharString());
+}
@@ -0,0 +1,212 @@
+#include <cstring>
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "dynamixel/dynamixel_group.h"
+#include "simulator/virtual_bus.h"
+
+
+/// 全てのバスのDynamixelの状態を、IDの順に並べた配列
+typedef struct
+{
+    uint8_t present_position[4][4];
+    uint8_t goal_position[4][4];
+    size_t call_num;
+} group_state;
+
+
+/// 現在位置から少し進めた位置を目標位置とする
+static void compute(
+    void *user_data,
+    uint64_t cycle
+)
+{
+    group_state *state = (group_state *)user_data;
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        memcpy(state->goal_position[i], state->present_position[i], 4);
+        state->goal_position[i][0] += 10;
+    }
+    state->call_num++;
+}
+
+
+/**
+ * バス0にID1から3、バス1にID4をつなぐ
+*/
+TEST_GROUP(DYNAMIXEL_GROUP)
+{
+    static const size_t bus_num = 2;
+    static const size_t servo_num = 4;
+    virtual_bus_t bus[bus_num];
+    virtual_servo_t servo[servo_num];
+    dynamixel_transport transport[bus_num];
+    dynamixel_t dynamixel_id[bus_num];
+    dynamixel_group_t group;
+    group_state state;
+    dynamixel_parse_result result[2 * servo_num];
+
+    void setup()
+    {
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+        uint8_t position[4] = {0};
+
+        for (size_t i = 0; i < bus_num; i++)
+        {
+            bus[i] = virtual_bus_create(1000000);
+            virtual_bus_init_transport(bus[i], &transport[i]);
+            dynamixel_id[i] = dynamixel_create_with_transport(&transport[i], 1000000, 100, 10);
+        }
+        for (size_t i = 0; i < servo_num; i++)
+        {
+            servo[i] = virtual_servo_create(i + 1);
+            virtual_servo_write_table(servo[i], 8, 1, &baud_rate_1m);
+            virtual_servo_set_return_delay_time_us(servo[i], 0);
+            // IDごとに違う現在位置
+            position[0] = 10 * (i + 1);
+            virtual_servo_write_table(servo[i], 132, 4, position);
+            virtual_bus_add_servo(bus[i < 3 ? 0 : 1], servo[i]);
+        }
+
+        memset(&state, 0, sizeof(state));
+        group = NULL;
+    }
+
+    void teardown()
+    {
+        if (group)
+            dynamixel_group_destroy(group);
+        for (size_t i = 0; i < bus_num; i++)
+        {
+            dynamixel_destroy(dynamixel_id[i]);
+            virtual_bus_destroy(bus[i]);
+        }
+        for (size_t i = 0; i < servo_num; i++)
+            virtual_servo_destroy(servo[i]);
+    }
+
+    void create_group(bool interleaved)
+    {
+        dynamixel_group_config config = {
+            dynamixel_id, bus_num, 2 * servo_num, compute, &state, interleaved
+        };
+
+        group = dynamixel_group_create(&config);
+        CHECK_TRUE(group);
+        for (uint8_t id = 1; id <= servo_num; id++)
+            LONGS_EQUAL(0, dynamixel_group_assign(group, id, id <= 3 ? 0 : 1));
+        for (uint8_t id = 1; id <= servo_num; id++)
+        {
+            LONGS_EQUAL(
+                0,
+                dynamixel_group_add_read(group, id, 132, 4, state.present_position[id - 1], &result[id - 1])
+            );
+            LONGS_EQUAL(
+                0,
+                dynamixel_group_add_write(group, id, 116, 4, state.goal_position[id - 1], &result[servo_num + id - 1])
+            );
+        }
+    }
+
+    void check_run()
+    {
+        uint64_t start_us[bus_num], elapsed_us[bus_num];
+        uint8_t goal_position[4];
+        dynamixel_group_statistics statistics;
+
+        for (size_t i = 0; i < bus_num; i++)
+            start_us[i] = dynamixel_get_time_us(dynamixel_id[i]);
+        LONGS_EQUAL(0, dynamixel_group_run(group));
+        for (size_t i = 0; i < bus_num; i++)
+            elapsed_us[i] = dynamixel_get_time_us(dynamixel_id[i]) - start_us[i];
+
+        // 全てのバスの結果が1つの配列にまとまる
+        UNSIGNED_LONGS_EQUAL(1, state.call_num);
+        for (size_t i = 0; i < servo_num; i++)
+        {
+            LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result[i]);
+            LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result[servo_num + i]);
+            BYTES_EQUAL(10 * (i + 1), state.present_position[i][0]);
+
+            // IDのつながっているバスに書き込まれる
+            virtual_servo_read_table(servo[i], 116, 4, goal_position);
+            BYTES_EQUAL(10 * (i + 1) + 10, goal_position[0]);
+        }
+
+        // 時間は最も遅いバス(3つをつないだバス0)で決まる
+        dynamixel_group_get_statistics(group, &statistics);
+        UNSIGNED_LONGS_EQUAL(1, statistics.runs);
+        UNSIGNED_LONGS_EQUAL(0, statistics.transaction_errors);
+        CHECK_TRUE(elapsed_us[1] < elapsed_us[0]);
+        UNSIGNED_LONGS_EQUAL(elapsed_us[0], statistics.last_read_us + statistics.last_write_us);
+        CHECK_TRUE(statistics.last_read_us + statistics.last_write_us < elapsed_us[0] + elapsed_us[1]);
+    }
+};
+
+TEST(DYNAMIXEL_GROUP, RoutesById)
+{
+    dynamixel_group_config config = {dynamixel_id, bus_num, 1, NULL, NULL, false};
+
+    group = dynamixel_group_create(&config);
+    LONGS_EQUAL(1, dynamixel_group_assign(group, 1, bus_num));
+    LONGS_EQUAL(1, dynamixel_group_assign(group, 254, 0));
+    // バスを登録していないID
+    LONGS_EQUAL(1, dynamixel_group_add_read(group, 1, 132, 4, state.present_position[0], NULL));
+
+    LONGS_EQUAL(0, dynamixel_group_assign(group, 1, 0));
+    LONGS_EQUAL(0, dynamixel_group_add_read(group, 1, 132, 4, state.present_position[0], NULL));
+    // 登録できる数を超えた
+    LONGS_EQUAL(1, dynamixel_group_add_read(group, 1, 132, 4, state.present_position[0], NULL));
+}
+
+TEST(DYNAMIXEL_GROUP, ThreadPerBus)
+{
+    create_group(false);
+    check_run();
+}
+
+TEST(DYNAMIXEL_GROUP, Interleaved)
+{
+    create_group(true);
+    check_run();
+}
+
+TEST(DYNAMIXEL_GROUP, InterleavedTakesAsLongAsThreadPerBus)
+{
+    dynamixel_group_statistics thread_statistics, interleaved_statistics;
+
+    create_group(false);
+    LONGS_EQUAL(0, dynamixel_group_run(group));
+    dynamixel_group_get_statistics(group, &thread_statistics);
+    dynamixel_group_destroy(group);
+
+    // 受信を待つ時間で通信が遅れないので、バスごとのスレッドで動かした場合と同じ時間で終わる
+    memset(&state, 0, sizeof(state));
+    create_group(true);
+    LONGS_EQUAL(0, dynamixel_group_run(group));
+    dynamixel_group_get_statistics(group, &interleaved_statistics);
+    UNSIGNED_LONGS_EQUAL(thread_statistics.last_read_us, interleaved_statistics.last_read_us);
+    UNSIGNED_LONGS_EQUAL(thread_statistics.last_write_us, interleaved_statistics.last_write_us);
+}
+
+TEST(DYNAMIXEL_GROUP, FailedTransactionIsCounted)
+{
+    dynamixel_group_config config = {dynamixel_id, bus_num, 2, NULL, NULL, false};
+    uint8_t data[4];
+    dynamixel_parse_result missing_result;
+    dynamixel_group_statistics statistics;
+
+    group = dynamixel_group_create(&config);
+    LONGS_EQUAL(0, dynamixel_group_assign(group, 1, 0));
+    // バス1に応答しないIDを登録する
+    LONGS_EQUAL(0, dynamixel_group_assign(group, 9, 1));
+    LONGS_EQUAL(0, dynamixel_group_add_read(group, 1, 132, 4, state.present_position[0], &result[0]));
+    LONGS_EQUAL(0, dynamixel_group_add_read(group, 9, 132, 4, data, &missing_result));
+
+    LONGS_EQUAL(1, dynamixel_group_run(group));
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result[0]);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, missing_result);
+
+    dynamixel_group_get_statistics(group, &statistics);
+    UNSIGNED_LONGS_EQUAL(1, statistics.transaction_errors);
+}
@@ -0,0 +1,155 @@
+#include <atomic>
+#include <thread>
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "dynamixel/dynamixel_mailbox.h"
+#include "simulator/virtual_bus.h"
+
+
+TEST_GROUP(DYNAMIXEL_MAILBOX)
+{
+    static const size_t servo_num = 3;
+    virtual_bus_t bus;
+    virtual_servo_t servo[servo_num];
+    dynamixel_transport transport;
+    dynamixel_t dynamixel_id;
+    dynamixel_mailbox_t mailbox;
+
+    void setup()
+    {
+        const uint8_t id[servo_num] = {1, 2, 3};
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+
+        bus = virtual_bus_create(1000000);
+        for (size_t i = 0; i < servo_num; i++)
+        {
+            servo[i] = virtual_servo_create(i + 1);
+            virtual_servo_write_table(servo[i], 8, 1, &baud_rate_1m);
+            virtual_servo_set_return_delay_time_us(servo[i], 0);
+            virtual_bus_add_servo(bus, servo[i]);
+        }
+        virtual_bus_init_transport(bus, &transport);
+
+        dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+        mailbox = dynamixel_mailbox_create(id, servo_num, 116, 4);
+    }
+
+    void teardown()
+    {
+        dynamixel_mailbox_destroy(mailbox);
+        dynamixel_destroy(dynamixel_id);
+        virtual_bus_destroy(bus);
+        for (size_t i = 0; i < servo_num; i++)
+            virtual_servo_destroy(servo[i]);
+    }
+
+    uint32_t read_goal_position(size_t index)
+    {
+        uint8_t data[4];
+
+        virtual_servo_read_table(servo[index], 116, 4, data);
+        return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+    }
+};
+
+TEST(DYNAMIXEL_MAILBOX, RejectsUnknownAndDuplicateId)
+{
+    const uint8_t duplicate_id[] = {1, 1};
+    uint8_t data[4] = {0};
+
+    POINTERS_EQUAL(NULL, dynamixel_mailbox_create(duplicate_id, 2, 116, 4));
+    LONGS_EQUAL(1, dynamixel_mailbox_post(mailbox, 4, data));
+    LONGS_EQUAL(1, dynamixel_mailbox_post(mailbox, 254, data));
+}
+
+TEST(DYNAMIXEL_MAILBOX, SendsOnlyLatestValues)
+{
+    dynamixel_mailbox_statistics statistics;
+    virtual_bus_statistics bus_statistics;
+
+    // ID1は3回上書きし、ID3は更新しない
+    LONGS_EQUAL(0, dynamixel_mailbox_post_goal_position(mailbox, 1, 0.088 * 10));
+    LONGS_EQUAL(0, dynamixel_mailbox_post_goal_position(mailbox, 1, 0.088 * 20));
+    LONGS_EQUAL(0, dynamixel_mailbox_post_goal_position(mailbox, 1, 0.088 * 30));
+    LONGS_EQUAL(0, dynamixel_mailbox_post_goal_position(mailbox, 2, 0.088 * 40));
+
+    UNSIGNED_LONGS_EQUAL(2, dynamixel_mailbox_flush(mailbox, dynamixel_id));
+    virtual_bus_get_statistics(bus, &bus_statistics);
+    UNSIGNED_LONGS_EQUAL(1, bus_statistics.instruction_packets);
+    UNSIGNED_LONGS_EQUAL(0, bus_statistics.status_packets);
+    UNSIGNED_LONGS_EQUAL(30, read_goal_position(0));
+    UNSIGNED_LONGS_EQUAL(40, read_goal_position(1));
+    UNSIGNED_LONGS_EQUAL(0, read_goal_position(2));
+
+    // 更新がなければ送らない
+    UNSIGNED_LONGS_EQUAL(0, dynamixel_mailbox_flush(mailbox, dynamixel_id));
+    virtual_bus_get_statistics(bus, &bus_statistics);
+    UNSIGNED_LONGS_EQUAL(1, bus_statistics.instruction_packets);
+
+    dynamixel_mailbox_get_statistics(mailbox, &statistics);
+    UNSIGNED_LONGS_EQUAL(4, statistics.posts);
+    UNSIGNED_LONGS_EQUAL(2, statistics.superseded);
+    UNSIGNED_LONGS_EQUAL(2, statistics.sent);
+    UNSIGNED_LONGS_EQUAL(1, statistics.sync_writes);
+}
+
+TEST(DYNAMIXEL_MAILBOX, SplitsSyncWriteToFitBuffer)
+{
+    const uint8_t id[servo_num] = {1, 2, 3};
+    // パラメータが(30 - 10) * 3 / 4 = 15Byteまでなので、1つのSync Writeに2つまで入る
+    dynamixel_t small_dynamixel = dynamixel_create_with_transport(&transport, 1000000, 30, 10);
+    virtual_bus_statistics bus_statistics;
+
+    for (size_t i = 0; i < servo_num; i++)
+        LONGS_EQUAL(0, dynamixel_mailbox_post_goal_position(mailbox, id[i], 0.088 * (i + 1)));
+
+    UNSIGNED_LONGS_EQUAL(3, dynamixel_mailbox_flush(mailbox, small_dynamixel));
+    virtual_bus_get_statistics(bus, &bus_statistics);
+    UNSIGNED_LONGS_EQUAL(2, bus_statistics.instruction_packets);
+    for (size_t i = 0; i < servo_num; i++)
+        UNSIGNED_LONGS_EQUAL(i + 1, read_goal_position(i));
+
+    dynamixel_destroy(small_dynamixel);
+}
+
+TEST(DYNAMIXEL_MAILBOX, ProducerNeverWaitsForBus)
+{
+    std::atomic<bool> stop(false);
+    uint32_t value;
+    size_t flush_num = 0;
+    dynamixel_mailbox_statistics statistics;
+
+    // 下位2Byteを同じ値(位置の範囲内)にして、書き込み途中の値を送っていないことを確かめる
+    std::thread producer([&] {
+        uint8_t data[4] = {0};
+
+        for (uint32_t i = 1; !stop; i++)
+        {
+            data[0] = data[1] = i & 0x0f;
+            dynamixel_mailbox_post(mailbox, 1, data);
+        }
+    });
+
+    while (flush_num < 200)
+    {
+        if (dynamixel_mailbox_flush(mailbox, dynamixel_id) == 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        flush_num++;
+
+        value = read_goal_position(0);
+        UNSIGNED_LONGS_EQUAL((value & 0xff) * 0x0101u, value);
+    }
+    stop = true;
+    producer.join();
+
+    // 最後の値を送る
+    dynamixel_mailbox_flush(mailbox, dynamixel_id);
+    dynamixel_mailbox_get_statistics(mailbox, &statistics);
+    UNSIGNED_LONGS_EQUAL(statistics.posts, statistics.sent + statistics.superseded);
+    UNSIGNED_LONGS_EQUAL(statistics.sent, statistics.sync_writes);
+    UNSIGNED_LONGS_EQUAL((statistics.posts & 0x0f) * 0x0101u, read_goal_position(0));
+    CHECK_TRUE(statistics.superseded > 0);
+}
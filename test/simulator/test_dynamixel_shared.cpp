@@ -0,0 +1,247 @@
+#include <atomic>
+#include <thread>
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "dynamixel/dynamixel_shared.h"
+#include "simulator/virtual_bus.h"
+
+
+/**
+ * 仮想バスを包み、開くまで送信を止める経路。
+ * 1つ目の通信を止めている間に、他のスレッドのリクエストをキューに並べる
+*/
+static dynamixel_transport inner_transport;
+static std::atomic<bool> gate_open;
+static std::atomic<bool> gate_entered;
+
+static int gated_write_async(
+    void *context,
+    const uint8_t *src,
+    size_t len
+)
+{
+    gate_entered = true;
+    while (!gate_open)
+        std::this_thread::yield();
+
+    return inner_transport.write_async(context, src, len);
+}
+
+
+TEST_GROUP(DYNAMIXEL_SHARED)
+{
+    virtual_bus_t bus;
+    virtual_servo_t servo[2];
+    dynamixel_transport transport;
+    dynamixel_t dynamixel_id;
+    dynamixel_shared_t shared;
+
+    void setup()
+    {
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+
+        bus = virtual_bus_create(1000000);
+        for (size_t i = 0; i < 2; i++)
+        {
+            servo[i] = virtual_servo_create(i + 1);
+            virtual_servo_write_table(servo[i], 8, 1, &baud_rate_1m);
+            virtual_servo_set_return_delay_time_us(servo[i], 0);
+            virtual_bus_add_servo(bus, servo[i]);
+        }
+        virtual_bus_init_transport(bus, &inner_transport);
+        transport = inner_transport;
+        transport.write_async = gated_write_async;
+        gate_open = true;
+        gate_entered = false;
+
+        dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+        shared = dynamixel_shared_create(dynamixel_id);
+    }
+
+    void teardown()
+    {
+        dynamixel_shared_destroy(shared);
+        dynamixel_destroy(dynamixel_id);
+        virtual_bus_destroy(bus);
+        for (size_t i = 0; i < 2; i++)
+            virtual_servo_destroy(servo[i]);
+    }
+
+    void wait_requests(uint64_t request_num)
+    {
+        dynamixel_shared_statistics statistics;
+
+        do
+        {
+            std::this_thread::yield();
+            dynamixel_shared_get_statistics(shared, &statistics);
+        } while (statistics.requests < request_num);
+    }
+};
+
+TEST(DYNAMIXEL_SHARED, SendPacketAndRead)
+{
+    uint8_t error, status_parameter[100], data[4];
+    size_t status_parameter_size;
+    dynamixel_shared_statistics statistics;
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_shared_send_packet(
+            shared, 1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL,
+            &error, &status_parameter_size, status_parameter, 0
+        )
+    );
+    UNSIGNED_LONGS_EQUAL(3, status_parameter_size);
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, dynamixel_shared_read(shared, 2, 132, 4, &error, data));
+    BYTES_EQUAL(0x00, data[0]);
+    BYTES_EQUAL(0x08, data[1]);
+
+    // 応答しないID
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, dynamixel_shared_read(shared, 9, 132, 4, &error, data));
+
+    dynamixel_shared_get_statistics(shared, &statistics);
+    UNSIGNED_LONGS_EQUAL(3, statistics.requests);
+    UNSIGNED_LONGS_EQUAL(3, statistics.transactions);
+    UNSIGNED_LONGS_EQUAL(0, statistics.coalesced_reads);
+}
+
+TEST(DYNAMIXEL_SHARED, CoalescesIdenticalReads)
+{
+    static const size_t reader_num = 4;
+    std::thread reader[reader_num];
+    uint8_t data[reader_num][4] = {{0}};
+    dynamixel_parse_result result[reader_num];
+    uint8_t error[reader_num];
+    uint8_t ping_error, ping_parameter[100];
+    size_t ping_parameter_size;
+    dynamixel_shared_statistics shared_statistics;
+    virtual_bus_statistics bus_statistics;
+
+    // 1つ目の通信を止めておく
+    gate_open = false;
+    std::thread pinger([&] {
+        dynamixel_shared_send_packet(
+            shared, 1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL,
+            &ping_error, &ping_parameter_size, ping_parameter, 0
+        );
+    });
+    while (!gate_entered)
+        std::this_thread::yield();
+
+    // ID1へのreadは1つにまとめられ、ID2へのreadは別に通信する
+    for (size_t i = 0; i < reader_num; i++)
+    {
+        reader[i] = std::thread([&, i] {
+            result[i] = dynamixel_shared_read(shared, i < reader_num - 1 ? 1 : 2, 132, 4, &error[i], data[i]);
+        });
+    }
+    wait_requests(1 + reader_num);
+
+    gate_open = true;
+    pinger.join();
+    for (size_t i = 0; i < reader_num; i++)
+        reader[i].join();
+
+    for (size_t i = 0; i < reader_num; i++)
+    {
+        LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result[i]);
+        BYTES_EQUAL(0x00, data[i][0]);
+        BYTES_EQUAL(0x08, data[i][1]);
+    }
+
+    dynamixel_shared_get_statistics(shared, &shared_statistics);
+    UNSIGNED_LONGS_EQUAL(1 + reader_num, shared_statistics.requests);
+    UNSIGNED_LONGS_EQUAL(3, shared_statistics.transactions);
+    UNSIGNED_LONGS_EQUAL(reader_num - 2, shared_statistics.coalesced_reads);
+    virtual_bus_get_statistics(bus, &bus_statistics);
+    UNSIGNED_LONGS_EQUAL(3, bus_statistics.instruction_packets);
+}
+
+TEST(DYNAMIXEL_SHARED, ReadArrivingDuringTransferIsNotCoalesced)
+{
+    uint8_t data[2][4] = {{0}};
+    dynamixel_parse_result result[2];
+    uint8_t error[2];
+    dynamixel_shared_statistics shared_statistics;
+    virtual_bus_statistics bus_statistics;
+
+    // 1つ目のreadを通信中で止めておく
+    gate_open = false;
+    std::thread first([&] {
+        result[0] = dynamixel_shared_read(shared, 1, 132, 4, &error[0], data[0]);
+    });
+    while (!gate_entered)
+        std::this_thread::yield();
+
+    // 通信中のreadと同じreadは、まとめずに後に並べる
+    std::thread second([&] {
+        result[1] = dynamixel_shared_read(shared, 1, 132, 4, &error[1], data[1]);
+    });
+    wait_requests(2);
+
+    gate_open = true;
+    first.join();
+    second.join();
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, result[i]);
+        BYTES_EQUAL(0x08, data[i][1]);
+    }
+
+    dynamixel_shared_get_statistics(shared, &shared_statistics);
+    UNSIGNED_LONGS_EQUAL(2, shared_statistics.requests);
+    UNSIGNED_LONGS_EQUAL(2, shared_statistics.transactions);
+    UNSIGNED_LONGS_EQUAL(0, shared_statistics.coalesced_reads);
+    virtual_bus_get_statistics(bus, &bus_statistics);
+    UNSIGNED_LONGS_EQUAL(2, bus_statistics.instruction_packets);
+}
+
+TEST(DYNAMIXEL_SHARED, ParallelThreadsShareBus)
+{
+    static const size_t thread_num = 4;
+    static const size_t iteration_num = 50;
+    std::thread worker[thread_num];
+    std::atomic<size_t> failure_num(0);
+    dynamixel_shared_statistics shared_statistics;
+    virtual_bus_statistics bus_statistics;
+
+    for (size_t i = 0; i < thread_num; i++)
+    {
+        worker[i] = std::thread([&, i] {
+            uint8_t error, data[4], status_parameter[100];
+            size_t status_parameter_size;
+
+            for (size_t j = 0; j < iteration_num; j++)
+            {
+                if (j % 5 == 0)
+                {
+                    if (dynamixel_shared_send_packet(
+                        shared, i % 2 + 1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL,
+                        &error, &status_parameter_size, status_parameter, 0
+                    ) != DYNAMIXEL_PARSE_SUCCESS)
+                        failure_num++;
+                }
+                else if (
+                    dynamixel_shared_read(shared, i % 2 + 1, 132, 4, &error, data) != DYNAMIXEL_PARSE_SUCCESS
+                    || data[1] != 0x08
+                )
+                    failure_num++;
+            }
+        });
+    }
+    for (size_t i = 0; i < thread_num; i++)
+        worker[i].join();
+
+    UNSIGNED_LONGS_EQUAL(0, failure_num);
+    dynamixel_shared_get_statistics(shared, &shared_statistics);
+    UNSIGNED_LONGS_EQUAL(thread_num * iteration_num, shared_statistics.requests);
+    UNSIGNED_LONGS_EQUAL(
+        shared_statistics.requests,
+        shared_statistics.transactions + shared_statistics.coalesced_reads
+    );
+    virtual_bus_get_statistics(bus, &bus_statistics);
+    UNSIGNED_LONGS_EQUAL(shared_statistics.transactions, bus_statistics.instruction_packets);
+}
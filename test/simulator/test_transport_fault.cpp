@@ -0,0 +1,204 @@
+#include <cstring>
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "simulator/virtual_bus.h"
+#include "simulator/transport_fault.h"
+
+
+TEST_GROUP(TRANSPORT_FAULT)
+{
+    virtual_bus_t bus;
+    virtual_servo_t servo;
+    dynamixel_transport bus_transport;
+    dynamixel_transport transport;
+    transport_fault_parameter parameter;
+    transport_fault_t fault;
+    dynamixel_t dynamixel_id;
+
+    void setup()
+    {
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+
+        bus = virtual_bus_create(1000000);
+        servo = virtual_servo_create(1);
+        virtual_servo_write_table(servo, 8, 1, &baud_rate_1m);
+        virtual_servo_set_return_delay_time_us(servo, 0);
+        virtual_bus_add_servo(bus, servo);
+        virtual_bus_init_transport(bus, &bus_transport);
+
+        memset(&parameter, 0, sizeof(parameter));
+        parameter.seed = 1;
+        fault = NULL;
+        dynamixel_id = NULL;
+    }
+
+    void teardown()
+    {
+        if (dynamixel_id)
+            dynamixel_destroy(dynamixel_id);
+        if (fault)
+            transport_fault_destroy(fault);
+        virtual_bus_destroy(bus);
+        virtual_servo_destroy(servo);
+    }
+
+    void create()
+    {
+        fault = transport_fault_create(&bus_transport, &parameter);
+        transport_fault_init_transport(fault, &transport);
+        dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+    }
+
+    dynamixel_parse_result ping()
+    {
+        uint8_t error;
+
+        return dynamixel_send_ping(dynamixel_id, 1, &error, NULL, NULL, 0);
+    }
+};
+
+TEST(TRANSPORT_FAULT, NoFaultPassesThrough)
+{
+    transport_fault_statistics statistics;
+    uint8_t error;
+    float position;
+
+    create();
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, ping());
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1)
+    );
+    DOUBLES_EQUAL(2048 * 0.088, position, 0.001);
+
+    transport_fault_get_statistics(fault, &statistics);
+    UNSIGNED_LONGS_EQUAL(0, statistics.tx_bit_flips);
+    UNSIGNED_LONGS_EQUAL(0, statistics.rx_bit_flips);
+    UNSIGNED_LONGS_EQUAL(0, statistics.rx_byte_drops);
+    UNSIGNED_LONGS_EQUAL(0, statistics.truncated_responses);
+    UNSIGNED_LONGS_EQUAL(0, statistics.stray_headers);
+    UNSIGNED_LONGS_EQUAL(0, statistics.late_responses);
+}
+
+TEST(TRANSPORT_FAULT, BitFlipBreaksInstructionPacket)
+{
+    transport_fault_statistics statistics;
+    virtual_bus_statistics bus_statistics;
+
+    parameter.bit_flip_rate = 1.0;
+    create();
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, ping());
+
+    // pingのインストラクションパケット10Byteが全て壊れ、仮想Dynamixelは受信できない
+    transport_fault_get_statistics(fault, &statistics);
+    UNSIGNED_LONGS_EQUAL(10, statistics.tx_bit_flips);
+    virtual_bus_get_statistics(bus, &bus_statistics);
+    UNSIGNED_LONGS_EQUAL(0, bus_statistics.instruction_packets);
+}
+
+TEST(TRANSPORT_FAULT, ByteDropLosesResponse)
+{
+    transport_fault_statistics statistics;
+
+    parameter.byte_drop_rate = 1.0;
+    create();
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, ping());
+
+    transport_fault_get_statistics(fault, &statistics);
+    UNSIGNED_LONGS_EQUAL(14, statistics.rx_byte_drops);
+}
+
+TEST(TRANSPORT_FAULT, TruncatedResponseIsIncomplete)
+{
+    transport_fault_statistics statistics;
+    dynamixel_parse_result result;
+
+    parameter.truncate_rate = 1.0;
+    create();
+    result = ping();
+    CHECK(result == DYNAMIXEL_PARSE_NO_RESPONSE || result == DYNAMIXEL_PARSE_INADEQUATE_DATA);
+
+    transport_fault_get_statistics(fault, &statistics);
+    UNSIGNED_LONGS_EQUAL(1, statistics.truncated_responses);
+}
+
+TEST(TRANSPORT_FAULT, StrayHeaderIsInserted)
+{
+    const uint8_t header[] = {0xff, 0xff, 0xfd, 0x00};
+    uint8_t data[64];
+    size_t read_size = 0;
+    bool found = false;
+
+    parameter.stray_header_rate = 1.0;
+    create();
+    dynamixel_write_uart_packet(dynamixel_id, 1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL);
+    while (!transport.wait_readable(transport.context, 1000))
+        read_size += transport.read_available(transport.context, data + read_size, sizeof(data) - read_size);
+
+    // 応答パケット14Byte + ヘッダー4Byte
+    UNSIGNED_LONGS_EQUAL(14 + 4, read_size);
+    // ヘッダーを取り除くと、ID 1の応答パケットに戻る位置がある
+    for (size_t i = 0; i < TRANSPORT_FAULT_TRUNCATE_MAX_SIZE; i++)
+    {
+        uint8_t packet[14];
+
+        if (memcmp(data + i, header, sizeof(header)) != 0)
+            continue;
+        memcpy(packet, data, i);
+        memcpy(packet + i, data + i + 4, 14 - i);
+        found |= memcmp(packet, header, sizeof(header)) == 0 && packet[4] == 0x01;
+    }
+    CHECK_TRUE(found);
+}
+
+TEST(TRANSPORT_FAULT, LateResponseTakesLonger)
+{
+    transport_fault_statistics statistics;
+    uint64_t start_us;
+
+    parameter.late_response_rate = 1.0;
+    parameter.late_response_mean_us = 300;
+    create();
+
+    start_us = virtual_bus_get_time_us(bus);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, ping());
+    // インストラクションパケット10Byte + 応答パケット14Byte(1Mbpsで10us/Byte)より遅れる
+    CHECK(virtual_bus_get_time_us(bus) - start_us > (10 + 14) * 10);
+    transport_fault_get_statistics(fault, &statistics);
+    UNSIGNED_LONGS_EQUAL(1, statistics.late_responses);
+}
+
+TEST(TRANSPORT_FAULT, VeryLateResponseTimesOut)
+{
+    parameter.late_response_rate = 1.0;
+    parameter.late_response_mean_us = 1000000;
+    create();
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, ping());
+}
+
+TEST(TRANSPORT_FAULT, SameSeedGivesSameFaults)
+{
+    transport_fault_statistics first, second;
+    dynamixel_parse_result first_result[100], second_result[100];
+
+    parameter.bit_flip_rate = 0.01;
+    parameter.byte_drop_rate = 0.01;
+    parameter.truncate_rate = 0.05;
+    parameter.stray_header_rate = 0.05;
+    create();
+    for (size_t i = 0; i < 100; i++)
+        first_result[i] = ping();
+    transport_fault_get_statistics(fault, &first);
+
+    dynamixel_destroy(dynamixel_id);
+    transport_fault_destroy(fault);
+    create();
+    for (size_t i = 0; i < 100; i++)
+        second_result[i] = ping();
+    transport_fault_get_statistics(fault, &second);
+
+    MEMCMP_EQUAL(first_result, second_result, sizeof(first_result));
+    MEMCMP_EQUAL(&first, &second, sizeof(first));
+    CHECK(first.rx_byte_drops > 0);
+}
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "simulator/virtual_bus.h"
+#include "simulator/transport_fault.h"
+
+
+/**
+ * 故障を起こす経路を通して現在位置の読み込みを繰り返し、故障の頻度と再送の回数ごとに、
+ * バスの時間(仮想時間)でのgoodput(成功した読み込みの数/s)と、読み込み1回の時間(再送を含む)の99パーセンタイルを計測する。
+ *
+ * 故障の頻度pは、1Byteごとの故障(ビット反転、欠落)の確率とし、
+ * 応答ごとの故障(途切れ、余分なヘッダー、遅れ)は、その10倍(応答パケット1つ分程度のByte数)の確率で起こす。
+ *
+ * 条件ごとにバスと仮想Dynamixelを作り直し、同じseedで故障を起こすので、結果は毎回同じになる。
+ * ただし、再送の回数や待ち時間によって乱数を使う順番が変わるため、条件どうしの比較には二項分布のばらつきを許す
+*/
+TEST_GROUP(TRANSPORT_FAULT_BENCHMARK)
+{
+    static const uint baud_rate = 1000000;
+    static const size_t transaction_num = 2000;
+    virtual_bus_t bus;
+    virtual_servo_t servo;
+    dynamixel_transport bus_transport;
+    dynamixel_transport transport;
+    transport_fault_t fault;
+    dynamixel_t dynamixel_id;
+
+    /// 計測結果
+    typedef struct
+    {
+        size_t success_num;
+        double goodput;
+        uint64_t p99_us;
+    } benchmark_result;
+
+    void setup()
+    {
+        bus = NULL;
+        servo = NULL;
+        fault = NULL;
+        dynamixel_id = NULL;
+    }
+
+    void teardown()
+    {
+        destroy_all();
+    }
+
+    void destroy_all()
+    {
+        if (dynamixel_id)
+            dynamixel_destroy(dynamixel_id);
+        if (fault)
+            transport_fault_destroy(fault);
+        if (bus)
+            virtual_bus_destroy(bus);
+        if (servo)
+            virtual_servo_destroy(servo);
+    }
+
+    /// 二項分布のばらつきを考えた、成功数の許容誤差(4σ)
+    static size_t tolerance(size_t n, double success_rate)
+    {
+        return (size_t)(4 * std::sqrt(n * success_rate * (1 - success_rate))) + 1;
+    }
+
+    /**
+     * 故障の頻度、再送の回数、応答パケットの待ち時間の余裕を指定して計測する
+     *
+     * 前の条件で遅れて届く応答パケットが残らないように、バスから作り直す
+    */
+    void run(
+        double error_rate, size_t retry_num, benchmark_result *result,
+        uint margin_us = DYNAMIXEL_TIMEOUT_MARGIN_US_DEFAULT
+    )
+    {
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+        transport_fault_parameter parameter;
+        std::vector<uint64_t> latency_us;
+        uint8_t error;
+        float position;
+
+        destroy_all();
+        bus = virtual_bus_create(baud_rate);
+        servo = virtual_servo_create(1);
+        virtual_servo_write_table(servo, 8, 1, &baud_rate_1m);
+        virtual_bus_add_servo(bus, servo);
+        virtual_bus_init_transport(bus, &bus_transport);
+
+        memset(&parameter, 0, sizeof(parameter));
+        parameter.seed = 1;
+        parameter.bit_flip_rate = error_rate;
+        parameter.byte_drop_rate = error_rate;
+        parameter.truncate_rate = error_rate * 10;
+        parameter.stray_header_rate = error_rate * 10;
+        parameter.late_response_rate = error_rate * 10;
+        parameter.late_response_mean_us = 500;
+        fault = transport_fault_create(&bus_transport, &parameter);
+        transport_fault_init_transport(fault, &transport);
+        dynamixel_id = dynamixel_create_with_transport(&transport, baud_rate, 100, 10);
+        dynamixel_set_timeout_margin_us(dynamixel_id, margin_us);
+
+        result->success_num = 0;
+        uint64_t start_us = virtual_bus_get_time_us(bus);
+
+        for (size_t i = 0; i < transaction_num; i++)
+        {
+            uint64_t transaction_start_us = virtual_bus_get_time_us(bus);
+
+            for (size_t attempt = 0; attempt <= retry_num; attempt++)
+            {
+                if (
+                    dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1)
+                    == DYNAMIXEL_PARSE_SUCCESS
+                )
+                {
+                    result->success_num++;
+                    break;
+                }
+            }
+
+            latency_us.push_back(virtual_bus_get_time_us(bus) - transaction_start_us);
+        }
+
+        uint64_t virtual_us = virtual_bus_get_time_us(bus) - start_us;
+        std::sort(latency_us.begin(), latency_us.end());
+        result->goodput = result->success_num * 1e6 / virtual_us;
+        result->p99_us = latency_us[latency_us.size() * 99 / 100];
+
+        UT_PRINT(StringFromFormat(
+            "p = %.0e, %u retries, margin %4u us: %5.1f%% success, goodput %.0f reads/s, p99 latency %llu us",
+            error_rate, (unsigned)retry_num, margin_us, 100.0 * result->success_num / transaction_num,
+            result->goodput, (unsigned long long)result->p99_us
+        ).asCharString());
+    }
+};
+
+TEST(TRANSPORT_FAULT_BENCHMARK, NoFault)
+{
+    benchmark_result result;
+
+    run(0, 0, &result);
+    UNSIGNED_LONGS_EQUAL(transaction_num, result.success_num);
+    // インストラクションパケット14Byte + Return Delay Time 500us + 応答パケット15Byte
+    UNSIGNED_LONGS_EQUAL(14 * 10 + 500 + 15 * 10, result.p99_us);
+}
+
+TEST(TRANSPORT_FAULT_BENCHMARK, GoodputAgainstErrorRate)
+{
+    const double error_rate[] = {1e-4, 1e-3, 1e-2, 3e-2};
+    const size_t retry_num[] = {0, 1, 3};
+    benchmark_result no_fault, result;
+
+    run(0, 0, &no_fault);
+    for (double p : error_rate)
+    {
+        size_t previous_success_num = 0;
+
+        for (size_t retry : retry_num)
+        {
+            run(p, retry, &result);
+            CHECK(result.goodput <= no_fault.goodput);
+            // 再送を増やすと成功する読み込みは減らない
+            CHECK(
+                result.success_num + tolerance(transaction_num, (double)previous_success_num / transaction_num)
+                >= previous_success_num
+            );
+            previous_success_num = result.success_num;
+        }
+    }
+
+    // 故障が多いと、再送しても全ては成功しない
+    CHECK(result.success_num < transaction_num);
+    CHECK(result.p99_us > no_fault.p99_us);
+}
+
+TEST(TRANSPORT_FAULT_BENCHMARK, GoodputAgainstTimeoutMargin)
+{
+    // 遅れた応答(平均500us)が多い条件で、待ち時間の余裕を変える
+    const uint margin_us[] = {0, 200, 1000, 3000};
+    const double error_rate = 1e-2;
+    benchmark_result no_margin, result;
+    uint64_t previous_p99_us;
+
+    run(error_rate, 0, &no_margin, margin_us[0]);
+    previous_p99_us = no_margin.p99_us;
+    for (size_t i = 1; i < sizeof(margin_us) / sizeof(margin_us[0]); i++)
+    {
+        run(error_rate, 0, &result, margin_us[i]);
+
+        // 余裕を大きくすると遅れた応答を取りこぼさなくなるが、応答がないときに長く待つ
+        CHECK(
+            result.success_num + tolerance(transaction_num, (double)no_margin.success_num / transaction_num)
+            >= no_margin.success_num
+        );
+        CHECK(result.p99_us > previous_p99_us);
+        previous_p99_us = result.p99_us;
+    }
+}
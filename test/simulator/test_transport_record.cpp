@@ -0,0 +1,345 @@
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "simulator/virtual_bus.h"
+#include "simulator/transport_recorder.h"
+#include "simulator/transport_replayer.h"
+
+
+/// 記録と再生で同じ操作を行い、結果と経過時間を残す
+typedef struct
+{
+    dynamixel_parse_result ping_result;
+    uint16_t model_no;
+    dynamixel_parse_result read_result;
+    float position;
+    dynamixel_parse_result no_response_result;
+    dynamixel_parse_result write_result;
+    uint32_t elapsed_us;
+} session_result;
+
+
+static void run_session(
+    dynamixel_transport *transport,
+    session_result *result
+)
+{
+    uint8_t error;
+    dynamixel_t dynamixel_id = dynamixel_create_with_transport(transport, 1000000, 100, 10);
+    uint32_t start_us = transport->now_us(transport->context);
+
+    result->ping_result = dynamixel_send_ping(dynamixel_id, 1, &error, &result->model_no, NULL, 0);
+    result->read_result = dynamixel_send_read_position(dynamixel_id, 1, &error, &result->position, 0, 1);
+    result->no_response_result = dynamixel_send_ping(dynamixel_id, 2, &error, NULL, NULL, 0);
+    result->write_result = dynamixel_send_write_goal_position(dynamixel_id, 1, &error, 90.0, 0, 1);
+    result->elapsed_us = transport->now_us(transport->context) - start_us;
+
+    dynamixel_destroy(dynamixel_id);
+}
+
+
+TEST_GROUP(TRANSPORT_RECORD)
+{
+    char path[64];
+    virtual_bus_t bus;
+    virtual_servo_t servo;
+    dynamixel_transport bus_transport;
+
+    void setup()
+    {
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+        int fd;
+
+        snprintf(path, sizeof(path), "/tmp/transport_record_XXXXXX");
+        fd = mkstemp(path);
+        close(fd);
+
+        bus = virtual_bus_create(1000000);
+        servo = virtual_servo_create(1);
+        virtual_servo_write_table(servo, 8, 1, &baud_rate_1m);
+        virtual_bus_add_servo(bus, servo);
+        virtual_bus_init_transport(bus, &bus_transport);
+    }
+
+    void teardown()
+    {
+        virtual_bus_destroy(bus);
+        virtual_servo_destroy(servo);
+        remove(path);
+    }
+
+    void record(session_result *result)
+    {
+        dynamixel_transport transport;
+        transport_recorder_t recorder = transport_recorder_create(&bus_transport, path);
+
+        CHECK(recorder != NULL);
+        transport_recorder_init_transport(recorder, &transport);
+        run_session(&transport, result);
+        CHECK(transport_recorder_get_record_num(recorder) > 0);
+        LONGS_EQUAL(0, transport_recorder_destroy(recorder));
+    }
+
+    /// ファイルの内容をそのまま書き込む
+    void write_file(const uint8_t *data, size_t size)
+    {
+        FILE *file = fopen(path, "wb");
+
+        UNSIGNED_LONGS_EQUAL(size, fwrite(data, 1, size, file));
+        fclose(file);
+    }
+
+    /// ファイルの内容を読み込む
+    size_t read_file(uint8_t *data, size_t max)
+    {
+        FILE *file = fopen(path, "rb");
+        size_t size = fread(data, 1, max, file);
+
+        fclose(file);
+        return size;
+    }
+};
+
+TEST(TRANSPORT_RECORD, ReplayFastReturnsSameResults)
+{
+    session_result recorded, replayed;
+    dynamixel_transport transport;
+    transport_replayer_t replayer;
+    transport_replayer_statistics statistics;
+
+    record(&recorded);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, recorded.ping_result);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, recorded.read_result);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, recorded.no_response_result);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, recorded.write_result);
+
+    replayer = transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST);
+    CHECK(replayer != NULL);
+    transport_replayer_init_transport(replayer, &transport);
+    run_session(&transport, &replayed);
+
+    LONGS_EQUAL(recorded.ping_result, replayed.ping_result);
+    UNSIGNED_LONGS_EQUAL(recorded.model_no, replayed.model_no);
+    LONGS_EQUAL(recorded.read_result, replayed.read_result);
+    DOUBLES_EQUAL(recorded.position, replayed.position, 0.001);
+    LONGS_EQUAL(recorded.no_response_result, replayed.no_response_result);
+    LONGS_EQUAL(recorded.write_result, replayed.write_result);
+    // 仮想的な時刻は記録と同じ間隔で進む
+    UNSIGNED_LONGS_EQUAL(recorded.elapsed_us, replayed.elapsed_us);
+
+    CHECK_TRUE(transport_replayer_is_finished(replayer));
+    transport_replayer_get_statistics(replayer, &statistics);
+    UNSIGNED_LONGS_EQUAL(4, statistics.tx_matched);
+    UNSIGNED_LONGS_EQUAL(0, statistics.tx_mismatched);
+    UNSIGNED_LONGS_EQUAL(0, statistics.tx_unexpected);
+    UNSIGNED_LONGS_EQUAL(0, statistics.rx_skipped);
+    // 応答パケット: ping 14Byte、read 15Byte、write 11Byte
+    UNSIGNED_LONGS_EQUAL(14 + 15 + 11, statistics.rx_bytes);
+
+    transport_replayer_destroy(replayer);
+}
+
+TEST(TRANSPORT_RECORD, ReplayDetectsDifferentInstruction)
+{
+    session_result recorded;
+    dynamixel_transport transport;
+    dynamixel_t dynamixel_id;
+    transport_replayer_t replayer;
+    transport_replayer_statistics statistics;
+    uint8_t error;
+    float position;
+
+    record(&recorded);
+
+    replayer = transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST);
+    transport_replayer_init_transport(replayer, &transport);
+    dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+
+    // pingの代わりにreadを送っても、記録された応答パケットが返る
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_ping(dynamixel_id, 1, &error, NULL, NULL, 0)
+    );
+    dynamixel_send_read_position(dynamixel_id, 3, &error, &position, 0, 1);
+    // 読み込まれなかった応答パケットは捨てる
+    dynamixel_send_ping(dynamixel_id, 1, &error, NULL, NULL, 0);
+    dynamixel_send_ping(dynamixel_id, 1, &error, NULL, NULL, 0);
+    dynamixel_send_ping(dynamixel_id, 1, &error, NULL, NULL, 0);
+
+    transport_replayer_get_statistics(replayer, &statistics);
+    UNSIGNED_LONGS_EQUAL(1, statistics.tx_matched);
+    UNSIGNED_LONGS_EQUAL(3, statistics.tx_mismatched);
+    UNSIGNED_LONGS_EQUAL(1, statistics.tx_unexpected);
+
+    dynamixel_destroy(dynamixel_id);
+    transport_replayer_destroy(replayer);
+}
+
+TEST(TRANSPORT_RECORD, ReplayRealtimeKeepsTiming)
+{
+    session_result recorded, replayed;
+    dynamixel_transport transport;
+    transport_replayer_t replayer;
+
+    record(&recorded);
+
+    replayer = transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_REALTIME);
+    transport_replayer_init_transport(replayer, &transport);
+    run_session(&transport, &replayed);
+
+    LONGS_EQUAL(recorded.read_result, replayed.read_result);
+    DOUBLES_EQUAL(recorded.position, replayed.position, 0.001);
+    // 実時間では記録より短くならない
+    CHECK(replayed.elapsed_us >= recorded.elapsed_us);
+    CHECK_TRUE(transport_replayer_is_finished(replayer));
+
+    transport_replayer_destroy(replayer);
+}
+
+TEST(TRANSPORT_RECORD, InvalidFileIsRejected)
+{
+    FILE *file;
+
+    POINTERS_EQUAL(NULL, transport_replayer_create("/nonexistent/record", TRANSPORT_REPLAYER_MODE_FAST));
+
+    file = fopen(path, "wb");
+    fputs("NOT A RECORD", file);
+    fclose(file);
+    POINTERS_EQUAL(NULL, transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST));
+}
+
+TEST(TRANSPORT_RECORD, CorruptFileIsRejected)
+{
+    // データサイズがファイルの残りより大きい送信の記録
+    const uint8_t larger_than_file[] = {'D', 'X', 'L', 'R', 1, 0x00, 0x00, 0x64, 0xff, 0xff, 0xfd};
+    // データサイズが64bitで表せる最大の値
+    const uint8_t huge_size[] = {
+        'D', 'X', 'L', 'R', 1, 0x01, 0x00,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01
+    };
+    // 64bitに収まらない経過時間
+    const uint8_t overflowing_varint[] = {
+        'D', 'X', 'L', 'R', 1, 0x03,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f
+    };
+    // 終わらない可変長整数
+    const uint8_t endless_varint[] = {
+        'D', 'X', 'L', 'R', 1, 0x03,
+        0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+    };
+    // 知らない種類の記録
+    const uint8_t unknown_type[] = {'D', 'X', 'L', 'R', 1, 0x7f, 0x00};
+    const uint8_t valid[] = {'D', 'X', 'L', 'R', 1, 0x00, 0x00, 0x01, 0xff, 0x03, 0x0a};
+    transport_replayer_t replayer;
+
+    write_file(larger_than_file, sizeof(larger_than_file));
+    POINTERS_EQUAL(NULL, transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST));
+    write_file(huge_size, sizeof(huge_size));
+    POINTERS_EQUAL(NULL, transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST));
+    write_file(overflowing_varint, sizeof(overflowing_varint));
+    POINTERS_EQUAL(NULL, transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST));
+    write_file(endless_varint, sizeof(endless_varint));
+    POINTERS_EQUAL(NULL, transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST));
+    write_file(unknown_type, sizeof(unknown_type));
+    POINTERS_EQUAL(NULL, transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST));
+
+    write_file(valid, sizeof(valid));
+    replayer = transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST);
+    CHECK(replayer != NULL);
+    transport_replayer_destroy(replayer);
+}
+
+TEST(TRANSPORT_RECORD, TruncatedFileIsRejected)
+{
+    session_result recorded;
+    uint8_t data[4096];
+    size_t size, rejected_num = 0;
+    transport_replayer_t replayer;
+
+    record(&recorded);
+    size = read_file(data, sizeof(data));
+    CHECK(size > 5 && size < sizeof(data));
+
+    // 最後の受信データの途中で切れている
+    write_file(data, size - 1);
+    POINTERS_EQUAL(NULL, transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST));
+
+    // どこで切れていても、読み込めないか、記録の区切りまでを読み込む
+    for (size_t i = 0; i < size; i++)
+    {
+        write_file(data, i);
+        replayer = transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST);
+        if (replayer)
+            transport_replayer_destroy(replayer);
+        else
+            rejected_num++;
+    }
+    CHECK(rejected_num > size / 2);
+}
+
+TEST(TRANSPORT_RECORD, RecorderReportsWriteFailure)
+{
+    dynamixel_transport transport;
+    transport_recorder_t recorder = transport_recorder_create(&bus_transport, "/dev/full");
+    uint8_t error;
+    dynamixel_t dynamixel_id;
+
+    // 書き込みに失敗しても、送受信は続ける
+    CHECK(recorder != NULL);
+    transport_recorder_init_transport(recorder, &transport);
+    dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+    for (size_t i = 0; i < 1000; i++)
+    {
+        LONGS_EQUAL(
+            DYNAMIXEL_PARSE_SUCCESS,
+            dynamixel_send_ping(dynamixel_id, 1, &error, NULL, NULL, 0)
+        );
+    }
+    dynamixel_destroy(dynamixel_id);
+
+    CHECK_TRUE(transport_recorder_has_failed(recorder));
+    LONGS_EQUAL(1, transport_recorder_destroy(recorder));
+}
+
+TEST(TRANSPORT_RECORD, ReplayFastThroughput)
+{
+    const size_t transaction_num = 1000;
+    dynamixel_transport transport;
+    transport_recorder_t recorder = transport_recorder_create(&bus_transport, path);
+    transport_replayer_t replayer;
+    dynamixel_t dynamixel_id;
+    uint8_t error;
+    float position;
+
+    transport_recorder_init_transport(recorder, &transport);
+    dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+    for (size_t i = 0; i < transaction_num; i++)
+        dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1);
+    dynamixel_destroy(dynamixel_id);
+    LONGS_EQUAL(0, transport_recorder_destroy(recorder));
+
+    replayer = transport_replayer_create(path, TRANSPORT_REPLAYER_MODE_FAST);
+    transport_replayer_init_transport(replayer, &transport);
+    dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < transaction_num; i++)
+    {
+        LONGS_EQUAL(
+            DYNAMIXEL_PARSE_SUCCESS,
+            dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1)
+        );
+    }
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    CHECK_TRUE(transport_replayer_is_finished(replayer));
+    UT_PRINT(StringFromFormat(
+        "replay: %zu transactions in %.3f ms (%.0f transactions/s)",
+        transaction_num, wall_s * 1000, transaction_num / wall_s
+    ).asCharString());
+
+    dynamixel_destroy(dynamixel_id);
+    transport_replayer_destroy(replayer);
+}
@@ -0,0 +1,788 @@
+#include <chrono>
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "simulator/virtual_bus.h"
+#include "util/packet_byte.h"
+
+
+TEST_GROUP(VIRTUAL_BUS)
+{
+    virtual_bus_t bus;
+    virtual_servo_t servo;
+    dynamixel_transport transport;
+    dynamixel_t dynamixel_id;
+
+    void setup()
+    {
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+
+        bus = virtual_bus_create(1000000);
+        servo = virtual_servo_create(1);
+        virtual_servo_write_table(servo, 8, 1, &baud_rate_1m);
+        virtual_bus_add_servo(bus, servo);
+        virtual_bus_init_transport(bus, &transport);
+
+        dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+    }
+
+    void teardown()
+    {
+        dynamixel_destroy(dynamixel_id);
+        virtual_bus_destroy(bus);
+        virtual_servo_destroy(servo);
+    }
+
+    /// Pingを送り、かかった時間を返す
+    uint64_t ping_us(dynamixel_parse_result expected_result)
+    {
+        uint8_t error;
+        uint64_t start_us = virtual_bus_get_time_us(bus);
+
+        LONGS_EQUAL(expected_result, dynamixel_send_ping(dynamixel_id, 1, &error, NULL, NULL, 0));
+        return virtual_bus_get_time_us(bus) - start_us;
+    }
+
+    /// Return Delay Timeを0にして、応答時間の推定値を収束させる
+    void converge_rtt_estimate()
+    {
+        uint8_t error;
+
+        LONGS_EQUAL(
+            DYNAMIXEL_PARSE_SUCCESS,
+            dynamixel_send_write_return_delay_time(dynamixel_id, 1, &error, 0, 0, 1)
+        );
+        for (size_t i = 0; i < 20; i++)
+            ping_us(DYNAMIXEL_PARSE_SUCCESS);
+    }
+};
+
+TEST(VIRTUAL_BUS, Ping)
+{
+    uint8_t error;
+    uint16_t model_no;
+    uint8_t firmware;
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_ping(dynamixel_id, 1, &error, &model_no, &firmware, 0)
+    );
+    UNSIGNED_LONGS_EQUAL(VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288, model_no);
+    UNSIGNED_LONGS_EQUAL(VIRTUAL_SERVO_FIRMWARE_VERSION_DEFAULT, firmware);
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_NO_RESPONSE,
+        dynamixel_send_ping(dynamixel_id, 2, &error, NULL, NULL, 0)
+    );
+}
+
+TEST(VIRTUAL_BUS, ReadTakesWireTimeAndReturnDelayTime)
+{
+    uint8_t error;
+    float position;
+    uint64_t start_us = virtual_bus_get_time_us(bus);
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1)
+    );
+    DOUBLES_EQUAL(2048 * 0.088, position, 0.001);
+
+    // インストラクションパケット14Byte + 応答パケット15Byte(1Mbpsで10us/Byte) + Return Delay Time 500us
+    UNSIGNED_LONGS_EQUAL(14 * 10 + 500 + 15 * 10, virtual_bus_get_time_us(bus) - start_us);
+
+    virtual_servo_set_return_delay_time_us(servo, 0);
+    start_us = virtual_bus_get_time_us(bus);
+    dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1);
+    UNSIGNED_LONGS_EQUAL(14 * 10 + 15 * 10, virtual_bus_get_time_us(bus) - start_us);
+}
+
+TEST(VIRTUAL_BUS, StatusTimestampUsesVirtualClock)
+{
+    uint8_t error;
+    float position;
+    dynamixel_status_timestamp timestamp;
+    uint64_t start_us = virtual_bus_get_time_us(bus);
+
+    LONGS_EQUAL(1, dynamixel_get_status_timestamp(dynamixel_id, &timestamp));
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1)
+    );
+    LONGS_EQUAL(0, dynamixel_get_status_timestamp(dynamixel_id, &timestamp));
+
+    // インストラクションパケット14Byte(1Mbpsで10us/Byte)の送信完了
+    UNSIGNED_LONGS_EQUAL(start_us + 14 * 10, timestamp.instruction_us);
+    // Return Delay Time 500us後に送信を始めた応答パケットの最初の1Byte
+    UNSIGNED_LONGS_EQUAL(timestamp.instruction_us + 500 + 10, timestamp.header_us);
+    // 応答パケット15Byteの最後の1Byte
+    UNSIGNED_LONGS_EQUAL(timestamp.instruction_us + 500 + 15 * 10, timestamp.crc_us);
+}
+
+TEST(VIRTUAL_BUS, StatusTimestampOfEachSyncReadResponse)
+{
+    uint8_t error;
+    uint8_t status_parameter[100];
+    size_t status_parameter_size;
+    uint8_t parameter[] = {132, 0, 4, 0, 1, 2};
+    uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+    dynamixel_status_timestamp first, second;
+    virtual_servo_t servo2 = virtual_servo_create(2);
+
+    virtual_servo_write_table(servo2, 8, 1, &baud_rate_1m);
+    virtual_servo_set_return_delay_time_us(servo, 0);
+    virtual_servo_set_return_delay_time_us(servo2, 0);
+    virtual_bus_add_servo(bus, servo2);
+
+    dynamixel_write_uart_packet(dynamixel_id, 0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, 6, parameter);
+    dynamixel_wait_write(dynamixel_id);
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_read_uart_packet(dynamixel_id, 1, &error, &status_parameter_size, status_parameter, 0)
+    );
+    dynamixel_get_status_timestamp(dynamixel_id, &first);
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_read_uart_packet(dynamixel_id, 2, &error, &status_parameter_size, status_parameter, 0)
+    );
+    dynamixel_get_status_timestamp(dynamixel_id, &second);
+
+    // 2台目の応答パケットは、1台目の応答パケットを受信し終わった直後から届く
+    UNSIGNED_LONGS_EQUAL(first.instruction_us, second.instruction_us);
+    UNSIGNED_LONGS_EQUAL(first.instruction_us + 15 * 10, first.crc_us);
+    UNSIGNED_LONGS_EQUAL(first.crc_us + 10, second.header_us);
+    UNSIGNED_LONGS_EQUAL(first.crc_us + 15 * 10, second.crc_us);
+
+    virtual_servo_destroy(servo2);
+}
+
+TEST(VIRTUAL_BUS, WriteThroughDriver)
+{
+    uint8_t error;
+    uint8_t data[4];
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_write_goal_position(dynamixel_id, 1, &error, 90.0, 0, 1)
+    );
+    virtual_servo_read_table(servo, 116, 4, data);
+    BYTES_EQUAL(1023 & 0xff, data[0]);
+    BYTES_EQUAL(1023 >> 8, data[1]);
+
+    // 範囲外の値はエラーの応答パケットが返る
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_STATUS_ERROR,
+        dynamixel_send_write_goal_position(dynamixel_id, 1, &error, 400.0, 0, 1)
+    );
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_DATA_LIMIT, error);
+}
+
+TEST(VIRTUAL_BUS, PositionFollowsGoalWithDynamics)
+{
+    uint8_t error;
+    float position, previous_position;
+    uint64_t start_us;
+
+    virtual_servo_enable_dynamics(servo, NULL);
+    virtual_servo_set_return_delay_time_us(servo, 0);
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_write_torque_enable(dynamixel_id, 1, &error, true, 0, 1)
+    );
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_write_goal_position(dynamixel_id, 1, &error, 264.0, 0, 1)
+    );
+
+    // 10msごとに現在位置を読み、目標位置に近づいていくことを確認する
+    start_us = virtual_bus_get_time_us(bus);
+    previous_position = 2048 * 0.088;
+    do
+    {
+        virtual_bus_advance_us(bus, 10000);
+        LONGS_EQUAL(
+            DYNAMIXEL_PARSE_SUCCESS,
+            dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1)
+        );
+        CHECK(position >= previous_position - 0.5);
+        previous_position = position;
+    } while (position < 263.0 && virtual_bus_get_time_us(bus) - start_us < 1000000);
+
+    CHECK(virtual_bus_get_time_us(bus) - start_us < 300000);
+}
+
+TEST(VIRTUAL_BUS, ConfigureFindsBaudRate)
+{
+    uint8_t error;
+    uint8_t baud_rate_57600 = DYNAMIXEL_BAUD_RATE_57600;
+    uint8_t operating_mode;
+
+    virtual_servo_write_table(servo, 8, 1, &baud_rate_57600);
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_configure(
+            dynamixel_id, 1, &error, 100,
+            DYNAMIXEL_OPERATING_MODE_VELOCITY_CONTROL, 0, 1
+        )
+    );
+    UNSIGNED_LONGS_EQUAL(1000000, virtual_servo_get_baud_rate(servo));
+    UNSIGNED_LONGS_EQUAL(1000000, virtual_bus_get_baud_rate(bus));
+    UNSIGNED_LONGS_EQUAL(100, virtual_servo_get_return_delay_time_us(servo));
+    virtual_servo_read_table(servo, 11, 1, &operating_mode);
+    BYTES_EQUAL(DYNAMIXEL_OPERATING_MODE_VELOCITY_CONTROL, operating_mode);
+}
+
+TEST(VIRTUAL_BUS, AdaptiveTimeoutBacksOffAndRecovers)
+{
+    uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+    uint8_t baud_rate_57600 = DYNAMIXEL_BAUD_RATE_57600;
+
+    converge_rtt_estimate();
+
+    // ボーレートを変えて応答しないようにすると、応答がないたびに待ち時間が2倍になる
+    // (Pingの送信に100us、待ち時間は下限の100us)
+    virtual_servo_write_table(servo, 8, 1, &baud_rate_57600);
+    UNSIGNED_LONGS_EQUAL(100 + 100, ping_us(DYNAMIXEL_PARSE_NO_RESPONSE));
+    UNSIGNED_LONGS_EQUAL(100 + 200, ping_us(DYNAMIXEL_PARSE_NO_RESPONSE));
+    UNSIGNED_LONGS_EQUAL(100 + 400, ping_us(DYNAMIXEL_PARSE_NO_RESPONSE));
+    UNSIGNED_LONGS_EQUAL(100 + 800, ping_us(DYNAMIXEL_PARSE_NO_RESPONSE));
+    // 8倍までしか延ばさない
+    UNSIGNED_LONGS_EQUAL(100 + 800, ping_us(DYNAMIXEL_PARSE_NO_RESPONSE));
+
+    // 応答が返ってくると、元の待ち時間に戻る
+    virtual_servo_write_table(servo, 8, 1, &baud_rate_1m);
+    ping_us(DYNAMIXEL_PARSE_SUCCESS);
+    virtual_servo_write_table(servo, 8, 1, &baud_rate_57600);
+    UNSIGNED_LONGS_EQUAL(100 + 100, ping_us(DYNAMIXEL_PARSE_NO_RESPONSE));
+}
+
+TEST(VIRTUAL_BUS, AdaptiveTimeoutFollowsLatencyStepUp)
+{
+    uint srtt_us, rttvar_us;
+    size_t no_response_num = 0;
+
+    converge_rtt_estimate();
+    dynamixel_set_response_sequencing(dynamixel_id, true);
+
+    // ドライバーを通さずに応答を遅くすると、待ち時間を延ばして応答を受け取れるようになる
+    virtual_servo_set_return_delay_time_us(servo, 300);
+    for (size_t i = 0; i < 10; i++)
+    {
+        uint8_t error;
+
+        if (dynamixel_send_ping(dynamixel_id, 1, &error, NULL, NULL, 0) == DYNAMIXEL_PARSE_SUCCESS)
+            break;
+        no_response_num++;
+        // 遅れて届く応答パケットを送り終えるまで待つ
+        virtual_bus_advance_us(bus, 1000);
+    }
+    UNSIGNED_LONGS_EQUAL(2, no_response_num);
+
+    // 以降は応答を取りこぼさない
+    for (size_t i = 0; i < 20; i++)
+        ping_us(DYNAMIXEL_PARSE_SUCCESS);
+    LONGS_EQUAL(0, dynamixel_get_rtt_estimate(dynamixel_id, 1, &srtt_us, &rttvar_us));
+    CHECK(srtt_us > 250);
+}
+
+TEST(VIRTUAL_BUS, WritingReturnDelayTimeResetsRttEstimate)
+{
+    uint8_t error;
+    uint srtt_us, rttvar_us;
+
+    converge_rtt_estimate();
+    LONGS_EQUAL(0, dynamixel_get_rtt_estimate(dynamixel_id, 1, &srtt_us, &rttvar_us));
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_write_return_delay_time(dynamixel_id, 1, &error, 400, 0, 1)
+    );
+    LONGS_EQUAL(1, dynamixel_get_rtt_estimate(dynamixel_id, 1, &srtt_us, &rttvar_us));
+
+    // 書き込んだReturn Delay Timeから計算した待ち時間で応答を受け取り、測定し直す
+    ping_us(DYNAMIXEL_PARSE_SUCCESS);
+    LONGS_EQUAL(0, dynamixel_get_rtt_estimate(dynamixel_id, 1, &srtt_us, &rttvar_us));
+    CHECK(srtt_us >= 400);
+}
+
+TEST(VIRTUAL_BUS, SyncRead)
+{
+    uint8_t error;
+    uint8_t status_parameter[100];
+    size_t status_parameter_size;
+    uint8_t parameter[] = {132, 0, 4, 0, 1};
+    virtual_bus_statistics statistics;
+
+    LONGS_EQUAL(0, dynamixel_write_uart_packet(
+        dynamixel_id, 0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, 5, parameter
+    ));
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_read_uart_packet(
+            dynamixel_id, 1, &error, &status_parameter_size, status_parameter, 0
+        )
+    );
+    UNSIGNED_LONGS_EQUAL(4, status_parameter_size);
+    BYTES_EQUAL(0x00, status_parameter[0]);
+    BYTES_EQUAL(0x08, status_parameter[1]);
+
+    virtual_bus_get_statistics(bus, &statistics);
+    UNSIGNED_LONGS_EQUAL(1, statistics.instruction_packets);
+    UNSIGNED_LONGS_EQUAL(1, statistics.status_packets);
+    UNSIGNED_LONGS_EQUAL(15, statistics.tx_bytes);
+    UNSIGNED_LONGS_EQUAL(15, statistics.rx_bytes);
+}
+
+TEST(VIRTUAL_BUS, ReadThroughput)
+{
+    const size_t transaction_num = 1000;
+    uint8_t error;
+    float position;
+    uint64_t start_us = virtual_bus_get_time_us(bus);
+    auto start = std::chrono::steady_clock::now();
+
+    virtual_servo_set_return_delay_time_us(servo, 0);
+    for (size_t i = 0; i < transaction_num; i++)
+    {
+        LONGS_EQUAL(
+            DYNAMIXEL_PARSE_SUCCESS,
+            dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1)
+        );
+    }
+
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t virtual_us = virtual_bus_get_time_us(bus) - start_us;
+
+    // 待ち時間を余分に取らなければ、バスの時間は送受信にかかる時間のみになる
+    UNSIGNED_LONGS_EQUAL(transaction_num * (14 + 15) * 10, virtual_us);
+    UT_PRINT(StringFromFormat(
+        "read position: %.0f transactions/s (virtual bus), %.0f transactions/s (host CPU)",
+        transaction_num * 1e6 / virtual_us, transaction_num / wall_s
+    ).asCharString());
+}
+
+
+TEST(VIRTUAL_BUS, PollReadsWithoutBlocking)
+{
+    // Present Position、4Byte
+    uint8_t parameter[] = {132, 0, 4, 0};
+    uint8_t error;
+    size_t status_parameter_size;
+    uint8_t status_parameter[100];
+    uint64_t now_us;
+    size_t poll_num = 0;
+
+    LONGS_EQUAL(0, dynamixel_start_packet(dynamixel_id, 1, DYNAMIXEL__INSTRUCTION_READ, 4, parameter, 0));
+    // 通信が終わるまで、次の通信は始められない
+    LONGS_EQUAL(1, dynamixel_start_packet(dynamixel_id, 1, DYNAMIXEL__INSTRUCTION_PING, 0, NULL, 0));
+
+    while (1)
+    {
+        now_us = virtual_bus_get_time_us(bus);
+        if (dynamixel_poll(dynamixel_id, now_us) == DYNAMIXEL_STATE_DONE)
+            break;
+
+        // dynamixel_poll()は待たない
+        UNSIGNED_LONGS_EQUAL(now_us, virtual_bus_get_time_us(bus));
+        // 通信中に他の処理を行う時間
+        virtual_bus_advance_us(bus, 10);
+        poll_num++;
+    }
+    // インストラクションパケット14Byte + Return Delay Time 500us + 応答パケット15Byte(1Mbpsで10us/Byte)
+    CHECK(poll_num * 10 >= 14 * 10 + 500 + 15 * 10);
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_get_packet_result(dynamixel_id, &error, &status_parameter_size, status_parameter)
+    );
+    UNSIGNED_LONGS_EQUAL(4, status_parameter_size);
+    BYTES_EQUAL(0x00, status_parameter[0]);
+    BYTES_EQUAL(0x08, status_parameter[1]);
+    LONGS_EQUAL(DYNAMIXEL_STATE_IDLE, dynamixel_get_state(dynamixel_id));
+}
+
+TEST(VIRTUAL_BUS, PollTimesOutWithoutResponse)
+{
+    uint8_t error;
+    size_t status_parameter_size;
+    uint8_t status_parameter[100];
+
+    dynamixel_set_timeout_model(dynamixel_id, DYNAMIXEL_TIMEOUT_MODEL_BAUD_RATE);
+    LONGS_EQUAL(0, dynamixel_start_packet(dynamixel_id, 2, DYNAMIXEL__INSTRUCTION_PING, 0, NULL, 0));
+
+    // 送信時間を過ぎるまでは送信中のまま
+    LONGS_EQUAL(DYNAMIXEL_STATE_TX, dynamixel_poll(dynamixel_id, virtual_bus_get_time_us(bus)));
+    virtual_bus_advance_us(bus, 10 * 10);
+    LONGS_EQUAL(DYNAMIXEL_STATE_AWAIT_FIRST_BYTE, dynamixel_poll(dynamixel_id, virtual_bus_get_time_us(bus)));
+
+    virtual_bus_advance_us(bus, dynamixel_get_response_timeout_us(dynamixel_id, 2, 0, 14) - 1);
+    LONGS_EQUAL(DYNAMIXEL_STATE_AWAIT_FIRST_BYTE, dynamixel_poll(dynamixel_id, virtual_bus_get_time_us(bus)));
+    virtual_bus_advance_us(bus, 1);
+    LONGS_EQUAL(DYNAMIXEL_STATE_DONE, dynamixel_poll(dynamixel_id, virtual_bus_get_time_us(bus)));
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_NO_RESPONSE,
+        dynamixel_get_packet_result(dynamixel_id, &error, &status_parameter_size, status_parameter)
+    );
+}
+
+TEST(VIRTUAL_BUS, PollRetriesReadWithoutBlocking)
+{
+    // Goal Position = 1024
+    const uint8_t goal_position[] = {0x00, 0x04, 0x00, 0x00};
+    uint8_t error;
+    size_t status_parameter_size;
+    uint8_t status_parameter[100];
+    virtual_bus_statistics statistics;
+    uint64_t now_us;
+
+    // ID 2は存在しないので、3回送って諦める
+    LONGS_EQUAL(0, dynamixel_start_read(dynamixel_id, 2, 132, 4, 0, 3));
+    while (1)
+    {
+        now_us = virtual_bus_get_time_us(bus);
+        if (dynamixel_poll(dynamixel_id, now_us) == DYNAMIXEL_STATE_DONE)
+            break;
+
+        // 送り直すときも待たない
+        UNSIGNED_LONGS_EQUAL(now_us, virtual_bus_get_time_us(bus));
+        virtual_bus_advance_us(bus, 10);
+    }
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_NO_RESPONSE,
+        dynamixel_get_packet_result(dynamixel_id, &error, &status_parameter_size, status_parameter)
+    );
+    virtual_bus_get_statistics(bus, &statistics);
+    UNSIGNED_LONGS_EQUAL(3, statistics.instruction_packets);
+
+    // 書き込んだ値を読み取る
+    LONGS_EQUAL(0, dynamixel_start_write(dynamixel_id, 1, 116, 4, goal_position, 0, 0));
+    while (dynamixel_poll(dynamixel_id, virtual_bus_get_time_us(bus)) != DYNAMIXEL_STATE_DONE)
+        virtual_bus_advance_us(bus, 10);
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_get_packet_result(dynamixel_id, &error, &status_parameter_size, status_parameter)
+    );
+
+    LONGS_EQUAL(0, dynamixel_start_read(dynamixel_id, 1, 116, 4, 0, 0));
+    while (dynamixel_poll(dynamixel_id, virtual_bus_get_time_us(bus)) != DYNAMIXEL_STATE_DONE)
+        virtual_bus_advance_us(bus, 10);
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_get_packet_result(dynamixel_id, &error, &status_parameter_size, status_parameter)
+    );
+    UNSIGNED_LONGS_EQUAL(4, status_parameter_size);
+    BYTES_EQUAL(0x00, status_parameter[0]);
+    BYTES_EQUAL(0x04, status_parameter[1]);
+    virtual_bus_get_statistics(bus, &statistics);
+    UNSIGNED_LONGS_EQUAL(3 + 2, statistics.instruction_packets);
+}
+
+/// 指定した回数だけ送信を開始できる経路
+static dynamixel_transport *limited_transport_inner;
+static size_t limited_write_num;
+
+static int limited_write_async(void *context, const uint8_t *src, size_t len)
+{
+    if (limited_write_num == 0)
+        return 1;
+
+    limited_write_num--;
+    return limited_transport_inner->write_async(context, src, len);
+}
+
+TEST(VIRTUAL_BUS, WriteFailureIsNotTimeout)
+{
+    uint8_t error;
+    size_t status_parameter_size;
+    uint8_t status_parameter[100];
+    dynamixel_transport limited_transport = transport;
+    dynamixel_t limited_dynamixel;
+    uint64_t start_us;
+
+    limited_transport_inner = &transport;
+    limited_transport.write_async = limited_write_async;
+    limited_dynamixel = dynamixel_create_with_transport(&limited_transport, 1000000, 100, 10);
+
+    // 応答パケットを待たずに、送信の失敗を返す
+    limited_write_num = 0;
+    start_us = virtual_bus_get_time_us(bus);
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_WRITE_FAILED,
+        dynamixel_send_ping(limited_dynamixel, 1, &error, NULL, NULL, 0)
+    );
+    UNSIGNED_LONGS_EQUAL(start_us, virtual_bus_get_time_us(bus));
+    LONGS_EQUAL(1, dynamixel_start_read(limited_dynamixel, 1, 132, 4, 0, 3));
+    LONGS_EQUAL(DYNAMIXEL_STATE_IDLE, dynamixel_get_state(limited_dynamixel));
+
+    // 存在しないID 2に1回目は送れるが、送り直しでは送れない
+    limited_write_num = 1;
+    LONGS_EQUAL(0, dynamixel_start_read(limited_dynamixel, 2, 132, 4, 0, 3));
+    while (dynamixel_poll(limited_dynamixel, virtual_bus_get_time_us(bus)) != DYNAMIXEL_STATE_DONE)
+        virtual_bus_advance_us(bus, 10);
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_WRITE_FAILED,
+        dynamixel_get_packet_result(limited_dynamixel, &error, &status_parameter_size, status_parameter)
+    );
+
+    dynamixel_destroy(limited_dynamixel);
+}
+
+TEST_GROUP(VIRTUAL_BUS_MULTI_SERVO)
+{
+    virtual_bus_t bus;
+    virtual_servo_t servo[5];
+    size_t servo_num;
+    dynamixel_transport transport;
+    dynamixel_t dynamixel_id;
+
+    void setup()
+    {
+        bus = virtual_bus_create(1000000);
+        servo_num = 0;
+        add_servo(1, VIRTUAL_SERVO_MODEL_XL330_M288, 46);
+        add_servo(2, VIRTUAL_SERVO_MODEL_XL430_W250, 45);
+        add_servo(3, VIRTUAL_SERVO_MODEL_XM430_W350, 48);
+        add_servo(4, VIRTUAL_SERVO_MODEL_XL330_M288, 50);
+        virtual_bus_init_transport(bus, &transport);
+
+        dynamixel_id = dynamixel_create_with_transport(&transport, 1000000, 100, 10);
+    }
+
+    void teardown()
+    {
+        dynamixel_destroy(dynamixel_id);
+        virtual_bus_destroy(bus);
+        for (size_t i = 0; i < servo_num; i++)
+            virtual_servo_destroy(servo[i]);
+    }
+
+    virtual_servo_t add_servo(uint8_t id, virtual_servo_model model, uint8_t firmware_version)
+    {
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+
+        servo[servo_num] = virtual_servo_create_with_model(id, model, firmware_version);
+        virtual_servo_write_table(servo[servo_num], 8, 1, &baud_rate_1m);
+        virtual_servo_set_return_delay_time_us(servo[servo_num], 0);
+        virtual_bus_add_servo(bus, servo[servo_num]);
+        return servo[servo_num++];
+    }
+
+    /**
+     * ドライバーにはReturn Delay Timeを0と書き込み、仮想Dynamixelだけ応答を遅らせる
+     * (応答パケットの待ち時間を過ぎてから応答が届く)
+    */
+    void delay_response(size_t index, uint return_delay_time_us)
+    {
+        uint8_t error;
+
+        dynamixel_send_write_return_delay_time(
+            dynamixel_id, virtual_servo_get_id(servo[index]), &error, 0, 0, 1
+        );
+        virtual_servo_set_return_delay_time_us(servo[index], return_delay_time_us);
+    }
+
+    dynamixel_parse_result read_status(uint8_t id, size_t *status_parameter_size, uint8_t *status_parameter)
+    {
+        uint8_t error;
+
+        return dynamixel_read_uart_packet(
+            dynamixel_id, id, &error, status_parameter_size, status_parameter, 0
+        );
+    }
+};
+
+TEST(VIRTUAL_BUS_MULTI_SERVO, SyncReadResponseTrain)
+{
+    uint8_t parameter[] = {132, 0, 4, 0, 3, 1, 4};
+    uint8_t status_parameter[100];
+    size_t status_parameter_size;
+    uint64_t start_us;
+
+    // ID 1のみReturn Delay Timeを設定する
+    virtual_servo_set_return_delay_time_us(servo[0], 100);
+
+    start_us = virtual_bus_get_time_us(bus);
+    dynamixel_write_uart_packet(dynamixel_id, 0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, 7, parameter);
+
+    // パラメータのIDの順に応答する
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, read_status(3, &status_parameter_size, status_parameter));
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, read_status(1, &status_parameter_size, status_parameter));
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, read_status(4, &status_parameter_size, status_parameter));
+    UNSIGNED_LONGS_EQUAL(4, status_parameter_size);
+
+    // インストラクションパケット17Byte + 応答パケット15Byte x 3 + ID 1のReturn Delay Time
+    UNSIGNED_LONGS_EQUAL((17 + 15 * 3) * 10 + 100, virtual_bus_get_time_us(bus) - start_us);
+}
+
+TEST(VIRTUAL_BUS_MULTI_SERVO, SyncReadTimestampOfEachResponse)
+{
+    uint8_t parameter[] = {132, 0, 4, 0, 3, 1, 4};
+    const uint8_t id[] = {3, 1, 4};
+    uint8_t status_parameter[100];
+    size_t status_parameter_size;
+    dynamixel_status_timestamp timestamp[3], last;
+
+    dynamixel_write_uart_packet(dynamixel_id, 0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, 7, parameter);
+    dynamixel_wait_write(dynamixel_id);
+    for (size_t i = 0; i < 3; i++)
+        LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, read_status(id[i], &status_parameter_size, status_parameter));
+
+    // 全ての応答パケットを読み込んだ後でも、IDごとに受信した時刻が分かる
+    for (size_t i = 0; i < 3; i++)
+        LONGS_EQUAL(0, dynamixel_get_status_timestamp_of_id(dynamixel_id, id[i], &timestamp[i]));
+    LONGS_EQUAL(1, dynamixel_get_status_timestamp_of_id(dynamixel_id, 2, &last));
+    LONGS_EQUAL(1, dynamixel_get_status_timestamp_of_id(dynamixel_id, 0xfe, &last));
+
+    // 応答パケット(15Byte)は前の応答パケットを受信し終わった直後から続けて届く
+    for (size_t i = 0; i < 3; i++)
+    {
+        UNSIGNED_LONGS_EQUAL(timestamp[0].instruction_us, timestamp[i].instruction_us);
+        UNSIGNED_LONGS_EQUAL(timestamp[i].header_us + 14 * 10, timestamp[i].crc_us);
+        if (i > 0)
+            UNSIGNED_LONGS_EQUAL(timestamp[i - 1].crc_us + 10, timestamp[i].header_us);
+    }
+    UNSIGNED_LONGS_EQUAL(timestamp[0].instruction_us + 10, timestamp[0].header_us);
+
+    // 最後に解析した応答パケットの時刻は、最後のIDの時刻と同じ
+    LONGS_EQUAL(0, dynamixel_get_status_timestamp(dynamixel_id, &last));
+    UNSIGNED_LONGS_EQUAL(timestamp[2].header_us, last.header_us);
+    UNSIGNED_LONGS_EQUAL(timestamp[2].crc_us, last.crc_us);
+}
+
+TEST(VIRTUAL_BUS_MULTI_SERVO, SyncReadStopsAfterMissingId)
+{
+    uint8_t parameter[] = {132, 0, 4, 0, 1, 9, 2};
+    uint8_t status_parameter[100];
+    size_t status_parameter_size;
+
+    dynamixel_write_uart_packet(dynamixel_id, 0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, 7, parameter);
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, read_status(1, &status_parameter_size, status_parameter));
+    // ID 9の応答がないため、ID 2は送信を始めない
+    LONGS_EQUAL(DYNAMIXEL_PARSE_NO_RESPONSE, read_status(2, &status_parameter_size, status_parameter));
+}
+
+TEST(VIRTUAL_BUS_MULTI_SERVO, BulkReadResponseTrain)
+{
+    uint8_t parameter[] = {2, 132, 0, 4, 0, 1, 64, 0, 1, 0};
+    uint8_t status_parameter[100];
+    size_t status_parameter_size;
+
+    dynamixel_write_uart_packet(dynamixel_id, 0xfe, DYNAMIXEL__INSTRUCTION_BULK_READ, 10, parameter);
+
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, read_status(2, &status_parameter_size, status_parameter));
+    UNSIGNED_LONGS_EQUAL(4, status_parameter_size);
+    LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, read_status(1, &status_parameter_size, status_parameter));
+    UNSIGNED_LONGS_EQUAL(1, status_parameter_size);
+}
+
+TEST(VIRTUAL_BUS_MULTI_SERVO, BroadcastPingInIdOrder)
+{
+    const uint16_t model_no[] = {
+        VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288,
+        VIRTUAL_SERVO_MODEL_NUMBER_XL430_W250,
+        VIRTUAL_SERVO_MODEL_NUMBER_XM430_W350,
+        VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288,
+    };
+    const uint8_t firmware_version[] = {46, 45, 48, 50};
+    uint8_t status_parameter[100];
+    size_t status_parameter_size;
+    uint64_t start_us;
+    virtual_bus_statistics statistics;
+
+    start_us = virtual_bus_get_time_us(bus);
+    dynamixel_write_uart_packet(dynamixel_id, 0xfe, DYNAMIXEL__INSTRUCTION_PING, 0, NULL);
+
+    for (uint8_t id = 1; id <= 4; id++)
+    {
+        LONGS_EQUAL(DYNAMIXEL_PARSE_SUCCESS, read_status(id, &status_parameter_size, status_parameter));
+        UNSIGNED_LONGS_EQUAL(3, status_parameter_size);
+        UNSIGNED_LONGS_EQUAL(model_no[id - 1], status_parameter[0] | (status_parameter[1] << 8));
+        UNSIGNED_LONGS_EQUAL(firmware_version[id - 1], status_parameter[2]);
+    }
+
+    // インストラクションパケット10Byte + ID 4の枠(ID x 14Byte)の後に応答パケット14Byte
+    UNSIGNED_LONGS_EQUAL((10 + 4 * 14 + 14) * 10, virtual_bus_get_time_us(bus) - start_us);
+
+    virtual_bus_get_statistics(bus, &statistics);
+    UNSIGNED_LONGS_EQUAL(4, statistics.status_packets);
+    UNSIGNED_LONGS_EQUAL(0, statistics.collisions);
+}
+
+TEST(VIRTUAL_BUS_MULTI_SERVO, LongReturnDelayCollidesInBroadcastPing)
+{
+    uint8_t status_parameter[100];
+    size_t status_parameter_size;
+    virtual_bus_statistics statistics;
+
+    // ID 1の応答がID 2の枠にはみ出す
+    virtual_servo_set_return_delay_time_us(servo[0], 100);
+    dynamixel_write_uart_packet(dynamixel_id, 0xfe, DYNAMIXEL__INSTRUCTION_PING, 0, NULL);
+
+    CHECK(read_status(1, &status_parameter_size, status_parameter) != DYNAMIXEL_PARSE_SUCCESS);
+
+    virtual_bus_get_statistics(bus, &statistics);
+    UNSIGNED_LONGS_EQUAL(1, statistics.collisions);
+}
+
+TEST(VIRTUAL_BUS_MULTI_SERVO, DuplicateIdCollides)
+{
+    uint8_t error;
+    virtual_bus_statistics statistics;
+
+    add_servo(1, VIRTUAL_SERVO_MODEL_XM430_W350, 48);
+
+    CHECK(dynamixel_send_ping(dynamixel_id, 1, &error, NULL, NULL, 0) != DYNAMIXEL_PARSE_SUCCESS);
+
+    virtual_bus_get_statistics(bus, &statistics);
+    UNSIGNED_LONGS_EQUAL(1, statistics.collisions);
+}
+
+TEST(VIRTUAL_BUS_MULTI_SERVO, LateResponseIsParsedAsNextResponse)
+{
+    uint8_t error;
+    float position;
+
+    delay_response(0, 400);
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_NO_RESPONSE,
+        dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1)
+    );
+    // ID 1の遅れた応答が届いた後に送信すると、ID 2の応答として解析する
+    virtual_bus_advance_us(bus, 1000);
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_WRONG_ID,
+        dynamixel_send_read_position(dynamixel_id, 2, &error, &position, 0, 1)
+    );
+}
+
+TEST(VIRTUAL_BUS_MULTI_SERVO, ResponseSequencingFlushesLateResponse)
+{
+    uint8_t error;
+    float position;
+    dynamixel_stale_statistics stale_statistics;
+    virtual_bus_statistics statistics;
+
+    delay_response(0, 400);
+    dynamixel_set_response_sequencing(dynamixel_id, true);
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_NO_RESPONSE,
+        dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1)
+    );
+    virtual_bus_advance_us(bus, 1000);
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_read_position(dynamixel_id, 2, &error, &position, 0, 1)
+    );
+
+    // ID 1の遅れた応答パケット15Byteを送信前に捨てたので、再送していない
+    dynamixel_get_stale_statistics(dynamixel_id, &stale_statistics);
+    UNSIGNED_LONGS_EQUAL(15, stale_statistics.flushed_bytes);
+    UNSIGNED_LONGS_EQUAL(0, stale_statistics.discarded_packets);
+    virtual_bus_get_statistics(bus, &statistics);
+    // Return Delay Timeの書き込み + 読み込み2回
+    UNSIGNED_LONGS_EQUAL(3, statistics.instruction_packets);
+}
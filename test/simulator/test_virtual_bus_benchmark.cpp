@@ -0,0 +1,141 @@
+#include <chrono>
+#include <vector>
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "simulator/virtual_bus.h"
+#include "util/packet_byte.h"
+
+
+/**
+ * 複数の仮想Dynamixelに対して、Sync Writeで目標位置を送り、Sync Readで現在位置を読む周期を繰り返す。
+ * 仮想Dynamixelは動力学モデルを有効にし、トルクオンで目標位置に向かって動かす。
+ * バスの時間(仮想時間)での周期と、ホストのCPU時間での周期を計測する
+*/
+TEST_GROUP(VIRTUAL_BUS_BENCHMARK)
+{
+    static const uint baud_rate = 1000000;
+    virtual_bus_t bus;
+    std::vector<virtual_servo_t> servo;
+    dynamixel_transport transport;
+    dynamixel_t dynamixel_id;
+
+    void setup()
+    {
+        bus = virtual_bus_create(baud_rate);
+        virtual_bus_init_transport(bus, &transport);
+        dynamixel_id = dynamixel_create_with_transport(&transport, baud_rate, 2048, 10);
+    }
+
+    void teardown()
+    {
+        dynamixel_destroy(dynamixel_id);
+        virtual_bus_destroy(bus);
+        for (virtual_servo_t s : servo)
+            virtual_servo_destroy(s);
+        servo.clear();
+    }
+
+    void add_servos(size_t servo_num)
+    {
+        const virtual_servo_model model[] = {
+            VIRTUAL_SERVO_MODEL_XL330_M288,
+            VIRTUAL_SERVO_MODEL_XL430_W250,
+            VIRTUAL_SERVO_MODEL_XM430_W350,
+        };
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+        uint8_t torque_enable = 1;
+
+        for (size_t i = 0; i < servo_num; i++)
+        {
+            virtual_servo_t s = virtual_servo_create_with_model(i + 1, model[i % 3], 40 + i % 10);
+            virtual_servo_write_table(s, 8, 1, &baud_rate_1m);
+            virtual_servo_set_return_delay_time_us(s, 0);
+            virtual_servo_enable_dynamics(s, NULL);
+            virtual_servo_write_table(s, 64, 1, &torque_enable);
+            virtual_bus_add_servo(bus, s);
+            servo.push_back(s);
+        }
+    }
+
+    void run_cycle(size_t servo_num, size_t cycle_num)
+    {
+        std::vector<uint8_t> sync_write(4 + servo_num * 5);
+        std::vector<uint8_t> sync_read(4 + servo_num);
+        uint8_t error, status_parameter[100];
+        size_t status_parameter_size;
+
+        add_servos(servo_num);
+
+        // Goal Position、Present Position(4Byte)
+        sync_write[0] = 116;
+        sync_write[2] = 4;
+        sync_read[0] = 132;
+        sync_read[2] = 4;
+        for (size_t i = 0; i < servo_num; i++)
+        {
+            sync_write[4 + i * 5] = i + 1;
+            sync_write[4 + i * 5 + 2] = 0x08;
+            sync_read[4 + i] = i + 1;
+        }
+
+        uint64_t start_us = virtual_bus_get_time_us(bus);
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t cycle = 0; cycle < cycle_num; cycle++)
+        {
+            // 目標位置を2048と2148で交互に切り替える
+            for (size_t i = 0; i < servo_num; i++)
+                sync_write[4 + i * 5 + 1] = cycle % 2 == 0 ? 0x00 : 0x64;
+
+            dynamixel_write_uart_packet(
+                dynamixel_id, 0xfe, DYNAMIXEL__INSTRUCTION_SYNC_WRITE,
+                sync_write.size(), sync_write.data()
+            );
+            dynamixel_write_uart_packet(
+                dynamixel_id, 0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ,
+                sync_read.size(), sync_read.data()
+            );
+
+            for (size_t i = 0; i < servo_num; i++)
+            {
+                LONGS_EQUAL(
+                    DYNAMIXEL_PARSE_SUCCESS,
+                    dynamixel_read_uart_packet(
+                        dynamixel_id, i + 1, &error,
+                        &status_parameter_size, status_parameter, 0
+                    )
+                );
+            }
+        }
+
+        double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t virtual_us = virtual_bus_get_time_us(bus) - start_us;
+
+        // Sync Write(14 + 5N Byte) + Sync Read(14 + N Byte) + 応答パケット(15N Byte)を1Mbpsで送受信する時間
+        UNSIGNED_LONGS_EQUAL(cycle_num * (28 + 21 * servo_num) * 10, virtual_us);
+        UT_PRINT(StringFromFormat(
+            "%3u servos: %.0f cycles/s (virtual bus), %.0f cycles/s (host CPU)",
+            (unsigned)servo_num, cycle_num * 1e6 / virtual_us, cycle_num / wall_s
+        ).asCharString());
+    }
+};
+
+TEST(VIRTUAL_BUS_BENCHMARK, SyncCycle4Servos)
+{
+    run_cycle(4, 1000);
+}
+
+TEST(VIRTUAL_BUS_BENCHMARK, SyncCycle16Servos)
+{
+    run_cycle(16, 500);
+}
+
+TEST(VIRTUAL_BUS_BENCHMARK, SyncCycle64Servos)
+{
+    run_cycle(64, 100);
+}
+
+TEST(VIRTUAL_BUS_BENCHMARK, SyncCycle252Servos)
+{
+    run_cycle(252, 20);
+}
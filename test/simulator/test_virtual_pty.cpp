@@ -0,0 +1,129 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "CppUTest/TestHarness.h"
+#include "dynamixel/dynamixel.h"
+#include "pico_communicator/pico_communicator.h"
+#include "pico_communicator/pico_communicator_host.h"
+#include "simulator/virtual_pty.h"
+#include "util/packet_byte.h"
+
+
+// hostではUARTインスタンスのアドレスだけを識別に使う
+static int uart_pty_entity;
+
+/**
+ * ptyの先で仮想バスを動かし、ホスト向けのシリアルデバイスの実装(termios)を通してドライバーで通信する
+*/
+TEST_GROUP(VIRTUAL_PTY)
+{
+    uart_inst_t *uart_pty;
+    virtual_bus_t bus;
+    virtual_servo_t servo[2];
+    virtual_pty_t pty;
+    std::atomic<bool> running;
+    std::thread runner;
+    dynamixel_transport transport;
+    dynamixel_t dynamixel_id;
+
+    void setup()
+    {
+        uint8_t baud_rate_57600 = DYNAMIXEL_BAUD_RATE_57600;
+        uint8_t baud_rate_1m = DYNAMIXEL_BAUD_RATE_1M;
+
+        uart_pty = (uart_inst_t *)&uart_pty_entity;
+        bus = virtual_bus_create(1000000);
+        servo[0] = virtual_servo_create(1);
+        servo[1] = virtual_servo_create_with_model(2, VIRTUAL_SERVO_MODEL_XM430_W350, 46);
+        virtual_servo_write_table(servo[0], 8, 1, &baud_rate_1m);
+        virtual_servo_write_table(servo[1], 8, 1, &baud_rate_57600);
+        virtual_bus_add_servo(bus, servo[0]);
+        virtual_bus_add_servo(bus, servo[1]);
+
+        pty = virtual_pty_create(bus);
+        CHECK(pty != NULL);
+        running = true;
+        runner = std::thread([this]() {
+            while (running)
+                virtual_pty_run_once(pty, 1000);
+        });
+
+        dynamixel_id = NULL;
+        LONGS_EQUAL(0, pico_uart_host_bind(uart_pty, virtual_pty_get_slave_path(pty)));
+    }
+
+    void teardown()
+    {
+        if (dynamixel_id)
+            dynamixel_destroy(dynamixel_id);
+        pico_uart_deinit(uart_pty);
+
+        running = false;
+        runner.join();
+        virtual_pty_destroy(pty);
+        virtual_bus_destroy(bus);
+        virtual_servo_destroy(servo[0]);
+        virtual_servo_destroy(servo[1]);
+    }
+
+    void connect(uint baud_rate)
+    {
+        if (dynamixel_id)
+            dynamixel_destroy(dynamixel_id);
+
+        CHECK(pico_uart_init(uart_pty, baud_rate, 8, 1, UART_PARITY_NONE) > 0);
+        dynamixel_transport_init_uart(&transport, uart_pty);
+        dynamixel_id = dynamixel_create_with_transport(&transport, baud_rate, 100, 20000);
+        CHECK(dynamixel_id != NULL);
+    }
+};
+
+TEST(VIRTUAL_PTY, PingAndReadThroughSlave)
+{
+    uint8_t error;
+    uint16_t model_no;
+    uint8_t firmware;
+    float position;
+
+    STRCMP_CONTAINS("/dev/pts/", virtual_pty_get_slave_path(pty));
+    connect(1000000);
+
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_ping(dynamixel_id, 1, &error, &model_no, &firmware, 0)
+    );
+    UNSIGNED_LONGS_EQUAL(VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288, model_no);
+
+    // インストラクションパケット14Byte + 応答パケット15Byte(1Mbps) + Return Delay Time 500us以上かかる
+    auto start = std::chrono::steady_clock::now();
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_read_position(dynamixel_id, 1, &error, &position, 0, 1)
+    );
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+    DOUBLES_EQUAL(2048 * 0.088, position, 0.001);
+    CHECK(elapsed_us >= 14 * 10 + 500 + 15 * 10);
+}
+
+TEST(VIRTUAL_PTY, SlaveBaudRateSelectsServos)
+{
+    uint8_t error;
+    uint16_t model_no;
+
+    // ID 2は57600bpsのため、1Mbpsでは応答しない
+    connect(1000000);
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_NO_RESPONSE,
+        dynamixel_send_ping(dynamixel_id, 2, &error, &model_no, NULL, 0)
+    );
+
+    connect(57600);
+    LONGS_EQUAL(
+        DYNAMIXEL_PARSE_SUCCESS,
+        dynamixel_send_ping(dynamixel_id, 2, &error, &model_no, NULL, 0)
+    );
+    UNSIGNED_LONGS_EQUAL(VIRTUAL_SERVO_MODEL_NUMBER_XM430_W350, model_no);
+    UNSIGNED_LONGS_EQUAL(57600, virtual_bus_get_baud_rate(bus));
+}
@@ -0,0 +1,287 @@
+#include "CppUTest/TestHarness.h"
+#include "simulator/virtual_servo.h"
+#include "util/packet_byte.h"
+
+
+TEST_GROUP(VIRTUAL_SERVO)
+{
+    virtual_servo_t servo;
+    uint8_t status_id;
+    uint8_t status_parameter[VIRTUAL_SERVO_STATUS_PARAMETER_MAX_SIZE];
+    size_t status_parameter_size;
+
+    void setup()
+    {
+        servo = virtual_servo_create(1);
+        status_id = 0;
+        status_parameter_size = 0;
+    }
+
+    void teardown()
+    {
+        virtual_servo_destroy(servo);
+    }
+
+    int handle(uint8_t id, uint8_t instruction, const uint8_t *parameter, size_t parameter_size)
+    {
+        return virtual_servo_handle_instruction(
+            servo, id, instruction, parameter, parameter_size,
+            &status_id, status_parameter, &status_parameter_size
+        );
+    }
+};
+
+TEST(VIRTUAL_SERVO, CreateWithInitialControlTable)
+{
+    uint8_t data[2];
+
+    POINTERS_EQUAL(NULL, virtual_servo_create(253));
+    UNSIGNED_LONGS_EQUAL(1, virtual_servo_get_id(servo));
+    UNSIGNED_LONGS_EQUAL(57600, virtual_servo_get_baud_rate(servo));
+    UNSIGNED_LONGS_EQUAL(500, virtual_servo_get_return_delay_time_us(servo));
+
+    LONGS_EQUAL(0, virtual_servo_read_table(servo, 0, 2, data));
+    BYTES_EQUAL(VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288 & 0xff, data[0]);
+    BYTES_EQUAL(VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288 >> 8, data[1]);
+    LONGS_EQUAL(1, virtual_servo_read_table(servo, VIRTUAL_SERVO_CONTROL_TABLE_SIZE - 1, 2, data));
+
+    virtual_servo_set_return_delay_time_us(servo, 1000);
+    UNSIGNED_LONGS_EQUAL(508, virtual_servo_get_return_delay_time_us(servo));
+}
+
+TEST(VIRTUAL_SERVO, Ping)
+{
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_PING, NULL, 0));
+    UNSIGNED_LONGS_EQUAL(1, status_id);
+    UNSIGNED_LONGS_EQUAL(4, status_parameter_size);
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_NONE, status_parameter[0]);
+    BYTES_EQUAL(VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288 & 0xff, status_parameter[1]);
+    BYTES_EQUAL(VIRTUAL_SERVO_MODEL_NUMBER_XL330_M288 >> 8, status_parameter[2]);
+    BYTES_EQUAL(VIRTUAL_SERVO_FIRMWARE_VERSION_DEFAULT, status_parameter[3]);
+
+    // ブロードキャストIDのpingにも応答する
+    LONGS_EQUAL(0, handle(0xfe, DYNAMIXEL__INSTRUCTION_PING, NULL, 0));
+    // 他のIDには応答しない
+    LONGS_EQUAL(1, handle(2, DYNAMIXEL__INSTRUCTION_PING, NULL, 0));
+}
+
+TEST(VIRTUAL_SERVO, WriteAndRead)
+{
+    uint8_t write_parameter[] = {116, 0, 0x00, 0x04, 0x00, 0x00};
+    uint8_t read_parameter[] = {116, 0, 4, 0};
+
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, write_parameter, 6));
+    UNSIGNED_LONGS_EQUAL(1, status_parameter_size);
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_NONE, status_parameter[0]);
+
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_READ, read_parameter, 4));
+    UNSIGNED_LONGS_EQUAL(5, status_parameter_size);
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_NONE, status_parameter[0]);
+    MEMCMP_EQUAL(write_parameter + 2, status_parameter + 1, 4);
+}
+
+TEST(VIRTUAL_SERVO, WriteErrors)
+{
+    // 読み込み専用
+    uint8_t present_position[] = {132, 0, 0, 0, 0, 0};
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, present_position, 6));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_ACCESS, status_parameter[0]);
+
+    // 項目の途中まで
+    uint8_t partial_goal_position[] = {116, 0, 0, 0};
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, partial_goal_position, 4));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_DATA_LENGTH, status_parameter[0]);
+
+    // 存在しない動作モード
+    uint8_t operating_mode[] = {11, 0, 2};
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, operating_mode, 3));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_DATA_RANGE, status_parameter[0]);
+
+    // Max Position Limitを超える
+    uint8_t goal_position[] = {116, 0, 0x00, 0x10, 0x00, 0x00};
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, goal_position, 6));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_DATA_LIMIT, status_parameter[0]);
+
+    // トルクオン中のEEPROM領域
+    uint8_t torque_enable[] = {64, 0, 1};
+    uint8_t return_delay_time[] = {9, 0, 0};
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, torque_enable, 3));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_NONE, status_parameter[0]);
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, return_delay_time, 3));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_ACCESS, status_parameter[0]);
+    UNSIGNED_LONGS_EQUAL(500, virtual_servo_get_return_delay_time_us(servo));
+
+    // 未定義のインストラクション
+    LONGS_EQUAL(0, handle(1, 0x7f, NULL, 0));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_INSTRUCTION, status_parameter[0]);
+}
+
+TEST(VIRTUAL_SERVO, StatusReturnLevelAndBroadcast)
+{
+    uint8_t led[] = {65, 0, 1};
+    uint8_t status_return_level[] = {68, 0, 0};
+    uint8_t read_parameter[] = {65, 0, 1, 0};
+    uint8_t data;
+
+    // ブロードキャストIDへの書き込みは反映されるが、応答しない
+    LONGS_EQUAL(1, handle(0xfe, DYNAMIXEL__INSTRUCTION_WRITE, led, 3));
+    virtual_servo_read_table(servo, 65, 1, &data);
+    BYTES_EQUAL(1, data);
+
+    // 書き込み後のStatus Return Levelで応答するかを決める
+    LONGS_EQUAL(1, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, status_return_level, 3));
+    // Status Return Levelが0のときは、pingのみ応答する
+    LONGS_EQUAL(1, handle(1, DYNAMIXEL__INSTRUCTION_READ, read_parameter, 4));
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_PING, NULL, 0));
+}
+
+TEST(VIRTUAL_SERVO, SecondaryIdIsReceivedWithoutResponse)
+{
+    uint8_t secondary_id[] = {12, 0, 5};
+    uint8_t led[] = {65, 0, 1};
+    uint8_t data;
+
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, secondary_id, 3));
+    LONGS_EQUAL(1, handle(5, DYNAMIXEL__INSTRUCTION_WRITE, led, 3));
+    virtual_servo_read_table(servo, 65, 1, &data);
+    BYTES_EQUAL(1, data);
+    LONGS_EQUAL(1, handle(5, DYNAMIXEL__INSTRUCTION_PING, NULL, 0));
+}
+
+TEST(VIRTUAL_SERVO, RegWriteAndAction)
+{
+    uint8_t led[] = {65, 0, 1};
+    uint8_t data;
+
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_REG_WRITE, led, 3));
+    virtual_servo_read_table(servo, 65, 1, &data);
+    BYTES_EQUAL(0, data);
+    virtual_servo_read_table(servo, 69, 1, &data);
+    BYTES_EQUAL(1, data);
+
+    LONGS_EQUAL(1, handle(0xfe, DYNAMIXEL__INSTRUCTION_ACTION, NULL, 0));
+    virtual_servo_read_table(servo, 65, 1, &data);
+    BYTES_EQUAL(1, data);
+    virtual_servo_read_table(servo, 69, 1, &data);
+    BYTES_EQUAL(0, data);
+}
+
+TEST(VIRTUAL_SERVO, SyncAndBulkInstructions)
+{
+    uint8_t sync_write[] = {65, 0, 1, 0, 2, 0, 1, 1};
+    uint8_t sync_read[] = {65, 0, 1, 0, 2, 1};
+    uint8_t sync_read_other[] = {65, 0, 1, 0, 2, 3};
+    uint8_t bulk_write[] = {2, 65, 0, 1, 0, 0, 1, 64, 0, 1, 0, 1};
+    uint8_t bulk_read[] = {2, 65, 0, 1, 0, 1, 64, 0, 2, 0};
+
+    LONGS_EQUAL(1, handle(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_WRITE, sync_write, 8));
+
+    LONGS_EQUAL(0, handle(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, sync_read, 6));
+    UNSIGNED_LONGS_EQUAL(1, status_id);
+    UNSIGNED_LONGS_EQUAL(2, status_parameter_size);
+    BYTES_EQUAL(1, status_parameter[1]);
+    // 自分のIDが含まれていなければ応答しない
+    LONGS_EQUAL(1, handle(0xfe, DYNAMIXEL__INSTRUCTION_SYNC_READ, sync_read_other, 6));
+
+    LONGS_EQUAL(1, handle(0xfe, DYNAMIXEL__INSTRUCTION_BULK_WRITE, bulk_write, 12));
+
+    LONGS_EQUAL(0, handle(0xfe, DYNAMIXEL__INSTRUCTION_BULK_READ, bulk_read, 10));
+    UNSIGNED_LONGS_EQUAL(3, status_parameter_size);
+    // Torque EnableとLED
+    BYTES_EQUAL(1, status_parameter[1]);
+    BYTES_EQUAL(1, status_parameter[2]);
+}
+
+TEST(VIRTUAL_SERVO, FactoryResetAndReboot)
+{
+    uint8_t id[] = {7, 0, 3};
+    uint8_t led[] = {65, 0, 1};
+    uint8_t factory_reset_except_id[] = {DYNAMIXEL_FACTORY_RESET_ID};
+    uint8_t factory_reset_all[] = {DYNAMIXEL_FACTORY_RESET_ALL};
+    uint8_t data;
+
+    virtual_servo_set_return_delay_time_us(servo, 0);
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, id, 3));
+    // 応答パケットは書き込み前のIDで返す
+    UNSIGNED_LONGS_EQUAL(1, status_id);
+    UNSIGNED_LONGS_EQUAL(3, virtual_servo_get_id(servo));
+
+    LONGS_EQUAL(0, handle(3, DYNAMIXEL__INSTRUCTION_WRITE, led, 3));
+    LONGS_EQUAL(0, handle(3, DYNAMIXEL__INSTRUCTION_REBOOT, NULL, 0));
+    virtual_servo_read_table(servo, 65, 1, &data);
+    BYTES_EQUAL(0, data);
+    UNSIGNED_LONGS_EQUAL(0, virtual_servo_get_return_delay_time_us(servo));
+
+    LONGS_EQUAL(0, handle(3, DYNAMIXEL__INSTRUCTION_FACTORY_RESET, factory_reset_except_id, 1));
+    UNSIGNED_LONGS_EQUAL(3, virtual_servo_get_id(servo));
+    UNSIGNED_LONGS_EQUAL(500, virtual_servo_get_return_delay_time_us(servo));
+
+    LONGS_EQUAL(0, handle(3, DYNAMIXEL__INSTRUCTION_FACTORY_RESET, factory_reset_all, 1));
+    UNSIGNED_LONGS_EQUAL(1, virtual_servo_get_id(servo));
+}
+
+TEST(VIRTUAL_SERVO, IndirectAddress)
+{
+    // Indirect Address 1、2をPresent Positionの下位2Byteに対応付ける
+    uint8_t indirect_address[] = {168, 0, 132, 0, 133, 0};
+    uint8_t present_position[] = {0x34, 0x12, 0x00, 0x00};
+    uint8_t read_parameter[] = {208, 0, 2, 0};
+
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, indirect_address, 6));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_NONE, status_parameter[0]);
+    virtual_servo_write_table(servo, 132, 4, present_position);
+
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_READ, read_parameter, 4));
+    UNSIGNED_LONGS_EQUAL(3, status_parameter_size);
+    BYTES_EQUAL(0x34, status_parameter[1]);
+    BYTES_EQUAL(0x12, status_parameter[2]);
+}
+
+TEST(VIRTUAL_SERVO, CrcError)
+{
+    LONGS_EQUAL(0, virtual_servo_handle_crc_error(
+        servo, 1, &status_id, status_parameter, &status_parameter_size
+    ));
+    UNSIGNED_LONGS_EQUAL(1, status_parameter_size);
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_CRC, status_parameter[0]);
+
+    LONGS_EQUAL(1, virtual_servo_handle_crc_error(
+        servo, 0xfe, &status_id, status_parameter, &status_parameter_size
+    ));
+}
+
+TEST(VIRTUAL_SERVO, CreateWithModel)
+{
+    virtual_servo_t xl430 = virtual_servo_create_with_model(2, VIRTUAL_SERVO_MODEL_XL430_W250, 45);
+    uint8_t current_control[] = {11, 0, DYNAMIXEL_OPERATING_MODE_CURRENT_CONTROL};
+    uint8_t velocity_limit[] = {44, 0, 0x0a, 0x01, 0x00, 0x00};
+
+    UNSIGNED_LONGS_EQUAL(VIRTUAL_SERVO_MODEL_NUMBER_XL430_W250, virtual_servo_get_model_number(xl430));
+    LONGS_EQUAL(0, virtual_servo_handle_instruction(
+        xl430, 2, DYNAMIXEL__INSTRUCTION_PING, NULL, 0,
+        &status_id, status_parameter, &status_parameter_size
+    ));
+    BYTES_EQUAL(VIRTUAL_SERVO_MODEL_NUMBER_XL430_W250 & 0xff, status_parameter[1]);
+    BYTES_EQUAL(VIRTUAL_SERVO_MODEL_NUMBER_XL430_W250 >> 8, status_parameter[2]);
+    BYTES_EQUAL(45, status_parameter[3]);
+
+    // 電流を制御できないモデル
+    LONGS_EQUAL(0, virtual_servo_handle_instruction(
+        xl430, 2, DYNAMIXEL__INSTRUCTION_WRITE, current_control, 3,
+        &status_id, status_parameter, &status_parameter_size
+    ));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_DATA_RANGE, status_parameter[0]);
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, current_control, 3));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_NONE, status_parameter[0]);
+
+    // Velocity Limitの上限(266はXL430-W250では範囲外、XL330-M288では範囲内)
+    LONGS_EQUAL(0, virtual_servo_handle_instruction(
+        xl430, 2, DYNAMIXEL__INSTRUCTION_WRITE, velocity_limit, 6,
+        &status_id, status_parameter, &status_parameter_size
+    ));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_DATA_RANGE, status_parameter[0]);
+    LONGS_EQUAL(0, handle(1, DYNAMIXEL__INSTRUCTION_WRITE, velocity_limit, 6));
+    BYTES_EQUAL(VIRTUAL_SERVO_ERROR_NONE, status_parameter[0]);
+
+    virtual_servo_destroy(xl430);
+}
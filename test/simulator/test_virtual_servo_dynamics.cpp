@@ -0,0 +1,208 @@
+#include <cstdlib>
+#include "CppUTest/TestHarness.h"
+#include "simulator/virtual_servo.h"
+#include "util/analyze_packet.h"
+#include "util/packet_byte.h"
+
+
+TEST_GROUP(VIRTUAL_SERVO_DYNAMICS)
+{
+    virtual_servo_t servo;
+    uint64_t now_us;
+
+    void setup()
+    {
+        servo = virtual_servo_create(1);
+        now_us = 0;
+    }
+
+    void teardown()
+    {
+        virtual_servo_destroy(servo);
+    }
+
+    void write_value(uint16_t address, uint16_t size, int32_t value)
+    {
+        uint8_t data[4];
+
+        divide_into_4_byte(value, data, data + 1, data + 2, data + 3);
+        LONGS_EQUAL(0, virtual_servo_write_table(servo, address, size, data));
+    }
+
+    int32_t read_value(uint16_t address, uint16_t size)
+    {
+        uint8_t data[4];
+
+        LONGS_EQUAL(0, virtual_servo_read_table(servo, address, size, data));
+        if (size == 4)
+            return combine_signed_4_byte(data[0], data[1], data[2], data[3]);
+        if (size == 2)
+            return combine_signed_2_byte(data[0], data[1]);
+        return data[0];
+    }
+
+    void advance_ms(uint64_t ms)
+    {
+        now_us += ms * 1000;
+        virtual_servo_update(servo, now_us);
+    }
+
+    void enable(const virtual_motor_parameter *parameter)
+    {
+        virtual_servo_enable_dynamics(servo, parameter);
+        virtual_servo_update(servo, now_us);
+    }
+};
+
+TEST(VIRTUAL_SERVO_DYNAMICS, TableIsStaticWithoutDynamics)
+{
+    write_value(116, 4, 3000);
+    write_value(64, 1, 1);
+    advance_ms(1000);
+
+    LONGS_EQUAL(2048, read_value(132, 4));
+    LONGS_EQUAL(0, read_value(128, 4));
+    LONGS_EQUAL(0, read_value(122, 1));
+}
+
+TEST(VIRTUAL_SERVO_DYNAMICS, PositionControlReachesGoal)
+{
+    enable(NULL);
+    LONGS_EQUAL(50, read_value(144, 2));
+
+    write_value(116, 4, 3000);
+    // トルクオフでは動かない
+    advance_ms(100);
+    LONGS_EQUAL(2048, read_value(132, 4));
+
+    write_value(64, 1, 1);
+    advance_ms(50);
+    CHECK(read_value(132, 4) > 2048);
+    CHECK(read_value(132, 4) < 3000);
+    CHECK(read_value(128, 4) > 0);
+    CHECK(read_value(126, 2) > 0);
+    LONGS_EQUAL(885, read_value(124, 2));
+    LONGS_EQUAL(1, read_value(122, 1));
+    // 無負荷回転数(約103 rpm)を超えない
+    CHECK(read_value(128, 4) <= 103 / 0.229);
+
+    advance_ms(950);
+    CHECK(abs(read_value(132, 4) - 3000) <= 1);
+    LONGS_EQUAL(0, read_value(128, 4));
+    LONGS_EQUAL(0, read_value(122, 1));
+    LONGS_EQUAL(0x01, read_value(123, 1));
+}
+
+TEST(VIRTUAL_SERVO_DYNAMICS, ProfileLimitsVelocity)
+{
+    enable(NULL);
+    // 20 x 0.229 rpm = 約313 pulse/sec.、加速度は制限しない
+    write_value(112, 4, 20);
+    write_value(116, 4, 3000);
+    write_value(64, 1, 1);
+
+    advance_ms(500);
+    CHECK(abs(read_value(140, 4) - (2048 + 156)) <= 2);
+    LONGS_EQUAL(20, read_value(136, 4));
+    CHECK(abs(read_value(128, 4) - 20) <= 2);
+    // P制御のみのため、目標軌道から少し遅れて追従する
+    CHECK(read_value(140, 4) - read_value(132, 4) > 0);
+    CHECK(read_value(140, 4) - read_value(132, 4) <= 20);
+    // プロファイルの実行中
+    LONGS_EQUAL(0x02, read_value(123, 1));
+
+    advance_ms(3000);
+    LONGS_EQUAL(3000, read_value(140, 4));
+    CHECK(abs(read_value(132, 4) - 3000) <= 1);
+}
+
+TEST(VIRTUAL_SERVO_DYNAMICS, VelocityControl)
+{
+    enable(NULL);
+    write_value(11, 1, DYNAMIXEL_OPERATING_MODE_VELOCITY_CONTROL);
+    write_value(104, 4, -50);
+    write_value(64, 1, 1);
+
+    advance_ms(2000);
+    CHECK(abs(read_value(128, 4) + 50) <= 1);
+
+    // 1秒間に50 x 0.229 rpmで進む距離(約782 pulse)
+    int32_t position = read_value(132, 4);
+    advance_ms(1000);
+    CHECK(abs(read_value(132, 4) - position + 782) <= 10);
+}
+
+TEST(VIRTUAL_SERVO_DYNAMICS, CurrentBasedPositionLimitsCurrent)
+{
+    virtual_motor_parameter parameter;
+
+    // 保持に約560 mA必要な負荷を、100 mAで支えようとする
+    LONGS_EQUAL(0, virtual_servo_get_default_motor_parameter(VIRTUAL_SERVO_MODEL_XL330_M288, &parameter));
+    parameter.load_torque = 0.2f;
+    enable(&parameter);
+    write_value(11, 1, DYNAMIXEL_OPERATING_MODE_CURRENT_BASED_POSITION_CONTROL);
+    write_value(102, 2, 100);
+    write_value(116, 4, 2048);
+    write_value(64, 1, 1);
+
+    advance_ms(500);
+    LONGS_EQUAL(100, read_value(126, 2));
+    CHECK(read_value(132, 4) < 2048 - 100);
+
+    // 電流の制限を上げると保持できる
+    write_value(102, 2, 1000);
+    advance_ms(2000);
+    CHECK(abs(read_value(126, 2) - 565) <= 20);
+}
+
+TEST(VIRTUAL_SERVO_DYNAMICS, LoadHeatsUpAndOverheats)
+{
+    virtual_motor_parameter parameter;
+    uint8_t status_id, status_parameter[VIRTUAL_SERVO_STATUS_PARAMETER_MAX_SIZE];
+    size_t status_parameter_size;
+
+    LONGS_EQUAL(1, virtual_servo_get_default_motor_parameter((virtual_servo_model)3, &parameter));
+    LONGS_EQUAL(0, virtual_servo_get_default_motor_parameter(VIRTUAL_SERVO_MODEL_XL330_M288, &parameter));
+    parameter.load_torque = 0.3f;
+    enable(&parameter);
+    write_value(116, 4, 2048);
+    write_value(64, 1, 1);
+
+    advance_ms(60000);
+    CHECK(read_value(146, 1) > 50);
+    LONGS_EQUAL(0, read_value(70, 1));
+    LONGS_EQUAL(1, read_value(64, 1));
+
+    // Temperature Limit(70 degC)を超えるとトルクオフになり、応答パケットのエラーにAlertビットが付く
+    advance_ms(600000);
+    LONGS_EQUAL(0x04, read_value(70, 1));
+    LONGS_EQUAL(0, read_value(64, 1));
+    LONGS_EQUAL(0, virtual_servo_handle_instruction(
+        servo, 1, DYNAMIXEL__INSTRUCTION_PING, NULL, 0,
+        &status_id, status_parameter, &status_parameter_size
+    ));
+    BYTES_EQUAL(0x80, status_parameter[0]);
+
+    // 再起動でハードウェアエラーは消えるが、位置と温度は保たれる
+    int32_t position = read_value(132, 4);
+    LONGS_EQUAL(0, virtual_servo_handle_instruction(
+        servo, 1, DYNAMIXEL__INSTRUCTION_REBOOT, NULL, 0,
+        &status_id, status_parameter, &status_parameter_size
+    ));
+    LONGS_EQUAL(0, read_value(70, 1));
+    LONGS_EQUAL(position, read_value(132, 4));
+    CHECK(read_value(146, 1) >= 70);
+}
+
+TEST(VIRTUAL_SERVO_DYNAMICS, DisableKeepsLastState)
+{
+    enable(NULL);
+    write_value(116, 4, 3000);
+    write_value(64, 1, 1);
+    advance_ms(50);
+    int32_t position = read_value(132, 4);
+
+    virtual_servo_disable_dynamics(servo);
+    advance_ms(1000);
+    LONGS_EQUAL(position, read_value(132, 4));
+}
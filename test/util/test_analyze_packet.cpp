@@ -1,3 +1,4 @@
+#include <cstring>
 #include "CppUTest/TestHarness.h"
 #include "util/analyze_packet.h"
 
@@ -402,6 +403,43 @@ TEST(ANALYZE_PACKET, test_parse_uart_packet_ReturnErrorValueWhenOnlySomeDataIsAv
 }
 
 
+TEST(ANALYZE_PACKET, test_parse_uart_packet_DoesNotWriteParameterWhenChecksumIsWrong)
+{
+    // lengthが壊れて0x0010になった(本来は0x0008で、パラメータは4Byte)
+    uint8_t packet[] = {
+        0xff, 0xff, 0xfd, 0x00,
+        0x01,
+        0x10, 0x00,
+        0x55,
+        0x00,
+        0x00, 0x08, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00
+    };
+    uint8_t id, instruction, error;
+    int header_position;
+    size_t parameter_size;
+    uint8_t parameter[PARAMETER_SIZE];
+
+    memset(parameter, 0xaa, sizeof(parameter));
+    LONGS_EQUAL(1, parse_uart_packet(
+        packet, sizeof(packet),
+        &header_position, &id, &instruction, &error,
+        parameter, &parameter_size
+    ));
+    // 誤りのあるデータはパラメータに書き込まない
+    for (int i = 0; i < PARAMETER_SIZE; i++)
+        BYTES_EQUAL(0xaa, parameter[i]);
+
+    // 4Byteより短いlengthも誤りとする
+    packet[5] = 0x01;
+    LONGS_EQUAL(1, parse_uart_packet(
+        packet, sizeof(packet),
+        &header_position, &id, &instruction, &error,
+        parameter, &parameter_size
+    ));
+}
+
 TEST(ANALYZE_PACKET, CombinePositive4Bytes)
 {
     int32_t result = combine_signed_4_byte(0xff, 0x00, 0x00, 0x00);
@@ -0,0 +1,93 @@
+#include "CppUTest/TestHarness.h"
+#include "util/ring_buffer.h"
+
+
+TEST_GROUP(RING_BUFFER)
+{
+    ring_buffer_t ring_buffer;
+
+    void setup()
+    {
+        ring_buffer = ring_buffer_create(8);
+    }
+
+    void teardown()
+    {
+        ring_buffer_destroy(ring_buffer);
+    }
+};
+
+TEST(RING_BUFFER, CreateOnlyPowerOfTwo)
+{
+    POINTERS_EQUAL(NULL, ring_buffer_create(0));
+    POINTERS_EQUAL(NULL, ring_buffer_create(12));
+    CHECK(ring_buffer != NULL);
+    UNSIGNED_LONGS_EQUAL(8, ring_buffer_capacity(ring_buffer));
+    UNSIGNED_LONGS_EQUAL(0, ring_buffer_available(ring_buffer));
+}
+
+TEST(RING_BUFFER, PushUntilFull)
+{
+    for (int i = 0; i < 8; i++)
+        LONGS_EQUAL(0, ring_buffer_push(ring_buffer, i));
+    LONGS_EQUAL(1, ring_buffer_push(ring_buffer, 8));
+    UNSIGNED_LONGS_EQUAL(8, ring_buffer_available(ring_buffer));
+
+    uint8_t output[8];
+    UNSIGNED_LONGS_EQUAL(8, ring_buffer_read(ring_buffer, output, 10));
+    for (int i = 0; i < 8; i++)
+        UNSIGNED_LONGS_EQUAL(i, output[i]);
+    UNSIGNED_LONGS_EQUAL(0, ring_buffer_available(ring_buffer));
+}
+
+TEST(RING_BUFFER, PeekDoesNotConsume)
+{
+    uint8_t input[] = {0xff, 0xff, 0xfd, 0x00};
+    uint8_t output[4] = {0};
+
+    UNSIGNED_LONGS_EQUAL(4, ring_buffer_write(ring_buffer, input, 4));
+
+    UNSIGNED_LONGS_EQUAL(3, ring_buffer_peek(ring_buffer, output, 3));
+    MEMCMP_EQUAL(input, output, 3);
+    UNSIGNED_LONGS_EQUAL(4, ring_buffer_available(ring_buffer));
+
+    // 読み込めるデータサイズを超えては捨てない
+    UNSIGNED_LONGS_EQUAL(2, ring_buffer_consume(ring_buffer, 2));
+    UNSIGNED_LONGS_EQUAL(2, ring_buffer_consume(ring_buffer, 5));
+    UNSIGNED_LONGS_EQUAL(0, ring_buffer_available(ring_buffer));
+}
+
+TEST(RING_BUFFER, WriteAndReadAcrossEnd)
+{
+    uint8_t input[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a};
+    uint8_t output[8] = {0};
+
+    // 書き込み位置をバッファーの末尾近くまで進める
+    UNSIGNED_LONGS_EQUAL(6, ring_buffer_write(ring_buffer, input, 6));
+    UNSIGNED_LONGS_EQUAL(6, ring_buffer_consume(ring_buffer, 6));
+
+    // 空きを超える分は書き込まない
+    UNSIGNED_LONGS_EQUAL(8, ring_buffer_write(ring_buffer, input, 10));
+    UNSIGNED_LONGS_EQUAL(8, ring_buffer_read(ring_buffer, output, 8));
+    MEMCMP_EQUAL(input, output, 8);
+}
+
+TEST(RING_BUFFER, InterleavedPushAndRead)
+{
+    uint8_t output[3];
+    uint8_t expected = 0;
+
+    // インデックスが何周しても順番が崩れない
+    for (int i = 0; i < 100; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            LONGS_EQUAL(0, ring_buffer_push(ring_buffer, (uint8_t)(i * 3 + j)));
+
+        UNSIGNED_LONGS_EQUAL(3, ring_buffer_read(ring_buffer, output, 3));
+        for (int j = 0; j < 3; j++)
+        {
+            UNSIGNED_LONGS_EQUAL(expected, output[j]);
+            expected++;
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#include <cstdint>
+#include "CppUTest/TestHarness.h"
+#include "util/spsc_queue.h"
+
+
+/// キューに入れる要素
+typedef struct
+{
+    uint32_t sequence;
+    uint8_t data[5];
+} element;
+
+
+TEST_GROUP(SPSC_QUEUE)
+{
+    spsc_queue_t queue;
+
+    void setup()
+    {
+        queue = spsc_queue_create(4, sizeof(element));
+    }
+
+    void teardown()
+    {
+        spsc_queue_destroy(queue);
+    }
+
+    int push(uint32_t sequence)
+    {
+        element *back = (element *)spsc_queue_back(queue);
+
+        if (!back)
+            return 1;
+
+        back->sequence = sequence;
+        back->data[4] = (uint8_t)sequence;
+        return spsc_queue_push(queue);
+    }
+};
+
+TEST(SPSC_QUEUE, CreateOnlyPowerOfTwo)
+{
+    POINTERS_EQUAL(NULL, spsc_queue_create(0, sizeof(element)));
+    POINTERS_EQUAL(NULL, spsc_queue_create(6, sizeof(element)));
+    POINTERS_EQUAL(NULL, spsc_queue_create(4, 0));
+    CHECK(queue != NULL);
+    UNSIGNED_LONGS_EQUAL(4, spsc_queue_capacity(queue));
+    UNSIGNED_LONGS_EQUAL(0, spsc_queue_size(queue));
+    POINTERS_EQUAL(NULL, spsc_queue_front(queue));
+    LONGS_EQUAL(1, spsc_queue_pop(queue));
+}
+
+TEST(SPSC_QUEUE, PushUntilFull)
+{
+    for (uint32_t i = 0; i < 4; i++)
+        LONGS_EQUAL(0, push(i));
+    POINTERS_EQUAL(NULL, spsc_queue_back(queue));
+    LONGS_EQUAL(1, spsc_queue_push(queue));
+    UNSIGNED_LONGS_EQUAL(4, spsc_queue_size(queue));
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        element *front = (element *)spsc_queue_front(queue);
+        UNSIGNED_LONGS_EQUAL(i, front->sequence);
+        BYTES_EQUAL(i, front->data[4]);
+        LONGS_EQUAL(0, spsc_queue_pop(queue));
+    }
+    POINTERS_EQUAL(NULL, spsc_queue_front(queue));
+}
+
+TEST(SPSC_QUEUE, BackIsHiddenUntilPush)
+{
+    element *back = (element *)spsc_queue_back(queue);
+
+    back->sequence = 1;
+    // 書き込み途中の要素は読み込み側に見えない
+    POINTERS_EQUAL(NULL, spsc_queue_front(queue));
+    // pushするまでは同じ領域を返す
+    POINTERS_EQUAL(back, spsc_queue_back(queue));
+
+    LONGS_EQUAL(0, spsc_queue_push(queue));
+    POINTERS_EQUAL(back, spsc_queue_front(queue));
+}
+
+TEST(SPSC_QUEUE, ElementsAreAligned)
+{
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        UNSIGNED_LONGS_EQUAL(0, (uintptr_t)spsc_queue_back(queue) % 8);
+        LONGS_EQUAL(0, push(i));
+    }
+}
+
+TEST(SPSC_QUEUE, InterleavedPushAndPop)
+{
+    uint32_t expected = 0;
+
+    // インデックスが何周しても順番が崩れない
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        for (uint32_t j = 0; j < 3; j++)
+            LONGS_EQUAL(0, push(i * 3 + j));
+
+        for (uint32_t j = 0; j < 3; j++)
+        {
+            UNSIGNED_LONGS_EQUAL(expected, ((element *)spsc_queue_front(queue))->sequence);
+            LONGS_EQUAL(0, spsc_queue_pop(queue));
+            expected++;
+        }
+    }
+}